@@ -564,13 +564,45 @@ int digit_array_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
 }
 
 // result = a*a.  returns size of result.  Error if <0
+//   The cross products a[i]*a[j], i < j, are computed once and doubled
+//   with a shift, then the squares a[i]*a[i] are added in.
 int digit_array_square(int size_a, uint64_t* a, int size_result,
                      uint64_t* result) {
   int real_size_a = digit_array_real_size(size_a, a);
   if ((real_size_a + real_size_a) > size_result) {
     return -1;
   }
-  return digit_array_mult(size_a, a, size_a, a, size_result, result);
+  digit_array_zero_num(size_result, result);
+
+  int i, j;
+  uint64_t mult_carry= 0ULL;
+  uint64_t carry_out = 0ULL;
+  uint64_t lo= 0ULL;
+  uint64_t hi= 0ULL;
+
+  for (i = 0; i < real_size_a; i++) {
+    mult_carry = 0ULL;
+    for (j = i + 1; j < real_size_a; j++) {
+      u64_product_step(a[i], a[j], mult_carry, result[i+j], &result[i+j], &carry_out);
+      mult_carry= carry_out;
+    }
+    result[i + real_size_a] = mult_carry;
+  }
+
+  uint64_t top = 0ULL;
+  for (i = 0; i < 2 * real_size_a; i++) {
+    lo = result[i];
+    result[i] = (lo << 1) | top;
+    top = lo >> 63;
+  }
+
+  mult_carry = 0ULL;
+  for (i = 0; i < real_size_a; i++) {
+    u64_mult_step(a[i], a[i], &lo, &hi);
+    u64_add_with_carry_step(result[2*i], lo, mult_carry, &result[2*i], &carry_out);
+    u64_add_with_carry_step(result[2*i+1], hi, carry_out, &result[2*i+1], &mult_carry);
+  }
+  return digit_array_real_size(size_result, result);
 }
 
 // a*= x.  a must have size_a+1 positions available
@@ -613,7 +645,7 @@ bool digit_array_short_division_algorithm(int size_a, uint64_t* a, uint64_t b,
 }
 
 // estimate quotient (cf: Knuth v2)
-// *est-2<= q <= *est
+// *est-2<= q <= *est, *est <= b - 1
 // note b1>0 and (a1 a2)_b >= b1_b, b= 2^64
 void estimate_quotient(uint64_t a1, uint64_t a2, uint64_t a3, uint64_t b1,
                        uint64_t b2, uint64_t* est) {
@@ -632,7 +664,7 @@ void estimate_quotient(uint64_t a1, uint64_t a2, uint64_t a3, uint64_t b1,
     d1 = (b1 << den_shift) | (b2 >> (NBITSINUINT64 - den_shift));
   }
 
-  if (n1 > d1) {
+  if (n1 >= d1) {
     *est = (uint64_t)-1;
     return;
   }
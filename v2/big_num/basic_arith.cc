@@ -117,9 +117,394 @@ bool big_unsigned_sub(big_num& a, big_num& b, big_num& r) {
   return true;
 }
 
+// Multiplication tiers.
+//   Operands shorter than big_karatsuba_threshold digits (or
+//   big_karatsuba_square_threshold for squares) go straight to the
+//   backend schoolbook kernels, digit_array_mult and digit_array_square.
+//   Longer operands are split with Karatsuba and operands of at least
+//   big_toom3_threshold digits with Toom-3.  The thresholds are
+//   variables so they can be retuned for a new machine; the defaults
+//   are the crossovers measured against the x64 asm kernels.
+int big_karatsuba_threshold = 32;
+int big_karatsuba_square_threshold = 48;
+int big_toom3_threshold = 1024;
+
+// r = a + b, all n digits, returns carry.  r may be a or b.
+static uint64_t fixed_add(int n, uint64_t* a, uint64_t* b, uint64_t* r) {
+  uint64_t carry = 0ULL;
+  for (int i = 0; i < n; i++) {
+    uint64_t s = a[i] + carry;
+    carry = (s < carry);
+    r[i] = s + b[i];
+    carry += (r[i] < s);
+  }
+  return carry;
+}
+
+// r = a - b, all n digits, returns borrow.  r may be a or b.
+static uint64_t fixed_sub(int n, uint64_t* a, uint64_t* b, uint64_t* r) {
+  uint64_t borrow = 0ULL;
+  for (int i = 0; i < n; i++) {
+    uint64_t d = a[i] - b[i];
+    uint64_t borrow_out = (a[i] < b[i]);
+    r[i] = d - borrow;
+    borrow_out |= (d < borrow);
+    borrow = borrow_out;
+  }
+  return borrow;
+}
+
+// r[0, n) += b[0, m), m <= n.  returns carry out of r[n-1].
+static uint64_t fixed_add_to(int n, uint64_t* r, int m, uint64_t* b) {
+  uint64_t carry = fixed_add(m, r, b, r);
+  for (int i = m; carry != 0ULL && i < n; i++) {
+    r[i]++;
+    carry = (r[i] == 0ULL);
+  }
+  return carry;
+}
+
+// r[0, n) -= b[0, m), m <= n.  returns borrow out of r[n-1].
+static uint64_t fixed_sub_from(int n, uint64_t* r, int m, uint64_t* b) {
+  uint64_t borrow = fixed_sub(m, r, b, r);
+  for (int i = m; borrow != 0ULL && i < n; i++) {
+    borrow = (r[i] == 0ULL);
+    r[i]--;
+  }
+  return borrow;
+}
+
+// r = |a - b| where a has h digits, b has k >= h digits and r has k.
+//   returns true if a < b.
+static bool fixed_abs_diff(int h, uint64_t* a, int k, uint64_t* b,
+                           uint64_t* r) {
+  int i;
+  for (i = 0; i < h; i++)
+    r[i] = a[i];
+  for (; i < k; i++)
+    r[i] = 0ULL;
+  for (i = k - 1; i >= 0; i--) {
+    if (r[i] != b[i])
+      break;
+  }
+  if (i < 0 || r[i] > b[i]) {
+    fixed_sub(k, r, b, r);
+    return false;
+  }
+  fixed_sub(k, b, r, r);
+  return true;
+}
+
+// r = the n digit slice a.
+static void toom3_load(int n, uint64_t* a, big_num& r) {
+  digit_array_zero_num(r.capacity_, r.value_);
+  for (int i = 0; i < n; i++)
+    r.value_[i] = a[i];
+  r.sign_ = false;
+  r.normalize();
+}
+
+static bool toom3_product(big_num& a, big_num& b, big_num& r, bool square) {
+  int k;
+  if (square)
+    k = digit_array_fast_square(a.size_, a.value_, r.capacity_, r.value_);
+  else
+    k = digit_array_fast_mult(a.size_, a.value_, b.size_, b.value_,
+                              r.capacity_, r.value_);
+  if (k < 0)
+    return false;
+  r.size_ = k;
+  r.sign_ = square ? false : (a.sign_ != b.sign_);
+  r.normalize();
+  return true;
+}
+
+// r = a/d, d = 2 or 3, a known to be divisible by d.
+static bool toom3_exact_div(big_num& a, uint64_t d, big_num& r) {
+  bool sign = a.sign_;
+  if (d == 2ULL) {
+    if (!big_shift(a, -1, r))
+      return false;
+  } else {
+    uint64_t rem = 0ULL;
+    int size_q = r.capacity_;
+    digit_array_zero_num(r.capacity_, r.value_);
+    if (!digit_array_short_division_algorithm(a.size_, a.value_, d, &size_q,
+                                              r.value_, &rem))
+      return false;
+  }
+  r.normalize();
+  r.sign_ = sign && !r.is_zero();
+  return true;
+}
+
+// Toom-3 evaluation at 0, 1, -1, -2, infinity.  a is split into
+//   a0 + a1 X + a2 X^2.  p[0..4] receive a(0), a(1), a(-1), a(-2), a(inf).
+static bool toom3_evaluate(int n, int k, uint64_t* a, big_num** p,
+                           big_num& t1, big_num& t2) {
+  toom3_load(k, a, *p[0]);
+  toom3_load(n - 2 * k, a + 2 * k, *p[4]);
+  toom3_load(k, a + k, t2);
+  if (!big_add(*p[0], *p[4], t1))                 // a0 + a2
+    return false;
+  if (!big_add(t1, t2, *p[1]))                    // a(1)
+    return false;
+  if (!big_sub(t1, t2, *p[2]))                    // a(-1)
+    return false;
+  if (!big_add(*p[2], *p[4], t1))                 // a(-1) + a2
+    return false;
+  if (!big_shift(t1, 1, t2))
+    return false;
+  t2.sign_ = t1.sign_;
+  return big_sub(t2, *p[0], *p[3]);               // a(-2)
+}
+
+// r = a*b, a and b have n digits, r has 2n digits.
+//   Toom-3 with Bodrato's interpolation sequence.
+static bool toom3_mult(int n, uint64_t* a, uint64_t* b, uint64_t* r) {
+  bool square = (a == b);
+  int k = (n + 2) / 3;
+  int cap = k + 4;
+  int i;
+  bool ret = true;
+  big_num* pa[5];
+  big_num* pb[5];
+  big_num* w[5];
+  big_num t1(2 * cap);
+  big_num t2(2 * cap);
+  big_num t3(2 * cap);
+
+  for (i = 0; i < 5; i++) {
+    pa[i] = new big_num(cap);
+    pb[i] = new big_num(cap);
+    w[i] = new big_num(2 * cap);
+  }
+
+  if (!toom3_evaluate(n, k, a, pa, t1, t2)) {
+    ret = false;
+    goto done;
+  }
+  if (!square && !toom3_evaluate(n, k, b, pb, t1, t2)) {
+    ret = false;
+    goto done;
+  }
+  for (i = 0; i < 5; i++) {
+    if (!toom3_product(*pa[i], square ? *pa[i] : *pb[i], *w[i], square)) {
+      ret = false;
+      goto done;
+    }
+  }
+
+  // w = [r0, r(1), r(-1), r(-2), r(inf)] -> coefficients in w[1], w[2], w[3]
+  if (!big_sub(*w[3], *w[1], t1) || !toom3_exact_div(t1, 3ULL, *w[3])) {
+    ret = false;
+    goto done;
+  }
+  if (!big_sub(*w[1], *w[2], t1) || !toom3_exact_div(t1, 2ULL, *w[1])) {
+    ret = false;
+    goto done;
+  }
+  if (!big_sub(*w[2], *w[0], t1) || !w[2]->copy_from(t1)) {
+    ret = false;
+    goto done;
+  }
+  if (!big_sub(*w[2], *w[3], t1) || !toom3_exact_div(t1, 2ULL, t2) ||
+      !big_shift(*w[4], 1, t3) || !big_add(t2, t3, *w[3])) {
+    ret = false;
+    goto done;
+  }
+  if (!big_add(*w[2], *w[1], t1) || !big_sub(t1, *w[4], *w[2])) {
+    ret = false;
+    goto done;
+  }
+  if (!big_sub(*w[1], *w[3], t1) || !w[1]->copy_from(t1)) {
+    ret = false;
+    goto done;
+  }
+
+  digit_array_zero_num(2 * n, r);
+  for (i = 0; i < 5; i++) {
+    if (w[i]->is_negative()) {
+      ret = false;
+      goto done;
+    }
+    int off = i * k;
+    if (w[i]->is_zero())
+      continue;
+    if (off + w[i]->size_ > 2 * n) {
+      ret = false;
+      goto done;
+    }
+    fixed_add_to(2 * n - off, r + off, w[i]->size_, w[i]->value_);
+  }
+
+done:
+  for (i = 0; i < 5; i++) {
+    delete pa[i];
+    delete pb[i];
+    delete w[i];
+  }
+  return ret;
+}
+
+// Scratch, in digits, needed by the Karatsuba recursion on n digits.
+static int karatsuba_scratch_size(int n) {
+  return 6 * n + 256;
+}
+
+// r = a*b, a and b have n digits, r has 2n digits.
+//   Subtractive Karatsuba:
+//     a0 b1 + a1 b0 = a0 b0 + a1 b1 - (a0 - a1)(b0 - b1).
+static bool balanced_mult(int n, uint64_t* a, uint64_t* b, uint64_t* r,
+                          uint64_t* scratch) {
+  if (n < big_karatsuba_threshold || n < 4) {
+    return digit_array_mult(n, a, n, b, 2 * n, r) >= 0;
+  }
+  if (n >= big_toom3_threshold && n >= 9) {
+    return toom3_mult(n, a, b, r);
+  }
+
+  int h = n / 2;
+  int k = n - h;
+  uint64_t* da = scratch;
+  uint64_t* db = da + k;
+  uint64_t* p = db + k;
+  uint64_t* mid = p + 2 * k;
+  uint64_t* next = mid + 2 * k + 1;
+  int i;
+
+  if (!balanced_mult(h, a, b, r, next))
+    return false;
+  if (!balanced_mult(k, a + h, b + h, r + 2 * h, next))
+    return false;
+  bool neg = fixed_abs_diff(h, a, k, a + h, da) !=
+             fixed_abs_diff(h, b, k, b + h, db);
+  if (!balanced_mult(k, da, db, p, next))
+    return false;
+
+  for (i = 0; i < 2 * h; i++)
+    mid[i] = r[i];
+  for (; i <= 2 * k; i++)
+    mid[i] = 0ULL;
+  fixed_add_to(2 * k + 1, mid, 2 * k, r + 2 * h);
+  if (neg)
+    fixed_add_to(2 * k + 1, mid, 2 * k, p);
+  else
+    fixed_sub_from(2 * k + 1, mid, 2 * k, p);
+  fixed_add_to(2 * n - h, r + h, 2 * k + 1, mid);
+  return true;
+}
+
+// r = a*a, a has n digits, r has 2n digits.
+//   a0 a1 + a1 a0 = a0^2 + a1^2 - (a0 - a1)^2.
+static bool balanced_square(int n, uint64_t* a, uint64_t* r,
+                            uint64_t* scratch) {
+  if (n < big_karatsuba_square_threshold || n < 4) {
+    return digit_array_square(n, a, 2 * n, r) >= 0;
+  }
+  if (n >= big_toom3_threshold && n >= 9) {
+    return toom3_mult(n, a, a, r);
+  }
+
+  int h = n / 2;
+  int k = n - h;
+  uint64_t* da = scratch;
+  uint64_t* p = da + k;
+  uint64_t* mid = p + 2 * k;
+  uint64_t* next = mid + 2 * k + 1;
+  int i;
+
+  if (!balanced_square(h, a, r, next))
+    return false;
+  if (!balanced_square(k, a + h, r + 2 * h, next))
+    return false;
+  fixed_abs_diff(h, a, k, a + h, da);
+  if (!balanced_square(k, da, p, next))
+    return false;
+
+  for (i = 0; i < 2 * h; i++)
+    mid[i] = r[i];
+  for (; i <= 2 * k; i++)
+    mid[i] = 0ULL;
+  fixed_add_to(2 * k + 1, mid, 2 * k, r + 2 * h);
+  fixed_sub_from(2 * k + 1, mid, 2 * k, p);
+  fixed_add_to(2 * n - h, r + h, 2 * k + 1, mid);
+  return true;
+}
+
+// result = a*b.  returns size of result.  Error if < 0
+//   Dispatches to the schoolbook, Karatsuba or Toom-3 tier.  Unbalanced
+//   operands are cut into pieces the size of the shorter one.
+int digit_array_fast_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
+                   int size_result, uint64_t* result) {
+  int real_size_a = digit_array_real_size(size_a, a);
+  int real_size_b = digit_array_real_size(size_b, b);
+  if ((real_size_a + real_size_b) > size_result) {
+    return -1;
+  }
+  if (real_size_a < real_size_b) {
+    uint64_t* t = a;
+    a = b;
+    b = t;
+    int s = real_size_a;
+    real_size_a = real_size_b;
+    real_size_b = s;
+  }
+  if (real_size_b < big_karatsuba_threshold) {
+    return digit_array_mult(real_size_a, a, real_size_b, b, size_result,
+                            result);
+  }
+
+  int n = real_size_a < 2 * real_size_b ? real_size_a : real_size_b;
+  int ret = -1;
+  int off, len, i;
+  uint64_t* scratch = new uint64_t[karatsuba_scratch_size(n) + 4 * n];
+  uint64_t* pa = scratch + karatsuba_scratch_size(n);
+  uint64_t* pb = pa + n;
+  uint64_t* prod = pb + n;
+
+  for (i = 0; i < n; i++)
+    pb[i] = i < real_size_b ? b[i] : 0ULL;
+  digit_array_zero_num(size_result, result);
+  for (off = 0; off < real_size_a; off += n) {
+    len = real_size_a - off < n ? real_size_a - off : n;
+    for (i = 0; i < n; i++)
+      pa[i] = i < len ? a[off + i] : 0ULL;
+    if (!balanced_mult(n, pa, pb, prod, scratch))
+      goto done;
+    len = size_result - off < 2 * n ? size_result - off : 2 * n;
+    fixed_add_to(size_result - off, result + off, len, prod);
+  }
+  ret = digit_array_real_size(size_result, result);
+
+done:
+  delete []scratch;
+  return ret;
+}
+
+// result = a*a.  returns size of result.  Error if < 0
+int digit_array_fast_square(int size_a, uint64_t* a, int size_result,
+                   uint64_t* result) {
+  int real_size_a = digit_array_real_size(size_a, a);
+  if ((real_size_a + real_size_a) > size_result) {
+    return -1;
+  }
+  if (real_size_a < big_karatsuba_square_threshold) {
+    return digit_array_square(real_size_a, a, size_result, result);
+  }
+
+  int ret = -1;
+  uint64_t* scratch = new uint64_t[karatsuba_scratch_size(real_size_a)];
+  digit_array_zero_num(size_result, result);
+  if (balanced_square(real_size_a, a, result, scratch))
+    ret = digit_array_real_size(size_result, result);
+  delete []scratch;
+  return ret;
+}
+
 bool big_unsigned_mult(big_num& a, big_num& b, big_num& r) {
-  int k = digit_array_mult(a.size_, a.value_, b.size_, b.value_, r.capacity_,
-                         r.value_);
+  int k = digit_array_fast_mult(a.size_, a.value_, b.size_, b.value_,
+                                r.capacity_, r.value_);
   if (k < 0) {
     return false;
   }
@@ -180,10 +565,11 @@ bool big_unsigned_div(big_num& a, big_num& b, big_num& q) {
 }
 
 bool big_unsigned_square(big_num& a, big_num& r) {
-  int k = digit_array_square(a.size_, a.value_, r.capacity_, r.value_);
+  int k = digit_array_fast_square(a.size_, a.value_, r.capacity_, r.value_);
   if (k < 0)
     return false;
   r.size_ = k;
+  r.normalize();
   return true;
 }
 
@@ -280,17 +666,17 @@ bool big_sub(big_num& a, big_num& b, big_num& r) {
     }
     r.sign_ = true;
     return big_unsigned_sub(b, a, r);
-  } else {  // a<0, b<0
+  } else {  // a<0, b<0: a - b = |b| - |a|
     int cmp = digit_array_compare(b.size_, b.value_, a.size_, a.value_);
     if (cmp > 0) {
-      r.sign_ = true;
+      r.sign_ = false;
       return big_unsigned_sub(b, a, r);
     }
     if (cmp == 0) {
       r.zero_num();
       return true;
     }
-    r.sign_ = false;
+    r.sign_ = true;
     return big_unsigned_sub(a, b, r);
   }
 }
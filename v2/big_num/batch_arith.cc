@@ -0,0 +1,700 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: batch_arith.cc
+
+#include "crypto_support.h"
+#include "big_num.h"
+#include "intel_digit_arith.h"
+#include "big_num_functions.h"
+#if defined(X64)
+#include <immintrin.h>
+#endif
+
+// Batched arithmetic
+//   Many numbers with the same modulus, e.g. signature checks against one
+//   public key.  The IFMA kernel keeps eight numbers in the eight 64 bit
+//   lanes of a zmm register, one 52 bit limb per register, and uses
+//   vpmadd52luq/vpmadd52huq for the limb products.  AVX2 has no wide
+//   enough multiply to beat the scalar mulx kernels, so without IFMA each
+//   number goes through mont_context.  Exponents are treated as public.
+
+static const int limb_bits = 52;
+static const uint64_t limb_mask = (1ULL << limb_bits) - 1ULL;
+static const int batch_lanes = 8;
+
+#if defined(X64)
+bool big_batch_use_ifma = have_intel_avx512_ifma();
+#else
+bool big_batch_use_ifma = false;
+#endif
+
+big_num_batch::big_num_batch(int num, int size) {
+  num_ = num;
+  size_ = size;
+  value_ = new uint64_t[num_ * size_];
+  zero_num();
+}
+
+big_num_batch::~big_num_batch() {
+  if (value_ != nullptr) {
+    zero_num();
+    delete []value_;
+    value_ = nullptr;
+  }
+}
+
+void big_num_batch::zero_num() {
+  for (int i = 0; i < (num_ * size_); i++)
+    value_[i] = 0ULL;
+}
+
+bool big_num_batch::set(int j, big_num& a) {
+  if (j < 0 || j >= num_ || a.is_negative() || a.size_ > size_)
+    return false;
+  for (int i = 0; i < size_; i++)
+    value_[i * num_ + j] = i < a.size_ ? a.value_[i] : 0ULL;
+  return true;
+}
+
+bool big_num_batch::get(int j, big_num& a) {
+  if (j < 0 || j >= num_)
+    return false;
+  int n = size_;
+  while (n > 1 && value_[(n - 1) * num_ + j] == 0ULL)
+    n--;
+  if (n > a.capacity_)
+    return false;
+  a.zero_num();
+  for (int i = 0; i < n; i++)
+    a.value_[i] = value_[i * num_ + j];
+  a.normalize();
+  return true;
+}
+
+// limbs[k * limb_stride] for k < num_limbs from the n digits d[i * digit_stride]
+static void digits_to_limbs(int n, uint64_t* d, int digit_stride, int num_limbs,
+                            uint64_t* limbs, int limb_stride) {
+  int bit, w, off;
+  uint64_t x;
+
+  for (int k = 0; k < num_limbs; k++) {
+    bit = k * limb_bits;
+    w = bit / NBITSINUINT64;
+    off = bit % NBITSINUINT64;
+    x = 0ULL;
+    if (w < n) {
+      x = d[w * digit_stride] >> off;
+      if (off > (NBITSINUINT64 - limb_bits) && (w + 1) < n)
+        x |= d[(w + 1) * digit_stride] << (NBITSINUINT64 - off);
+    }
+    limbs[k * limb_stride] = x & limb_mask;
+  }
+}
+
+// r = a mod m, lane by lane
+static bool batch_reduce(big_num_batch& a, big_num& m, big_num_batch& r) {
+  big_num t(a.size_ > m.size_ ? a.size_ : m.size_);
+
+  if (r.num_ != a.num_ || r.size_ < m.size_)
+    return false;
+  for (int j = 0; j < a.num_; j++) {
+    if (!a.get(j, t))
+      return false;
+    if (big_compare(t, m) >= 0 && !big_mod_normalize(t, m))
+      return false;
+    if (!r.set(j, t))
+      return false;
+  }
+  return true;
+}
+
+#if defined(X64)
+static void limbs_to_digits(int num_limbs, uint64_t* limbs, int limb_stride,
+                            int n, uint64_t* d, int digit_stride) {
+  int bit, w, off;
+  uint64_t x;
+
+  for (int i = 0; i < n; i++)
+    d[i * digit_stride] = 0ULL;
+  for (int k = 0; k < num_limbs; k++) {
+    bit = k * limb_bits;
+    w = bit / NBITSINUINT64;
+    off = bit % NBITSINUINT64;
+    x = limbs[k * limb_stride];
+    if (w < n)
+      d[w * digit_stride] |= x << off;
+    if (off > (NBITSINUINT64 - limb_bits) && (w + 1) < n)
+      d[(w + 1) * digit_stride] |= x >> (NBITSINUINT64 - off);
+  }
+}
+
+// w bits of the n digits e[i * stride] starting at bit pos
+static uint64_t exp_window_bits(int n, uint64_t* e, int stride, int pos, int w) {
+  int word = pos / NBITSINUINT64;
+  int off = pos % NBITSINUINT64;
+  uint64_t x = 0ULL;
+
+  if (word < n) {
+    x = e[word * stride] >> off;
+    if ((off + w) > NBITSINUINT64 && (word + 1) < n)
+      x |= e[(word + 1) * stride] << (NBITSINUINT64 - off);
+  }
+  return x & ((1ULL << w) - 1ULL);
+}
+
+static int batch_high_bit(big_num_batch& e) {
+  int high = 0;
+  int bits;
+
+  for (int j = 0; j < e.num_; j++) {
+    for (int i = e.size_ - 1; i >= 0; i--) {
+      if (e.value_[i * e.num_ + j] != 0ULL) {
+        bits = i * NBITSINUINT64 + high_bit_in_digit(e.value_[i * e.num_ + j]);
+        if (bits > high)
+          high = bits;
+        break;
+      }
+    }
+  }
+  return high;
+}
+
+// IFMA Montgomery multiplication
+//   Word by word Montgomery reduction in radix 2^52 on eight lanes.  For
+//   n limb a, b < m and t of 2n + 1 columns:
+//     for (i = 0; i < n; i++) {
+//       t[i..] += a b[i]
+//       u = t[i] k0 (mod 2^52)
+//       t[i..] += u m
+//       t[i + 1] += t[i] >> 52
+//     }
+//   leaving ab/R in t[n..2n].  Column sums are not carried until the end;
+//   each column collects at most 4n products of 52 bits so 64 bits is
+//   enough for n < 1024.  The result is below 2m and a masked subtraction
+//   of m finishes the reduction.  r may alias a or b.
+
+// _mm512_srli_epi64 passes an undefined register as the merge source and
+// gcc 12 reports it as uninitialized; the all ones zero mask form is the
+// same vpsrlq
+__attribute__((target("avx512f")))
+static inline __m512i lane_shift_right(__m512i x, unsigned int n) {
+  return _mm512_maskz_srli_epi64((__mmask8)0xff, x, n);
+}
+
+__attribute__((target("avx512f,avx512ifma")))
+static void ifma_mont_mult(int n, __m512i* a, __m512i* b, __m512i* m,
+                           __m512i k0, __m512i* r) {
+  __m512i t[2 * n + 1];
+  __m512i zero = _mm512_setzero_si512();
+  __m512i mask = _mm512_set1_epi64((long long)limb_mask);
+  __m512i bi, u, x, carry, borrow;
+  __mmask8 keep_t;
+  int i, j;
+
+  for (j = 0; j < (2 * n + 1); j++)
+    t[j] = zero;
+  for (i = 0; i < n; i++) {
+    bi = b[i];
+    for (j = 0; j < n; j++) {
+      t[i + j] = _mm512_madd52lo_epu64(t[i + j], a[j], bi);
+      t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], a[j], bi);
+    }
+    u = _mm512_madd52lo_epu64(zero, t[i], k0);
+    for (j = 0; j < n; j++) {
+      t[i + j] = _mm512_madd52lo_epu64(t[i + j], m[j], u);
+      t[i + j + 1] = _mm512_madd52hi_epu64(t[i + j + 1], m[j], u);
+    }
+    t[i + 1] = _mm512_add_epi64(t[i + 1], lane_shift_right(t[i], limb_bits));
+  }
+
+  carry = zero;
+  for (j = n; j <= 2 * n; j++) {
+    x = _mm512_add_epi64(t[j], carry);
+    carry = lane_shift_right(x, limb_bits);
+    t[j] = _mm512_and_si512(x, mask);
+  }
+
+  // keep t if t - m borrows
+  borrow = zero;
+  for (j = 0; j < n; j++) {
+    x = _mm512_sub_epi64(_mm512_sub_epi64(t[n + j], m[j]), borrow);
+    borrow = lane_shift_right(x, NBITSINUINT64 - 1);
+    r[j] = _mm512_and_si512(x, mask);
+  }
+  keep_t = _mm512_cmplt_epu64_mask(t[2 * n], borrow);
+  for (j = 0; j < n; j++)
+    r[j] = _mm512_mask_blend_epi64(keep_t, r[j], t[n + j]);
+}
+
+// lanes [first, first + 8) of a as n limb vectors, missing lanes are zero
+__attribute__((target("avx512f")))
+static void ifma_load(big_num_batch& a, int first, int n, __m512i* x) {
+  uint64_t buf[n * batch_lanes];
+
+  for (int l = 0; l < batch_lanes; l++) {
+    if ((first + l) < a.num_) {
+      digits_to_limbs(a.size_, &a.value_[first + l], a.num_, n, &buf[l],
+                      batch_lanes);
+    } else {
+      for (int k = 0; k < n; k++)
+        buf[k * batch_lanes + l] = 0ULL;
+    }
+  }
+  for (int k = 0; k < n; k++)
+    x[k] = _mm512_loadu_si512((void*)&buf[k * batch_lanes]);
+}
+
+__attribute__((target("avx512f")))
+static void ifma_store(int n, __m512i* x, int first, big_num_batch& a) {
+  uint64_t buf[n * batch_lanes];
+
+  for (int k = 0; k < n; k++)
+    _mm512_storeu_si512((void*)&buf[k * batch_lanes], x[k]);
+  for (int l = 0; l < batch_lanes && (first + l) < a.num_; l++)
+    limbs_to_digits(n, &buf[l], batch_lanes, a.size_, &a.value_[first + l],
+                    a.num_);
+}
+
+__attribute__((target("avx512f")))
+static void ifma_broadcast(int n, uint64_t* limbs, __m512i* x) {
+  for (int k = 0; k < n; k++)
+    x[k] = _mm512_set1_epi64((long long)limbs[k]);
+}
+
+// r = a b R^(-1), or a c R^(-1) when c is not null
+__attribute__((target("avx512f,avx512ifma")))
+static void ifma_batch_mult(batch_mont_context& ctx, big_num_batch& a,
+                            big_num_batch* b, uint64_t* c, big_num_batch& r) {
+  int n = ctx.num_limbs_;
+  __m512i m[n];
+  __m512i x[n];
+  __m512i y[n];
+  __m512i k0 = _mm512_set1_epi64((long long)ctx.k0_);
+
+  ifma_broadcast(n, ctx.m_limbs_, m);
+  if (c != nullptr)
+    ifma_broadcast(n, c, y);
+  for (int first = 0; first < a.num_; first += batch_lanes) {
+    ifma_load(a, first, n, x);
+    if (c == nullptr)
+      ifma_load(*b, first, n, y);
+    ifma_mont_mult(n, x, y, m, k0, x);
+    ifma_store(n, x, first, r);
+  }
+}
+
+// r = a b, a and b reduced
+__attribute__((target("avx512f,avx512ifma")))
+static void ifma_batch_mod_mult(batch_mont_context& ctx, big_num_batch& a,
+                                big_num_batch& b, big_num_batch& r) {
+  int n = ctx.num_limbs_;
+  __m512i m[n];
+  __m512i r2[n];
+  __m512i x[n];
+  __m512i y[n];
+  __m512i k0 = _mm512_set1_epi64((long long)ctx.k0_);
+
+  ifma_broadcast(n, ctx.m_limbs_, m);
+  ifma_broadcast(n, ctx.r_squared_limbs_, r2);
+  for (int first = 0; first < a.num_; first += batch_lanes) {
+    ifma_load(a, first, n, x);
+    ifma_load(b, first, n, y);
+    ifma_mont_mult(n, x, r2, m, k0, x);
+    ifma_mont_mult(n, x, y, m, k0, x);
+    ifma_store(n, x, first, r);
+  }
+}
+
+// out = b^e, b reduced.  With e_batch each lane has its own exponent and the
+// table entry for each lane's window is picked with masks; otherwise the
+// window is the same for every lane and zero windows are skipped.
+__attribute__((target("avx512f,avx512ifma")))
+static bool ifma_batch_exp(batch_mont_context& ctx, big_num_batch& b,
+                           big_num* e, big_num_batch* e_batch,
+                           big_num_batch& out) {
+  int n = ctx.num_limbs_;
+  int bits = e_batch != nullptr ? batch_high_bit(*e_batch) : big_high_bit(*e);
+  int w = big_exp_window_size(bits);
+  if (w > 5)
+    w = 5;
+  int table_size = 1 << w;
+  int num_windows = (bits + w - 1) / w;
+  __m512i m[n];
+  __m512i r2[n];
+  __m512i one[n];
+  __m512i acc[n];
+  __m512i sel[n];
+  __m512i k0 = _mm512_set1_epi64((long long)ctx.k0_);
+  __m512i* table = (__m512i*)_mm_malloc(table_size * n * sizeof(__m512i),
+                                        sizeof(__m512i));
+  uint64_t lane_digits[batch_lanes];
+  __m512i digits;
+  __mmask8 pick;
+  uint64_t d;
+  int first, i, j, k, l;
+
+  if (table == nullptr)
+    return false;
+  ifma_broadcast(n, ctx.m_limbs_, m);
+  ifma_broadcast(n, ctx.r_squared_limbs_, r2);
+  ifma_broadcast(n, ctx.one_limbs_, one);
+  for (first = 0; first < b.num_; first += batch_lanes) {
+    // table[i] = b^i R
+    for (k = 0; k < n; k++)
+      table[k] = one[k];
+    ifma_load(b, first, n, &table[n]);
+    ifma_mont_mult(n, &table[n], r2, m, k0, &table[n]);
+    for (i = 2; i < table_size; i++)
+      ifma_mont_mult(n, &table[(i - 1) * n], &table[n], m, k0, &table[i * n]);
+
+    for (k = 0; k < n; k++)
+      acc[k] = one[k];
+    for (i = num_windows - 1; i >= 0; i--) {
+      if (i != (num_windows - 1)) {
+        for (j = 0; j < w; j++)
+          ifma_mont_mult(n, acc, acc, m, k0, acc);
+      }
+      if (e_batch == nullptr) {
+        d = exp_window_bits(e->size_, e->value_, 1, i * w, w);
+        if (d != 0ULL)
+          ifma_mont_mult(n, acc, &table[d * n], m, k0, acc);
+        continue;
+      }
+      for (l = 0; l < batch_lanes; l++) {
+        lane_digits[l] = 0ULL;
+        if ((first + l) < e_batch->num_)
+          lane_digits[l] = exp_window_bits(e_batch->size_,
+                                           &e_batch->value_[first + l],
+                                           e_batch->num_, i * w, w);
+      }
+      digits = _mm512_loadu_si512((void*)lane_digits);
+      for (k = 0; k < n; k++)
+        sel[k] = table[k];
+      for (j = 1; j < table_size; j++) {
+        pick = _mm512_cmpeq_epi64_mask(digits, _mm512_set1_epi64(j));
+        for (k = 0; k < n; k++)
+          sel[k] = _mm512_mask_blend_epi64(pick, sel[k], table[j * n + k]);
+      }
+      ifma_mont_mult(n, acc, sel, m, k0, acc);
+    }
+
+    // out of Montgomery form
+    for (k = 0; k < n; k++)
+      sel[k] = _mm512_setzero_si512();
+    sel[0] = _mm512_set1_epi64(1);
+    ifma_mont_mult(n, acc, sel, m, k0, acc);
+    ifma_store(n, acc, first, out);
+  }
+
+  for (i = 0; i < (table_size * n); i++)
+    table[i] = _mm512_setzero_si512();
+  _mm_free(table);
+  return true;
+}
+#endif
+
+batch_mont_context::batch_mont_context() {
+  initialized_ = false;
+  use_ifma_ = false;
+  num_digits_ = 0;
+  num_limbs_ = 0;
+  k0_ = 0ULL;
+  m_limbs_ = nullptr;
+  one_limbs_ = nullptr;
+  r_squared_limbs_ = nullptr;
+}
+
+batch_mont_context::~batch_mont_context() {
+  clear();
+}
+
+void batch_mont_context::clear() {
+  if (m_limbs_ != nullptr) {
+    delete []m_limbs_;
+    m_limbs_ = nullptr;
+  }
+  if (one_limbs_ != nullptr) {
+    delete []one_limbs_;
+    one_limbs_ = nullptr;
+  }
+  if (r_squared_limbs_ != nullptr) {
+    delete []r_squared_limbs_;
+    r_squared_limbs_ = nullptr;
+  }
+  ctx_.clear();
+  initialized_ = false;
+  use_ifma_ = false;
+  num_digits_ = 0;
+  num_limbs_ = 0;
+  k0_ = 0ULL;
+}
+
+bool batch_mont_context::init(big_num& m) {
+  clear();
+  if (!ctx_.init(m))
+    return false;
+  num_digits_ = ctx_.num_digits_;
+  use_ifma_ = big_batch_use_ifma;
+  if (!use_ifma_) {
+    initialized_ = true;
+    return true;
+  }
+
+  int n = (big_high_bit(m) + limb_bits - 1) / limb_bits;
+  big_num t(2 * num_digits_ + 4);
+  big_num q(2 * num_digits_ + 4);
+  big_num rem(2 * num_digits_ + 4);
+  uint64_t inv = m.value_[0];
+
+  num_limbs_ = n;
+  m_limbs_ = new uint64_t[n];
+  one_limbs_ = new uint64_t[n];
+  r_squared_limbs_ = new uint64_t[n];
+  digits_to_limbs(m.size_, m.value_, 1, n, m_limbs_, 1);
+
+  // 1/m (mod 2^64), Newton
+  for (int i = 0; i < 5; i++)
+    inv *= 2ULL - m.value_[0] * inv;
+  k0_ = (0ULL - inv) & limb_mask;
+
+  // R = 2^(52 n)
+  if (!big_shift(big_one, limb_bits * n, t) ||
+      !big_unsigned_euclid(t, m, q, rem))
+    goto fail;
+  digits_to_limbs(rem.size_, rem.value_, 1, n, one_limbs_, 1);
+  t.zero_num();
+  if (!big_shift(big_one, 2 * limb_bits * n, t) ||
+      !big_unsigned_euclid(t, m, q, rem))
+    goto fail;
+  digits_to_limbs(rem.size_, rem.value_, 1, n, r_squared_limbs_, 1);
+
+  initialized_ = true;
+  return true;
+
+fail:
+  clear();
+  return false;
+}
+
+// mont_a = a R (mod m)
+bool batch_mont_context::to_mont(big_num_batch& a, big_num_batch& mont_a) {
+  if (!initialized_ || mont_a.num_ != a.num_ || mont_a.size_ < num_digits_)
+    return false;
+  big_num_batch x(a.num_, num_digits_);
+  if (!batch_reduce(a, *ctx_.m_, x))
+    return false;
+
+#if defined(X64)
+  if (use_ifma_) {
+    ifma_batch_mult(*this, x, nullptr, r_squared_limbs_, mont_a);
+    return true;
+  }
+#endif
+  big_num t(num_digits_);
+  big_num r(num_digits_);
+  for (int j = 0; j < a.num_; j++) {
+    if (!x.get(j, t) || !ctx_.to_mont(t, r) || !mont_a.set(j, r))
+      return false;
+  }
+  return true;
+}
+
+// a = mont_a R^(-1) (mod m)
+bool batch_mont_context::from_mont(big_num_batch& mont_a, big_num_batch& a) {
+  if (!initialized_ || mont_a.num_ != a.num_ || a.size_ < num_digits_)
+    return false;
+
+#if defined(X64)
+  if (use_ifma_) {
+    uint64_t one[num_limbs_];
+    for (int k = 0; k < num_limbs_; k++)
+      one[k] = 0ULL;
+    one[0] = 1ULL;
+    ifma_batch_mult(*this, mont_a, nullptr, one, a);
+    return true;
+  }
+#endif
+  big_num t(mont_a.size_);
+  big_num r(num_digits_);
+  for (int j = 0; j < a.num_; j++) {
+    if (!mont_a.get(j, t) || !ctx_.from_mont(t, r) || !a.set(j, r))
+      return false;
+  }
+  return true;
+}
+
+// abR = aR bR R^(-1) (mod m), aR and bR in [0, m)
+bool batch_mont_context::mult(big_num_batch& aR, big_num_batch& bR,
+                              big_num_batch& abR) {
+  if (!initialized_ || aR.num_ != bR.num_ || abR.num_ != aR.num_ ||
+      abR.size_ < num_digits_)
+    return false;
+
+#if defined(X64)
+  if (use_ifma_) {
+    ifma_batch_mult(*this, aR, &bR, nullptr, abR);
+    return true;
+  }
+#endif
+  big_num x(aR.size_);
+  big_num y(bR.size_);
+  big_num r(num_digits_);
+  for (int j = 0; j < aR.num_; j++) {
+    if (!aR.get(j, x) || !bR.get(j, y) || !ctx_.mult(x, y, r) ||
+        !abR.set(j, r))
+      return false;
+  }
+  return true;
+}
+
+// r = a b (mod m)
+bool batch_mont_context::mod_mult(big_num_batch& a, big_num_batch& b,
+                                  big_num_batch& r) {
+  if (!initialized_ || a.num_ != b.num_ || r.num_ != a.num_ ||
+      r.size_ < num_digits_)
+    return false;
+  big_num_batch x(a.num_, num_digits_);
+  big_num_batch y(b.num_, num_digits_);
+  if (!batch_reduce(a, *ctx_.m_, x) || !batch_reduce(b, *ctx_.m_, y))
+    return false;
+
+#if defined(X64)
+  if (use_ifma_) {
+    ifma_batch_mod_mult(*this, x, y, r);
+    return true;
+  }
+#endif
+  big_num s(num_digits_);
+  big_num t(num_digits_);
+  big_num u(num_digits_);
+  for (int j = 0; j < a.num_; j++) {
+    if (!x.get(j, s) || !y.get(j, t) || !ctx_.to_mont(s, u) ||
+        !ctx_.mult(u, t, s) || !r.set(j, s))
+      return false;
+  }
+  return true;
+}
+
+// out = b^e (mod m), the same e for every number
+bool batch_mont_context::exp(big_num_batch& b, big_num& e, big_num_batch& out) {
+  if (!initialized_ || out.num_ != b.num_ || out.size_ < num_digits_)
+    return false;
+  big_num_batch x(b.num_, num_digits_);
+  if (!batch_reduce(b, *ctx_.m_, x))
+    return false;
+
+#if defined(X64)
+  if (use_ifma_)
+    return ifma_batch_exp(*this, x, &e, nullptr, out);
+#endif
+  big_num s(num_digits_);
+  big_num t(num_digits_);
+  for (int j = 0; j < b.num_; j++) {
+    if (!x.get(j, s) || !big_mont_window_exp(ctx_, s, e, t) || !out.set(j, t))
+      return false;
+  }
+  return true;
+}
+
+// out[j] = b[j]^e[j] (mod m)
+bool batch_mont_context::exp(big_num_batch& b, big_num_batch& e,
+                             big_num_batch& out) {
+  if (!initialized_ || e.num_ != b.num_ || out.num_ != b.num_ ||
+      out.size_ < num_digits_)
+    return false;
+  big_num_batch x(b.num_, num_digits_);
+  if (!batch_reduce(b, *ctx_.m_, x))
+    return false;
+
+#if defined(X64)
+  if (use_ifma_)
+    return ifma_batch_exp(*this, x, nullptr, &e, out);
+#endif
+  big_num s(num_digits_);
+  big_num t(num_digits_);
+  big_num f(e.size_);
+  for (int j = 0; j < b.num_; j++) {
+    if (!x.get(j, s) || !e.get(j, f) || !big_mont_window_exp(ctx_, s, f, t) ||
+        !out.set(j, t))
+      return false;
+  }
+  return true;
+}
+
+bool big_batch_mont_mult(batch_mont_context& ctx, big_num_batch& aR,
+                         big_num_batch& bR, big_num_batch& abR) {
+  return ctx.mult(aR, bR, abR);
+}
+
+// Montgomery needs an odd modulus; even ones go number by number
+bool big_batch_mod_mult(big_num_batch& a, big_num_batch& b, big_num& m,
+                        big_num_batch& r) {
+  if ((m.value_[0] & 1ULL) != 0ULL) {
+    batch_mont_context ctx;
+    if (ctx.init(m))
+      return ctx.mod_mult(a, b, r);
+  }
+  if (a.num_ != b.num_ || r.num_ != a.num_)
+    return false;
+  int n = a.size_ > b.size_ ? a.size_ : b.size_;
+  if (m.size_ > n)
+    n = m.size_;
+  big_num x(a.size_);
+  big_num y(b.size_);
+  big_num z(2 * n + 1);
+  for (int j = 0; j < a.num_; j++) {
+    if (!a.get(j, x) || !b.get(j, y) || !big_mod_mult(x, y, m, z) ||
+        !r.set(j, z))
+      return false;
+  }
+  return true;
+}
+
+bool big_batch_mod_exp(big_num_batch& b, big_num& e, big_num& m,
+                       big_num_batch& out) {
+  if ((m.value_[0] & 1ULL) != 0ULL) {
+    batch_mont_context ctx;
+    if (ctx.init(m))
+      return ctx.exp(b, e, out);
+  }
+  if (out.num_ != b.num_)
+    return false;
+  big_num x(b.size_);
+  int n = b.size_ > m.size_ ? b.size_ : m.size_;
+  big_num z(2 * n + 1);
+  for (int j = 0; j < b.num_; j++) {
+    if (!b.get(j, x) || !big_mod_exp(x, e, m, z) || !out.set(j, z))
+      return false;
+  }
+  return true;
+}
+
+bool big_batch_mod_exp(big_num_batch& b, big_num_batch& e, big_num& m,
+                       big_num_batch& out) {
+  if ((m.value_[0] & 1ULL) != 0ULL) {
+    batch_mont_context ctx;
+    if (ctx.init(m))
+      return ctx.exp(b, e, out);
+  }
+  if (e.num_ != b.num_ || out.num_ != b.num_)
+    return false;
+  big_num x(b.size_);
+  big_num f(e.size_);
+  int n = b.size_ > m.size_ ? b.size_ : m.size_;
+  big_num z(2 * n + 1);
+  for (int j = 0; j < b.num_; j++) {
+    if (!b.get(j, x) || !e.get(j, f) || !big_mod_exp(x, f, m, z) ||
+        !out.set(j, z))
+      return false;
+  }
+  return true;
+}
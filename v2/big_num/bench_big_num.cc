@@ -0,0 +1,334 @@
+// Copyright 2020 John Manferdelli, All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: bench_big_num.cc
+
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <vector>
+#include "crypto_support.h"
+#include "support.pb.h"
+#include "crypto_names.h"
+#include "big_num.h"
+#include "intel_digit_arith.h"
+#include "big_num_functions.h"
+
+// Micro-benchmarks for the big_num layer.
+//   Each (operation, size) cell is timed with read_rdtsc.  Cheap
+//   operations are repeated inside a sample so a sample is long enough
+//   to swamp the counter overhead; the reported figures are per
+//   operation.  Results go to stdout as csv or json so runs on
+//   different kernels or machines can be diffed.
+
+DEFINE_string(format, "csv", "Output format: csv or json");
+DEFINE_string(ops, "add,sub,mult,square,div,mod_exp,mont_exp,extended_gcd,gen_prime",
+              "Comma separated operations to time");
+DEFINE_int32(min_bits, 256, "Smallest operand size in bits");
+DEFINE_int32(max_bits, 8192, "Largest operand size in bits");
+DEFINE_int32(max_prime_bits, 2048, "Largest size for gen_prime");
+DEFINE_int32(samples, 101, "Samples per operation and size");
+DEFINE_int32(min_samples, 5, "Samples taken even if the time budget is spent");
+DEFINE_int32(budget_ms, 3000, "Time budget per operation and size");
+
+const uint64_t min_sample_cycles = 20000ULL;
+
+uint64_t cycles_per_second = 0ULL;
+
+class bench_operands {
+ public:
+  int bits_;
+  int n_;
+  big_num* a_;
+  big_num* b_;
+  big_num* m_;      // odd, exactly bits_ bits
+  big_num* m_prime_;
+  big_num* wide_;   // 2 * bits_ bits, dividend for div
+  big_num* r_;
+  big_num* q_;
+
+  bench_operands(int bits);
+  ~bench_operands();
+  bool init();
+};
+
+bench_operands::bench_operands(int bits) {
+  bits_ = bits;
+  n_ = (bits + NBITSINUINT64 - 1) / NBITSINUINT64;
+  a_ = new big_num(4 * n_ + 1);
+  b_ = new big_num(4 * n_ + 1);
+  m_ = new big_num(4 * n_ + 1);
+  m_prime_ = new big_num(4 * n_ + 1);
+  wide_ = new big_num(4 * n_ + 1);
+  r_ = new big_num(4 * n_ + 1);
+  q_ = new big_num(4 * n_ + 1);
+}
+
+bench_operands::~bench_operands() {
+  delete a_;
+  delete b_;
+  delete m_;
+  delete m_prime_;
+  delete wide_;
+  delete r_;
+  delete q_;
+}
+
+static bool random_big_num(int n, big_num& a) {
+  a.zero_num();
+  if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)a.value_) < 0)
+    return false;
+  a.value_[n - 1] |= 1ULL << (NBITSINUINT64 - 1);
+  a.normalize();
+  return true;
+}
+
+bool bench_operands::init() {
+  if (!random_big_num(n_, *a_) || !random_big_num(n_, *b_) ||
+      !random_big_num(n_, *m_) || !random_big_num(2 * n_, *wide_))
+    return false;
+  m_->value_[0] |= 1ULL;
+
+  // a, b < m so they are valid residues
+  if (big_compare(*a_, *m_) >= 0)
+    a_->value_[n_ - 1] &= ~(1ULL << (NBITSINUINT64 - 1));
+  if (big_compare(*b_, *m_) >= 0)
+    b_->value_[n_ - 1] &= ~(1ULL << (NBITSINUINT64 - 1));
+  a_->normalize();
+  b_->normalize();
+  return big_mont_params(*m_, n_ * NBITSINUINT64, *m_prime_);
+}
+
+// One call of op at operands o.
+typedef bool (*bench_op)(bench_operands& o);
+
+bool op_add(bench_operands& o) {
+  o.r_->zero_num();
+  return big_add(*o.a_, *o.b_, *o.r_);
+}
+
+bool op_sub(bench_operands& o) {
+  o.r_->zero_num();
+  return big_sub(*o.a_, *o.b_, *o.r_);
+}
+
+bool op_mult(bench_operands& o) {
+  o.r_->zero_num();
+  return big_mult(*o.a_, *o.b_, *o.r_);
+}
+
+bool op_square(bench_operands& o) {
+  o.r_->zero_num();
+  return big_square(*o.a_, *o.r_);
+}
+
+bool op_div(bench_operands& o) {
+  o.q_->zero_num();
+  o.r_->zero_num();
+  return big_unsigned_euclid(*o.wide_, *o.m_, *o.q_, *o.r_);
+}
+
+bool op_mod_exp(bench_operands& o) {
+  o.r_->zero_num();
+  return big_mod_exp(*o.a_, *o.b_, *o.m_, *o.r_);
+}
+
+bool op_mont_exp(bench_operands& o) {
+  o.r_->zero_num();
+  return big_mont_exp(*o.a_, *o.b_, o.n_ * NBITSINUINT64, *o.m_, *o.m_prime_,
+                      *o.r_);
+}
+
+bool op_extended_gcd(bench_operands& o) {
+  big_num x(2 * o.n_ + 1);
+  big_num y(2 * o.n_ + 1);
+  o.r_->zero_num();
+  return big_extended_gcd(*o.a_, *o.m_, x, y, *o.r_);
+}
+
+bool op_gen_prime(bench_operands& o) {
+  o.r_->zero_num();
+  return big_gen_prime(*o.r_, o.bits_);
+}
+
+struct bench_entry {
+  const char* name_;
+  bench_op op_;
+  bool expensive_;
+};
+
+bench_entry bench_table[] = {
+  {"add", op_add, false},
+  {"sub", op_sub, false},
+  {"mult", op_mult, false},
+  {"square", op_square, false},
+  {"div", op_div, false},
+  {"mod_exp", op_mod_exp, true},
+  {"mont_exp", op_mont_exp, true},
+  {"extended_gcd", op_extended_gcd, false},
+  {"gen_prime", op_gen_prime, true},
+};
+const int num_bench_entries = sizeof(bench_table) / sizeof(bench_entry);
+
+class bench_result {
+ public:
+  const char* name_;
+  int bits_;
+  int samples_;
+  int reps_;
+  double median_;
+  double p99_;
+  double mean_;
+  double min_;
+};
+
+// Cycles per op in each sample, sorted.
+static bool time_op(bench_entry& e, bench_operands& o, bench_result* res) {
+  uint64_t t0 = read_rdtsc();
+  if (!e.op_(o))
+    return false;
+  uint64_t one = read_rdtsc() - t0;
+
+  int reps = 1;
+  if (!e.expensive_ && one < min_sample_cycles)
+    reps = (int)(min_sample_cycles / (one + 1)) + 1;
+  uint64_t budget = (cycles_per_second / 1000ULL) * (uint64_t)FLAGS_budget_ms;
+
+  std::vector<double> per_op;
+  uint64_t spent = 0ULL;
+  for (int i = 0; i < FLAGS_samples; i++) {
+    if (i >= FLAGS_min_samples && spent > budget)
+      break;
+    t0 = read_rdtsc();
+    for (int j = 0; j < reps; j++) {
+      if (!e.op_(o))
+        return false;
+    }
+    uint64_t t = read_rdtsc() - t0;
+    spent += t;
+    per_op.push_back((double)t / (double)reps);
+  }
+  std::sort(per_op.begin(), per_op.end());
+
+  int k = (int)per_op.size();
+  double sum = 0.0;
+  for (int i = 0; i < k; i++)
+    sum += per_op[i];
+  res->name_ = e.name_;
+  res->bits_ = o.bits_;
+  res->samples_ = k;
+  res->reps_ = reps;
+  res->median_ = per_op[k / 2];
+  res->p99_ = per_op[(99 * (k - 1)) / 100];
+  res->mean_ = sum / (double)k;
+  res->min_ = per_op[0];
+  return true;
+}
+
+static bool op_selected(const char* name) {
+  string list = "," + FLAGS_ops + ",";
+  string key = string(",") + name + ",";
+  return list.find(key) != string::npos;
+}
+
+static const char* backend_name() {
+#if defined(X64)
+  return digit_array_use_mulx ? "x64-mulx" : "x64";
+#elif defined(ARM64)
+  return "arm64";
+#else
+  return "generic";
+#endif
+}
+
+static double cycles_to_ns(double c) {
+  return 1.0e9 * c / (double)cycles_per_second;
+}
+
+void print_header() {
+  if (FLAGS_format == "json") {
+    printf("{\n  \"backend\": \"%s\",\n  \"cycles_per_second\": %llu,\n",
+           backend_name(), (unsigned long long)cycles_per_second);
+    printf("  \"results\": [");
+  } else {
+    printf("backend,op,bits,samples,reps,median_cycles,p99_cycles,mean_cycles,"
+           "min_cycles,median_ns\n");
+  }
+}
+
+void print_result(bench_result& r, bool first) {
+  if (FLAGS_format == "json") {
+    printf("%s\n    {\"op\": \"%s\", \"bits\": %d, \"samples\": %d, \"reps\": %d, "
+           "\"median_cycles\": %.1f, \"p99_cycles\": %.1f, \"mean_cycles\": %.1f, "
+           "\"min_cycles\": %.1f, \"median_ns\": %.1f}",
+           first ? "" : ",", r.name_, r.bits_, r.samples_, r.reps_, r.median_,
+           r.p99_, r.mean_, r.min_, cycles_to_ns(r.median_));
+  } else {
+    printf("%s,%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f\n", backend_name(),
+           r.name_, r.bits_, r.samples_, r.reps_, r.median_, r.p99_, r.mean_,
+           r.min_, cycles_to_ns(r.median_));
+  }
+  fflush(stdout);
+}
+
+void print_trailer() {
+  if (FLAGS_format == "json")
+    printf("\n  ]\n}\n");
+}
+
+int main(int an, char** av) {
+  gflags::ParseCommandLineFlags(&an, &av, true);
+
+  if (FLAGS_format != "csv" && FLAGS_format != "json") {
+    fprintf(stderr, "Unknown format %s\n", FLAGS_format.c_str());
+    return 1;
+  }
+  if (!init_crypto()) {
+    fprintf(stderr, "Can't init_crypto\n");
+    return 1;
+  }
+  cycles_per_second = calibrate_rdtsc();
+  if (cycles_per_second == 0ULL) {
+    fprintf(stderr, "No cycle counter on this machine\n");
+    close_crypto();
+    return 1;
+  }
+
+  int ret = 0;
+  bool first = true;
+  print_header();
+  for (int bits = FLAGS_min_bits; bits <= FLAGS_max_bits; bits *= 2) {
+    bench_operands o(bits);
+    if (!o.init()) {
+      fprintf(stderr, "Can't make %d bit operands\n", bits);
+      ret = 1;
+      break;
+    }
+    for (int i = 0; i < num_bench_entries; i++) {
+      if (!op_selected(bench_table[i].name_))
+        continue;
+      if (bench_table[i].op_ == op_gen_prime && bits > FLAGS_max_prime_bits)
+        continue;
+      bench_result r;
+      if (!time_op(bench_table[i], o, &r)) {
+        fprintf(stderr, "%s failed at %d bits\n", bench_table[i].name_, bits);
+        ret = 1;
+        continue;
+      }
+      print_result(r, first);
+      first = false;
+    }
+  }
+  print_trailer();
+
+  close_crypto();
+  return ret;
+}
@@ -23,17 +23,158 @@
 //  __declspec(align(4)) uint32_t  size_;
 //  __declspec(align(8)) uint64_t* value_;
 
-big_num::big_num(int size) {
-  value_ = new uint64_t[size];
+big_num_arena::big_num_arena(int block_digits) {
+  block_digits_ = block_digits;
+  num_blocks_ = 0;
+  max_blocks_ = 0;
+  current_ = 0;
+  used_ = 0;
+  block_size_ = nullptr;
+  blocks_ = nullptr;
+}
+
+big_num_arena::~big_num_arena() {
+  release();
+  for (int i = 0; i < num_blocks_; i++)
+    delete []blocks_[i];
+  delete []blocks_;
+  delete []block_size_;
+}
+
+uint64_t* big_num_arena::alloc(int n) {
+  if (num_blocks_ > 0 && (block_size_[current_] - used_) >= n) {
+    uint64_t* p = &blocks_[current_][used_];
+    used_ += n;
+    return p;
+  }
+
+  // move to the next block, inserting a new one if it is too small
+  int next = num_blocks_ > 0 ? current_ + 1 : 0;
+  if (next >= num_blocks_ || block_size_[next] < n) {
+    if (num_blocks_ >= max_blocks_) {
+      int new_max = max_blocks_ == 0 ? 8 : 2 * max_blocks_;
+      uint64_t** new_blocks = new uint64_t*[new_max];
+      int* new_size = new int[new_max];
+      for (int i = 0; i < num_blocks_; i++) {
+        new_blocks[i] = blocks_[i];
+        new_size[i] = block_size_[i];
+      }
+      delete []blocks_;
+      delete []block_size_;
+      blocks_ = new_blocks;
+      block_size_ = new_size;
+      max_blocks_ = new_max;
+    }
+    for (int i = num_blocks_; i > next; i--) {
+      blocks_[i] = blocks_[i - 1];
+      block_size_[i] = block_size_[i - 1];
+    }
+    block_size_[next] = n > block_digits_ ? n : block_digits_;
+    blocks_[next] = new uint64_t[block_size_[next]];
+    num_blocks_++;
+  }
+  current_ = next;
+  used_ = n;
+  return blocks_[current_];
+}
+
+big_num_arena::mark big_num_arena::get_mark() {
+  mark m;
+  m.block_ = current_;
+  m.used_ = used_;
+  return m;
+}
+
+void big_num_arena::rewind(mark& m) {
+  if (num_blocks_ == 0)
+    return;
+  for (int i = current_; i > m.block_; i--) {
+    digit_array_zero_num(block_size_[i], blocks_[i]);
+  }
+  if (current_ > m.block_)
+    used_ = block_size_[m.block_];
+  if (used_ > m.used_)
+    digit_array_zero_num(used_ - m.used_, &blocks_[m.block_][m.used_]);
+  current_ = m.block_;
+  used_ = m.used_;
+}
+
+void big_num_arena::release() {
+  mark m;
+  m.block_ = 0;
+  m.used_ = 0;
+  rewind(m);
+}
+
+static thread_local big_num_arena* installed_arena = nullptr;
+
+big_num_arena* big_num_arena::thread_pool() {
+  static thread_local big_num_arena pool;
+  return &pool;
+}
+
+big_num_arena* big_num_arena::thread_arena() {
+  return installed_arena;
+}
+
+big_num_arena* big_num_arena::set_thread_arena(big_num_arena* arena) {
+  big_num_arena* previous = installed_arena;
+  installed_arena = arena;
+  return previous;
+}
+
+big_num_arena_scope::big_num_arena_scope() {
+  arena_ = big_num_arena::thread_pool();
+  mark_ = arena_->get_mark();
+  previous_ = big_num_arena::set_thread_arena(arena_);
+}
+
+big_num_arena_scope::big_num_arena_scope(big_num_arena* arena) {
+  arena_ = arena;
+  mark_ = arena_->get_mark();
+  previous_ = big_num_arena::set_thread_arena(arena_);
+}
+
+big_num_arena_scope::~big_num_arena_scope() {
+  big_num_arena::set_thread_arena(previous_);
+  arena_->rewind(mark_);
+}
+
+// Small values live in inline_, larger ones come from the arena if
+//   there is one and from the heap otherwise.
+void big_num::allocate(int size, big_num_arena* arena) {
   capacity_ = size;
+  arena_ = nullptr;
+  if (size <= BIG_NUM_INLINE_DIGITS) {
+    value_ = inline_;
+    return;
+  }
+  if (arena == nullptr)
+    arena = big_num_arena::thread_arena();
+  if (arena != nullptr) {
+    value_ = arena->alloc(size);
+    arena_ = arena;
+    return;
+  }
+  value_ = new uint64_t[size];
+}
+
+big_num::big_num(int size) {
+  allocate(size, nullptr);
+  digit_array_zero_num(capacity_, value_);
+  size_ = 1;
+  sign_ = false;
+}
+
+big_num::big_num(big_num_arena* arena, int size) {
+  allocate(size, arena);
   digit_array_zero_num(capacity_, value_);
   size_ = 1;
   sign_ = false;
 }
 
 big_num::big_num(int size, uint64_t x) {
-  value_ = new uint64_t[size];
-  capacity_ = size;
+  allocate(size, nullptr);
   size_ = 1;
   digit_array_zero_num(capacity_, value_);
   value_[0] = x;
@@ -41,25 +182,24 @@ big_num::big_num(int size, uint64_t x) {
 }
 
 big_num::big_num(big_num& n, int capacity) {
-  capacity_ = capacity;
+  allocate(capacity, nullptr);
   size_ = n.size_;
   sign_ = n.sign_;
-  value_ = new uint64_t[capacity_];
   copy_from(n);
 }
 
 big_num::big_num(big_num& n) {
-  capacity_ = n.capacity_;
+  allocate(n.capacity_, nullptr);
   size_ = n.size_;
   sign_ = n.sign_;
-  value_ = new uint64_t[capacity_];
   copy_from(n);
 }
 
 big_num::~big_num() {
   if (value_ != nullptr) {
     digit_array_zero_num(capacity_, value_);
-    delete value_;
+    if (value_ != inline_ && arena_ == nullptr)
+      delete []value_;
     value_ = nullptr;
   }
 }
@@ -437,6 +437,173 @@ int digit_array_sub_from(int capacity_a, int size_a, uint64_t* a, int size_b,
   return digit_array_real_size(capacity_a, a);
 }
 
+// MULX/ADCX/ADOX kernels.
+//   mulx leaves the flags alone and adcx/adox carry through CF and OF
+//   only, so a row can run two independent carry chains: CF for the low
+//   halves and OF for the high halves.  Loop control uses lea and jrcxz,
+//   which also leave the flags alone.  digit_array_use_mulx is set once
+//   at startup from cpuid; when it is false the mulq kernels are used.
+bool digit_array_use_mulx = have_intel_bmi2_adx();
+
+// One row: result[0, len] += rdx * b[0, len).
+//   On entry r9 = b, r13 = result, rcx = len/4, rbx = len%4.  Four
+//   products per pass, alternating r10 and r14 for the high digit.
+#define MULX_ROW_ASM \
+      "\txorq   %%r10, %%r10\n"  /* also clears CF and OF */ \
+      "\tjrcxz  22f\n" \
+      "21:\n" \
+      "\tmulxq  (%%r9), %%rax, %%r14\n" \
+      "\tadcxq  (%%r13), %%rax\n" \
+      "\tadoxq  %%r10, %%rax\n" \
+      "\tmovq   %%rax, (%%r13)\n" \
+      "\tmulxq  8(%%r9), %%rax, %%r10\n" \
+      "\tadcxq  8(%%r13), %%rax\n" \
+      "\tadoxq  %%r14, %%rax\n" \
+      "\tmovq   %%rax, 8(%%r13)\n" \
+      "\tmulxq  16(%%r9), %%rax, %%r14\n" \
+      "\tadcxq  16(%%r13), %%rax\n" \
+      "\tadoxq  %%r10, %%rax\n" \
+      "\tmovq   %%rax, 16(%%r13)\n" \
+      "\tmulxq  24(%%r9), %%rax, %%r10\n" \
+      "\tadcxq  24(%%r13), %%rax\n" \
+      "\tadoxq  %%r14, %%rax\n" \
+      "\tmovq   %%rax, 24(%%r13)\n" \
+      "\tleaq   32(%%r9), %%r9\n" \
+      "\tleaq   32(%%r13), %%r13\n" \
+      "\tleaq   -1(%%rcx), %%rcx\n" \
+      "\tjrcxz  22f\n" \
+      "\tjmp    21b\n" \
+      "22:\n" \
+      "\tmovq   %%rbx, %%rcx\n" \
+      "\tjrcxz  24f\n" \
+      "23:\n" \
+      "\tmulxq  (%%r9), %%rax, %%r14\n" \
+      "\tadcxq  (%%r13), %%rax\n" \
+      "\tadoxq  %%r10, %%rax\n" \
+      "\tmovq   %%rax, (%%r13)\n" \
+      "\tmovq   %%r14, %%r10\n" \
+      "\tleaq   8(%%r9), %%r9\n" \
+      "\tleaq   8(%%r13), %%r13\n" \
+      "\tleaq   -1(%%rcx), %%rcx\n" \
+      "\tjrcxz  24f\n" \
+      "\tjmp    23b\n" \
+      "24:\n" \
+      "\tmovl   $0, %%eax\n" \
+      "\tadcxq  %%rax, %%r10\n" \
+      "\tadoxq  %%rax, %%r10\n" \
+      "\tmovq   %%r10, (%%r13)\n"
+
+// result += a*b, result zero on entry and at least len_a+len_b digits.
+static void mulx_digit_array_mult(uint64_t len_a, uint64_t* a, uint64_t len_b,
+                                  uint64_t* b, uint64_t* result) {
+  //    r8 : a
+  //    r11: i
+  //    r15: result
+  asm volatile (
+      "\tmovq   %[a], %%r8\n"
+      "\tmovq   %[result], %%r15\n"
+      "\txorq   %%r11, %%r11\n"
+
+      "1:\n"
+      "\tmovq   (%%r8, %%r11, 8), %%rdx\n"
+      "\tmovq   %[b], %%r9\n"
+      "\tleaq   (%%r15, %%r11, 8), %%r13\n"
+      "\tmovq   %[len_b], %%rcx\n"
+      "\tmovq   %%rcx, %%rbx\n"
+      "\tshrq   $2, %%rcx\n"
+      "\tandq   $3, %%rbx\n"
+      MULX_ROW_ASM
+      "\taddq   $1, %%r11\n"
+      "\tcmpq   %[len_a], %%r11\n"
+      "\tjl     1b\n"
+      :: [a] "g"(a), [b] "g"(b), [len_a] "g"(len_a), [len_b] "g"(len_b),
+         [result] "g"(result)
+      : "memory", "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r9", "%r10",
+        "%r11", "%r13", "%r14", "%r15");
+}
+
+// result = a*a, result zero on entry and at least 2*len digits.
+static void mulx_digit_array_square(uint64_t len, uint64_t* a,
+                                    uint64_t* result) {
+  //    r8 : a
+  //    r11: i
+  //    r15: result
+  asm volatile (
+      "\tmovq   %[a], %%r8\n"
+      "\tmovq   %[result], %%r15\n"
+      "\txorq   %%r11, %%r11\n"
+
+      // cross products, row i: result[i+j] += a[i]*a[j], j > i
+      "1:\n"
+      "\tmovq   %[len], %%rcx\n"
+      "\tsubq   %%r11, %%rcx\n"
+      "\tsubq   $1, %%rcx\n"
+      "\tjle    4f\n"
+      "\tmovq   (%%r8, %%r11, 8), %%rdx\n"
+      "\tleaq   8(%%r8, %%r11, 8), %%r9\n"
+      "\tleaq   (%%r11, %%r11), %%r13\n"
+      "\tleaq   8(%%r15, %%r13, 8), %%r13\n"
+      "\tmovq   %%rcx, %%rbx\n"
+      "\tshrq   $2, %%rcx\n"
+      "\tandq   $3, %%rbx\n"
+      MULX_ROW_ASM
+      "\taddq   $1, %%r11\n"
+      "\tjmp    1b\n"
+
+      // double the cross products on the OF chain and add a[i]*a[i]
+      // on the CF chain
+      "4:\n"
+      "\tmovq   %[len], %%rcx\n"
+      "\txorq   %%r11, %%r11\n"        // also clears CF and OF
+      "5:\n"
+      "\tmovq   (%%r8, %%r11, 8), %%rdx\n"
+      "\tmulxq  %%rdx, %%rax, %%r14\n"
+      "\tleaq   (%%r11, %%r11), %%r13\n"
+      "\tmovq   (%%r15, %%r13, 8), %%r10\n"
+      "\tadoxq  %%r10, %%r10\n"
+      "\tadcxq  %%rax, %%r10\n"
+      "\tmovq   %%r10, (%%r15, %%r13, 8)\n"
+      "\tmovq   8(%%r15, %%r13, 8), %%r10\n"
+      "\tadoxq  %%r10, %%r10\n"
+      "\tadcxq  %%r14, %%r10\n"
+      "\tmovq   %%r10, 8(%%r15, %%r13, 8)\n"
+      "\tleaq   1(%%r11), %%r11\n"
+      "\tleaq   -1(%%rcx), %%rcx\n"
+      "\tjrcxz  6f\n"
+      "\tjmp    5b\n"
+      "6:\n"
+      :: [a] "g"(a), [len] "g"(len), [result] "g"(result)
+      : "memory", "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r9", "%r10",
+        "%r11", "%r13", "%r14", "%r15");
+}
+
+// a*= x over len digits, carry out stored in a[len].
+static void mulx_digit_array_mult_by(uint64_t len, uint64_t* a, uint64_t x) {
+  //    r8 : carry (high digit of previous product)
+  //    r9 : current a
+  //    rdx: x
+  asm volatile (
+      "\tmovq   %[a], %%r9\n"
+      "\tmovq   %[x], %%rdx\n"
+      "\tmovq   %[len], %%rcx\n"
+      "\txorq   %%r8, %%r8\n"          // also clears CF
+      "1:\n"
+      "\tmulxq  (%%r9), %%rax, %%r10\n"
+      "\tadcxq  %%r8, %%rax\n"
+      "\tmovq   %%rax, (%%r9)\n"
+      "\tmovq   %%r10, %%r8\n"
+      "\tleaq   8(%%r9), %%r9\n"
+      "\tleaq   -1(%%rcx), %%rcx\n"
+      "\tjrcxz  2f\n"
+      "\tjmp    1b\n"
+      "2:\n"
+      "\tmovl   $0, %%eax\n"
+      "\tadcxq  %%rax, %%r8\n"
+      "\tmovq   %%r8, (%%r9)\n"
+      :: [a] "g"(a), [x] "g"(x), [len] "g"(len)
+      : "memory", "cc", "%rax", "%rcx", "%rdx", "%r8", "%r9", "%r10");
+}
+
 // result = a*b.  returns size of result.  Error if < 0
 int digit_array_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
                    int size_result, uint64_t* result) {
@@ -447,6 +614,11 @@ int digit_array_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
     return -1;
   }
   digit_array_zero_num(size_result, result);
+  if (digit_array_use_mulx) {
+    mulx_digit_array_mult((uint64_t)real_size_a, a, (uint64_t)real_size_b, b,
+                          result);
+    return digit_array_real_size(size_result, result);
+  }
 
 #define FASTMULT
 #ifdef FASTMULT
@@ -523,108 +695,92 @@ int digit_array_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
 
 #define FASTSQUARE
 // result = a*a.  returns size of result.  Error if <0
+//   The cross products a[i]*a[j], i < j, are computed once, the
+//   sum is doubled and then the squares a[i]*a[i] are added in.
 int digit_array_square(int size_a, uint64_t* a, int size_result,
                      uint64_t* result) {
   int real_size_a = digit_array_real_size(size_a, a);
   if ((real_size_a + real_size_a) > size_result) {
     return -1;
   }
+  digit_array_zero_num(size_result, result);
+  if (digit_array_use_mulx) {
+    mulx_digit_array_square((uint64_t)real_size_a, a, result);
+    return digit_array_real_size(size_result, result);
+  }
 
 #ifdef FASTSQUARE
-  uint64_t cur_in = 0ULL;
-  uint64_t cur_out = 0ULL;
+  uint64_t len = (uint64_t) real_size_a;
 
+  //    r8 : a
+  //    r10: len
+  //    r11: i
+  //    r12: j
+  //    r13: current output index
+  //    r14: carry
+  //    r15: result
   asm volatile(
-      "\tmovq   %[result], %%r15\n"  // %%r15 <-- address of output place
-      "\tmovq   %[a], %%r8\n"        // %%r8 <-- address of low input digit
-      "\txorq   %%rax,%%rax\n"
-      "\tmovl   %[real_size_a], %%eax\n"  // number of output words
-      "\tmovq   %%rax, %%r12\n"      // number of output words
-      "\tshlq   $3, %%r12\n"
-      "\taddq   %%r8, %%r12\n"  // %%r12>address of last input digit
-
-      // a[i]*a[i]
-      "1:\n"
-      "\tmovq   (%%r8), %%rax\n"
-      "\tmulq   (%%r8)\n"  // a[i]**2 result in rdx:rax
-      "\tmovq   %%rax, (%%r15)\n"
-      "\tmovq   %%rdx, 8(%%r15)\n"
-      "\taddq   $16, %%r15\n"
-      "\taddq   $8, %%r8\n"
-      "\tcmpq   %%r8, %%r12\n"
-      "\tjg     1b\n"
-
-      "\tmovq   %[a], %%r9\n"       // input
-      "\tmovq   %%r9, %[cur_in]\n"  // input
-      "\tsubq   $8, %[cur_in]\n"
-      "\tmovq   %[result], %%r9\n"
-      "\tmovq   %%r9, %[cur_out]\n"
-      "\tsubq   $8, %[cur_out]\n"
-
-      "\t.balign 16\n"
-      "2:\n"
-      "\tmovq   %[cur_in], %%r8\n"
-      "\taddq   $8, %%r8\n"
-      "\tmovq   %%r8, %[cur_in]\n"
-      "\tmovq   %[cur_out], %%r15\n"
-      "\taddq   $16, %%r15\n"
-      "\tmovq   %%r15, %[cur_out]\n"
-      "\tmovq   %%r8, %%r9\n"
-      "\taddq   $8, %%r9\n"
-      "\tcmpq   %%r9, %%r12\n"
-      "\tjle    11f\n"
-
-      // loop on %%r9
-      "3:\n"
-      "\tmovq   (%%r8), %%rax\n"
-      "\tmulq   (%%r9)\n"
-      "\tmovq   %%r15, %%r11\n"
+      "\tmovq   %[a], %%r8\n"
+      "\tmovq   %[result], %%r15\n"
+      "\tmovq   %[len], %%r10\n"
+      "\txorq   %%r11, %%r11\n"
 
-      // shift by 1, top bit in %%r14
+      // cross products, row i: result[i+j] += a[i]*a[j], j > i
+      "1:\n"
+      "\tleaq   1(%%r11), %%r12\n"
+      "\tcmpq   %%r10, %%r12\n"
+      "\tjge    4f\n"
+      "\tmovq   (%%r8, %%r11, 8), %%rbx\n"
+      "\tleaq   (%%r11, %%r12), %%r13\n"
       "\txorq   %%r14, %%r14\n"
-      "\tshlq   $1, %%rax\n"
-      "\tjnc    4f\n"
-      "\tmovq   $1, %%r14\n"
+      "2:\n"
+      "\tmovq   (%%r8, %%r12, 8), %%rax\n"
+      "\tmulq   %%rbx\n"
+      "\taddq   %%r14, %%rax\n"
+      "\tadcq   $0, %%rdx\n"
+      "\taddq   (%%r15, %%r13, 8), %%rax\n"
+      "\tadcq   $0, %%rdx\n"
+      "\tmovq   %%rax, (%%r15, %%r13, 8)\n"
+      "\tmovq   %%rdx, %%r14\n"
+      "\taddq   $1, %%r12\n"
+      "\taddq   $1, %%r13\n"
+      "\tcmpq   %%r10, %%r12\n"
+      "\tjl     2b\n"
+      "\tmovq   %%r14, (%%r15, %%r13, 8)\n"
+      "\taddq   $1, %%r11\n"
+      "\tjmp    1b\n"
 
+      // double: one adc chain over 2*len digits, lea and dec keep CF
       "4:\n"
-      "\tshlq   $1,%%rdx\n"
-      "\tjnc    8f\n"
-      "\torq    %%r14, %%rdx\n"
-      "\txorq   %%r14,%%r14\n"
-      "\taddq   $24, %%r11\n"
-      "\taddq   %%rax, (%%r15)\n"
-      "\tadcq   %%rdx, 8(%%r15)\n"
-      "\tadcq   $1, 16(%%r15)\n"
-      "\tjnc    10f\n"
-      "\tjmp    9f\n"
-
-      "8:\n"
-      "\torq    %%r14, %%rdx\n"
-      "\txorq   %%r14,%%r14\n"
-      "\taddq   $16, %%r11\n"
-      "\taddq   %%rax, (%%r15)\n"
-      "\tadcq   %%rdx, 8(%%r15)\n"
-      "\tjnc    10f\n"
-
-      "9:\n"
-      "\taddq   $1, (%%r11)\n"
-      "\tjnc    10f\n"
-      "\taddq   $8, %%r11\n"
-      "\tjmp    9b\n"
-
-      "10:\n"
-      "\taddq   $8, %%r9\n"
-      "\taddq   $8, %%r15\n"
-      "\tcmpq   %%r9, %%r12\n"
-      "\tjg     3b\n"
-      "\tjmp    2b\n"
-      "\t.balign 16\n"
-      "11:\n"
-      : [cur_in] "=m"(cur_in), [cur_out] "=m"(cur_out)
-      : [a] "m"(a), [result] "m"(result), [real_size_a] "m"(real_size_a),
-        [size_result] "m"(size_result)
-      : "memory", "cc", "%rax", "%rdx", "%r8", "%r9", "%r12", "%r11", "%r14",
-        "%r15");
+      "\tleaq   (%%r10, %%r10), %%rcx\n"
+      "\txorq   %%r13, %%r13\n"
+      "5:\n"
+      "\tmovq   (%%r15, %%r13, 8), %%rax\n"
+      "\tadcq   %%rax, %%rax\n"
+      "\tmovq   %%rax, (%%r15, %%r13, 8)\n"
+      "\tleaq   1(%%r13), %%r13\n"
+      "\tdecq   %%rcx\n"
+      "\tjnz    5b\n"
+
+      // add a[i]*a[i] at result[2i]
+      "\txorq   %%r11, %%r11\n"
+      "\txorq   %%r14, %%r14\n"
+      "6:\n"
+      "\tmovq   (%%r8, %%r11, 8), %%rax\n"
+      "\tmulq   %%rax\n"
+      "\taddq   %%r14, %%rax\n"
+      "\tadcq   $0, %%rdx\n"
+      "\tleaq   (%%r11, %%r11), %%r13\n"
+      "\tmovl   $0, %%r14d\n"
+      "\taddq   %%rax, (%%r15, %%r13, 8)\n"
+      "\tadcq   %%rdx, 8(%%r15, %%r13, 8)\n"
+      "\tadcq   $0, %%r14\n"
+      "\taddq   $1, %%r11\n"
+      "\tcmpq   %%r10, %%r11\n"
+      "\tjl     6b\n"
+      :: [a] "g"(a), [result] "g"(result), [len] "g"(len)
+      : "memory", "cc", "%rax", "%rbx", "%rcx", "%rdx", "%r8", "%r10", "%r11",
+        "%r12", "%r13", "%r14", "%r15");
   return digit_array_real_size(size_result, result);
 #else
   return digit_array_mult(size_a, a, size_a, a, size_result, result);
@@ -633,6 +789,10 @@ int digit_array_square(int size_a, uint64_t* a, int size_result,
 
 // a*= x.  a must have size_a+1 positions available
 int digit_array_mult_by(int capacity_a, int size_a, uint64_t* a, uint64_t x) {
+  if (digit_array_use_mulx && size_a > 0) {
+    mulx_digit_array_mult_by((uint64_t)size_a, a, x);
+    return digit_array_real_size(size_a, a);
+  }
   asm volatile(
       "\txorq   %%r8, %%r8\n"  // carry
       "\txorq   %%rdx, %%rdx\n"
@@ -702,7 +862,7 @@ bool digit_array_short_division_algorithm(int size_a, uint64_t* a, uint64_t b,
 }
 
 // estimate quotient (cf: Knuth v2)
-// *est-2<= q <= *est
+// *est-2<= q <= *est, *est <= b - 1
 // note b1>0 and (a1 a2)_b >= b1_b, b= 2^64
 void estimate_quotient(uint64_t a1, uint64_t a2, uint64_t a3, uint64_t b1,
                        uint64_t b2, uint64_t* est) {
@@ -721,7 +881,7 @@ void estimate_quotient(uint64_t a1, uint64_t a2, uint64_t a3, uint64_t b1,
     d1 = (b1 << den_shift) | (b2 >> (NBITSINUINT64 - den_shift));
   }
 
-  if (n1 > d1) {
+  if (n1 >= d1) {
     *est = (uint64_t)-1;
     return;
   }
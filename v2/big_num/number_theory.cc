@@ -15,83 +15,200 @@
 #include "big_num.h"
 #include "intel_digit_arith.h"
 #include "big_num_functions.h"
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+// Extended gcd
+//   Lehmer's method, Knuth, TAOCP v2, 4.5.2, Algorithm L.  The Euclid
+//   quotients are simulated on the leading 62 bits of u and v, which gives a
+//   cofactor matrix (A B; C D) with single digit entries.  The full length
+//   values are updated once per matrix, u = Au + Bv, v = Cu + Dv, rather than
+//   once per quotient; when the leading bits give no quotient a full
+//   division step is done.  Only the cofactor of a is carried.  Successive
+//   cofactors alternate in sign so they are kept as magnitudes along with the
+//   sign of the first one.  y comes from g = xa + yb at the end.  The work
+//   arrays are allocated once, on entry.
+
+static const int lehmer_bits = 62;
+
+// r = A u + B v, A and B have opposite signs and r >= 0.  r may be v.
+static void lehmer_combine(int n, int64_t A, uint64_t* u, int64_t B,
+                           uint64_t* v, uint64_t* r) {
+  __int128 t;
+  __int128 carry = 0;
+
+  for (int i = 0; i < n; i++) {
+    t = (__int128)A * u[i] + (__int128)B * v[i] + carry;
+    r[i] = (uint64_t)t;
+    carry = t >> NBITSINUINT64;
+  }
+}
 
-bool big_extended_gcd(big_num& a, big_num& b, big_num& x, big_num& y, big_num& g) {
-  big_num* a_coeff[3] = {nullptr, nullptr, nullptr};
-  big_num* b_coeff[3] = {nullptr, nullptr, nullptr};
-  big_num* c[3] = {nullptr, nullptr, nullptr};
-
-  int n = a.size_ > b.size_ ? a.size_ : b.size_;
-  big_num q(2 * n + 1);
-  big_num r(2 * n + 1);
-  big_num t1(2 * n + 1);
-  big_num t2(2 * n + 1);
-  int old = 0;
-  int current = 1;
-  int next = 2;
-  bool ret = true;
-  int i;
+// r = A x + B y on magnitudes.  r may be y.
+static void lehmer_combine_abs(int n, uint64_t A, uint64_t* x, uint64_t B,
+                               uint64_t* y, uint64_t* r) {
+  unsigned __int128 t;
+  uint64_t carry = 0ULL;
 
-  for (i = 0; i < 3; i++) {
-    a_coeff[i] = new big_num(2 * n + 1);
-    b_coeff[i] = new big_num(2 * n + 1);
-    c[i] = new big_num(2 * n + 1);
+  for (int i = 0; i < n; i++) {
+    t = (unsigned __int128)A * x[i] + (unsigned __int128)B * y[i] + carry;
+    r[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> NBITSINUINT64);
   }
+}
 
-  a_coeff[0]->copy_from(big_one);
-  b_coeff[0]->copy_from(big_zero);
-  a_coeff[1]->copy_from(big_zero);
-  b_coeff[1]->copy_from(big_one);
-  a.copy_to(*c[0]);
-  b.copy_to(*c[1]);
+// lehmer_bits bits of u starting at bit shift
+static uint64_t lehmer_leading_bits(int size_u, uint64_t* u, int shift) {
+  int word = shift / NBITSINUINT64;
+  int bit = shift % NBITSINUINT64;
+  uint64_t x = u[word] >> bit;
 
-  for (;;) {
-    r.zero_num();
-    q.zero_num();
-    t1.zero_num();
-    t2.zero_num();
+  if (bit != 0 && (word + 1) < size_u)
+    x |= u[word + 1] << (NBITSINUINT64 - bit);
+  return x & ((1ULL << lehmer_bits) - 1ULL);
+}
 
-    // c[new]= q*c[old] +r;
-    ret = big_unsigned_euclid(*c[old], *c[current], q, r);
-    if (!ret)
-      goto done;
-    if (r.is_zero())
+bool big_extended_gcd(big_num& a, big_num& b, big_num& x, big_num& y, big_num& g) {
+  bool swapped = digit_array_compare(a.size_, a.value_, b.size_, b.value_) < 0;
+  big_num& aa = swapped ? b : a;
+  big_num& bb = swapped ? a : b;
+  int n = aa.size_ + 1;
+  uint64_t u[n];
+  uint64_t v[n];
+  uint64_t w[n];
+  uint64_t xu[n];
+  uint64_t xv[n];
+  uint64_t xw[n];
+  uint64_t q[n];
+  uint64_t t[2 * n];
+  int sign_u = 1;  // sign of the cofactor in xu, xv has the other sign
+  int size_u, size_v, size_q, size_r, size_t;
+  int high, shift;
+  int64_t A, B, C, D, T, qh;
+  uint64_t uh, vh, carry;
+  unsigned __int128 sum;
+  int i;
+
+  digit_array_zero_num(n, u);
+  digit_array_zero_num(n, v);
+  digit_array_zero_num(n, xu);
+  digit_array_zero_num(n, xv);
+  if (!digit_array_copy(aa.size_, aa.value_, n, u) ||
+      !digit_array_copy(bb.size_, bb.value_, n, v))
+    return false;
+  xu[0] = 1ULL;
+
+  for (;;) {
+    if (digit_array_is_zero(n, v))
       break;
-    r.copy_to(*c[next]);
-    ret = big_mult(q, *a_coeff[current], t1);
-    if (!ret)
-      goto done;
-    ret = big_mult(q, *b_coeff[current], t2);
-    if (!ret)
-      goto done;
-    ret = big_sub(*a_coeff[old], t1, *a_coeff[next]);
-    if (!ret)
-      goto done;
-    ret = big_sub(*b_coeff[old], t2, *b_coeff[next]);
-    if (!ret)
-      goto done;
-    old = (old + 1) % 3;
-    current = (current + 1) % 3;
-    next = (next + 1) % 3;
+    size_u = digit_array_real_size(n, u);
+    size_v = digit_array_real_size(n, v);
+    high = (size_u - 1) * NBITSINUINT64 + high_bit_in_digit(u[size_u - 1]);
+    if (high <= lehmer_bits) {
+      uh = u[0];
+      vh = v[0];
+    } else {
+      shift = high - lehmer_bits;
+      uh = lehmer_leading_bits(size_u, u, shift);
+      vh = lehmer_leading_bits(size_v, v, shift);
+    }
+
+    A = 1;
+    B = 0;
+    C = 0;
+    D = 1;
+    for (;;) {
+      if (((int64_t)vh + C) == 0 || ((int64_t)vh + D) == 0)
+        break;
+      qh = ((int64_t)uh + A) / ((int64_t)vh + C);
+      if (qh != ((int64_t)uh + B) / ((int64_t)vh + D))
+        break;
+      T = A - qh * C;
+      A = C;
+      C = T;
+      T = B - qh * D;
+      B = D;
+      D = T;
+      T = (int64_t)uh - qh * (int64_t)vh;
+      uh = vh;
+      vh = (uint64_t)T;
+    }
+
+    if (B == 0) {
+      // full step: w = u - qv, xw = xu + q xv
+      size_q = n;
+      size_r = n;
+      digit_array_zero_num(n, q);
+      digit_array_zero_num(n, w);
+      if (!digit_array_division_algorithm(size_u, u, size_v, v, &size_q, q,
+                                          &size_r, w))
+        return false;
+      size_t = digit_array_mult(size_q, q, n, xv, 2 * n, t);
+      if (size_t < 0)
+        return false;
+      carry = 0ULL;
+      for (i = 0; i < n; i++) {
+        sum = (unsigned __int128)t[i] + xu[i] + carry;
+        xw[i] = (uint64_t)sum;
+        carry = (uint64_t)(sum >> NBITSINUINT64);
+      }
+      digit_array_copy(n, v, n, u);
+      digit_array_copy(n, w, n, v);
+      digit_array_copy(n, xv, n, xu);
+      digit_array_copy(n, xw, n, xv);
+      sign_u = -sign_u;
+      continue;
+    }
+
+    lehmer_combine(n, A, u, B, v, w);
+    lehmer_combine(n, C, u, D, v, v);
+    digit_array_copy(n, w, n, u);
+    lehmer_combine_abs(n, A < 0 ? -A : A, xu, B < 0 ? -B : B, xv, xw);
+    lehmer_combine_abs(n, C < 0 ? -C : C, xu, D < 0 ? -D : D, xv, xv);
+    digit_array_copy(n, xw, n, xu);
+    if (A < 0 || B > 0)
+      sign_u = -sign_u;
   }
 
-  a_coeff[current]->copy_to(x);
-  b_coeff[current]->copy_to(y);
-  c[current]->copy_to(g);
+  // x_aa = sign_u xu, y_bb = (g - x_aa aa) / bb
+  big_num gg(n);
+  big_num x_aa(n);
+  big_num y_bb(2 * n + 1);
+  big_num p(2 * n + 1);
+  big_num s(2 * n + 1);
+  big_num rem(2 * n + 1);
+
+  digit_array_copy(n, u, gg.capacity_, gg.value_);
+  gg.normalize();
+  digit_array_copy(n, xu, x_aa.capacity_, x_aa.value_);
+  x_aa.normalize();
+  if (sign_u < 0 && !x_aa.is_zero())
+    x_aa.toggle_sign();
+  if (!bb.is_zero()) {
+    if (!big_mult(x_aa, aa, p))
+      return false;
+    if (!big_sub(gg, p, s))
+      return false;
+    if (!big_unsigned_euclid(s, bb, y_bb, rem) || !rem.is_zero())
+      return false;
+    y_bb.normalize();
+    if (s.is_negative() && !y_bb.is_zero())
+      y_bb.toggle_sign();
+  }
 
-done:
-  for (i = 0; i < 3; i++) {
-    if (a_coeff[i] != nullptr)
-      delete a_coeff[i];
-    a_coeff[i] = nullptr;
-    if (b_coeff[i] != nullptr)
-      delete b_coeff[i];
-    b_coeff[i] = nullptr;
-    if (c[i] != nullptr)
-      delete c[i];
-    c[i] = nullptr;
+  x.zero_num();
+  y.zero_num();
+  g.zero_num();
+  g.copy_from(gg);
+  if (swapped) {
+    x.copy_from(y_bb);
+    y.copy_from(x_aa);
+  } else {
+    x.copy_from(x_aa);
+    y.copy_from(y_bb);
   }
-  return ret;
+  return true;
 }
 
 bool big_crt(big_num& s1, big_num& s2, big_num& m1, big_num& m2, big_num& r) {
@@ -272,6 +389,206 @@ bool big_mod_inv(big_num& a, big_num& m, big_num& r) {
   return big_mod_normalize(r, m);
 }
 
+// Constant time modular inverse
+//   Bernstein and Yang, "Fast constant-time gcd computation and modular
+//   inversion."  For odd m, f = m, g = a, d = 0, e = 1 and delta = 1; each
+//   divstep is
+//     if (delta > 0 and g odd)
+//       delta, f, g, d, e = 1 - delta, g, (g - f)/2, e, (e - d)/2
+//     else
+//       delta, f, g, d, e = 1 + delta, f, (g + (g&1) f)/2, d, (e + (g&1) d)/2
+//   with d, e taken mod m so that f = da, g = ea (mod m) throughout.  After
+//   the iteration bound for the size of m, g = 0 and f = +-1, so a^(-1) is
+//   +-d.  62 divsteps at a time are run on the low digits of f and g giving
+//   a matrix (u v; q r) with 2^62 (f', g') = (uf + vg, qf + rg), which is then
+//   applied to the full length values.  For d and e a multiple of m is added
+//   to make the sums divisible by 2^62.  f, g, d, e are two's complement digit
+//   arrays one digit longer than m and are always processed in full, using
+//   masks rather than branches, so the running time depends only on the size
+//   of m.
+
+static const int ct_divsteps = 62;
+
+// x = -x if mask is all ones
+static void ct_cneg(int n, uint64_t mask, uint64_t* x) {
+  unsigned __int128 t;
+  uint64_t carry = mask & 1ULL;
+
+  for (int i = 0; i < n; i++) {
+    t = (unsigned __int128)(x[i] ^ mask) + carry;
+    x[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> NBITSINUINT64);
+  }
+}
+
+// x += y & mask
+static void ct_add_masked(int n, uint64_t* x, uint64_t mask, uint64_t* y) {
+  unsigned __int128 t;
+  uint64_t carry = 0ULL;
+
+  for (int i = 0; i < n; i++) {
+    t = (unsigned __int128)x[i] + (y[i] & mask) + carry;
+    x[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> NBITSINUINT64);
+  }
+}
+
+// x -= y
+static void ct_sub(int n, uint64_t* x, uint64_t* y) {
+  unsigned __int128 t;
+  uint64_t borrow = 0ULL;
+
+  for (int i = 0; i < n; i++) {
+    t = (unsigned __int128)x[i] - y[i] - borrow;
+    x[i] = (uint64_t)t;
+    borrow = (uint64_t)(t >> NBITSINUINT64) & 1ULL;
+  }
+}
+
+static inline uint64_t ct_sign_mask(int n, uint64_t* x) {
+  return (uint64_t)((int64_t)x[n - 1] >> (NBITSINUINT64 - 1));
+}
+
+// ct_divsteps divsteps on the low digits of f and g, returns the new delta
+static int64_t ct_divsteps_matrix(int64_t delta, uint64_t f, uint64_t g,
+                                  int64_t* mat) {
+  uint64_t u = 1ULL;
+  uint64_t v = 0ULL;
+  uint64_t q = 0ULL;
+  uint64_t r = 1ULL;
+  uint64_t odd, swap, t;
+
+  for (int i = 0; i < ct_divsteps; i++) {
+    odd = 0ULL - (g & 1ULL);
+    swap = odd & (uint64_t)((-delta) >> (NBITSINUINT64 - 1));
+    delta = ((delta ^ (int64_t)swap) - (int64_t)swap) + 1;
+    t = (f ^ g) & swap;
+    f ^= t;
+    g ^= t;
+    t = (u ^ q) & swap;
+    u ^= t;
+    q ^= t;
+    t = (v ^ r) & swap;
+    v ^= t;
+    r ^= t;
+    g = (g ^ swap) - swap;
+    q = (q ^ swap) - swap;
+    r = (r ^ swap) - swap;
+    g += f & odd;
+    q += u & odd;
+    r += v & odd;
+    g >>= 1;
+    u <<= 1;
+    v <<= 1;
+  }
+  mat[0] = (int64_t)u;
+  mat[1] = (int64_t)v;
+  mat[2] = (int64_t)q;
+  mat[3] = (int64_t)r;
+  return delta;
+}
+
+// r = (ux + vy + km) / 2^62, the sum is a multiple of 2^62
+static void ct_combine(int n, int64_t u, uint64_t* x, int64_t v, uint64_t* y,
+                       uint64_t k, uint64_t* m, uint64_t* r) {
+  uint64_t s[n + 1];
+  __int128 t;
+  __int128 carry = 0;
+  __int128 xi, yi;
+
+  for (int i = 0; i < n; i++) {
+    xi = (i == (n - 1)) ? (__int128)(int64_t)x[i] : (__int128)x[i];
+    yi = (i == (n - 1)) ? (__int128)(int64_t)y[i] : (__int128)y[i];
+    t = u * xi + v * yi + (__int128)((unsigned __int128)k * m[i]) + carry;
+    s[i] = (uint64_t)t;
+    carry = t >> NBITSINUINT64;
+  }
+  s[n] = (uint64_t)carry;
+  for (int i = 0; i < n; i++)
+    r[i] = (s[i] >> ct_divsteps) | (s[i + 1] << (NBITSINUINT64 - ct_divsteps));
+}
+
+bool big_mod_inv_ct(big_num& a, big_num& m, big_num& r) {
+  if (m.is_zero() || (m.value_[0] & 1ULL) == 0ULL || m.is_negative())
+    return false;
+  if (r.capacity_ < m.size_)
+    return false;
+
+  int n = m.size_ + 1;
+  int bits = big_high_bit(m);
+  int iterations = bits < 46 ? (49 * bits + 80) / 17 : (49 * bits + 57) / 17;
+  uint64_t f[n];
+  uint64_t g[n];
+  uint64_t d[n];
+  uint64_t e[n];
+  uint64_t t1[n];
+  uint64_t t2[n];
+  uint64_t mm[n];
+  int64_t mat[4];
+  int64_t delta = 1;
+  uint64_t m_inv, k_d, k_e, neg;
+  uint64_t low_bits = (1ULL << ct_divsteps) - 1ULL;
+  big_num a_mod(a.size_ > n ? a.size_ : n);
+  int i, j;
+
+  // a in [0, m)
+  if (!a_mod.copy_from(a) || !big_mod_normalize(a_mod, m))
+    return false;
+
+  digit_array_zero_num(n, d);
+  digit_array_zero_num(n, e);
+  e[0] = 1ULL;
+  if (!digit_array_copy(m.size_, m.value_, n, mm) ||
+      !digit_array_copy(m.size_, m.value_, n, f) ||
+      !digit_array_copy(a_mod.size_, a_mod.value_, n, g))
+    return false;
+
+  // m^(-1) (mod 2^64), Newton
+  m_inv = mm[0];
+  for (j = 0; j < 5; j++)
+    m_inv *= 2ULL - mm[0] * m_inv;
+
+  for (i = 0; i < iterations; i += ct_divsteps) {
+    delta = ct_divsteps_matrix(delta, f[0], g[0], mat);
+
+    ct_combine(n, mat[0], f, mat[1], g, 0ULL, mm, t1);
+    ct_combine(n, mat[2], f, mat[3], g, 0ULL, mm, t2);
+    digit_array_copy(n, t1, n, f);
+    digit_array_copy(n, t2, n, g);
+
+    // pick k so that k m cancels the low bits of ud + ve
+    k_d = (0ULL - ((uint64_t)mat[0] * d[0] + (uint64_t)mat[1] * e[0]) * m_inv) &
+          low_bits;
+    k_e = (0ULL - ((uint64_t)mat[2] * d[0] + (uint64_t)mat[3] * e[0]) * m_inv) &
+          low_bits;
+    ct_combine(n, mat[0], d, mat[1], e, k_d, mm, t1);
+    ct_combine(n, mat[2], d, mat[3], e, k_e, mm, t2);
+
+    // (-m, 2m) to (-m, m)
+    ct_sub(n, t1, mm);
+    ct_add_masked(n, t1, ct_sign_mask(n, t1), mm);
+    ct_sub(n, t2, mm);
+    ct_add_masked(n, t2, ct_sign_mask(n, t2), mm);
+    digit_array_copy(n, t1, n, d);
+    digit_array_copy(n, t2, n, e);
+  }
+
+  // f = +-gcd(a, m)
+  neg = ct_sign_mask(n, f);
+  ct_cneg(n, neg, f);
+  ct_cneg(n, neg, d);
+  if (!digit_array_is_zero(n - 1, &f[1]) || f[0] != 1ULL)
+    return false;
+
+  // d in (-m, m) to [0, m)
+  ct_add_masked(n, d, ct_sign_mask(n, d), mm);
+
+  r.zero_num();
+  digit_array_copy(n - 1, d, r.capacity_, r.value_);
+  r.normalize();
+  return true;
+}
+
 // r= a/b
 bool big_mod_div(big_num& a, big_num& b, big_num& m, big_num& r) {
   int n = a.size_ > b.size_ ? a.size_ : b.size_;
@@ -287,6 +604,13 @@ bool big_mod_div(big_num& a, big_num& b, big_num& m, big_num& r) {
 }
 
 bool big_mod_exp(big_num& a, big_num& e, big_num& m, big_num& r) {
+  // odd moduli go through the Montgomery sliding window
+  if (!m.is_negative() && (m.value_[0] & 1ULL) != 0ULL && !m.is_one()) {
+    mont_context ctx;
+    if (ctx.init(m))
+      return big_mont_window_exp(ctx, a, e, r);
+  }
+
   big_num* accum[2] = {nullptr, nullptr};
   big_num* doubled[2] = {nullptr, nullptr};
   int accum_current = 0;
@@ -355,75 +679,268 @@ done:
   return ret;
 }
 
-bool big_gen_prime(big_num& p, uint64_t num_bits, int prime_trys) {
-  int i, j;
-
-  for (i = 0; i < prime_trys; i++) {
-    p.zero_num();
-    if (crypto_get_random_bytes((num_bits + NBITSINBYTE -1) / NBITSINBYTE,
-                                (byte_t*)p.value_) < 0)
-      return false;
-    p.normalize();
-    p.value_[p.size_ - 1] |= (1ULL) << 63;
-    p.value_[0] |= 1ULL;
-    p.normalize();
-    for (j = 0; j < prime_trys; j++, i++) {
-      if (big_is_prime(p)) {
-        return true;
-      }
-      if (!big_unsigned_add_to(p, big_two)) {
-        return false;
-      }
-    }
-  }
-  return false;
-}
-
+//  n - 1 = 2^shift d, d odd.  n passes for base a if a^d = 1 or
+//  a^(2^j d) = -1 (mod n) for some 0 <= j < shift.
 bool big_miller_rabin(big_num& n, big_num** random_a, int trys) {
-  big_num n_minus_1(2 * n.size_);
-  big_num odd_part_n_minus_1(2 * n.size_);
-  big_num y(4 * n.size_ + 1);
-  big_num z(4 * n.size_ + 1);
+  big_num n_minus_1(n.size_ + 1);
+  big_num odd_part_n_minus_1(n.size_ + 1);
+  big_num a(n.size_ + 1);
+  big_num y(n.size_ + 1);
+  big_num mont_y(n.size_ + 1);
+  big_num mont_minus_one(n.size_ + 1);
+  mont_context ctx;
   int i;
   int j;
   int shift;
 
+  if (!ctx.init(n))
+    return false;
   if (!big_sub(n, big_one, n_minus_1))
     return false;
   shift = big_max_power_of_two_dividing(n_minus_1);
-  if (shift > 0) {
-    if (!big_shift(n_minus_1, -shift, odd_part_n_minus_1))
-      return false;
-  }
+  if (!big_shift(n_minus_1, -shift, odd_part_n_minus_1))
+    return false;
+  // -1 in Montgomery form is m - R (mod m)
+  if (!big_unsigned_sub(n, *ctx.r_mod_m_, mont_minus_one))
+    return false;
+
   for (i = 0; i < trys; i++) {
-    y.zero_num();
-    if (!big_mod_exp(*random_a[i], odd_part_n_minus_1, n, y))
+    if (!big_mod(*random_a[i], n, a))
+      return false;
+    if (big_compare(a, big_one) <= 0 || big_compare(a, n_minus_1) == 0)
+      continue;
+    if (!big_mont_window_exp(ctx, a, odd_part_n_minus_1, y))
       return false;
     if (big_compare(y, big_one) == 0 || big_compare(y, n_minus_1) == 0)
       continue;
-    for (j = 0; j < shift; j++) {
-      z.zero_num();
-      if (!big_mod_mult(y, y, n, z))
+    if (!ctx.to_mont(y, mont_y))
+      return false;
+    for (j = 1; j < shift; j++) {
+      if (!ctx.square(mont_y, mont_y))
         return false;
-      if (big_compare(z, big_one) == 0)
+      if (big_compare(mont_y, mont_minus_one) == 0)
+        break;
+      if (big_compare(mont_y, *ctx.r_mod_m_) == 0)
         return false;
     }
-    y.copy_from(z);
-    if (big_compare(y, n_minus_1) == 0)
-      break;
+    if (j >= shift)
+      return false;
   }
-  if (big_compare(y, n_minus_1) != 0)
-    return false;
   return true;
 }
 
+// Prime generation
+//   A random odd base b with the top two bits set is sieved over the window of
+//   candidates b + 2k, 0 <= k < prime_sieve_window.  b is reduced once by each
+//   odd prime p < prime_sieve_bound and the k with b + 2k = 0 (mod p) are crossed out of a
+//   bitmap, so candidates with a small factor are never touched by a big
+//   division.  The survivors are handed out in order to num_threads workers
+//   (big_prime_threads by default) running Miller-Rabin; the first prime
+//   found ends the search.  prime_trys bounds the number of candidates
+//   examined.
+
+int big_prime_threads = (int)std::thread::hardware_concurrency();
+static const int prime_sieve_window = 4096;
+static const int prime_sieve_bound = 1 << 16;
+static const int prime_test_trys = 20;
+
+// odd primes below prime_sieve_bound, Eratosthenes
+static int fill_sieve_primes(uint32_t* primes) {
+  byte_t composite[prime_sieve_bound];
+  int num = 0;
+
+  memset(composite, 0, prime_sieve_bound);
+  for (int i = 3; i < prime_sieve_bound; i += 2) {
+    if (composite[i])
+      continue;
+    primes[num++] = (uint32_t)i;
+    if (i > prime_sieve_bound / i)
+      continue;
+    for (int j = i * i; j < prime_sieve_bound; j += 2 * i)
+      composite[j] = 1;
+  }
+  return num;
+}
+
+static int sieve_primes(uint32_t** primes) {
+  static uint32_t table[prime_sieve_bound / 8];
+  static int num = fill_sieve_primes(table);
+
+  *primes = table;
+  return num;
+}
+
+class prime_search {
+public:
+  big_num* base_;
+  uint64_t* composite_;
+  int window_;
+  int num_bits_;
+  std::atomic<int> next_;
+  std::atomic<bool> found_;
+  std::atomic<bool> failed_;
+  std::mutex lock_;
+  int k_found_;
+};
+
+static bool big_probable_prime(big_num& n, int trys) {
+  big_num* random_a[trys];
+  bool ret = true;
+  int i;
+
+  for (i = 0; i < trys; i++)
+    random_a[i] = nullptr;
+  for (i = 0; i < trys; i++) {
+    random_a[i] = new big_num(n.size_);
+    if (crypto_get_random_bytes(n.size_ * sizeof(uint64_t),
+                                (byte_t*)random_a[i]->value_) < 0) {
+      ret = false;
+      goto done;
+    }
+    random_a[i]->normalize();
+  }
+  ret = big_miller_rabin(n, random_a, trys);
+
+done:
+  for (i = 0; i < trys; i++) {
+    if (random_a[i] != nullptr)
+      delete random_a[i];
+  }
+  return ret;
+}
+
+static void prime_search_worker(prime_search* s) {
+  big_num offset(1);
+  big_num candidate(s->base_->capacity_ + 1);
+  int k;
+
+  while (!s->found_) {
+    k = s->next_.fetch_add(1);
+    if (k >= s->window_)
+      return;
+    if ((s->composite_[k / NBITSINUINT64] >> (k % NBITSINUINT64)) & 1ULL)
+      continue;
+    offset.value_[0] = 2ULL * (uint64_t)k;
+    offset.normalize();
+    candidate.zero_num();
+    if (!big_unsigned_add(*s->base_, offset, candidate)) {
+      s->failed_ = true;
+      return;
+    }
+    if (big_high_bit(candidate) > s->num_bits_)
+      return;
+    if (big_probable_prime(candidate, prime_test_trys)) {
+      s->lock_.lock();
+      if (!s->found_ || k < s->k_found_)
+        s->k_found_ = k;
+      s->found_ = true;
+      s->lock_.unlock();
+      return;
+    }
+  }
+}
+
+bool big_gen_prime(big_num& p, uint64_t num_bits, int prime_trys,
+                   int num_threads) {
+  uint32_t* primes;
+  int num_primes = sieve_primes(&primes);
+  int num_digits = (num_bits + NBITSINUINT64 - 1) / NBITSINUINT64;
+  int top_bit = (num_bits - 1) % NBITSINUINT64;
+  big_num base(num_digits + 1);
+  uint64_t composite[(prime_sieve_window + NBITSINUINT64 - 1) / NBITSINUINT64];
+  uint64_t q[num_digits + 1];
+  uint64_t prime, r, k;
+  int size_q, i, j;
+  int examined = 0;
+  prime_search s;
+
+  if (num_bits < 3 || p.capacity_ < num_digits)
+    return false;
+  if (num_threads <= 0)
+    num_threads = big_prime_threads;
+  if (num_threads <= 0)
+    num_threads = 1;
+
+  while (examined < prime_trys) {
+    base.zero_num();
+    if (crypto_get_random_bytes(num_digits * sizeof(uint64_t),
+                                (byte_t*)base.value_) < 0)
+      return false;
+    // exactly num_bits bits with the top two on, so a product of two such
+    // primes has 2 num_bits bits
+    if (top_bit < (NBITSINUINT64 - 1))
+      base.value_[num_digits - 1] &= (1ULL << (top_bit + 1)) - 1ULL;
+    base.value_[num_digits - 1] |= 1ULL << top_bit;
+    if (top_bit > 0)
+      base.value_[num_digits - 1] |= 1ULL << (top_bit - 1);
+    else
+      base.value_[num_digits - 2] |= 1ULL << (NBITSINUINT64 - 1);
+    base.value_[0] |= 1ULL;
+    base.normalize();
+
+    s.window_ = prime_trys - examined;
+    if (s.window_ > prime_sieve_window)
+      s.window_ = prime_sieve_window;
+    // small sizes: only count candidates that still have num_bits bits
+    if (num_bits <= NBITSINUINT64) {
+      uint64_t top = num_bits == NBITSINUINT64 ? ~0ULL : (1ULL << num_bits) - 1ULL;
+      uint64_t room = (top - base.value_[0]) / 2ULL + 1ULL;
+      if ((uint64_t)s.window_ > room)
+        s.window_ = (int)room;
+    }
+    examined += s.window_;
+
+    for (j = 0; j < (int)(sizeof(composite) / sizeof(uint64_t)); j++)
+      composite[j] = 0ULL;
+    for (i = 0; i < num_primes; i++) {
+      prime = primes[i];
+      if (base.size_ == 1 && prime >= base.value_[0])
+        break;
+      size_q = num_digits + 1;
+      digit_array_zero_num(size_q, q);
+      if (!digit_array_short_division_algorithm(base.size_, base.value_, prime,
+                                                &size_q, q, &r))
+        return false;
+      // b + 2k = 0 (mod p) for k = -b/2
+      k = (((prime - r) % prime) * ((prime + 1) / 2)) % prime;
+      for (; k < (uint64_t)s.window_; k += prime)
+        composite[k / NBITSINUINT64] |= 1ULL << (k % NBITSINUINT64);
+    }
+
+    s.base_ = &base;
+    s.composite_ = composite;
+    s.num_bits_ = (int)num_bits;
+    s.next_ = 0;
+    s.found_ = false;
+    s.failed_ = false;
+    s.k_found_ = 0;
+    if (num_threads == 1) {
+      prime_search_worker(&s);
+    } else {
+      std::thread* workers = new std::thread[num_threads];
+      for (i = 0; i < num_threads; i++)
+        workers[i] = std::thread(prime_search_worker, &s);
+      for (i = 0; i < num_threads; i++)
+        workers[i].join();
+      delete []workers;
+    }
+    if (s.failed_)
+      return false;
+    if (s.found_) {
+      big_num offset(1, 2ULL * (uint64_t)s.k_found_);
+      p.zero_num();
+      return big_unsigned_add(base, offset, p);
+    }
+  }
+  return false;
+}
+
 bool big_is_prime(big_num& n) {
   extern uint64_t smallest_primes[];
   extern int num_smallest_primes;
   int i, k, m;
   uint64_t q[n.size_];
   uint64_t r;
-  big_num** random_a = new big_num* [20];
 
   for (i = 0; i < num_smallest_primes; i++) {
     if (n.size_ == 1 && smallest_primes[i] >= n.value_[0])
@@ -437,13 +954,7 @@ bool big_is_prime(big_num& n) {
     if (r == 0ULL)
       return false;
   }
-  for (int j = 0; j < 20; j++) {
-    random_a[j] = new big_num(20);
-    if (crypto_get_random_bytes(n.size(), (byte_t*)random_a[j]->value_ptr()) < 0)
-      return false;
-    random_a[j]->normalize();
-  }
-  return big_miller_rabin(n, random_a, 20);
+  return big_probable_prime(n, prime_test_trys);
 }
 
 bool big_mod_is_square(big_num& n, big_num& p) {
@@ -915,3 +1426,562 @@ bool big_mont_exp(big_num& b, big_num& e, int r, big_num& m, big_num& m_prime,
   }
   return big_mont_reduce(accum, r, m, m_prime, out);
 }
+
+// Montgomery context
+//   CIOS (coarsely integrated operand scanning) multiply-reduce, Koc, Acar
+//   and Kaliski, "Analyzing and comparing Montgomery multiplication
+//   algorithms."  With n digit operands a, b < m and t of n + 2 digits:
+//     for (i = 0; i < n; i++) {
+//       t += a b[i]
+//       u = t[0] n0' (mod 2^64)
+//       t = (t + u m) / 2^64
+//     }
+//     if (t >= m) t -= m
+//   The final subtraction is done with a mask so the running time does not
+//   depend on the operands.
+
+static inline __attribute__((always_inline)) void mont_mult_cios(int n,
+        uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime, uint64_t* r) {
+  uint64_t t[n + 2];
+  uint64_t d[n];
+  unsigned __int128 prod;
+  uint64_t carry;
+  uint64_t u;
+  int i, j;
+
+  for (j = 0; j < (n + 2); j++)
+    t[j] = 0ULL;
+
+  for (i = 0; i < n; i++) {
+    carry = 0ULL;
+    for (j = 0; j < n; j++) {
+      prod = (unsigned __int128)a[j] * b[i] + t[j] + carry;
+      t[j] = (uint64_t)prod;
+      carry = (uint64_t)(prod >> NBITSINUINT64);
+    }
+    prod = (unsigned __int128)t[n] + carry;
+    t[n] = (uint64_t)prod;
+    t[n + 1] = (uint64_t)(prod >> NBITSINUINT64);
+
+    u = t[0] * n0_prime;
+    prod = (unsigned __int128)u * m[0] + t[0];
+    carry = (uint64_t)(prod >> NBITSINUINT64);
+    for (j = 1; j < n; j++) {
+      prod = (unsigned __int128)u * m[j] + t[j] + carry;
+      t[j - 1] = (uint64_t)prod;
+      carry = (uint64_t)(prod >> NBITSINUINT64);
+    }
+    prod = (unsigned __int128)t[n] + carry;
+    t[n - 1] = (uint64_t)prod;
+    t[n] = t[n + 1] + (uint64_t)(prod >> NBITSINUINT64);
+  }
+
+  // d = t - m, keep t if that borrowed out of t[n]
+  uint64_t borrow = 0ULL;
+  for (j = 0; j < n; j++) {
+    prod = (unsigned __int128)t[j] - m[j] - borrow;
+    d[j] = (uint64_t)prod;
+    borrow = (uint64_t)(prod >> NBITSINUINT64) & 1ULL;
+  }
+  uint64_t keep_t = 0ULL - (borrow & (t[n] ^ 1ULL));
+  for (j = 0; j < n; j++)
+    r[j] = (t[j] & keep_t) | (d[j] & ~keep_t);
+}
+
+static void mont_mult_256(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(4, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_384(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(6, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_512(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(8, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_1024(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(16, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_2048(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(32, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_3072(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(48, a, b, m, n0_prime, r);
+}
+
+static void mont_mult_4096(uint64_t* a, uint64_t* b, uint64_t* m, uint64_t n0_prime,
+      uint64_t* r) {
+  mont_mult_cios(64, a, b, m, n0_prime, r);
+}
+
+// -1/m[0] (mod 2^64) by Newton iteration, m[0] odd.
+//   Each step doubles the number of correct low bits; x = m[0] is correct to 3.
+static uint64_t mont_n0_prime(uint64_t m0) {
+  uint64_t x = m0;
+
+  for (int i = 0; i < 5; i++)
+    x *= 2ULL - m0 * x;
+  return 0ULL - x;
+}
+
+mont_context::mont_context() {
+  initialized_ = false;
+  num_digits_ = 0;
+  n0_prime_ = 0ULL;
+  m_ = nullptr;
+  r_mod_m_ = nullptr;
+  r_squared_ = nullptr;
+  kernel_ = nullptr;
+}
+
+mont_context::~mont_context() {
+  clear();
+}
+
+void mont_context::clear() {
+  if (m_ != nullptr) {
+    delete m_;
+    m_ = nullptr;
+  }
+  if (r_mod_m_ != nullptr) {
+    delete r_mod_m_;
+    r_mod_m_ = nullptr;
+  }
+  if (r_squared_ != nullptr) {
+    delete r_squared_;
+    r_squared_ = nullptr;
+  }
+  initialized_ = false;
+  num_digits_ = 0;
+  n0_prime_ = 0ULL;
+  kernel_ = nullptr;
+}
+
+bool mont_context::init(big_num& m) {
+  clear();
+  m.normalize();
+  if (m.is_negative() || (m.value_[0] & 1ULL) == 0ULL || m.is_one())
+    return false;
+
+  num_digits_ = m.size_;
+  n0_prime_ = mont_n0_prime(m.value_[0]);
+  m_ = new big_num(m, num_digits_);
+  r_mod_m_ = new big_num(num_digits_);
+  r_squared_ = new big_num(num_digits_);
+
+  switch (num_digits_ * NBITSINUINT64) {
+    case 256:
+      kernel_ = mont_mult_256;
+      break;
+    case 384:
+      kernel_ = mont_mult_384;
+      break;
+    case 512:
+      kernel_ = mont_mult_512;
+      break;
+    case 1024:
+      kernel_ = mont_mult_1024;
+      break;
+    case 2048:
+      kernel_ = mont_mult_2048;
+      break;
+    case 3072:
+      kernel_ = mont_mult_3072;
+      break;
+    case 4096:
+      kernel_ = mont_mult_4096;
+      break;
+    default:
+      kernel_ = nullptr;
+      break;
+  }
+
+  // R (mod m) and R^2 (mod m), once
+  big_num t(2 * num_digits_ + 2);
+  big_num q(2 * num_digits_ + 2);
+  big_num rem(2 * num_digits_ + 2);
+  if (!big_shift(big_one, NBITSINUINT64 * num_digits_, t))
+    goto fail;
+  if (!big_unsigned_euclid(t, *m_, q, rem))
+    goto fail;
+  if (!r_mod_m_->copy_from(rem))
+    goto fail;
+  t.zero_num();
+  if (!big_shift(big_one, 2 * NBITSINUINT64 * num_digits_, t))
+    goto fail;
+  if (!big_unsigned_euclid(t, *m_, q, rem))
+    goto fail;
+  if (!r_squared_->copy_from(rem))
+    goto fail;
+
+  initialized_ = true;
+  return true;
+
+fail:
+  clear();
+  return false;
+}
+
+// r = a b R^(-1) (mod m).  a, b, r are num_digits_ digits and r may alias a or b.
+void mont_context::mult_digits(uint64_t* a, uint64_t* b, uint64_t* r) {
+  if (kernel_ != nullptr) {
+    (*kernel_)(a, b, m_->value_, n0_prime_, r);
+    return;
+  }
+  mont_mult_cios(num_digits_, a, b, m_->value_, n0_prime_, r);
+}
+
+// mont_a = a R (mod m)
+bool mont_context::to_mont(big_num& a, big_num& mont_a) {
+  if (!initialized_ || mont_a.capacity_ < num_digits_)
+    return false;
+
+  uint64_t x[num_digits_];
+  if (a.is_negative() || big_compare(a, *m_) >= 0) {
+    big_num t(a, a.size_ > num_digits_ ? a.size_ : num_digits_);
+    if (!big_mod_normalize(t, *m_))
+      return false;
+    if (!digit_array_copy(t.size_, t.value_, num_digits_, x))
+      return false;
+  } else {
+    if (!digit_array_copy(a.size_, a.value_, num_digits_, x))
+      return false;
+  }
+  mont_a.zero_num();
+  mult_digits(x, r_squared_->value_, mont_a.value_);
+  mont_a.normalize();
+  return true;
+}
+
+// a = mont_a R^(-1) (mod m)
+bool mont_context::from_mont(big_num& mont_a, big_num& a) {
+  if (!initialized_ || a.capacity_ < num_digits_ || mont_a.size_ > num_digits_)
+    return false;
+
+  uint64_t x[num_digits_];
+  uint64_t one[num_digits_];
+  if (!digit_array_copy(mont_a.size_, mont_a.value_, num_digits_, x))
+    return false;
+  digit_array_zero_num(num_digits_, one);
+  one[0] = 1ULL;
+  a.zero_num();
+  mult_digits(x, one, a.value_);
+  a.normalize();
+  return true;
+}
+
+// abR = aR bR R^(-1) (mod m)
+bool mont_context::mult(big_num& aR, big_num& bR, big_num& abR) {
+  if (!initialized_ || abR.capacity_ < num_digits_ ||
+      aR.size_ > num_digits_ || bR.size_ > num_digits_)
+    return false;
+
+  uint64_t x[num_digits_];
+  uint64_t y[num_digits_];
+  if (!digit_array_copy(aR.size_, aR.value_, num_digits_, x))
+    return false;
+  if (!digit_array_copy(bR.size_, bR.value_, num_digits_, y))
+    return false;
+  abR.zero_num();
+  mult_digits(x, y, abR.value_);
+  abR.normalize();
+  return true;
+}
+
+bool mont_context::square(big_num& aR, big_num& a2R) {
+  return mult(aR, aR, a2R);
+}
+
+// Windowed exponentiation
+//   big_mont_window_exp is a left to right sliding window over the exponent
+//   with a table of the odd powers b, b^3, ..., b^(2^w - 1) in Montgomery
+//   form.  It runs in time that depends on e and is for public exponents.
+//   big_mont_fixed_window_exp processes e in w bit chunks, always squares
+//   w times, always multiplies and reads every table entry with a mask.  Use
+//   it for private exponents.
+
+// Window size for an exponent of exp_bits bits.
+int big_exp_window_size(int exp_bits) {
+  if (exp_bits > 671)
+    return 6;
+  if (exp_bits > 239)
+    return 5;
+  if (exp_bits > 79)
+    return 4;
+  if (exp_bits > 23)
+    return 3;
+  return 1;
+}
+
+static inline int exp_bit(uint64_t* e, int i) {
+  return (int)((e[i / NBITSINUINT64] >> (i % NBITSINUINT64)) & 1ULL);
+}
+
+// Copy the n digit result x into out, which need not be n digits long.
+static bool mont_result_to_big_num(int n, uint64_t* x, big_num& out) {
+  int k = digit_array_real_size(n, x);
+  if (k > out.capacity_)
+    return false;
+  out.zero_num();
+  if (!digit_array_copy(k, x, out.capacity_, out.value_))
+    return false;
+  out.normalize();
+  return true;
+}
+
+// out = b^e (mod m), sliding window
+bool big_mont_window_exp(mont_context& ctx, big_num& b, big_num& e, big_num& out) {
+  if (!ctx.initialized_)
+    return false;
+  int n = ctx.num_digits_;
+  e.normalize();
+  int k = big_high_bit(e);
+  if (k == 0) {
+    uint64_t one = 1ULL;
+    return mont_result_to_big_num(1, &one, out);
+  }
+
+  int w = big_exp_window_size(k);
+  int num_odd_powers = 1 << (w - 1);
+  uint64_t table[num_odd_powers * n];
+  uint64_t b_squared[n];
+  uint64_t accum[n];
+  uint64_t one[n];
+  big_num mont_b(n);
+
+  if (!ctx.to_mont(b, mont_b))
+    return false;
+  digit_array_copy(mont_b.size_, mont_b.value_, n, table);
+  if (num_odd_powers > 1) {
+    ctx.mult_digits(table, table, b_squared);
+    for (int i = 1; i < num_odd_powers; i++)
+      ctx.mult_digits(&table[(i - 1) * n], b_squared, &table[i * n]);
+  }
+
+  digit_array_copy(ctx.r_mod_m_->size_, ctx.r_mod_m_->value_, n, accum);
+  int i = k - 1;
+  while (i >= 0) {
+    if (exp_bit(e.value_, i) == 0) {
+      ctx.mult_digits(accum, accum, accum);
+      i--;
+      continue;
+    }
+    // longest window [j, i] of at most w bits ending in a one
+    int j = i - w + 1;
+    if (j < 0)
+      j = 0;
+    while (exp_bit(e.value_, j) == 0)
+      j++;
+    int val = 0;
+    for (int l = i; l >= j; l--) {
+      ctx.mult_digits(accum, accum, accum);
+      val = (val << 1) | exp_bit(e.value_, l);
+    }
+    ctx.mult_digits(accum, &table[(val >> 1) * n], accum);
+    i = j - 1;
+  }
+
+  digit_array_zero_num(n, one);
+  one[0] = 1ULL;
+  ctx.mult_digits(accum, one, accum);
+  bool ret = mont_result_to_big_num(n, accum, out);
+  digit_array_zero_num(num_odd_powers * n, table);
+  digit_array_zero_num(n, accum);
+  return ret;
+}
+
+// out = b^e (mod m), fixed window with constant time table reads
+bool big_mont_fixed_window_exp(mont_context& ctx, big_num& b, big_num& e, big_num& out) {
+  if (!ctx.initialized_)
+    return false;
+  int n = ctx.num_digits_;
+  int e_digits = e.size_ > n ? e.size_ : n;
+  int num_bits = e_digits * NBITSINUINT64;
+  int w = big_exp_window_size(num_bits);
+  if (w > 5)
+    w = 5;
+  int table_size = 1 << w;
+  uint64_t table[table_size * n];
+  uint64_t x[e_digits];
+  uint64_t accum[n];
+  uint64_t sel[n];
+  uint64_t one[n];
+  big_num mont_b(n);
+
+  if (!digit_array_copy(e.size_, e.value_, e_digits, x))
+    return false;
+  if (!ctx.to_mont(b, mont_b))
+    return false;
+  digit_array_copy(ctx.r_mod_m_->size_, ctx.r_mod_m_->value_, n, table);
+  digit_array_copy(mont_b.size_, mont_b.value_, n, &table[n]);
+  for (int i = 2; i < table_size; i++)
+    ctx.mult_digits(&table[(i - 1) * n], &table[n], &table[i * n]);
+
+  digit_array_copy(ctx.r_mod_m_->size_, ctx.r_mod_m_->value_, n, accum);
+  int top = ((num_bits + w - 1) / w) * w;
+  for (int i = top - w; i >= 0; i -= w) {
+    int val = 0;
+    for (int l = w - 1; l >= 0; l--) {
+      ctx.mult_digits(accum, accum, accum);
+      if ((i + l) < num_bits)
+        val = (val << 1) | exp_bit(x, i + l);
+      else
+        val <<= 1;
+    }
+    digit_array_zero_num(n, sel);
+    for (int t = 0; t < table_size; t++) {
+      uint64_t mask = 0ULL - (uint64_t)(t == val);
+      for (int j = 0; j < n; j++)
+        sel[j] |= table[t * n + j] & mask;
+    }
+    ctx.mult_digits(accum, sel, accum);
+  }
+
+  digit_array_zero_num(n, one);
+  one[0] = 1ULL;
+  ctx.mult_digits(accum, one, accum);
+  bool ret = mont_result_to_big_num(n, accum, out);
+  digit_array_zero_num(table_size * n, table);
+  digit_array_zero_num(e_digits, x);
+  digit_array_zero_num(n, accum);
+  digit_array_zero_num(n, sel);
+  return ret;
+}
+
+// r = a*b (mod m) on k digit residues for big_batch_mod_inv.  With a
+//   Montgomery context this is the Montgomery product a b R^(-1).
+static bool batch_mult(mont_context* ctx, big_num& m, int k, uint64_t* a,
+                       uint64_t* b, uint64_t* r, big_num& t1, big_num& t2,
+                       big_num& t3) {
+  if (ctx != nullptr) {
+    ctx->mult_digits(a, b, r);
+    return true;
+  }
+  t1.zero_num();
+  t2.zero_num();
+  t3.zero_num();
+  if (!digit_array_copy(k, a, t1.capacity_, t1.value_) ||
+      !digit_array_copy(k, b, t2.capacity_, t2.value_))
+    return false;
+  t1.normalize();
+  t2.normalize();
+  if (!big_unsigned_mult(t1, t2, t3))
+    return false;
+  if (!big_mod(t3, m, t1))
+    return false;
+  digit_array_zero_num(k, r);
+  return digit_array_copy(t1.size_, t1.value_, k, r);
+}
+
+// Batch inversion (Montgomery's trick)
+//   out[i] = in[i]^(-1) (mod m), using one extended gcd and 3(k-1)
+//   multiplications for the k inputs that are nonzero mod m.  Inputs
+//   that are 0 (mod m) have no inverse: their out[i] is set to 0 and
+//   they are left out of the running product.  Fails if any other input
+//   is not invertible.  out[i] may be in[i].
+//   For odd m the products are Montgomery products left unconverted.
+//   With c_j = a_0 ... a_j R^(-j), the inverse of c_(k-1) is
+//   (a_0 ... a_(k-1))^(-1) R^(k-1) and each backward step drops one R,
+//   so the results come out in ordinary form.
+bool big_batch_mod_inv(int n, big_num** in, big_num& m, big_num** out) {
+  if (n <= 0)
+    return n == 0;
+  m.normalize();
+  if (m.is_negative() || m.is_zero() || m.is_one())
+    return false;
+
+  int k = m.size_;
+  mont_context mont;
+  mont_context* ctx = nullptr;
+  if ((m.value_[0] & 1ULL) != 0ULL) {
+    if (!mont.init(m))
+      return false;
+    ctx = &mont;
+  }
+
+  bool ret = false;
+  int num = 0;
+  int i, j;
+  uint64_t* a = new uint64_t[n * k];
+  uint64_t* c = new uint64_t[n * k];
+  uint64_t* u = new uint64_t[2 * k];
+  uint64_t* v = &u[k];
+  int* idx = new int[n];
+  big_num t1(2 * k + 2);
+  big_num t2(2 * k + 2);
+  big_num t3(2 * k + 2);
+  big_num x(2 * k + 2);
+  big_num y(2 * k + 2);
+  big_num g(2 * k + 2);
+
+  // reduce the inputs and drop the zeros
+  for (i = 0; i < n; i++) {
+    int cap = in[i]->size_ > k ? in[i]->size_ : k;
+    big_num r(*in[i], cap);
+    if (!big_mod_normalize(r, m))
+      goto done;
+    if (r.is_zero()) {
+      out[i]->zero_num();
+      continue;
+    }
+    digit_array_zero_num(k, &a[num * k]);
+    if (!digit_array_copy(r.size_, r.value_, k, &a[num * k]))
+      goto done;
+    idx[num++] = i;
+  }
+  if (num == 0) {
+    ret = true;
+    goto done;
+  }
+
+  // c_j = a_0 ... a_j
+  digit_array_copy(k, a, k, c);
+  for (j = 1; j < num; j++) {
+    if (!batch_mult(ctx, m, k, &c[(j - 1) * k], &a[j * k], &c[j * k], t1, t2, t3))
+      goto done;
+  }
+
+  // u = c_(num-1)^(-1)
+  t1.zero_num();
+  digit_array_copy(k, &c[(num - 1) * k], t1.capacity_, t1.value_);
+  t1.normalize();
+  if (!big_extended_gcd(t1, m, x, y, g) || !g.is_one())
+    goto done;
+  if (!big_mod_normalize(x, m))
+    goto done;
+  digit_array_zero_num(k, u);
+  if (!digit_array_copy(x.size_, x.value_, k, u))
+    goto done;
+
+  // out_j = u c_(j-1), u = u a_j
+  for (j = num - 1; j > 0; j--) {
+    if (!batch_mult(ctx, m, k, u, &c[(j - 1) * k], v, t1, t2, t3))
+      goto done;
+    if (!batch_mult(ctx, m, k, u, &a[j * k], u, t1, t2, t3))
+      goto done;
+    if (!mont_result_to_big_num(k, v, *out[idx[j]]))
+      goto done;
+  }
+  if (!mont_result_to_big_num(k, u, *out[idx[0]]))
+    goto done;
+  ret = true;
+
+done:
+  digit_array_zero_num(n * k, a);
+  digit_array_zero_num(n * k, c);
+  digit_array_zero_num(2 * k, u);
+  delete []a;
+  delete []c;
+  delete []u;
+  delete []idx;
+  return ret;
+}
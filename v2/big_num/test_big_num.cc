@@ -1524,6 +1524,762 @@ bool big_mont_test1() {
   return true;
 }
 
+// Compare mont_context against big_mod_mult for random odd moduli
+bool mont_context_test1() {
+  int sizes[] = {4, 5, 6, 8, 16, 32, 48, 64};
+  int num_sizes = sizeof(sizes) / sizeof(int);
+
+  for (int k = 0; k < num_sizes; k++) {
+    int n = sizes[k];
+    big_num m(n);
+    big_num a(2 * n + 1);
+    big_num b(2 * n + 1);
+    big_num mont_a(2 * n + 1);
+    big_num mont_b(2 * n + 1);
+    big_num mont_c(2 * n + 1);
+    big_num c(2 * n + 1);
+    big_num check(2 * n + 1);
+    mont_context ctx;
+
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)m.value_ptr()) < 0)
+      return false;
+    m.value_[0] |= 1ULL;
+    m.value_[n - 1] |= 1ULL << 63;
+    m.normalize();
+    if (!ctx.init(m)) {
+      printf("mont_context init failed, %d digits\n", n);
+      return false;
+    }
+
+    for (int i = 0; i < 10; i++) {
+      a.zero_num();
+      b.zero_num();
+      if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)a.value_ptr()) < 0)
+        return false;
+      if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)b.value_ptr()) < 0)
+        return false;
+      a.normalize();
+      b.normalize();
+      if (!big_mod_normalize(a, m) || !big_mod_normalize(b, m))
+        return false;
+
+      if (!ctx.to_mont(a, mont_a) || !ctx.to_mont(b, mont_b))
+        return false;
+      if (!ctx.mult(mont_a, mont_b, mont_c))
+        return false;
+      if (!ctx.from_mont(mont_c, c))
+        return false;
+      check.zero_num();
+      if (!big_mod_mult(a, b, m, check))
+        return false;
+      if (big_compare(c, check) != 0) {
+        printf("mont_context mult mismatch, %d digits\n", n);
+        if (FLAGS_print_all) {
+          printf("  a    : "); a.print(); printf("\n");
+          printf("  b    : "); b.print(); printf("\n");
+          printf("  ab   : "); check.print(); printf("\n");
+          printf("  mont : "); c.print(); printf("\n");
+        }
+        return false;
+      }
+
+      if (!ctx.square(mont_a, mont_c))
+        return false;
+      if (!ctx.from_mont(mont_c, c))
+        return false;
+      check.zero_num();
+      if (!big_mod_mult(a, a, m, check))
+        return false;
+      if (big_compare(c, check) != 0) {
+        printf("mont_context square mismatch, %d digits\n", n);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// reference b^e (mod m) by right to left square and multiply
+bool reference_mod_exp(big_num& b, big_num& e, big_num& m, big_num& r) {
+  int n = 2 * m.size_ + 2;
+  big_num accum(n, 1ULL);
+  big_num square(n);
+  big_num t(n);
+
+  if (!big_mod(b, m, square))
+    return false;
+  for (int i = 1; i <= big_high_bit(e); i++) {
+    if (big_bit_position_on(e, i)) {
+      t.zero_num();
+      if (!big_mod_mult(accum, square, m, t))
+        return false;
+      accum.copy_from(t);
+    }
+    t.zero_num();
+    if (!big_mod_mult(square, square, m, t))
+      return false;
+    square.copy_from(t);
+  }
+  return r.copy_from(accum);
+}
+
+bool window_exp_test1() {
+  int sizes[] = {1, 4, 7, 16, 32};
+  int num_sizes = sizeof(sizes) / sizeof(int);
+
+  for (int k = 0; k < num_sizes; k++) {
+    int n = sizes[k];
+    big_num m(n);
+    big_num b(n + 1);
+    big_num e(n + 1);
+    big_num r1(n + 1);
+    big_num r2(n + 1);
+    big_num r3(n + 1);
+    big_num r4(n + 1);
+    mont_context ctx;
+
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)m.value_ptr()) < 0)
+      return false;
+    m.value_[0] |= 1ULL;
+    m.value_[n - 1] |= 1ULL << 63;
+    m.normalize();
+    if (!ctx.init(m))
+      return false;
+
+    for (int i = 0; i < 4; i++) {
+      b.zero_num();
+      e.zero_num();
+      if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)b.value_ptr()) < 0)
+        return false;
+      // exponents of several lengths, including a one digit exponent
+      int e_digits = (i == 0) ? 1 : n;
+      if (crypto_get_random_bytes(e_digits * sizeof(uint64_t), (byte_t*)e.value_ptr()) < 0)
+        return false;
+      b.normalize();
+      e.normalize();
+
+      if (!reference_mod_exp(b, e, m, r1))
+        return false;
+      if (!big_mont_window_exp(ctx, b, e, r2))
+        return false;
+      if (!big_mont_fixed_window_exp(ctx, b, e, r3))
+        return false;
+      if (!big_mod_exp(b, e, m, r4))
+        return false;
+      if (big_compare(r1, r2) != 0 || big_compare(r1, r3) != 0 ||
+          big_compare(r1, r4) != 0) {
+        printf("window exp mismatch, %d digits\n", n);
+        if (FLAGS_print_all) {
+          printf("  reference    : "); r1.print(); printf("\n");
+          printf("  sliding      : "); r2.print(); printf("\n");
+          printf("  fixed        : "); r3.print(); printf("\n");
+          printf("  big_mod_exp  : "); r4.print(); printf("\n");
+        }
+        return false;
+      }
+    }
+
+    // e = 0
+    e.zero_num();
+    if (!big_mont_window_exp(ctx, b, e, r2) || !r2.is_one())
+      return false;
+    if (!big_mont_fixed_window_exp(ctx, b, e, r3) || !r3.is_one())
+      return false;
+  }
+  return true;
+}
+
+// x a + y b = g and g divides a and b, so g is the gcd
+bool extended_gcd_check(big_num& a, big_num& b) {
+  int n = (a.size_ > b.size_ ? a.size_ : b.size_) + 1;
+  big_num x(n);
+  big_num y(n);
+  big_num g(n);
+  big_num t1(2 * n + 1);
+  big_num t2(2 * n + 1);
+  big_num t3(2 * n + 1);
+  big_num q(2 * n + 1);
+  big_num r(2 * n + 1);
+
+  if (!big_extended_gcd(a, b, x, y, g))
+    return false;
+  if (!big_mult(x, a, t1) || !big_mult(y, b, t2) || !big_add(t1, t2, t3))
+    return false;
+  if (big_compare(t3, g) != 0) {
+    printf("extended gcd: xa + yb != g\n");
+    printf("a: "); a.print(); printf("\n");
+    printf("b: "); b.print(); printf("\n");
+    return false;
+  }
+  if (g.is_zero())
+    return a.is_zero() && b.is_zero();
+  if (!a.is_zero() && (!big_unsigned_euclid(a, g, q, r) || !r.is_zero()))
+    return false;
+  if (!b.is_zero() && (!big_unsigned_euclid(b, g, q, r) || !r.is_zero()))
+    return false;
+  return true;
+}
+
+bool extended_gcd_test1() {
+  int sizes[] = {1, 2, 3, 5, 8, 16, 33};
+  int num_sizes = sizeof(sizes) / sizeof(int);
+  big_num a(80);
+  big_num b(80);
+  big_num c(80);
+  big_num t(80);
+
+  for (int i = 0; i < num_sizes; i++) {
+    for (int j = 0; j < num_sizes; j++) {
+      a.zero_num();
+      b.zero_num();
+      if (crypto_get_random_bytes(sizes[i] * sizeof(uint64_t),
+                                  (byte_t*)a.value_) < 0 ||
+          crypto_get_random_bytes(sizes[j] * sizeof(uint64_t),
+                                  (byte_t*)b.value_) < 0)
+        return false;
+      a.normalize();
+      b.normalize();
+      if (!extended_gcd_check(a, b))
+        return false;
+
+      // common factor
+      c.zero_num();
+      if (crypto_get_random_bytes(sizes[(i + j) % 3] * sizeof(uint64_t),
+                                  (byte_t*)c.value_) < 0)
+        return false;
+      c.normalize();
+      if (!big_mult(a, c, t) || !a.copy_from(t))
+        return false;
+      if (!big_mult(b, c, t) || !b.copy_from(t))
+        return false;
+      if (!extended_gcd_check(a, b))
+        return false;
+    }
+  }
+
+  // edge cases
+  if (!extended_gcd_check(a, a) || !extended_gcd_check(a, big_one) ||
+      !extended_gcd_check(big_one, a) || !extended_gcd_check(big_zero, a) ||
+      !extended_gcd_check(a, big_zero))
+    return false;
+  big_num f1(2, 0xffffffffffffffffULL);
+  big_num f2(2, 0x7fffffffffffffffULL);
+  if (!extended_gcd_check(f1, f2) || !extended_gcd_check(f2, f1))
+    return false;
+  return true;
+}
+
+bool mod_inv_ct_test1() {
+  int bits[] = {64, 255, 521, 1024, 2048};
+  big_num m(40);
+  big_num a(40);
+  big_num r1(40);
+  big_num r2(40);
+
+  for (int i = 0; i < (int)(sizeof(bits) / sizeof(int)); i++) {
+    for (int k = 0; k < 2; k++) {
+      // a prime and a random odd modulus
+      m.zero_num();
+      if (k == 0) {
+        // one search from a single base can come up empty at 2048 bits
+        bool found = false;
+        for (int t = 0; t < 5 && !found; t++)
+          found = big_gen_prime(m, bits[i], 20000);
+        if (!found)
+          return false;
+      } else {
+        if (crypto_get_random_bytes(bits[i] / NBITSINBYTE,
+                                    (byte_t*)m.value_) < 0)
+          return false;
+        m.value_[0] |= 1ULL;
+        m.normalize();
+      }
+      for (int j = 0; j < 5; j++) {
+        a.zero_num();
+        if (crypto_get_random_bytes(m.size_ * sizeof(uint64_t),
+                                    (byte_t*)a.value_) < 0)
+          return false;
+        a.normalize();
+        if (!big_mod_normalize(a, m))
+          return false;
+        if (j == 0)
+          a.copy_from(big_one);
+        bool ok1 = big_mod_inv(a, m, r1);
+        bool ok2 = big_mod_inv_ct(a, m, r2);
+        big_num g(40);
+        big_num x(40);
+        big_num y(40);
+        if (!big_extended_gcd(a, m, x, y, g))
+          return false;
+        if (!g.is_one()) {
+          if (ok2)
+            return false;
+          continue;
+        }
+        if (!ok1 || !ok2 || big_compare(r1, r2) != 0) {
+          printf("big_mod_inv_ct mismatch, %d bits\n", bits[i]);
+          return false;
+        }
+      }
+    }
+  }
+
+  // not invertible
+  big_num m3(1, 21ULL);
+  big_num a3(1, 14ULL);
+  if (big_mod_inv_ct(a3, m3, r1))
+    return false;
+  // even modulus is not supported
+  big_num m4(1, 22ULL);
+  big_num a4(1, 3ULL);
+  if (big_mod_inv_ct(a4, m4, r1))
+    return false;
+  return true;
+}
+
+bool gen_prime_test1() {
+  int bits[] = {16, 65, 127, 512, 1024};
+  int threads[] = {1, 3};
+  big_num p(20);
+
+  for (int i = 0; i < (int)(sizeof(bits) / sizeof(int)); i++) {
+    for (int j = 0; j < 2; j++) {
+      if (!big_gen_prime(p, bits[i], 2500, threads[j])) {
+        printf("big_gen_prime fails, %d bits\n", bits[i]);
+        return false;
+      }
+      if (big_high_bit(p) != bits[i] || !big_bit_position_on(p, bits[i] - 1)) {
+        printf("big_gen_prime, wrong size\n");
+        return false;
+      }
+      if (!big_is_prime(p)) {
+        printf("big_gen_prime, not prime\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool batch_check(big_num& m, int num) {
+  int n = m.size_;
+  big_num_batch a(num, n);
+  big_num_batch b(num, n);
+  big_num_batch e(num, n);
+  big_num_batch r(num, n);
+  big_num_batch aR(num, n);
+  big_num_batch bR(num, n);
+  big_num x(2 * n + 1);
+  big_num y(2 * n + 1);
+  big_num f(2 * n + 1);
+  big_num z(2 * n + 1);
+  big_num w(2 * n + 1);
+  big_num e_common(n);
+  big_num e_short(1, 0x010001ULL);
+  int j;
+
+  // operands may be larger than m
+  if (crypto_get_random_bytes(num * n * sizeof(uint64_t), (byte_t*)a.value_) < 0 ||
+      crypto_get_random_bytes(num * n * sizeof(uint64_t), (byte_t*)b.value_) < 0 ||
+      crypto_get_random_bytes(num * n * sizeof(uint64_t), (byte_t*)e.value_) < 0 ||
+      crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)e_common.value_) < 0)
+    return false;
+  e_common.normalize();
+  x.zero_num();
+  if (num > 3 && (!a.set(1, x) || !b.set(2, big_one) || !e.set(3, x)))
+    return false;
+
+  if (!big_batch_mod_mult(a, b, m, r))
+    return false;
+  for (j = 0; j < num; j++) {
+    if (!a.get(j, x) || !b.get(j, y) || !r.get(j, z) || !big_mod_mult(x, y, m, w))
+      return false;
+    if (big_compare(z, w) != 0) {
+      printf("big_batch_mod_mult, number %d wrong\n", j);
+      return false;
+    }
+  }
+
+  for (int t = 0; t < 2; t++) {
+    big_num& exponent = t == 0 ? e_short : e_common;
+    if (!big_batch_mod_exp(a, exponent, m, r))
+      return false;
+    for (j = 0; j < num; j++) {
+      if (!a.get(j, x) || !r.get(j, z) || !big_mod_exp(x, exponent, m, w))
+        return false;
+      if (big_compare(z, w) != 0) {
+        printf("big_batch_mod_exp, number %d wrong\n", j);
+        return false;
+      }
+    }
+  }
+
+  if (!big_batch_mod_exp(a, e, m, r))
+    return false;
+  for (j = 0; j < num; j++) {
+    if (!a.get(j, x) || !e.get(j, f) || !r.get(j, z) || !big_mod_exp(x, f, m, w))
+      return false;
+    if (big_compare(z, w) != 0) {
+      printf("big_batch_mod_exp, exponent %d wrong\n", j);
+      return false;
+    }
+  }
+
+  // Montgomery round trip
+  if ((m.value_[0] & 1ULL) == 0ULL)
+    return true;
+  batch_mont_context ctx;
+  if (!ctx.init(m) || !ctx.to_mont(a, aR) || !ctx.to_mont(b, bR))
+    return false;
+  if (!big_batch_mont_mult(ctx, aR, bR, aR) || !ctx.from_mont(aR, aR))
+    return false;
+  if (!big_batch_mod_mult(a, b, m, r))
+    return false;
+  for (j = 0; j < num; j++) {
+    if (!aR.get(j, x) || !r.get(j, z) || big_compare(x, z) != 0) {
+      printf("big_batch_mont_mult, number %d wrong\n", j);
+      return false;
+    }
+  }
+  return true;
+}
+
+bool batch_arith_test1() {
+  int bits[] = {128, 256, 1024, 2048};
+  int nums[] = {1, 8, 13};
+  bool save_ifma = big_batch_use_ifma;
+  bool ret = true;
+  big_num m(40);
+
+  for (int k = 0; k < 2 && ret; k++) {
+    // scalar kernel, then IFMA if it is present
+    if (k == 1 && !have_intel_avx512_ifma()) {
+      printf("avx512 ifma not present, ifma batch kernels not tested\n");
+      break;
+    }
+    big_batch_use_ifma = k == 1;
+    for (int i = 0; i < (int)(sizeof(bits) / sizeof(int)) && ret; i++) {
+      for (int t = 0; t < 2 && ret; t++) {
+        m.zero_num();
+        if (crypto_get_random_bytes(bits[i] / NBITSINBYTE, (byte_t*)m.value_) < 0) {
+          ret = false;
+          break;
+        }
+        m.value_[bits[i] / NBITSINUINT64 - 1] |= 1ULL << (NBITSINUINT64 - 1);
+        m.value_[0] |= 1ULL;
+        m.normalize();
+        if (t == 1 && i == 0)
+          m.value_[0] ^= 1ULL;  // even modulus
+        for (int j = 0; j < 3 && ret; j++)
+          ret = batch_check(m, nums[j]);
+      }
+    }
+  }
+  big_batch_use_ifma = save_ifma;
+  return ret;
+}
+
+bool batch_mod_inv_test1() {
+  const int num = 9;
+  int bits[] = {256, 521, 1024};
+  big_num* in[num];
+  big_num* out[num];
+  big_num check(40);
+  bool ret = true;
+
+  for (int i = 0; i < num; i++) {
+    in[i] = new big_num(20);
+    out[i] = new big_num(20);
+  }
+  for (int t = 0; t < 4 && ret; t++) {
+    // three prime moduli and one even modulus
+    big_num m(20);
+    if (t < 3) {
+      bool found = false;
+      for (int k = 0; k < 5 && !found; k++)
+        found = big_gen_prime(m, bits[t], 20000);
+      if (!found) {
+        ret = false;
+        break;
+      }
+    } else {
+      m.value_[4] = 1ULL << 44;  // 2^300
+      m.normalize();
+    }
+    for (int i = 0; i < num; i++) {
+      in[i]->zero_num();
+      if (i == 2 || i == 7)
+        continue;  // zero inputs
+      if (crypto_get_random_bytes(m.size_ * sizeof(uint64_t),
+                                  (byte_t*)in[i]->value_) < 0) {
+        ret = false;
+        break;
+      }
+      in[i]->value_[0] |= 1ULL;  // odd, so invertible mod the even m too
+      in[i]->normalize();
+      if (i == 5 && !big_mod_normalize(*in[i], m)) {
+        ret = false;
+        break;
+      }
+    }
+    if (ret && t == 1) {
+      // out may be in
+      if (!big_batch_mod_inv(num, in, m, in)) {
+        ret = false;
+        break;
+      }
+      for (int i = 0; i < num; i++)
+        out[i]->copy_from(*in[i]);
+    } else if (ret && !big_batch_mod_inv(num, in, m, out)) {
+      printf("big_batch_mod_inv failed\n");
+      ret = false;
+      break;
+    }
+    for (int i = 0; i < num && ret && t != 1; i++) {
+      if (in[i]->is_zero()) {
+        if (!out[i]->is_zero())
+          ret = false;
+        continue;
+      }
+      if (!big_mod_mult(*in[i], *out[i], m, check) || !check.is_one()) {
+        printf("batch inverse %d wrong\n", i);
+        ret = false;
+      }
+    }
+    for (int i = 0; i < num && ret && t == 1; i++) {
+      if ((i == 2 || i == 7) != out[i]->is_zero())
+        ret = false;
+    }
+  }
+
+  // a shared factor with m makes the batch fail
+  if (ret) {
+    big_num m(4, 15ULL);
+    in[0]->copy_from(big_two);
+    in[1]->copy_from(big_five);
+    if (big_batch_mod_inv(2, in, m, out))
+      ret = false;
+  }
+
+  for (int i = 0; i < num; i++) {
+    delete in[i];
+    delete out[i];
+  }
+  return ret;
+}
+
+bool big_num_arena_test1() {
+  big_num_arena arena(64);
+  big_num_arena::mark m0 = arena.get_mark();
+
+  // small values stay inline and ignore the arena
+  big_num s(&arena, BIG_NUM_INLINE_DIGITS);
+  big_num_arena::mark m1 = arena.get_mark();
+  if (m1.block_ != m0.block_ || m1.used_ != m0.used_)
+    return false;
+
+  {
+    big_num a(&arena, 40);
+    big_num b(&arena, 100);  // larger than a block
+    big_num c(&arena, 2 * 40 + 1);
+    if (a.value_ == nullptr || b.value_ == nullptr || c.value_ == nullptr)
+      return false;
+    for (int i = 0; i < 40; i++)
+      a.value_[i] = (uint64_t)(i + 1);
+    a.normalize();
+    if (!big_unsigned_square(a, c) || !big_unsigned_mult(a, a, b))
+      return false;
+    if (big_compare(b, c) != 0)
+      return false;
+  }
+  arena.release();
+
+  // scopes nest, and temporaries inside them come from the arena
+  big_num_arena::set_thread_arena(nullptr);
+  big_num outer(64);
+  outer.value_[0] = 5ULL;
+  {
+    big_num_arena_scope scope(&arena);
+    if (big_num_arena::thread_arena() != &arena)
+      return false;
+    big_num x(64);
+    big_num_arena::mark m2 = arena.get_mark();
+    {
+      big_num_arena_scope inner(&arena);
+      big_num y(64);
+      big_num z(64);
+    }
+    big_num_arena::mark m3 = arena.get_mark();
+    if (m2.block_ != m3.block_ || m2.used_ != m3.used_)
+      return false;
+    if (!big_unsigned_add(outer, outer, x) || x.value_[0] != 10ULL)
+      return false;
+  }
+  if (big_num_arena::thread_arena() != nullptr)
+    return false;
+  return outer.value_[0] == 5ULL;
+}
+
+// Compare the MULX/ADX kernels against the mulq kernels.
+bool mulx_kernel_test1() {
+  if (!have_intel_bmi2_adx()) {
+    printf("bmi2/adx not present, mulx kernels not tested\n");
+    return true;
+  }
+  bool save_mulx = digit_array_use_mulx;
+  bool ret = true;
+  uint64_t a[66];
+  uint64_t b[66];
+  uint64_t r1[132];
+  uint64_t r2[132];
+
+  for (int n = 1; n <= 64 && ret; n++) {
+    for (int t = 0; t < 4 && ret; t++) {
+      if (t == 0) {
+        for (int i = 0; i < n; i++) {
+          a[i] = 0xffffffffffffffffULL;
+          b[i] = 0xffffffffffffffffULL;
+        }
+      } else {
+        if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)a) < 0 ||
+            crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)b) < 0) {
+          ret = false;
+          break;
+        }
+        a[n - 1] |= 1ULL;
+      }
+      int m = (t == 3) ? (n + 1) / 2 : n;
+      if (b[m - 1] == 0ULL)
+        b[m - 1] = 1ULL;
+
+      digit_array_use_mulx = false;
+      int k1 = digit_array_mult(n, a, m, b, 2 * n, r1);
+      digit_array_use_mulx = true;
+      int k2 = digit_array_mult(n, a, m, b, 2 * n, r2);
+      if (k1 < 0 || k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+        printf("mulx mult mismatch, %d x %d digits\n", n, m);
+        ret = false;
+        break;
+      }
+
+      digit_array_use_mulx = false;
+      k1 = digit_array_square(n, a, 2 * n, r1);
+      digit_array_use_mulx = true;
+      k2 = digit_array_square(n, a, 2 * n, r2);
+      if (k1 < 0 || k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+        printf("mulx square mismatch, %d digits\n", n);
+        ret = false;
+        break;
+      }
+
+      digit_array_zero_num(n + 1, r1);
+      digit_array_zero_num(n + 1, r2);
+      digit_array_copy(n, a, n + 1, r1);
+      digit_array_copy(n, a, n + 1, r2);
+      digit_array_use_mulx = false;
+      digit_array_mult_by(n + 1, n, r1, b[0]);
+      digit_array_use_mulx = true;
+      digit_array_mult_by(n + 1, n, r2, b[0]);
+      if (digit_array_compare(n + 1, r1, n + 1, r2) != 0) {
+        printf("mulx mult_by mismatch, %d digits\n", n);
+        ret = false;
+        break;
+      }
+    }
+  }
+  digit_array_use_mulx = save_mulx;
+  return ret;
+}
+
+// Compare the Karatsuba/Toom-3 tiers against the schoolbook kernel.
+bool fast_mult_check(int size_a, int size_b, bool all_ones) {
+  int size_r = size_a + size_b;
+  int size_s = 2 * size_a;
+  uint64_t* a = new uint64_t[size_a];
+  uint64_t* b = new uint64_t[size_b];
+  uint64_t* r1 = new uint64_t[size_r > size_s ? size_r : size_s];
+  uint64_t* r2 = new uint64_t[size_r > size_s ? size_r : size_s];
+  bool ret = false;
+  int k1, k2;
+
+  if (all_ones) {
+    for (int i = 0; i < size_a; i++)
+      a[i] = 0xffffffffffffffffULL;
+    for (int i = 0; i < size_b; i++)
+      b[i] = 0xffffffffffffffffULL;
+  } else {
+    if (crypto_get_random_bytes(size_a * sizeof(uint64_t), (byte_t*)a) < 0)
+      goto done;
+    if (crypto_get_random_bytes(size_b * sizeof(uint64_t), (byte_t*)b) < 0)
+      goto done;
+    a[size_a - 1] |= 1ULL;
+    b[size_b - 1] |= 1ULL;
+  }
+
+  k1 = digit_array_mult(size_a, a, size_b, b, size_r, r1);
+  k2 = digit_array_fast_mult(size_a, a, size_b, b, size_r, r2);
+  if (k1 < 0 || k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+    printf("fast mult mismatch, %d x %d digits\n", size_a, size_b);
+    goto done;
+  }
+  k2 = digit_array_fast_mult(size_b, b, size_a, a, size_r, r2);
+  if (k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+    printf("fast mult mismatch, %d x %d digits\n", size_b, size_a);
+    goto done;
+  }
+
+  k1 = digit_array_mult(size_a, a, size_a, a, size_s, r1);
+  k2 = digit_array_fast_square(size_a, a, size_s, r2);
+  if (k1 < 0 || k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+    printf("fast square mismatch, %d digits\n", size_a);
+    goto done;
+  }
+  k2 = digit_array_square(size_a, a, size_s, r2);
+  if (k1 != k2 || digit_array_compare(k1, r1, k2, r2) != 0) {
+    printf("square kernel mismatch, %d digits\n", size_a);
+    goto done;
+  }
+  ret = true;
+
+done:
+  delete []a;
+  delete []b;
+  delete []r1;
+  delete []r2;
+  return ret;
+}
+
+bool fast_mult_test1() {
+  int sizes[] = {1, 3, 23, 24, 25, 31, 32, 33, 47, 64, 100, 159, 160, 161, 200, 321};
+  int num_sizes = sizeof(sizes) / sizeof(int);
+  int save_karatsuba = big_karatsuba_threshold;
+  int save_square = big_karatsuba_square_threshold;
+  int save_toom3 = big_toom3_threshold;
+  bool ret = true;
+
+  for (int pass = 0; pass < 2 && ret; pass++) {
+    // second pass drives small operands through every tier
+    if (pass == 1) {
+      big_karatsuba_threshold = 4;
+      big_karatsuba_square_threshold = 4;
+      big_toom3_threshold = 12;
+    }
+    for (int k = 0; k < num_sizes && ret; k++) {
+      int n = sizes[k];
+      if (!fast_mult_check(n, n, false) || !fast_mult_check(n, n, true) ||
+          !fast_mult_check(n, n / 2 + 1, false) ||
+          !fast_mult_check(n, n / 3 + 1, true) ||
+          !fast_mult_check(n + 7, n, false))
+        ret = false;
+    }
+  }
+
+  big_karatsuba_threshold = save_karatsuba;
+  big_karatsuba_square_threshold = save_square;
+  big_toom3_threshold = save_toom3;
+  return ret;
+}
+
 TEST(digit_tests, set1) {
   EXPECT_TRUE(basic_digit_test1());
 }
@@ -1536,14 +2292,38 @@ TEST(decimal, convert) {
 TEST(big_num, basic_num_test1) {
   EXPECT_TRUE(basic_big_num_test1());
 }
+TEST(big_num, arena) {
+  EXPECT_TRUE(big_num_arena_test1());
+}
 TEST(big_num, basic_arith_test1) {
   EXPECT_TRUE(basic_arith_test1());
 }
+TEST(big_num, fast_mult) {
+  EXPECT_TRUE(fast_mult_test1());
+}
+TEST(big_num, mulx_kernels) {
+  EXPECT_TRUE(mulx_kernel_test1());
+}
 TEST(big_num, basic_number_theory_test1) {
   EXPECT_TRUE(basic_number_theory_test1());
 }
+TEST(big_num, extended_gcd) {
+  EXPECT_TRUE(extended_gcd_test1());
+  EXPECT_TRUE(mod_inv_ct_test1());
+}
+TEST(big_num, gen_prime) {
+  EXPECT_TRUE(gen_prime_test1());
+}
+TEST(big_num, batch_arith) {
+  EXPECT_TRUE(batch_arith_test1());
+}
+TEST(big_num, batch_mod_inv) {
+  EXPECT_TRUE(batch_mod_inv_test1());
+}
 TEST(big_num, montgomery) {
   EXPECT_TRUE(big_mont_test1());
+  EXPECT_TRUE(mont_context_test1());
+  EXPECT_TRUE(window_exp_test1());
 }
 
 int main(int an, char** av) {
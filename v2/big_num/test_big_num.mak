@@ -54,7 +54,7 @@ PROTO=protoc
 AR=ar
 
 dobj=   $(O)/test_big_num.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o \
-	$(O)/globals.o $(O)/intel_digit_arith.o $(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o
+	$(O)/globals.o $(O)/intel_digit_arith.o $(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o $(O)/batch_arith.o
 
 all:    test_big_num.exe
 clean:
@@ -102,6 +102,10 @@ $(O)/number_theory.o: $(S)/number_theory.cc
 	@echo "compiling number_theory.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/number_theory.o $(S)/number_theory.cc
 
+$(O)/batch_arith.o: $(S)/batch_arith.cc
+	@echo "compiling batch_arith.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/batch_arith.o $(S)/batch_arith.cc
+
 $(O)/big_num.o: $(S)/big_num.cc
 	@echo "compiling big_num.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/big_num.o $(S)/big_num.cc
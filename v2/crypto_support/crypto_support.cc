@@ -577,6 +577,161 @@ bool have_intel_aes_ni() {
   return false;
 }
 
+// PCLMULQDQ: cpuid leaf 1, ecx bit 1
+bool have_intel_pclmul() {
+  uint32_t arg = 1;
+  uint32_t features;
+
+#if defined(X64)
+  asm volatile(
+      "\tmovl    %[arg], %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%ecx, %[features]\n"
+      : [features] "=m"(features)
+      : [arg] "m"(arg)
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 1) & 1) != 0) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+// BMI2 (mulx) and ADX (adcx, adox): cpuid leaf 7, subleaf 0, ebx bits 8 and 19
+bool have_intel_bmi2_adx() {
+  uint32_t max_leaf = 0;
+  uint32_t features = 0;
+
+#if defined(X64)
+  asm volatile(
+      "\txorl    %%eax, %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%eax, %[max_leaf]\n"
+      : [max_leaf] "=m"(max_leaf)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (max_leaf < 7)
+    return false;
+  asm volatile(
+      "\tmovl    $7, %%eax\n"
+      "\txorl    %%ecx, %%ecx\n"
+      "\tcpuid\n"
+      "\tmovl    %%ebx, %[features]\n"
+      : [features] "=m"(features)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 8) & 1) != 0 && ((features >> 19) & 1) != 0) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+// AVX-512F and AVX-512 IFMA: cpuid leaf 7, subleaf 0, ebx bits 16 and 21.
+//   The OS must also save the opmask and zmm state: cpuid leaf 1, ecx bit 27
+//   (OSXSAVE) and XCR0 bits 1, 2, 5, 6 and 7.
+bool have_intel_avx512_ifma() {
+  uint32_t max_leaf = 0;
+  uint32_t features = 0;
+  uint32_t xcr0 = 0;
+
+#if defined(X64)
+  asm volatile(
+      "\txorl    %%eax, %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%eax, %[max_leaf]\n"
+      : [max_leaf] "=m"(max_leaf)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (max_leaf < 7)
+    return false;
+  asm volatile(
+      "\tmovl    $1, %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%ecx, %[features]\n"
+      : [features] "=m"(features)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 27) & 1) == 0)
+    return false;
+  asm volatile(
+      "\txorl    %%ecx, %%ecx\n"
+      "\txgetbv\n"
+      "\tmovl    %%eax, %[xcr0]\n"
+      : [xcr0] "=m"(xcr0)
+      :
+      : "%eax", "%ecx", "%edx");
+  if ((xcr0 & 0xe6) != 0xe6)
+    return false;
+  asm volatile(
+      "\tmovl    $7, %%eax\n"
+      "\txorl    %%ecx, %%ecx\n"
+      "\tcpuid\n"
+      "\tmovl    %%ebx, %[features]\n"
+      : [features] "=m"(features)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 16) & 1) != 0 && ((features >> 21) & 1) != 0) {
+    return true;
+  }
+#endif
+  return false;
+}
+
+// VAES on zmm registers: cpuid leaf 7, subleaf 0, ebx bits 16 and 30
+//   (AVX-512F, AVX-512BW) and ecx bit 9 (VAES), with the same OS state
+//   requirements as above.
+bool have_intel_vaes_avx512() {
+  uint32_t max_leaf = 0;
+  uint32_t features = 0;
+  uint32_t ext_features = 0;
+  uint32_t xcr0 = 0;
+
+#if defined(X64)
+  asm volatile(
+      "\txorl    %%eax, %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%eax, %[max_leaf]\n"
+      : [max_leaf] "=m"(max_leaf)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (max_leaf < 7)
+    return false;
+  asm volatile(
+      "\tmovl    $1, %%eax\n"
+      "\tcpuid\n"
+      "\tmovl    %%ecx, %[features]\n"
+      : [features] "=m"(features)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 27) & 1) == 0)
+    return false;
+  asm volatile(
+      "\txorl    %%ecx, %%ecx\n"
+      "\txgetbv\n"
+      "\tmovl    %%eax, %[xcr0]\n"
+      : [xcr0] "=m"(xcr0)
+      :
+      : "%eax", "%ecx", "%edx");
+  if ((xcr0 & 0xe6) != 0xe6)
+    return false;
+  asm volatile(
+      "\tmovl    $7, %%eax\n"
+      "\txorl    %%ecx, %%ecx\n"
+      "\tcpuid\n"
+      "\tmovl    %%ebx, %[features]\n"
+      "\tmovl    %%ecx, %[ext_features]\n"
+      : [features] "=m"(features), [ext_features] "=m"(ext_features)
+      :
+      : "%eax", "%ebx", "%ecx", "%edx");
+  if (((features >> 16) & 1) != 0 && ((features >> 30) & 1) != 0 &&
+      ((ext_features >> 9) & 1) != 0) {
+    return true;
+  }
+#endif
+  return false;
+}
+
 ofstream logging_descriptor;
 bool init_log(const char* log_file) {
   time_point tp;
@@ -611,6 +766,9 @@ uint64_t read_rdtsc() {
       :
       : [ptr_out] "m"(ptr_out)
       : "memory", "cc", "%eax", "%edx", "%rcx");
+#elif defined(ARM64)
+  // generic timer; ticks at a fixed rate rather than the core clock
+  asm volatile("mrs %[out], cntvct_el0\n" : [out] "=r"(out) : : "memory");
 #else
   out = 0;
 #endif
@@ -877,6 +1035,49 @@ key_message* make_ecckey(const char* name, int prime_bit_size, const char* purpo
   return km;
 }
 
+// x25519 and ed25519 keys: the 32 byte secret is the private multiplier and
+// the 32 byte encoded public key is the x coordinate of the public point.
+key_message* make_curve25519_key(const char* alg, const char* name,
+                                 const char* purpose, const char* not_before,
+                                 const char* not_after, string& secret,
+                                 string& public_key) {
+  if (alg == nullptr)
+    return nullptr;
+  const char* curve_name;
+  if (strcmp(alg, "x25519") == 0)
+    curve_name = "curve25519";
+  else if (strcmp(alg, "ed25519") == 0)
+    curve_name = "edwards25519";
+  else
+    return nullptr;
+
+  key_message* km = new(key_message);
+  if (km == nullptr)
+    return nullptr;
+  km->set_family_type("public");
+  km->set_algorithm_type(alg);
+  if (name != nullptr)
+    km->set_key_name(name);
+  if (purpose != nullptr)
+    km->set_purpose(purpose);
+  if (not_before != nullptr)
+    km->set_notbefore(not_before);
+  if (not_after != nullptr)
+    km->set_notafter(not_after);
+  km->set_key_size(256);
+
+  ecc_public_parameters_message* pub = km->mutable_ecc_pub();
+  pub->mutable_cm()->set_curve_name(curve_name);
+  point_message* ppm = pub->mutable_public_point();
+  ppm->set_x((void*)public_key.data(), (int)public_key.size());
+
+  if (secret.size() > 0) {
+    ecc_private_parameters_message* priv = km->mutable_ecc_priv();
+    priv->set_private_multiplier((void*)secret.data(), (int)secret.size());
+  }
+  return km;
+}
+
 key_message* make_rsakey(const char* alg, const char* name, int bit_size,
     const char* purpose, const char* not_before, const char* not_after,
     string& mod, string& e, string& d, string& p, string& q, string& dp,
@@ -951,9 +1152,13 @@ certificate_body_message* make_certificate_body(string& version, string& subject
   cnm->set_name_value(subject_name_value.c_str());
   certificate_algorithm_message* cam = cbm->mutable_subject_key();
   cam->set_algorithm_name(subject_key.algorithm_type().c_str());
-  rsa_public_parameters_message* rpm = cam->mutable_rsa_params();
-  rpm->set_modulus(subject_key.rsa_pub().modulus());
-  rpm->set_e(subject_key.rsa_pub().e());
+  if (subject_key.has_ecc_pub()) {
+    cam->mutable_ecc_params()->CopyFrom(subject_key.ecc_pub());
+  } else {
+    rsa_public_parameters_message* rpm = cam->mutable_rsa_params();
+    rpm->set_modulus(subject_key.rsa_pub().modulus());
+    rpm->set_e(subject_key.rsa_pub().e());
+  }
   cbm->set_purpose(purpose.c_str());
   cbm->set_not_before(not_before.c_str());
   cbm->set_not_after(not_after.c_str());
@@ -974,9 +1179,13 @@ certificate_message* make_certificate(certificate_body_message& cbm,
   cm->set_signing_algorithm(signing_algorithm);
   certificate_algorithm_message* cam = cm->mutable_signing_key();
   cam->set_algorithm_name(signing_algorithm.c_str());
-  rsa_public_parameters_message* rpm = cam->mutable_rsa_params();
-  rpm->set_modulus(issuer_key.rsa_pub().modulus());
-  rpm->set_e(issuer_key.rsa_pub().e());
+  if (issuer_key.has_ecc_pub()) {
+    cam->mutable_ecc_params()->CopyFrom(issuer_key.ecc_pub());
+  } else {
+    rsa_public_parameters_message* rpm = cam->mutable_rsa_params();
+    rpm->set_modulus(issuer_key.rsa_pub().modulus());
+    rpm->set_e(issuer_key.rsa_pub().e());
+  }
   cm->set_signature(signature);
   return cm;
 }
@@ -1121,6 +1330,10 @@ void print_key_message(key_message& m) {
     }
     if (pub->has_base_point()) {
       point_message* pt= pub->mutable_base_point();
+      if (pt->has_encoded()) {
+        printf("  base        : ");
+        print_bytes((int)pt->encoded().size(), (byte_t*)pt->encoded().data());
+      }
       if (pt->has_x()) {
         printf("  base x      : ");
         print_bytes((int)pt->x().size(), (byte_t*)pt->x().data());
@@ -1132,6 +1345,10 @@ void print_key_message(key_message& m) {
     }
     if (pub->has_public_point()) {
       point_message* pt= pub->mutable_public_point();
+      if (pt->has_encoded()) {
+        printf("  public      : ");
+        print_bytes((int)pt->encoded().size(), (byte_t*)pt->encoded().data());
+      }
       if (pt->has_x()) {
         printf("  public x    : ");
         print_bytes((int)pt->x().size(), (byte_t*)pt->x().data());
@@ -1196,7 +1413,10 @@ void print_algorithm_message(certificate_algorithm_message& am) {
       strcmp(am.algorithm_name().c_str(), "rsa-2048-sha-256-pkcs") == 0) {
     rsa_public_parameters_message* rm = am.mutable_rsa_params();
     print_rsa_public_parameters_message(*rm);
-  } else if (strcmp(am.algorithm_name().c_str(), "ecc") == 0) {
+  } else if (strcmp(am.algorithm_name().c_str(), "ecc") == 0 ||
+      strcmp(am.algorithm_name().c_str(), "ecc-256-sha-256-ecdsa") == 0 ||
+      strcmp(am.algorithm_name().c_str(), "ecc-384-sha-256-ecdsa") == 0 ||
+      strcmp(am.algorithm_name().c_str(), "ecc-521-sha-256-ecdsa") == 0) {
       ecc_public_parameters_message* em = am.mutable_ecc_params();
       print_ecc_public_parameters_message(*em);
   } else {
@@ -594,6 +594,14 @@ int main(int an, char** av) {
     printf("aes ni present\n");
   else
     printf("aes ni not present\n");
+  if (have_intel_bmi2_adx())
+    printf("bmi2/adx present\n");
+  else
+    printf("bmi2/adx not present\n");
+  if (have_intel_avx512_ifma())
+    printf("avx512 ifma present\n");
+  else
+    printf("avx512 ifma not present\n");
 #endif
 
   printf("Starting\n");
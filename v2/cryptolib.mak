@@ -53,12 +53,12 @@ ifndef NEWPROTOBUF
 else
 endif
 
-dobj=	$(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o \
+dobj=	$(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o $(O)/batch_arith.o \
 	$(O)/intel_digit_arith.o $(O)/globals.o $(O)/rc4.o \
-	$(O)/ecc.o $(O)/rsa.o $(O)/crypto_support.o $(O)/tea.o \
-	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/simonspeck.o $(O)/sha1.o \
+	$(O)/ecc.o $(O)/ecc_field.o $(O)/ecc_mult.o $(O)/curve25519.o $(O)/rsa.o $(O)/crypto_support.o $(O)/tea.o \
+	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/aes_gcm.o $(O)/simonspeck.o $(O)/sha1.o \
 	$(O)/aesni.o $(O)/hash.o $(O)/hmac_sha256.o $(O)/sha3.o $(O)/twofish.o \
-	$(O)/encryption_scheme.o $(O)/sha256.o 
+	$(O)/encryption_scheme.o $(O)/sha256.o $(O)/sha512.o 
 
 all:	$(OBJ_DIR)/jlmcryptolib.a
 clean:
@@ -97,6 +97,10 @@ $(O)/number_theory.o: $(SRC_DIR)/big_num/number_theory.cc
 	@echo "compiling number_theory.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/number_theory.o $(SRC_DIR)/big_num/number_theory.cc
 
+$(O)/batch_arith.o: $(SRC_DIR)/big_num/batch_arith.cc
+	@echo "compiling batch_arith.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/batch_arith.o $(SRC_DIR)/big_num/batch_arith.cc
+
 $(O)/intel_digit_arith.o: $(SRC_DIR)/big_num/intel_digit_arith.cc
 	@echo "compiling intel_digit_arith.cc"
 	$(CC) $(CFLAGS1) -c -o $(O)/intel_digit_arith.o $(SRC_DIR)/big_num/intel_digit_arith.cc
@@ -105,6 +109,18 @@ $(O)/ecc.o: $(SRC_DIR)/ecc/ecc.cc
 	@echo "compiling ecc.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/ecc.o $(SRC_DIR)/ecc/ecc.cc
 
+$(O)/ecc_field.o: $(SRC_DIR)/ecc/ecc_field.cc
+	@echo "compiling ecc_field.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/ecc_field.o $(SRC_DIR)/ecc/ecc_field.cc
+
+$(O)/ecc_mult.o: $(SRC_DIR)/ecc/ecc_mult.cc
+	@echo "compiling ecc_mult.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/ecc_mult.o $(SRC_DIR)/ecc/ecc_mult.cc
+
+$(O)/curve25519.o: $(SRC_DIR)/ecc/curve25519.cc
+	@echo "compiling curve25519.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/curve25519.o $(SRC_DIR)/ecc/curve25519.cc
+
 $(O)/rsa.o: $(SRC_DIR)/rsa/rsa.cc
 	@echo "compiling rsa.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/rsa.o $(SRC_DIR)/rsa/rsa.cc
@@ -121,6 +137,10 @@ $(O)/sha256.o: $(SRC_DIR)/hash/sha256.cc
 	@echo "compiling sha256.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/sha256.o $(SRC_DIR)/hash/sha256.cc
 
+$(O)/sha512.o: $(SRC_DIR)/hash/sha512.cc
+	@echo "compiling sha512.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/sha512.o $(SRC_DIR)/hash/sha512.cc
+
 $(O)/sha3.o: $(SRC_DIR)/hash/sha3.cc
 	@echo "compiling sha3.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/sha3.o $(SRC_DIR)/hash/sha3.cc
@@ -145,6 +165,10 @@ $(O)/aes.o: $(SRC_DIR)/symmetric/aes.cc
 	@echo "compiling aes.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/aes.o $(SRC_DIR)/symmetric/aes.cc
 
+$(O)/aes_gcm.o: $(SRC_DIR)/symmetric/aes_gcm.cc
+	@echo "compiling aes_gcm.cc"
+	$(CC) $(CFLAGS) -c -o $(O)/aes_gcm.o $(SRC_DIR)/symmetric/aes_gcm.cc
+
 $(O)/aesni.o: $(SRC_DIR)/symmetric/aesni.cc
 	@echo "compiling aesni.cc"
 	$(CC) $(CFLAGS) -c -o $(O)/aesni.o $(SRC_DIR)/symmetric/aesni.cc
@@ -53,11 +53,11 @@ LINK=g++
 LDFLAGS= -lprotobuf -lgtest -lgflags -lpthread
 
 dobj=  $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/globals.o \
-       $(O)/arm64_digit_arith.o $(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o \
+       $(O)/arm64_digit_arith.o $(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o $(O)/batch_arith.o \
        $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/hash.o \
-       $(O)/sha1.o $(O)/sha256.o $(O)/hmac_sha256.o $(O)/pkcs.o $(O)/pbkdf2.o $(O)/sha3.o \
-       $(O)/encryption_scheme.o $(O)/rsa.o  $(O)/ecc.o $(O)/ecc_curve_data.o $(O)/lll.o \
-       $(O)/lwe.o $(O)/ntru.o $(O)/symmetric_cipher.o $(O)/aes.o $(O)/tea.o \
+       $(O)/sha1.o $(O)/sha256.o $(O)/sha512.o $(O)/hmac_sha256.o $(O)/pkcs.o $(O)/pbkdf2.o $(O)/sha3.o \
+       $(O)/encryption_scheme.o $(O)/rsa.o  $(O)/ecc.o $(O)/ecc_field.o $(O)/ecc_mult.o $(O)/curve25519.o $(O)/ecc_curve_data.o $(O)/lll.o \
+       $(O)/lwe.o $(O)/ntru.o $(O)/symmetric_cipher.o $(O)/aes.o $(O)/aes_gcm.o $(O)/tea.o \
        $(O)/rc4.o $(O)/twofish.o $(O)/simonspeck.o
 
 
@@ -116,6 +116,10 @@ $(O)/number_theory.o: $(S_BIGNUM)/number_theory.cc
 	@echo "compiling number_theory.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/number_theory.o $(S_BIGNUM)/number_theory.cc
 
+$(O)/batch_arith.o: $(S_BIGNUM)/batch_arith.cc
+	@echo "compiling batch_arith.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/batch_arith.o $(S_BIGNUM)/batch_arith.cc
+
 $(O)/big_num.o: $(S_BIGNUM)/big_num.cc
 	@echo "compiling big_num.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/big_num.o $(S_BIGNUM)/big_num.cc
@@ -128,6 +132,18 @@ $(O)/ecc.o: $(S_ECC)/ecc.cc
 	@echo "compiling ecc.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc.o $(S_ECC)/ecc.cc
 
+$(O)/ecc_field.o: $(S_ECC)/ecc_field.cc
+	@echo "compiling ecc_field.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_field.o $(S_ECC)/ecc_field.cc
+
+$(O)/ecc_mult.o: $(S_ECC)/ecc_mult.cc
+	@echo "compiling ecc_mult.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_mult.o $(S_ECC)/ecc_mult.cc
+
+$(O)/curve25519.o: $(S_ECC)/curve25519.cc
+	@echo "compiling curve25519.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/curve25519.o $(S_ECC)/curve25519.cc
+
 $(O)/ecc_curve_data.o: $(S_ECC)/ecc_curve_data.cc
 	@echo "compiling ecc_curve_data.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_curve_data.o $(S_ECC)/ecc_curve_data.cc
@@ -140,6 +156,10 @@ $(O)/aes.o: $(S_SYMMETRIC)/aes.cc
 	@echo "compiling aes.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes.o $(S_SYMMETRIC)/aes.cc
 
+$(O)/aes_gcm.o: $(S_SYMMETRIC)/aes_gcm.cc
+	@echo "compiling aes_gcm.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes_gcm.o $(S_SYMMETRIC)/aes_gcm.cc
+
 $(O)/twofish.o: $(S_SYMMETRIC)/twofish.cc
 	@echo "compiling twofish.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/twofish.o $(S_SYMMETRIC)/twofish.cc
@@ -160,6 +180,10 @@ $(O)/sha256.o: $(S_HASH)/sha256.cc
 	@echo "compiling sha256.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha256.o $(S_HASH)/sha256.cc
 
+$(O)/sha512.o: $(S_HASH)/sha512.cc
+	@echo "compiling sha512.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha512.o $(S_HASH)/sha512.cc
+
 $(O)/hmac_sha256.o: $(S_HASH)/hmac_sha256.cc
 	@echo "compiling hmac_sha256.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/hmac_sha256.o $(S_HASH)/hmac_sha256.cc
@@ -30,6 +30,7 @@
 #include "twofish.h"
 #include "big_num.h"
 #include "ecc_curve_data.h"
+#include "curve25519.h"
 #include "hash.h"
 #include "lattice.h"
 #include "rc4.h"
@@ -108,7 +109,10 @@ int num_cryptutil_algs;
 std::string cryptalgs[] = {
     "aes", "rsa", "ecc", "sha-1", "sha-256", "sha-3",
     "hmac-sha-256", "pbdkf", "twofish", "tea", "simon",
-    "aes-hmac-sha256-ctr", "aes-hmac-sha256-cbc",};
+    "aes-hmac-sha256-ctr", "aes-hmac-sha256-cbc", "aes-gcm",
+    "ecc-256-sha-256-ecdsa", "ecc-384-sha-256-ecdsa", "ecc-521-sha-256-ecdsa",
+    "x25519", "ed25519", "rsa-1024-sha-256-pss", "rsa-2048-sha-256-pss",
+    "rsa-1024-sha3-256-pss", "rsa-2048-sha3-256-pss",};
 
 void print_options() {
   printf("Permitted operations:\n\n");
@@ -330,8 +334,9 @@ bool decrypt_rsa(int size_in, byte_t* in,
   return rk.decrypt(size_in, in, &size_out, out, 0);
 }
 
-bool encrypt_ecc(int size_in, byte_t* in,
-                 curve_point* pt1, curve_point* pt2) {
+// The ciphertext points travel as compressed SEC1 octets in cpm1 and cpm2.
+bool encrypt_ecc(int size_in, byte_t* in, curve_point* pt1, curve_point* pt2,
+                 point_message* cpm1, point_message* cpm2) {
 
   ecc ek;
   ek.ecc_key_ = new key_message;
@@ -363,11 +368,32 @@ bool encrypt_ecc(int size_in, byte_t* in,
     return false;
   }
   k.normalize();
-  return ek.encrypt(size_in, in, k, *pt1, *pt2);
+  if (!ek.encrypt(size_in, in, k, *pt1, *pt2))
+    return false;
+
+  string s;
+  if (!ecc_point_to_octets(*ek.c_, *pt1, true, &s))
+    return false;
+  cpm1->set_encoded(s);
+  s.clear();
+  if (!ecc_point_to_octets(*ek.c_, *pt2, true, &s))
+    return false;
+  cpm2->set_encoded(s);
+  return true;
 }
 
-bool decrypt_ecc(curve_point& pt1, curve_point& pt2,
-                 int size_out, byte_t* out) {
+// Points written before point_message.encoded existed carry x and y.
+static bool ecc_point_from_message(ecc_curve& c, point_message& pm, curve_point& pt) {
+  if (pm.has_encoded())
+    return ecc_point_from_octets(c, (int)pm.encoded().size(),
+                                 (const byte_t*)pm.encoded().data(), pt);
+  if (!string_msg_to_bignum(pm.x(), *pt.x_) || !string_msg_to_bignum(pm.y(), *pt.y_))
+    return false;
+  return ecc_is_on_curve(c, pt);
+}
+
+bool decrypt_ecc(point_message& cpm1, point_message& cpm2,
+                 curve_point& pt1, curve_point& pt2, int size_out, byte_t* out) {
 
   ecc ek;
   ek.ecc_key_ = new key_message;
@@ -391,6 +417,11 @@ bool decrypt_ecc(curve_point& pt1, curve_point& pt2,
     printf("Can't retrieve parameters\n");
     return false;
   }
+  if (!ecc_point_from_message(*ek.c_, cpm1, pt1) ||
+      !ecc_point_from_message(*ek.c_, cpm2, pt2)) {
+    printf("Can't get message points\n");
+    return false;
+  }
 #if 0
 printf("decrypt_ecc\n");
 printf("pt1            : ");pt1.print();printf("\n");
@@ -442,6 +473,226 @@ bool pkcs_verify_hash(const char* hash_alg, rsa& rk, byte_t* digest, int block_s
   return true;
 }
 
+// Hash algorithm for an RSA-PSS algorithm name, nullptr if it isn't one.
+const char* rsa_pss_hash_alg(const char* alg) {
+  if (strcmp(alg, "rsa-2048-sha-256-pss") == 0 ||
+      strcmp(alg, "rsa-1024-sha-256-pss") == 0)
+    return "sha-256";
+  if (strcmp(alg, "rsa-2048-sha3-256-pss") == 0 ||
+      strcmp(alg, "rsa-1024-sha3-256-pss") == 0)
+    return "sha3-256";
+  return nullptr;
+}
+
+// Hashes a file a block at a time so it is never held in memory.
+const int hash_file_block_size = 65536;
+bool hash_file(const char* hash_alg, const char* file_name, int digest_size,
+               byte_t* digest) {
+  file_util in_file;
+  pkcs_hash h;
+  byte_t* buf = new byte_t[hash_file_block_size];
+  bool ret = false;
+
+  if (!h.init(hash_alg) || !in_file.open(file_name))
+    goto done;
+  for (int left = in_file.bytes_in_file(); left > 0;) {
+    int n = in_file.read_a_block(
+        left < hash_file_block_size ? left : hash_file_block_size, buf);
+    if (n <= 0)
+      goto done;
+    h.add_to_hash(n, buf);
+    left -= n;
+  }
+  h.finalize();
+  ret = h.get_digest(digest_size, digest);
+
+done:
+  in_file.close();
+  delete []buf;
+  return ret;
+}
+
+bool ecdsa_algorithm(const char* alg) {
+  return strcmp(alg, "ecc-256-sha-256-ecdsa") == 0 ||
+         strcmp(alg, "ecc-384-sha-256-ecdsa") == 0 ||
+         strcmp(alg, "ecc-521-sha-256-ecdsa") == 0;
+}
+
+bool read_ecc_key(const char* file_name, ecc& ek) {
+  ek.ecc_key_ = new key_message;
+  if (!read_key(file_name, ek.ecc_key_)) {
+    printf("Can't read ecc key\n");
+    return false;
+  }
+  if (!ek.ecc_key_->has_algorithm_type() ||
+      strcmp(ek.ecc_key_->algorithm_type().c_str(), "ecc") != 0) {
+    printf("Not an ecc key\n");
+    return false;
+  }
+  if (!ek.retrieve_parameters_from_key_message()) {
+    printf("Can't retrieve parameters\n");
+    return false;
+  }
+  return true;
+}
+
+// ECDSA takes the digest with its words in big endian order,
+// sha256::get_digest leaves them in machine order.
+void ecdsa_digest_octets(int size, byte_t* digest, byte_t* out) {
+#ifndef BIGENDIAN
+  for (int i = 0; i < size / (int)sizeof(uint32_t); i++)
+    little_to_big_endian_32(&((uint32_t*)digest)[i], &((uint32_t*)out)[i]);
+#else
+  memcpy(out, digest, size);
+#endif
+}
+
+bool ecdsa_sign_hash(ecc& ek, byte_t* digest, int hash_size, string* s_signature) {
+  byte_t octets[hash_size];
+  int cap = 2 * ek.order_of_base_point_->size_ + 2;
+  big_num r(cap);
+  big_num s(cap);
+
+  ecdsa_digest_octets(hash_size, digest, octets);
+  if (!ek.sign(hash_size, octets, r, s)) {
+    printf("Can't ecdsa sign\n");
+    return false;
+  }
+  return ecdsa_signature_to_bytes(*ek.order_of_base_point_, r, s, s_signature);
+}
+
+bool ecdsa_verify_hash(ecc& ek, byte_t* digest, int hash_size, string& signature) {
+  byte_t octets[hash_size];
+  int cap = 2 * ek.order_of_base_point_->size_ + 2;
+  big_num r(cap);
+  big_num s(cap);
+
+  if (!ecdsa_signature_from_bytes(*ek.order_of_base_point_, signature, r, s))
+    return false;
+  ecdsa_digest_octets(hash_size, digest, octets);
+  return ek.verify(hash_size, octets, r, s);
+}
+
+// x25519 and ed25519 keys, see make_curve25519_key
+bool read_curve25519_key(const char* file_name, const char* alg,
+                         key_message* km, byte_t* pub, byte_t* secret) {
+  if (!read_key(file_name, km)) {
+    printf("Can't read %s key\n", alg);
+    return false;
+  }
+  if (!km->has_algorithm_type() || strcmp(km->algorithm_type().c_str(), alg) != 0 ||
+      !km->has_ecc_pub() ||
+      (int)km->ecc_pub().public_point().x().size() != curve25519_key_bytes) {
+    printf("Not an %s key\n", alg);
+    return false;
+  }
+  memcpy(pub, km->ecc_pub().public_point().x().data(), curve25519_key_bytes);
+  if (secret == nullptr)
+    return true;
+  if (!km->has_ecc_priv() ||
+      (int)km->ecc_priv().private_multiplier().size() != curve25519_key_bytes) {
+    printf("No private %s key\n", alg);
+    return false;
+  }
+  memcpy(secret, km->ecc_priv().private_multiplier().data(), curve25519_key_bytes);
+  return true;
+}
+
+// x25519 encryption is aes-hmac-sha256-ctr under keys derived from the
+// X25519 shared secret of an ephemeral key and the recipient key:
+//   key_i = hmac-sha256(shared, ephemeral public || public || i), i = 1, 2
+// The ciphertext is the ephemeral public key followed by the scheme output.
+const int x25519_scheme_key_size = 128;
+
+bool x25519_scheme_init(encryption_scheme& scheme, byte_t* shared,
+                        byte_t* e_pub, byte_t* pub) {
+  byte_t in[2 * curve25519_key_bytes + 1];
+  byte_t key[2][hmac_sha256::MACBYTESIZE];
+  string enc_key;
+  string mac_key;
+  bool ret;
+
+  memcpy(in, e_pub, curve25519_key_bytes);
+  memcpy(&in[curve25519_key_bytes], pub, curve25519_key_bytes);
+  for (int i = 0; i < 2; i++) {
+    hmac_sha256 h;
+    in[2 * curve25519_key_bytes] = (byte_t)(i + 1);
+    if (!h.init(curve25519_key_bytes, shared))
+      return false;
+    h.add_to_inner_hash(sizeof(in), in);
+    h.finalize();
+    if (!h.get_hmac(hmac_sha256::MACBYTESIZE, key[i]))
+      return false;
+  }
+  enc_key.assign((char*)key[0], x25519_scheme_key_size / NBITSINBYTE);
+  mac_key.assign((char*)key[1], x25519_scheme_key_size / NBITSINBYTE);
+  ret = scheme.init("aes-hmac-sha256-ctr", "", "ctr", "sym-pad", "", "now",
+                    "later", "aes", x25519_scheme_key_size, enc_key,
+                    "x25519-key", "hmac-sha256", x25519_scheme_key_size, mac_key);
+  memset(key, 0, sizeof(key));
+  return ret;
+}
+
+bool encrypt_x25519(byte_t* pub, int size_in, byte_t* in, string* out) {
+  byte_t e[curve25519_key_bytes];
+  byte_t e_pub[curve25519_key_bytes];
+  byte_t shared[curve25519_key_bytes];
+  encryption_scheme scheme;
+  int size_out;
+  byte_t* buf = nullptr;
+  bool ret = false;
+
+  if (crypto_get_random_bytes(curve25519_key_bytes, e) < curve25519_key_bytes)
+    goto done;
+  if (!x25519_public_key(e, e_pub) || !x25519(e, pub, shared))
+    goto done;
+  if (!x25519_scheme_init(scheme, shared, e_pub, pub))
+    goto done;
+  size_out = size_in + 3 * scheme.get_block_size() + scheme.get_mac_size();
+  buf = new byte_t[size_out];
+  if (!scheme.encrypt_message(size_in, in, size_out, buf))
+    goto done;
+  out->assign((char*)e_pub, curve25519_key_bytes);
+  out->append((char*)buf, scheme.get_total_bytes_output());
+  ret = true;
+
+done:
+  memset(e, 0, sizeof(e));
+  memset(shared, 0, sizeof(shared));
+  delete scheme.scheme_msg_;
+  scheme.scheme_msg_ = nullptr;
+  delete []buf;
+  return ret;
+}
+
+bool decrypt_x25519(byte_t* pub, byte_t* secret, int size_in, byte_t* in,
+                    string* out) {
+  byte_t shared[curve25519_key_bytes];
+  encryption_scheme scheme;
+  int size_out = size_in - curve25519_key_bytes;
+  byte_t* buf = nullptr;
+  bool ret = false;
+
+  if (size_out <= 0)
+    return false;
+  if (!x25519(secret, in, shared))
+    goto done;
+  if (!x25519_scheme_init(scheme, shared, in, pub))
+    goto done;
+  buf = new byte_t[size_out];
+  if (!scheme.decrypt_message(size_out, &in[curve25519_key_bytes], size_out, buf))
+    goto done;
+  out->assign((char*)buf, scheme.get_bytes_encrypted());
+  ret = true;
+
+done:
+  memset(shared, 0, sizeof(shared));
+  delete scheme.scheme_msg_;
+  scheme.scheme_msg_ = nullptr;
+  delete []buf;
+  return ret;
+}
+
 const char* salt_str = "jlm ucb math"; 
 const int num_iter = 100;
 
@@ -745,6 +996,37 @@ int main(int an, char** av) {
 
     const char* alg = km.algorithm_type().c_str();
     printf("alg: %s\n", alg);
+    if (strcmp(alg, "x25519") == 0) {
+      byte_t pub[curve25519_key_bytes];
+      byte_t secret[curve25519_key_bytes];
+      byte_t in[size_in];
+      string out;
+      bool encrypt = "encrypt_with_key" == FLAGS_operation;
+
+      if (!read_curve25519_key(FLAGS_key_file.c_str(), alg, &km, pub,
+                               encrypt ? nullptr : secret)) {
+        ret = 1;
+        goto done;
+      }
+      if (in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
+        printf("Can't read %s\n", FLAGS_input_file.c_str());
+        ret = 1;
+        goto done;
+      }
+      if (encrypt ? !encrypt_x25519(pub, size_in, in, &out) :
+                    !decrypt_x25519(pub, secret, size_in, in, &out)) {
+        printf("Can't %s x25519\n", encrypt ? "encrypt" : "decrypt");
+        memset(secret, 0, sizeof(secret));
+        ret = 1;
+        goto done;
+      }
+      memset(secret, 0, sizeof(secret));
+      file_util out_file;
+      out_file.write_file(FLAGS_output_file.c_str(), (int)out.size(), (byte_t*)out.data());
+      printf("in            : "); print_bytes(size_in, in);
+      printf("out           : "); print_bytes((int)out.size(), (byte_t*)out.data());
+      goto done;
+    }
     int block_size;
     if (strcmp(alg, "aes") == 0) {
       block_size = aes::BLOCKBYTESIZE;
@@ -774,6 +1056,8 @@ int main(int an, char** av) {
     memset(out, 0, in_out_size);
     curve_point pt1(8);
     curve_point pt2(8);
+    point_message cpm1;
+    point_message cpm2;
 
     if (in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
       printf("Can't open %s\n", FLAGS_input2_file.c_str());
@@ -782,30 +1066,11 @@ int main(int an, char** av) {
     }
 
     if (strcmp(alg, "ecc") == 0 && strcmp(FLAGS_operation.c_str(), "decrypt_with_key") == 0) {
-      // read and deserialise into point
+      // read and deserialise, decrypt_ecc decodes the points
       string s_point;
-      point_message cpm1;
-      point_message cpm2;
-      curve_point cp(8);
 
       s_point.assign((char*)in, (size_t)size_in);
       cpm1.ParseFromString(s_point);
-
-      string s;
-      s.clear();
-      s.assign((char*)cpm1.x().data(), cpm1.x().size());
-      if (!string_msg_to_bignum(s, *pt1.x_)) {
-        printf("Can't get message points\n");
-        ret = 1;
-        goto done;
-      }
-      s.clear();
-      s.assign((char*)cpm1.y().data(), cpm1.y().size());
-      if (!string_msg_to_bignum(s, *pt1.y_)) {
-        printf("Can't get message points\n");
-        ret = 1;
-        goto done;
-      }
     
       int size_in2;
       if (!in_file.open(FLAGS_input2_file.c_str())) {
@@ -825,21 +1090,6 @@ int main(int an, char** av) {
 
       s_point.assign((char*)in2, (size_t)size_in2);
       cpm2.ParseFromString(s_point);
-
-      s.clear();
-      s.assign((char*)cpm2.x().data(), cpm2.x().size());
-      if (!string_msg_to_bignum(s, *pt2.x_)) {
-        printf("Can't get message points\n");
-        ret = 1;
-        goto done;
-      }
-      s.clear();
-      s.assign((char*)cpm2.y().data(), cpm2.y().size());
-      if (!string_msg_to_bignum(s, *pt2.y_)) {
-        printf("Can't get message points\n");
-        ret = 1;
-        goto done;
-      }
       printf("retrieved points\n");
     } 
 
@@ -889,13 +1139,13 @@ int main(int an, char** av) {
       }
     } else if (strcmp(alg, "ecc") == 0) {
       if ("encrypt_with_key" == FLAGS_operation) {
-        if (!encrypt_ecc(in_out_size, in, &pt1, &pt2)) {
+        if (!encrypt_ecc(in_out_size, in, &pt1, &pt2, &cpm1, &cpm2)) {
           printf("Can't encrypt ecc\n");
           ret = 1;
           goto done;
         }
       } else {
-        if (!decrypt_ecc(pt1, pt2, in_out_size, out)) {
+        if (!decrypt_ecc(cpm1, cpm2, pt1, pt2, in_out_size, out)) {
           printf("Can't decrypt ecc\n");
           ret = 1;
           goto done;
@@ -912,40 +1162,6 @@ int main(int an, char** av) {
       string serialized_pt1;
       string serialized_pt2;
 
-      point_message cpm1;
-      point_message cpm2;
-
-      string s;
-      s.clear();
-      if (!bignum_to_string_msg(*pt1.x_, &s)) {
-        printf("bad conversion 1\n");
-        ret = 1;
-        goto done;
-      }
-      cpm1.set_x(s);
-      s.clear();
-      if (!bignum_to_string_msg(*pt1.y_, &s)) {
-        printf("bad conversion 2\n");
-        ret = 1;
-        goto done;
-      }
-      cpm1.set_y(s);
-
-      s.clear();
-      if (!bignum_to_string_msg(*pt2.x_, &s)) {
-        printf("bad conversion 3\n");
-        ret = 1;
-        goto done;
-      }
-      cpm2.set_x(s);
-      s.clear();
-      if (!bignum_to_string_msg(*pt2.y_, &s)) {
-        printf("bad conversion 4\n");
-        ret = 1;
-        goto done;
-      }
-      cpm2.set_y(s);
-
       cpm1.SerializeToString(&serialized_pt1);
       cpm2.SerializeToString(&serialized_pt2);
 
@@ -1024,6 +1240,11 @@ int main(int an, char** av) {
       mode = (char*)"cbc";
       enc_alg = (char*)"aes";
       hmac_alg = (char*)"hmac-sha256";
+    } else if (FLAGS_algorithm == "aes-gcm") {
+      mode = (char*)"gcm";
+      pad = "none";
+      enc_alg = (char*)"aes";
+      hmac_alg = (char*)"none";
     } else {
       printf("scheme_decrypt: unsupported algorithm %s\n",
               FLAGS_algorithm.c_str());
@@ -1170,6 +1391,11 @@ int main(int an, char** av) {
       mode = (char*)"cbc";
       enc_alg = (char*)"aes";
       hmac_alg = (char*)"hmac-sha256";
+    } else if (FLAGS_algorithm == "aes-gcm") {
+      pad = (char*)"none";
+      mode = (char*)"gcm";
+      enc_alg = (char*)"aes";
+      hmac_alg = (char*)"none";
     } else {
       printf("password: unsupported algorithm %s\n",
               FLAGS_algorithm.c_str());
@@ -1323,6 +1549,11 @@ int main(int an, char** av) {
       mode = (char*)"cbc";
       enc_alg = (char*)"aes";
       hmac_alg = (char*)"hmac-sha256";
+    } else if (FLAGS_algorithm == "aes-gcm") {
+      pad = (char*)"none";
+      mode = (char*)"gcm";
+      enc_alg = (char*)"aes";
+      hmac_alg = (char*)"none";
     } else {
       printf("password: unsupported algorithm %s\n",
               FLAGS_algorithm.c_str());
@@ -1522,6 +1753,12 @@ int main(int an, char** av) {
         ret = 1;
         goto done;
       }
+      // the gcd coefficient can be negative and only |d| is serialized
+      if (!big_mod_normalize(d, exp_mod)) {
+        printf("Can't compute d (3)\n");
+        ret = 1;
+        goto done;
+      }
 
 #if 0
       // can use this to check d is OK.
@@ -1640,6 +1877,33 @@ int main(int an, char** av) {
       }
       print_key_message(*ek.ecc_key_);
       goto done;
+    } else if (strcmp(FLAGS_algorithm.c_str(), "x25519") == 0 ||
+               strcmp(FLAGS_algorithm.c_str(), "ed25519") == 0) {
+      byte_t secret[curve25519_key_bytes];
+      byte_t pub[curve25519_key_bytes];
+      bool ok;
+
+      if (crypto_get_random_bytes(curve25519_key_bytes, secret) < curve25519_key_bytes) {
+        printf("Can't generate random key\n");
+        ret = 1;
+        goto done;
+      }
+      if (strcmp(FLAGS_algorithm.c_str(), "x25519") == 0)
+        ok = x25519_public_key(secret, pub);
+      else
+        ok = ed25519_public_key(secret, pub);
+      if (!ok) {
+        printf("Can't compute %s public key\n", FLAGS_algorithm.c_str());
+        ret = 1;
+        goto done;
+      }
+      string s_secret;
+      string s_pub;
+      s_secret.assign((char*)secret, curve25519_key_bytes);
+      s_pub.assign((char*)pub, curve25519_key_bytes);
+      memset(secret, 0, sizeof(secret));
+      km = make_curve25519_key(FLAGS_algorithm.c_str(), FLAGS_key_name.c_str(),
+              FLAGS_purpose.c_str(), s1.c_str(), s2.c_str(), s_secret, s_pub);
     } else {
       printf("Unknown key type\n");
       ret = 1;
@@ -1754,38 +2018,67 @@ int main(int an, char** av) {
       ret = 1;
       goto done;
     }
-    int size_in = in_file.bytes_in_file();
+    // PSS streams the file through its hash below rather than read it here
+    const char* pss_hash_alg = rsa_pss_hash_alg(FLAGS_algorithm.c_str());
+    int size_in = pss_hash_alg == nullptr ? in_file.bytes_in_file() : 0;
     byte_t in[size_in];
     in_file.close();
-    if (in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
+    if (pss_hash_alg == nullptr &&
+        in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
       printf("Can't read %s\n", FLAGS_input_file.c_str());
       ret = 1;
       goto done;
     }
 
     rsa rk;
-    rk.rsa_key_ = new key_message;
-    if (!read_key(FLAGS_key_file.c_str(), rk.rsa_key_)) {
-      printf("Can't read signing key\n");
-      ret = 1;
-      goto done;
-    }
-    if (!rk.retrieve_parameters_from_key_message()) {
-      printf("Can't retreive signing key data\n");
-      ret = 1;
-      goto done;
+    ecc ek;
+    bool use_ecdsa = ecdsa_algorithm(FLAGS_algorithm.c_str());
+    bool use_ed25519 = strcmp(FLAGS_algorithm.c_str(), "ed25519") == 0;
+    key_message ed_km;
+    byte_t ed_pub[curve25519_key_bytes];
+    byte_t ed_secret[curve25519_key_bytes];
+    if (use_ed25519) {
+      if (!read_curve25519_key(FLAGS_key_file.c_str(), "ed25519", &ed_km, ed_pub, ed_secret)) {
+        ret = 1;
+        goto done;
+      }
+    } else if (use_ecdsa) {
+      if (!read_ecc_key(FLAGS_key_file.c_str(), ek)) {
+        ret = 1;
+        goto done;
+      }
+    } else {
+      rk.rsa_key_ = new key_message;
+      if (!read_key(FLAGS_key_file.c_str(), rk.rsa_key_)) {
+        printf("Can't read signing key\n");
+        ret = 1;
+        goto done;
+      }
+      if (!rk.retrieve_parameters_from_key_message()) {
+        printf("Can't retreive signing key data\n");
+        ret = 1;
+        goto done;
+      }
     }
 
     int signature_block_size;
     int hash_size;
     int block_size;
     const char* hash_alg;
-    if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
+    if (use_ecdsa || use_ed25519) {
+        hash_size = sha256::DIGESTBYTESIZE;
+        block_size = 0;
+        hash_alg = "sha-256";
+    } else if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
         strcmp(FLAGS_algorithm.c_str(), "rsa-1024-sha-256-pkcs") == 0) {
         hash_size = sha256::DIGESTBYTESIZE;
         signature_block_size = pkcs_sha256_sigblock_size;
         block_size = rk.bit_size_modulus_ / NBITSINBYTE;
         hash_alg = "sha-256";
+      } else if (pss_hash_alg != nullptr) {
+        hash_size = pkcs_digest_size(pss_hash_alg);
+        block_size = rk.bit_size_modulus_ / NBITSINBYTE;
+        hash_alg = pss_hash_alg;
       } else {
         printf("unsupported signing algorithm: %s\n", FLAGS_algorithm.c_str());
         ret = 1;
@@ -1794,15 +2087,49 @@ int main(int an, char** av) {
 
     byte_t digest[hash_size];
     memset(digest, 0, hash_size);
-    sha256 h;
+    if (pss_hash_alg != nullptr) {
+      if (!hash_file(pss_hash_alg, FLAGS_input_file.c_str(), hash_size, digest)) {
+        printf("Can't hash %s\n", FLAGS_input_file.c_str());
+        ret = 1;
+        goto done;
+      }
+    } else {
+      sha256 h;
 
-    h.init();
-    h.add_to_hash(size_in, in);
-    h.finalize();
-    h.get_digest(hash_size, digest);
+      h.init();
+      h.add_to_hash(size_in, in);
+      h.finalize();
+      h.get_digest(hash_size, digest);
+    }
 
     string s_signature;
-    if (!pkcs_sign_rsa_hash(hash_alg, rk, digest, block_size, &s_signature)) {
+    if (use_ed25519) {
+      byte_t ed_sig[ed25519_signature_bytes];
+      bool signed_ok = ed25519_sign(ed_secret, ed_pub, size_in, in, ed_sig);
+      memset(ed_secret, 0, sizeof(ed_secret));
+      if (!signed_ok) {
+        printf("Can't ed25519 sign\n");
+        ret = 1;
+        goto done;
+      }
+      s_signature.assign((char*)ed_sig, ed25519_signature_bytes);
+    } else if (use_ecdsa) {
+      if (!ecdsa_sign_hash(ek, digest, hash_size, &s_signature)) {
+        ret = 1;
+        goto done;
+      }
+    } else if (pss_hash_alg != nullptr) {
+      rsa_private_context ctx;
+      byte_t pss_sig[block_size];
+      int size_sig = block_size;
+      if (!ctx.init(rk) ||
+          !rsa_pss_sign(ctx, hash_alg, digest, &size_sig, pss_sig)) {
+        printf("Can't rsa pss sign\n");
+        ret = 1;
+        goto done;
+      }
+      s_signature.assign((char*)pss_sig, (size_t)size_sig);
+    } else if (!pkcs_sign_rsa_hash(hash_alg, rk, digest, block_size, &s_signature)) {
       printf("Can't rsa sign\n");
       ret = 1;
       goto done;
@@ -1833,36 +2160,64 @@ int main(int an, char** av) {
       ret = 1;
       goto done;
     }
-    int size_in = in_file.bytes_in_file();
+    // PSS streams the file through its hash below rather than read it here
+    const char* pss_hash_alg = rsa_pss_hash_alg(FLAGS_algorithm.c_str());
+    int size_in = pss_hash_alg == nullptr ? in_file.bytes_in_file() : 0;
     byte_t in[size_in];
     in_file.close();
-    if (in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
+    if (pss_hash_alg == nullptr &&
+        in_file.read_file(FLAGS_input_file.c_str(), size_in, in) < size_in) {
       printf("Can't read %s\n", FLAGS_input_file.c_str());
       ret = 1;
       goto done;
     }
 
     rsa rk;
-    rk.rsa_key_ = new key_message;
-    if (!read_key(FLAGS_key_file.c_str(), rk.rsa_key_)) {
-      printf("Can't read signing key\n");
-      ret = 1;
-      goto done;
-    }
-    if (!rk.retrieve_parameters_from_key_message()) {
-      printf("Can't retreive signing key data\n");
-      ret = 1;
-      goto done;
+    ecc ek;
+    bool use_ecdsa = ecdsa_algorithm(FLAGS_algorithm.c_str());
+    bool use_ed25519 = strcmp(FLAGS_algorithm.c_str(), "ed25519") == 0;
+    key_message ed_km;
+    byte_t ed_pub[curve25519_key_bytes];
+    if (use_ed25519) {
+      if (!read_curve25519_key(FLAGS_key_file.c_str(), "ed25519", &ed_km, ed_pub, nullptr)) {
+        ret = 1;
+        goto done;
+      }
+    } else if (use_ecdsa) {
+      if (!read_ecc_key(FLAGS_key_file.c_str(), ek)) {
+        ret = 1;
+        goto done;
+      }
+    } else {
+      rk.rsa_key_ = new key_message;
+      if (!read_key(FLAGS_key_file.c_str(), rk.rsa_key_)) {
+        printf("Can't read signing key\n");
+        ret = 1;
+        goto done;
+      }
+      if (!rk.retrieve_parameters_from_key_message()) {
+        printf("Can't retreive signing key data\n");
+        ret = 1;
+        goto done;
+      }
     }
 
     int hash_size;
     int block_size;
     const char* hash_alg;
-    if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
+    if (use_ecdsa || use_ed25519) {
+        hash_size = sha256::DIGESTBYTESIZE;
+        block_size = 0;
+        hash_alg = "sha-256";
+    } else if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
         strcmp(FLAGS_algorithm.c_str(), "rsa-1024-sha-256-pkcs") == 0) {
         hash_size = sha256::DIGESTBYTESIZE;
         block_size = rk.bit_size_modulus_ / NBITSINBYTE;
         hash_alg = "sha-256";
+      } else if (pss_hash_alg != nullptr) {
+        hash_size = pkcs_digest_size(pss_hash_alg);
+        block_size = rk.bit_size_modulus_ / NBITSINBYTE;
+        hash_alg = pss_hash_alg;
       } else {
         printf("unsupported signing algorithm: %s\n", FLAGS_algorithm.c_str());
         ret = 1;
@@ -1871,12 +2226,20 @@ int main(int an, char** av) {
 
     byte_t digest[hash_size];
     memset(digest, 0, hash_size);
-    sha256 h;
+    if (pss_hash_alg != nullptr) {
+      if (!hash_file(pss_hash_alg, FLAGS_input_file.c_str(), hash_size, digest)) {
+        printf("Can't hash %s\n", FLAGS_input_file.c_str());
+        ret = 1;
+        goto done;
+      }
+    } else {
+      sha256 h;
 
-    h.init();
-    h.add_to_hash(size_in, in);
-    h.finalize();
-    h.get_digest(hash_size, digest);
+      h.init();
+      h.add_to_hash(size_in, in);
+      h.finalize();
+      h.get_digest(hash_size, digest);
+    }
 
     signature_message sm;
     if (!in_file.open(FLAGS_signature_file.c_str())) {
@@ -1904,7 +2267,18 @@ int main(int an, char** av) {
 
     string s_signature;
     s_signature.assign((char*)sm.signature().data(), (size_t)sm.signature().size());
-    if (pkcs_verify_hash(hash_alg, rk, digest, block_size, s_signature)) {
+    bool verified;
+    if (use_ed25519)
+      verified = (int)s_signature.size() == ed25519_signature_bytes &&
+                 ed25519_verify(ed_pub, size_in, in, (byte_t*)s_signature.data());
+    else if (use_ecdsa)
+      verified = ecdsa_verify_hash(ek, digest, hash_size, s_signature);
+    else if (pss_hash_alg != nullptr)
+      verified = rsa_pss_verify(rk, hash_alg, digest, (int)s_signature.size(),
+                                (byte_t*)s_signature.data());
+    else
+      verified = pkcs_verify_hash(hash_alg, rk, digest, block_size, s_signature);
+    if (verified) {
       printf("Signature verifies\n");
     } else {
       printf("Signature does not verify\n");
@@ -1927,7 +2301,8 @@ int main(int an, char** av) {
     int block_size;
     const char* hash_alg;
 
-    if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
+    bool use_ecdsa = ecdsa_algorithm(FLAGS_algorithm.c_str());
+    if (use_ecdsa || strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
       strcmp(FLAGS_algorithm.c_str(), "rsa-1024-sha-256-pkcs") == 0) {
       hash_size = sha256::DIGESTBYTESIZE;
       hash_alg = "sha-256";
@@ -1982,29 +2357,46 @@ int main(int an, char** av) {
     h.get_digest(hash_size, digest);
 
     rsa sk;
-    sk.rsa_key_ = new key_message;
-    if (!read_key(FLAGS_key2_file.c_str(), sk.rsa_key_)) {
-      printf("Can't issuer signing key\n");
-      ret = 1;
-      goto done;
-    }
-    if (!sk.retrieve_parameters_from_key_message()) {
-      printf("Can't retreive signing key data\n");
-      ret = 1;
-      goto done;
-    }
-    block_size = sk.bit_size_modulus_ / NBITSINBYTE;
-    print_key_message(*sk.rsa_key_);
-
+    ecc ek;
+    key_message* issuer_key;
     string s_signature; 
-    if (!pkcs_sign_rsa_hash(hash_alg, sk, digest, block_size, &s_signature)) {
-      printf("Can't sign body\n");
-      ret = 1;
-      goto done;
+    if (use_ecdsa) {
+      if (!read_ecc_key(FLAGS_key2_file.c_str(), ek)) {
+        ret = 1;
+        goto done;
+      }
+      issuer_key = ek.ecc_key_;
+      print_key_message(*issuer_key);
+      if (!ecdsa_sign_hash(ek, digest, hash_size, &s_signature)) {
+        printf("Can't sign body\n");
+        ret = 1;
+        goto done;
+      }
+    } else {
+      sk.rsa_key_ = new key_message;
+      if (!read_key(FLAGS_key2_file.c_str(), sk.rsa_key_)) {
+        printf("Can't issuer signing key\n");
+        ret = 1;
+        goto done;
+      }
+      if (!sk.retrieve_parameters_from_key_message()) {
+        printf("Can't retreive signing key data\n");
+        ret = 1;
+        goto done;
+      }
+      block_size = sk.bit_size_modulus_ / NBITSINBYTE;
+      issuer_key = sk.rsa_key_;
+      print_key_message(*issuer_key);
+
+      if (!pkcs_sign_rsa_hash(hash_alg, sk, digest, block_size, &s_signature)) {
+        printf("Can't sign body\n");
+        ret = 1;
+        goto done;
+      }
     }
 
     certificate_message* cm = make_certificate(*cbm, issuer_name_type, FLAGS_issuer_name,
-              *sk.rsa_key_, FLAGS_algorithm, s_signature);
+              *issuer_key, FLAGS_algorithm, s_signature);
     cm->set_signing_algorithm(FLAGS_algorithm.c_str());
     print_certificate_message(*cm);
 
@@ -2054,7 +2446,8 @@ int main(int an, char** av) {
     int hash_size;
     int block_size;
     const char* hash_alg;
-    if (strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
+    bool use_ecdsa = ecdsa_algorithm(FLAGS_algorithm.c_str());
+    if (use_ecdsa || strcmp(FLAGS_algorithm.c_str(), "rsa-2048-sha-256-pkcs") == 0 ||
         strcmp(FLAGS_algorithm.c_str(), "rsa-1024-sha-256-pkcs") == 0) {
         hash_size = sha256::DIGESTBYTESIZE;
         hash_alg = "sha-256";
@@ -2074,22 +2467,32 @@ int main(int an, char** av) {
     h.get_digest(hash_size, digest);
 
     rsa sk;
-    sk.rsa_key_ = new key_message;
-    if (!read_key(FLAGS_key2_file.c_str(), sk.rsa_key_)) {
-      printf("Can't read signing key\n");
-      ret = 1;
-      goto done;
-    }
-    if (!sk.retrieve_parameters_from_key_message()) {
-      printf("Can't retreive signing key data\n");
-      ret = 1;
-      goto done;
-    }
-    block_size = sk.bit_size_modulus_ / NBITSINBYTE;
-    
+    ecc ek;
+    bool verified;
     string s_signature;
     s_signature.assign((char*)cm.signature().data(), (size_t)cm.signature().size());
-    if (pkcs_verify_hash(hash_alg, sk, digest, block_size, s_signature)) {
+    if (use_ecdsa) {
+      if (!read_ecc_key(FLAGS_key2_file.c_str(), ek)) {
+        ret = 1;
+        goto done;
+      }
+      verified = ecdsa_verify_hash(ek, digest, hash_size, s_signature);
+    } else {
+      sk.rsa_key_ = new key_message;
+      if (!read_key(FLAGS_key2_file.c_str(), sk.rsa_key_)) {
+        printf("Can't read signing key\n");
+        ret = 1;
+        goto done;
+      }
+      if (!sk.retrieve_parameters_from_key_message()) {
+        printf("Can't retreive signing key data\n");
+        ret = 1;
+        goto done;
+      }
+      block_size = sk.bit_size_modulus_ / NBITSINBYTE;
+      verified = pkcs_verify_hash(hash_alg, sk, digest, block_size, s_signature);
+    }
+    if (verified) {
       printf("Certificate valid\n");
     } else {
       printf("Certificate invalid\n");
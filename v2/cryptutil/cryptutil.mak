@@ -46,12 +46,12 @@ O= $(OBJ_DIR)/cryptutil
 INCLUDE= -I$(SRC_DIR)/include -I$(S) -I$(S_SUPPORT) -I/usr/local/include
 
 ifndef NEWPROTOBUF
-CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++11
-CFLAGS1=$(INCLUDE) -O3 -g -Wall -std=c++11
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++11 -D X64
+CFLAGS1=$(INCLUDE) -O3 -g -Wall -std=c++11 -D X64
 LDFLAGS= -lprotobuf -lgtest -lgflags -lpthread
 else
-CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++17
-CFLAGS1=$(INCLUDE) -O3 -g -Wall -std=c++17
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++17 -D X64
+CFLAGS1=$(INCLUDE) -O3 -g -Wall -std=c++17 -D X64
 export LD_LIBRARY_PATH=/usr/local/lib
 LDFLAGS= -L/usr/local/lib `pkg-config --cflags --libs protobuf` -lgtest -lgflags -lpthread
 endif
@@ -71,6 +71,10 @@ $BIN/cryptutil.exe --operation=encrypt_file_with_password --algorithm="aes-hmac-
 --pass="my voice is my password" --input_file=test_plain --output_file=test_cipher
 $BIN/cryptutil.exe --operation=decrypt_file_with_password --algorithm="aes-hmac-sha256-cbc" --encrypt_key_size=128 --mac_key_size=256 \
 --pass="my voice is my password" --input_file=test_cipher --output_file=test_decrypted
+$BIN/cryptutil.exe --operation=encrypt_file_with_password --algorithm="aes-gcm" --encrypt_key_size=128 \
+--pass="my voice is my password" --input_file=test_plain --output_file=test_cipher
+$BIN/cryptutil.exe --operation=decrypt_file_with_password --algorithm="aes-gcm" --encrypt_key_size=128 \
+--pass="my voice is my password" --input_file=test_cipher --output_file=test_decrypted
 
 
 $BIN/cryptutil.exe --operation=generate_key --key_file=ecc_key --algorithm="ecc" \
@@ -81,3 +85,26 @@ $BIN/cryptutil.exe --operation=encrypt_with_key --key_file=ecc_key --input_file=
 $BIN/cryptutil.exe --operation=decrypt_with_key --key_file=ecc_key --input_file=pt1.out \
 --input2_file=pt2.out --output_file=ecc_decrypted
 
+
+$BIN/cryptutil.exe --operation=pkcs_sign_with_key --algorithm=ecc-256-sha-256-ecdsa --key_file=ecc_key \
+--key_name=ecc_test_key --signature_file=ecc_signature.file --input_file=test_plain  --signer_name=jlm
+$BIN/cryptutil.exe --operation=pkcs_verify_with_key --algorithm=ecc-256-sha-256-ecdsa --key_file=ecc_key \
+--key_name=ecc_test_key --signature_file=ecc_signature.file --input_file=test_plain
+$BIN/cryptutil.exe --operation=make_certificate_and_sign --algorithm=ecc-256-sha-256-ecdsa --key_file=ecc_key \
+--key_name=ecc_test_key --key2_file=ecc_key --issuer_name=jlm --subject_name=jlm --output_file=ecc_cert.out
+$BIN/cryptutil.exe --operation=verify_certificate --algorithm=ecc-256-sha-256-ecdsa --key_file=ecc_key \
+--key_name=ecc_test_key --key2_file=ecc_key  --input_file=ecc_cert.out
+
+
+$BIN/cryptutil.exe --operation=generate_key --key_file=x25519_key --algorithm="x25519" \
+--key_name=x25519_test_key
+$BIN/cryptutil.exe --operation=encrypt_with_key --key_file=x25519_key --input_file=test_plain \
+--output_file=x25519_cipher
+$BIN/cryptutil.exe --operation=decrypt_with_key --key_file=x25519_key --input_file=x25519_cipher \
+--output_file=x25519_decrypted
+$BIN/cryptutil.exe --operation=generate_key --key_file=ed25519_key --algorithm="ed25519" \
+--key_name=ed25519_test_key
+$BIN/cryptutil.exe --operation=pkcs_sign_with_key --algorithm=ed25519 --key_file=ed25519_key \
+--key_name=ed25519_test_key --signature_file=ed25519_signature.file --input_file=test_plain  --signer_name=jlm
+$BIN/cryptutil.exe --operation=pkcs_verify_with_key --algorithm=ed25519 --key_file=ed25519_key \
+--key_name=ed25519_test_key --signature_file=ed25519_signature.file --input_file=test_plain
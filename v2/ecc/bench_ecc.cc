@@ -0,0 +1,478 @@
+// Copyright 2020 John Manferdelli, All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: bench_ecc.cc
+
+#include <gflags/gflags.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include "crypto_support.h"
+#include "support.pb.h"
+#include "crypto_names.h"
+#include "big_num.h"
+#include "intel_digit_arith.h"
+#include "big_num_functions.h"
+#include "ecc.h"
+#include "ecc_curve_data.h"
+
+// Benchmarks for the ecc layer on the NIST curves.
+//   Each (curve, operation) cell is timed with read_rdtsc as in
+//   bench_big_num: cheap operations are repeated inside a sample and the
+//   figures are cycles per operation, with ops/sec derived from the
+//   median.  With --threads=n > 1 each cell is then run again on n
+//   threads at once, each with its own key and operands, and ops/sec is
+//   the aggregate over the wall clock time.  Results go to stdout as csv
+//   or json so runs can be diffed.
+
+DEFINE_string(format, "csv", "Output format: csv or json");
+DEFINE_string(curves, "P-256,P-384,P-521", "Comma separated curves to time");
+DEFINE_string(ops, "add,double,mult,faster_mult,projective_mult,embed,extract,"
+              "encrypt,decrypt", "Comma separated operations to time");
+DEFINE_int32(samples, 101, "Samples per operation and curve");
+DEFINE_int32(min_samples, 5, "Samples taken even if the time budget is spent");
+DEFINE_int32(budget_ms, 2000, "Time budget per operation and curve");
+DEFINE_int32(threads, 1, "Threads for the throughput run, 1 for none");
+
+const uint64_t min_sample_cycles = 20000ULL;
+const int embed_shift = 8;
+const int embed_trys = 20;
+
+uint64_t cycles_per_second = 0ULL;
+
+// Everything an operation touches, so threads share nothing but the
+// read only field and comb tables.
+class bench_operands {
+ public:
+  const char* curve_name_;
+  int n_;               // digits in p
+  int msg_size_;        // plaintext bytes
+  ecc key_;
+  curve_point* p_;      // random affine points
+  curve_point* q_;
+  curve_point* r_;      // results
+  curve_point* s_;
+  curve_point* embedded_;
+  curve_point* ct1_;    // an encryption of msg_
+  curve_point* ct2_;
+  big_num* k_;          // random scalar below the order
+  big_num* m_;
+  big_num* m_out_;
+  byte_t* msg_;
+  byte_t* out_;
+
+  bench_operands(const char* curve_name);
+  ~bench_operands();
+  bool init();
+};
+
+bench_operands::bench_operands(const char* curve_name) {
+  curve_name_ = curve_name;
+  n_ = 0;
+  msg_size_ = 0;
+  p_ = nullptr;
+  q_ = nullptr;
+  r_ = nullptr;
+  s_ = nullptr;
+  embedded_ = nullptr;
+  ct1_ = nullptr;
+  ct2_ = nullptr;
+  k_ = nullptr;
+  m_ = nullptr;
+  m_out_ = nullptr;
+  msg_ = nullptr;
+  out_ = nullptr;
+}
+
+bench_operands::~bench_operands() {
+  delete p_;
+  delete q_;
+  delete r_;
+  delete s_;
+  delete embedded_;
+  delete ct1_;
+  delete ct2_;
+  delete k_;
+  delete m_;
+  delete m_out_;
+  if (msg_ != nullptr)
+    delete []msg_;
+  if (out_ != nullptr)
+    delete []out_;
+}
+
+// 0 < k < order
+static bool random_scalar(big_num& order, big_num& k) {
+  big_num t(2 * order.size_ + 1);
+  if (crypto_get_random_bytes(2 * order.size_ * sizeof(uint64_t), (byte_t*)t.value_) < 0)
+    return false;
+  t.normalize();
+  k.zero_num();
+  if (!big_mod(t, order, k))
+    return false;
+  if (k.is_zero())
+    k.value_[0] = 1ULL;
+  k.normalize();
+  return true;
+}
+
+bool bench_operands::init() {
+  if (!key_.generate_ecc_from_standard_template(curve_name_, "bench_key",
+              "bench", seconds_in_common_year))
+    return false;
+  ecc_curve& c = *key_.c_;
+  n_ = c.curve_p_->capacity_;
+  int cap = 1 + 2 * n_;
+
+  p_ = new curve_point(cap);
+  q_ = new curve_point(cap);
+  r_ = new curve_point(cap);
+  s_ = new curve_point(cap);
+  embedded_ = new curve_point(cap);
+  ct1_ = new curve_point(cap);
+  ct2_ = new curve_point(cap);
+  k_ = new big_num(cap);
+  m_ = new big_num(cap);
+  m_out_ = new big_num(cap);
+
+  // p and q are random multiples of the base point
+  big_num t(cap);
+  if (!random_scalar(*key_.order_of_base_point_, t) ||
+      !ecc_mult(c, *key_.base_point_, t, *p_))
+    return false;
+  if (!random_scalar(*key_.order_of_base_point_, t) ||
+      !ecc_mult(c, *key_.base_point_, t, *q_))
+    return false;
+  if (!random_scalar(*key_.order_of_base_point_, *k_))
+    return false;
+
+  // room for the embedding shift, as in cryptutil
+  msg_size_ = key_.prime_bit_size_ / NBITSINBYTE / 2;
+  msg_ = new byte_t[n_ * sizeof(uint64_t)];
+  out_ = new byte_t[n_ * sizeof(uint64_t)];
+  memset(msg_, 0, n_ * sizeof(uint64_t));
+  if (crypto_get_random_bytes(msg_size_, msg_) < 0)
+    return false;
+  memcpy((byte_t*)m_->value_, msg_, msg_size_);
+  m_->normalize();
+  if (!ecc_embed(c, *m_, *embedded_, embed_shift, embed_trys))
+    return false;
+  return key_.encrypt(msg_size_, msg_, *k_, *ct1_, *ct2_);
+}
+
+// One call of op at operands o.
+typedef bool (*bench_op)(bench_operands& o);
+
+bool op_add(bench_operands& o) {
+  return ecc_add(*o.key_.c_, *o.p_, *o.q_, *o.r_);
+}
+
+bool op_double(bench_operands& o) {
+  return ecc_double(*o.key_.c_, *o.p_, *o.r_);
+}
+
+bool op_mult(bench_operands& o) {
+  return ecc_mult(*o.key_.c_, *o.p_, *o.k_, *o.r_);
+}
+
+bool op_faster_mult(bench_operands& o) {
+  return faster_ecc_mult(*o.key_.c_, *o.p_, *o.k_, *o.r_);
+}
+
+bool op_projective_mult(bench_operands& o) {
+  return projective_point_mult(*o.key_.c_, *o.k_, *o.p_, *o.r_);
+}
+
+bool op_embed(bench_operands& o) {
+  return ecc_embed(*o.key_.c_, *o.m_, *o.r_, embed_shift, embed_trys);
+}
+
+bool op_extract(bench_operands& o) {
+  o.m_out_->zero_num();
+  return ecc_extract(*o.key_.c_, *o.embedded_, *o.m_out_, embed_shift);
+}
+
+bool op_encrypt(bench_operands& o) {
+  return o.key_.encrypt(o.msg_size_, o.msg_, *o.k_, *o.r_, *o.s_);
+}
+
+bool op_decrypt(bench_operands& o) {
+  int size = o.n_ * sizeof(uint64_t);
+  return o.key_.decrypt(*o.ct1_, *o.ct2_, &size, o.out_);
+}
+
+struct bench_entry {
+  const char* name_;
+  bench_op op_;
+  bool expensive_;
+};
+
+bench_entry bench_table[] = {
+  {"add", op_add, false},
+  {"double", op_double, false},
+  {"mult", op_mult, true},
+  {"faster_mult", op_faster_mult, true},
+  {"projective_mult", op_projective_mult, true},
+  {"embed", op_embed, false},
+  {"extract", op_extract, false},
+  {"encrypt", op_encrypt, true},
+  {"decrypt", op_decrypt, true},
+};
+const int num_bench_entries = sizeof(bench_table) / sizeof(bench_entry);
+
+class bench_result {
+ public:
+  const char* name_;
+  const char* curve_name_;
+  int threads_;
+  int samples_;
+  int reps_;
+  double median_;
+  double p99_;
+  double mean_;
+  double min_;
+  double ops_per_sec_;
+};
+
+// What one thread measured: cycles per op in each sample.
+class bench_samples {
+ public:
+  bool ok_;
+  int reps_;
+  uint64_t ops_;
+  std::vector<double> per_op_;
+};
+
+static int reps_for(bench_entry& e, bench_operands& o) {
+  uint64_t t0 = read_rdtsc();
+  if (!e.op_(o))
+    return -1;
+  uint64_t one = read_rdtsc() - t0;
+  if (!e.expensive_ && one < min_sample_cycles)
+    return (int)(min_sample_cycles / (one + 1)) + 1;
+  return 1;
+}
+
+static void take_samples(bench_entry* e, bench_operands* o, int reps,
+                         bench_samples* s) {
+  uint64_t budget = (cycles_per_second / 1000ULL) * (uint64_t)FLAGS_budget_ms;
+  uint64_t spent = 0ULL;
+
+  s->ok_ = true;
+  s->reps_ = reps;
+  s->ops_ = 0ULL;
+  for (int i = 0; i < FLAGS_samples; i++) {
+    if (i >= FLAGS_min_samples && spent > budget)
+      break;
+    uint64_t t0 = read_rdtsc();
+    for (int j = 0; j < reps; j++) {
+      if (!e->op_(*o)) {
+        s->ok_ = false;
+        return;
+      }
+    }
+    uint64_t t = read_rdtsc() - t0;
+    spent += t;
+    s->ops_ += (uint64_t)reps;
+    s->per_op_.push_back((double)t / (double)reps);
+  }
+}
+
+static void summarize(bench_entry& e, bench_operands& o, int threads,
+                      std::vector<double>& per_op, int reps, uint64_t ops,
+                      uint64_t wall, bench_result* res) {
+  std::sort(per_op.begin(), per_op.end());
+  int k = (int)per_op.size();
+  double sum = 0.0;
+  for (int i = 0; i < k; i++)
+    sum += per_op[i];
+  res->name_ = e.name_;
+  res->curve_name_ = o.curve_name_;
+  res->threads_ = threads;
+  res->samples_ = k;
+  res->reps_ = reps;
+  res->median_ = per_op[k / 2];
+  res->p99_ = per_op[(99 * (k - 1)) / 100];
+  res->mean_ = sum / (double)k;
+  res->min_ = per_op[0];
+  if (threads == 1)
+    res->ops_per_sec_ = (double)cycles_per_second / res->median_;
+  else
+    res->ops_per_sec_ = (double)ops * (double)cycles_per_second / (double)wall;
+}
+
+static bool time_op(bench_entry& e, bench_operands& o, bench_result* res) {
+  int reps = reps_for(e, o);
+  if (reps < 0)
+    return false;
+  bench_samples s;
+  take_samples(&e, &o, reps, &s);
+  if (!s.ok_)
+    return false;
+  summarize(e, o, 1, s.per_op_, reps, s.ops_, 0ULL, res);
+  return true;
+}
+
+// All threads run e at once, each on its own operands.  The latency
+// figures pool every thread's samples.
+static bool time_op_threaded(bench_entry& e, int threads, bench_operands** o,
+                             bench_result* res) {
+  int reps = reps_for(e, *o[0]);
+  if (reps < 0)
+    return false;
+
+  bench_samples* s = new bench_samples[threads];
+  std::thread* workers = new std::thread[threads];
+  uint64_t t0 = read_rdtsc();
+  for (int i = 0; i < threads; i++)
+    workers[i] = std::thread(take_samples, &e, o[i], reps, &s[i]);
+  for (int i = 0; i < threads; i++)
+    workers[i].join();
+  uint64_t wall = read_rdtsc() - t0;
+
+  bool ret = true;
+  std::vector<double> per_op;
+  uint64_t ops = 0ULL;
+  for (int i = 0; i < threads; i++) {
+    if (!s[i].ok_)
+      ret = false;
+    ops += s[i].ops_;
+    per_op.insert(per_op.end(), s[i].per_op_.begin(), s[i].per_op_.end());
+  }
+  if (ret)
+    summarize(e, *o[0], threads, per_op, reps, ops, wall, res);
+  delete []workers;
+  delete []s;
+  return ret;
+}
+
+static bool in_list(string& flag, const char* name) {
+  string list = "," + flag + ",";
+  string key = string(",") + name + ",";
+  return list.find(key) != string::npos;
+}
+
+static double cycles_to_ns(double c) {
+  return 1.0e9 * c / (double)cycles_per_second;
+}
+
+void print_header() {
+  if (FLAGS_format == "json") {
+    printf("{\n  \"cycles_per_second\": %llu,\n",
+           (unsigned long long)cycles_per_second);
+    printf("  \"results\": [");
+  } else {
+    printf("curve,op,threads,samples,reps,median_cycles,p99_cycles,mean_cycles,"
+           "min_cycles,median_ns,ops_per_sec\n");
+  }
+}
+
+void print_result(bench_result& r, bool first) {
+  if (FLAGS_format == "json") {
+    printf("%s\n    {\"curve\": \"%s\", \"op\": \"%s\", \"threads\": %d, "
+           "\"samples\": %d, \"reps\": %d, \"median_cycles\": %.1f, "
+           "\"p99_cycles\": %.1f, \"mean_cycles\": %.1f, \"min_cycles\": %.1f, "
+           "\"median_ns\": %.1f, \"ops_per_sec\": %.1f}",
+           first ? "" : ",", r.curve_name_, r.name_, r.threads_, r.samples_,
+           r.reps_, r.median_, r.p99_, r.mean_, r.min_, cycles_to_ns(r.median_),
+           r.ops_per_sec_);
+  } else {
+    printf("%s,%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f,%.1f,%.1f\n", r.curve_name_,
+           r.name_, r.threads_, r.samples_, r.reps_, r.median_, r.p99_, r.mean_,
+           r.min_, cycles_to_ns(r.median_), r.ops_per_sec_);
+  }
+  fflush(stdout);
+}
+
+void print_trailer() {
+  if (FLAGS_format == "json")
+    printf("\n  ]\n}\n");
+}
+
+const char* bench_curves[] = {"P-256", "P-384", "P-521"};
+const int num_bench_curves = sizeof(bench_curves) / sizeof(const char*);
+
+int main(int an, char** av) {
+  gflags::ParseCommandLineFlags(&an, &av, true);
+
+  if (FLAGS_format != "csv" && FLAGS_format != "json") {
+    fprintf(stderr, "Unknown format %s\n", FLAGS_format.c_str());
+    return 1;
+  }
+  if (FLAGS_threads < 1) {
+    fprintf(stderr, "--threads must be at least 1\n");
+    return 1;
+  }
+  if (!init_crypto()) {
+    fprintf(stderr, "Can't init_crypto\n");
+    return 1;
+  }
+  cycles_per_second = calibrate_rdtsc();
+  if (cycles_per_second == 0ULL) {
+    fprintf(stderr, "No cycle counter on this machine\n");
+    close_crypto();
+    return 1;
+  }
+  if (!init_ecc_curves()) {
+    fprintf(stderr, "Can't init_ecc_curves\n");
+    close_crypto();
+    return 1;
+  }
+
+  int ret = 0;
+  bool first = true;
+  print_header();
+  for (int i = 0; i < num_bench_curves; i++) {
+    if (!in_list(FLAGS_curves, bench_curves[i]))
+      continue;
+    int nt = FLAGS_threads;
+    bench_operands** o = new bench_operands*[nt];
+    bool ready = true;
+    for (int t = 0; t < nt; t++) {
+      o[t] = new bench_operands(bench_curves[i]);
+      if (!o[t]->init())
+        ready = false;
+    }
+    if (!ready) {
+      fprintf(stderr, "Can't make %s operands\n", bench_curves[i]);
+      ret = 1;
+    }
+    for (int j = 0; ready && j < num_bench_entries; j++) {
+      if (!in_list(FLAGS_ops, bench_table[j].name_))
+        continue;
+      bench_result r;
+      if (!time_op(bench_table[j], *o[0], &r)) {
+        fprintf(stderr, "%s failed on %s\n", bench_table[j].name_, bench_curves[i]);
+        ret = 1;
+        continue;
+      }
+      print_result(r, first);
+      first = false;
+      if (nt == 1)
+        continue;
+      if (!time_op_threaded(bench_table[j], nt, o, &r)) {
+        fprintf(stderr, "%s failed on %s, %d threads\n", bench_table[j].name_,
+                bench_curves[i], nt);
+        ret = 1;
+        continue;
+      }
+      print_result(r, first);
+    }
+    for (int t = 0; t < nt; t++)
+      delete o[t];
+    delete []o;
+  }
+  print_trailer();
+
+  close_crypto();
+  return ret;
+}
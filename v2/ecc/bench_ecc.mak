@@ -0,0 +1,147 @@
+#    Copyright 2014 John Manferdelli, All Rights Reserved.
+#    Licensed under the Apache License, Version 2.0 (the "License");
+#    you may not use this file except in compliance with the License.
+#    You may obtain a copy of the License at
+#        http://www.apache.org/licenses/LICENSE-2.0
+#    or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS,
+#    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+#    See the License for the specific language governing permissions and
+#    limitations under the License
+#    File: bench_ecc.mak
+
+
+ifndef SRC_DIR
+SRC_DIR=$(HOME)/src/github.com/jlmucb/crypto/v2
+endif
+ifndef OBJ_DIR
+OBJ_DIR=$(HOME)/cryptoobj/v2
+endif
+ifndef EXE_DIR
+EXE_DIR=$(HOME)/cryptobin
+endif
+#ifndef GOOGLE_INCLUDE
+#GOOGLE_INCLUDE=/usr/local/include/google
+#endif
+ifndef LOCAL_LIB
+LOCAL_LIB=/usr/local/lib
+endif
+ifndef TARGET_MACHINE_TYPE
+TARGET_MACHINE_TYPE=X64
+endif
+NEWPROTOBUF=1
+
+S= $(SRC_DIR)/ecc
+O= $(OBJ_DIR)/ecc
+S_SUPPORT=$(SRC_DIR)/crypto_support
+S_BIG_NUM=$(SRC_DIR)/big_num
+S_HASH=$(SRC_DIR)/hash
+INCLUDE= -I$(SRC_DIR)/include -I$(S) -I$(S_SUPPORT) -I/usr/local/include
+
+ifndef NEWPROTOBUF
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++11 -Wno-unused-variable
+CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++11 -Wno-unused-variable
+LDFLAGS= -lprotobuf -lgflags -lpthread
+else
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++17 -Wno-unused-variable
+CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++17 -Wno-unused-variable
+export LD_LIBRARY_PATH=/usr/local/lib
+LDFLAGS= -L/usr/local/lib `pkg-config --cflags --libs protobuf` -lgflags -lpthread
+endif
+
+CC=g++
+LINK=g++
+PROTO=protoc
+AR=ar
+
+dobj=	$(O)/bench_ecc.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/ecc.o $(O)/ecc_field.o $(O)/ecc_mult.o $(O)/curve25519.o \
+	$(O)/globals.o $(O)/big_num.o $(O)/intel_digit_arith.o $(O)/basic_arith.o $(O)/number_theory.o \
+	$(O)/ecc_curve_data.o $(O)/hash.o $(O)/sha256.o $(O)/sha512.o $(O)/hmac_sha256.o
+
+all:	bench_ecc.exe
+clean:
+	@echo "removing object files"
+	rm $(O)/*.o
+	@echo "removing executable file"
+	rm $(EXE_DIR)/bench_ecc.exe
+
+bench_ecc.exe: $(dobj) 
+	@echo "linking executable files"
+	$(LINK) -o $(EXE_DIR)/bench_ecc.exe $(dobj) $(LDFLAGS)
+
+$(S_SUPPORT)/support.pb.cc $(S_SUPPORT)/support.pb.h: $(S_SUPPORT)/support.proto
+	$(PROTO) -I=$(S) --cpp_out=$(S_SUPPORT) $(S_SUPPORT)/support.proto
+
+$(O)/bench_ecc.o: $(S)/bench_ecc.cc
+	@echo "compiling bench_ecc.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/bench_ecc.o $(S)/bench_ecc.cc
+
+$(O)/support.pb.o: $(S_SUPPORT)/support.pb.cc $(S_SUPPORT)/support.pb.h
+	@echo "compiling support.pb.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/support.pb.o $(S_SUPPORT)/support.pb.cc
+
+$(O)/crypto_support.o: $(S_SUPPORT)/crypto_support.cc $(S_SUPPORT)/support.pb.h
+	@echo "compiling crypto_support.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/crypto_support.o $(S_SUPPORT)/crypto_support.cc
+
+$(O)/crypto_names.o: $(S_SUPPORT)/crypto_names.cc
+	@echo "compiling crypto_names.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/crypto_names.o $(S_SUPPORT)/crypto_names.cc
+
+$(O)/ecc.o: $(S)/ecc.cc
+	@echo "compiling ecc.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc.o $(S)/ecc.cc
+
+$(O)/ecc_field.o: $(S)/ecc_field.cc
+	@echo "compiling ecc_field.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_field.o $(S)/ecc_field.cc
+
+$(O)/ecc_mult.o: $(S)/ecc_mult.cc
+	@echo "compiling ecc_mult.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_mult.o $(S)/ecc_mult.cc
+
+$(O)/curve25519.o: $(S)/curve25519.cc
+	@echo "compiling curve25519.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/curve25519.o $(S)/curve25519.cc
+
+$(O)/ecc_curve_data.o: $(S)/ecc_curve_data.cc
+	@echo "compiling ecc_curve_data.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_curve_data.o $(S)/ecc_curve_data.cc
+
+$(O)/hash.o: $(S_HASH)/hash.cc
+	@echo "compiling hash.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/hash.o $(S_HASH)/hash.cc
+
+$(O)/sha256.o: $(S_HASH)/sha256.cc
+	@echo "compiling sha256.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha256.o $(S_HASH)/sha256.cc
+
+$(O)/sha512.o: $(S_HASH)/sha512.cc
+	@echo "compiling sha512.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha512.o $(S_HASH)/sha512.cc
+
+$(O)/hmac_sha256.o: $(S_HASH)/hmac_sha256.cc
+	@echo "compiling hmac_sha256.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/hmac_sha256.o $(S_HASH)/hmac_sha256.cc
+
+$(O)/big_num.o: $(S_BIG_NUM)/big_num.cc
+	@echo "compiling big_num.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/big_num.o $(S_BIG_NUM)/big_num.cc
+
+$(O)/globals.o: $(S_BIG_NUM)/globals.cc
+	@echo "compiling globals.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/globals.o $(S_BIG_NUM)/globals.cc
+
+$(O)/intel_digit_arith.o: $(S_BIG_NUM)/intel_digit_arith.cc
+	@echo "compiling intel_digit_arith.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/intel_digit_arith.o $(S_BIG_NUM)/intel_digit_arith.cc
+
+$(O)/number_theory.o: $(S_BIG_NUM)/number_theory.cc
+	@echo "compiling number_theory.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/number_theory.o $(S_BIG_NUM)/number_theory.cc
+
+$(O)/basic_arith.o: $(S_BIG_NUM)/basic_arith.cc
+	@echo "compiling basic_arith.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/basic_arith.o $(S_BIG_NUM)/basic_arith.cc
+
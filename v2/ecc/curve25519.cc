@@ -0,0 +1,1041 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: curve25519.cc
+
+#include <mutex>
+#include "crypto_support.h"
+#include "big_num.h"
+#include "big_num_functions.h"
+#include "sha512.h"
+#include "curve25519.h"
+
+typedef unsigned __int128 uint128_t;
+
+// ---------------------------------------------------------------------------
+// GF(2^255-19): h = v_[0] + 2^51 v_[1] + ... + 2^204 v_[4].  The limbs are
+// kept below 2^52 between operations; only fe_to_bytes reduces fully.
+
+const uint64_t fe_mask51 = (((uint64_t)1) << 51) - 1;
+
+class fe25519 {
+ public:
+  uint64_t v_[5];
+};
+
+static const fe25519 fe_d = {{0x34dca135978a3ULL, 0x1a8283b156ebdULL,
+    0x5e7a26001c029ULL, 0x739c663a03cbbULL, 0x52036cee2b6ffULL}};
+static const fe25519 fe_d2 = {{0x69b9426b2f159ULL, 0x35050762add7aULL,
+    0x3cf44c0038052ULL, 0x6738cc7407977ULL, 0x2406d9dc56dffULL}};
+static const fe25519 fe_sqrtm1 = {{0x61b274a0ea0b0ULL, 0x0d5a5fc8f189dULL,
+    0x7ef5e9cbd0c60ULL, 0x78595a6804c9eULL, 0x2b8324804fc1dULL}};
+
+static inline uint64_t load_64(const byte_t* in) {
+  uint64_t r = 0;
+  for (int i = 7; i >= 0; i--)
+    r = (r << NBITSINBYTE) | in[i];
+  return r;
+}
+
+static inline void store_64(uint64_t x, byte_t* out) {
+  for (int i = 0; i < 8; i++) {
+    out[i] = (byte_t)x;
+    x >>= NBITSINBYTE;
+  }
+}
+
+static inline void fe_zero(fe25519& h) {
+  for (int i = 0; i < 5; i++)
+    h.v_[i] = 0;
+}
+
+static inline void fe_one(fe25519& h) {
+  fe_zero(h);
+  h.v_[0] = 1;
+}
+
+static inline void fe_carry(fe25519& h) {
+  uint64_t c;
+  c = h.v_[0] >> 51; h.v_[0] &= fe_mask51; h.v_[1] += c;
+  c = h.v_[1] >> 51; h.v_[1] &= fe_mask51; h.v_[2] += c;
+  c = h.v_[2] >> 51; h.v_[2] &= fe_mask51; h.v_[3] += c;
+  c = h.v_[3] >> 51; h.v_[3] &= fe_mask51; h.v_[4] += c;
+  c = h.v_[4] >> 51; h.v_[4] &= fe_mask51; h.v_[0] += 19 * c;
+}
+
+static inline void fe_add(fe25519& h, const fe25519& f, const fe25519& g) {
+  for (int i = 0; i < 5; i++)
+    h.v_[i] = f.v_[i] + g.v_[i];
+  fe_carry(h);
+}
+
+// h = f - g, computed as f + 4p - g so no limb goes negative
+static inline void fe_sub(fe25519& h, const fe25519& f, const fe25519& g) {
+  h.v_[0] = (f.v_[0] + 0x1fffffffffffb4ULL) - g.v_[0];
+  for (int i = 1; i < 5; i++)
+    h.v_[i] = (f.v_[i] + 0x1ffffffffffffcULL) - g.v_[i];
+  fe_carry(h);
+}
+
+static inline void fe_neg(fe25519& h, const fe25519& f) {
+  fe25519 z;
+  fe_zero(z);
+  fe_sub(h, z, f);
+}
+
+// Reduce the five double width column sums into h
+static inline void fe_reduce_wide(fe25519& h, uint128_t r0, uint128_t r1,
+                                  uint128_t r2, uint128_t r3, uint128_t r4) {
+  uint64_t h0, h1, h2, h3, h4;
+  r1 += (uint64_t)(r0 >> 51); h0 = (uint64_t)r0 & fe_mask51;
+  r2 += (uint64_t)(r1 >> 51); h1 = (uint64_t)r1 & fe_mask51;
+  r3 += (uint64_t)(r2 >> 51); h2 = (uint64_t)r2 & fe_mask51;
+  r4 += (uint64_t)(r3 >> 51); h3 = (uint64_t)r3 & fe_mask51;
+  uint128_t t = (uint128_t)h0 + ((uint128_t)(uint64_t)(r4 >> 51)) * 19;
+  h4 = (uint64_t)r4 & fe_mask51;
+  h0 = (uint64_t)t & fe_mask51;
+  h1 += (uint64_t)(t >> 51);
+  h.v_[0] = h0; h.v_[1] = h1; h.v_[2] = h2; h.v_[3] = h3; h.v_[4] = h4;
+}
+
+static void fe_mult(fe25519& h, const fe25519& f, const fe25519& g) {
+  uint64_t f0 = f.v_[0], f1 = f.v_[1], f2 = f.v_[2], f3 = f.v_[3], f4 = f.v_[4];
+  uint64_t g0 = g.v_[0], g1 = g.v_[1], g2 = g.v_[2], g3 = g.v_[3], g4 = g.v_[4];
+  uint64_t g1_19 = 19 * g1, g2_19 = 19 * g2, g3_19 = 19 * g3, g4_19 = 19 * g4;
+
+  uint128_t r0 = (uint128_t)f0 * g0 + (uint128_t)f1 * g4_19 +
+                 (uint128_t)f2 * g3_19 + (uint128_t)f3 * g2_19 +
+                 (uint128_t)f4 * g1_19;
+  uint128_t r1 = (uint128_t)f0 * g1 + (uint128_t)f1 * g0 +
+                 (uint128_t)f2 * g4_19 + (uint128_t)f3 * g3_19 +
+                 (uint128_t)f4 * g2_19;
+  uint128_t r2 = (uint128_t)f0 * g2 + (uint128_t)f1 * g1 +
+                 (uint128_t)f2 * g0 + (uint128_t)f3 * g4_19 +
+                 (uint128_t)f4 * g3_19;
+  uint128_t r3 = (uint128_t)f0 * g3 + (uint128_t)f1 * g2 +
+                 (uint128_t)f2 * g1 + (uint128_t)f3 * g0 +
+                 (uint128_t)f4 * g4_19;
+  uint128_t r4 = (uint128_t)f0 * g4 + (uint128_t)f1 * g3 +
+                 (uint128_t)f2 * g2 + (uint128_t)f3 * g1 +
+                 (uint128_t)f4 * g0;
+  fe_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+static void fe_square(fe25519& h, const fe25519& f) {
+  uint64_t f0 = f.v_[0], f1 = f.v_[1], f2 = f.v_[2], f3 = f.v_[3], f4 = f.v_[4];
+  uint64_t f0_2 = 2 * f0, f1_2 = 2 * f1;
+  uint64_t f1_38 = 38 * f1, f2_38 = 38 * f2, f3_38 = 38 * f3;
+  uint64_t f3_19 = 19 * f3, f4_19 = 19 * f4;
+
+  uint128_t r0 = (uint128_t)f0 * f0 + (uint128_t)f1_38 * f4 +
+                 (uint128_t)f2_38 * f3;
+  uint128_t r1 = (uint128_t)f0_2 * f1 + (uint128_t)f2_38 * f4 +
+                 (uint128_t)f3_19 * f3;
+  uint128_t r2 = (uint128_t)f0_2 * f2 + (uint128_t)f1 * f1 +
+                 (uint128_t)f3_38 * f4;
+  uint128_t r3 = (uint128_t)f0_2 * f3 + (uint128_t)f1_2 * f2 +
+                 (uint128_t)f4_19 * f4;
+  uint128_t r4 = (uint128_t)f0_2 * f4 + (uint128_t)f1_2 * f3 +
+                 (uint128_t)f2 * f2;
+  fe_reduce_wide(h, r0, r1, r2, r3, r4);
+}
+
+// h = f^(2^n)
+static void fe_square_n(fe25519& h, const fe25519& f, int n) {
+  fe_square(h, f);
+  for (int i = 1; i < n; i++)
+    fe_square(h, h);
+}
+
+static void fe_mult_small(fe25519& h, const fe25519& f, uint64_t n) {
+  fe_reduce_wide(h, (uint128_t)f.v_[0] * n, (uint128_t)f.v_[1] * n,
+                 (uint128_t)f.v_[2] * n, (uint128_t)f.v_[3] * n,
+                 (uint128_t)f.v_[4] * n);
+}
+
+// z_11 = z^11 and z_250 = z^(2^250-1), shared by inversion and square roots
+static void fe_pow_common(const fe25519& z, fe25519& z_11, fe25519& z_250) {
+  fe25519 z2, z9, t, z_5, z_10, z_20, z_50, z_100;
+
+  fe_square(z2, z);
+  fe_square_n(t, z2, 2);
+  fe_mult(z9, t, z);
+  fe_mult(z_11, z9, z2);
+  fe_square(t, z_11);
+  fe_mult(z_5, t, z9);
+  fe_square_n(t, z_5, 5);
+  fe_mult(z_10, t, z_5);
+  fe_square_n(t, z_10, 10);
+  fe_mult(z_20, t, z_10);
+  fe_square_n(t, z_20, 20);
+  fe_mult(t, t, z_20);
+  fe_square_n(t, t, 10);
+  fe_mult(z_50, t, z_10);
+  fe_square_n(t, z_50, 50);
+  fe_mult(z_100, t, z_50);
+  fe_square_n(t, z_100, 100);
+  fe_mult(t, t, z_100);
+  fe_square_n(t, t, 50);
+  fe_mult(z_250, t, z_50);
+}
+
+// h = z^(p-2) = 1/z, and 0 for z = 0
+static void fe_invert(fe25519& h, const fe25519& z) {
+  fe25519 z_11, z_250, t;
+  fe_pow_common(z, z_11, z_250);
+  fe_square_n(t, z_250, 5);
+  fe_mult(h, t, z_11);
+}
+
+// h = z^((p-5)/8)
+static void fe_pow22523(fe25519& h, const fe25519& z) {
+  fe25519 z_11, z_250, t;
+  fe_pow_common(z, z_11, z_250);
+  fe_square_n(t, z_250, 2);
+  fe_mult(h, t, z);
+}
+
+// Bit 255 is ignored
+static void fe_from_bytes(fe25519& h, const byte_t* in) {
+  h.v_[0] = load_64(in) & fe_mask51;
+  h.v_[1] = (load_64(in + 6) >> 3) & fe_mask51;
+  h.v_[2] = (load_64(in + 12) >> 6) & fe_mask51;
+  h.v_[3] = (load_64(in + 19) >> 1) & fe_mask51;
+  h.v_[4] = (load_64(in + 24) >> 12) & fe_mask51;
+}
+
+// The unique representative in [0, p)
+static void fe_to_bytes(byte_t* out, const fe25519& f) {
+  fe25519 h = f;
+  uint64_t q;
+
+  fe_carry(h);
+  q = (h.v_[0] + 19) >> 51;
+  q = (h.v_[1] + q) >> 51;
+  q = (h.v_[2] + q) >> 51;
+  q = (h.v_[3] + q) >> 51;
+  q = (h.v_[4] + q) >> 51;
+  h.v_[0] += 19 * q;
+  h.v_[1] += h.v_[0] >> 51; h.v_[0] &= fe_mask51;
+  h.v_[2] += h.v_[1] >> 51; h.v_[1] &= fe_mask51;
+  h.v_[3] += h.v_[2] >> 51; h.v_[2] &= fe_mask51;
+  h.v_[4] += h.v_[3] >> 51; h.v_[3] &= fe_mask51;
+  h.v_[4] &= fe_mask51;
+
+  store_64(h.v_[0] | (h.v_[1] << 51), out);
+  store_64((h.v_[1] >> 13) | (h.v_[2] << 38), out + 8);
+  store_64((h.v_[2] >> 26) | (h.v_[3] << 25), out + 16);
+  store_64((h.v_[3] >> 39) | (h.v_[4] << 12), out + 24);
+}
+
+static bool fe_is_zero(const fe25519& f) {
+  byte_t s[32];
+  byte_t acc = 0;
+  fe_to_bytes(s, f);
+  for (int i = 0; i < 32; i++)
+    acc |= s[i];
+  return acc == 0;
+}
+
+static int fe_is_negative(const fe25519& f) {
+  byte_t s[32];
+  fe_to_bytes(s, f);
+  return s[0] & 1;
+}
+
+// Swap f and g if b = 1, without branching on b
+static inline void fe_cswap(fe25519& f, fe25519& g, uint64_t b) {
+  uint64_t mask = 0 - b;
+  for (int i = 0; i < 5; i++) {
+    uint64_t x = mask & (f.v_[i] ^ g.v_[i]);
+    f.v_[i] ^= x;
+    g.v_[i] ^= x;
+  }
+}
+
+// f = g if b = 1, without branching on b
+static inline void fe_cmov(fe25519& f, const fe25519& g, uint64_t b) {
+  uint64_t mask = 0 - b;
+  for (int i = 0; i < 5; i++)
+    f.v_[i] ^= mask & (f.v_[i] ^ g.v_[i]);
+}
+
+// ---------------------------------------------------------------------------
+// X25519
+
+bool x25519(byte_t* scalar, byte_t* u, byte_t* out) {
+  byte_t k[32];
+  fe25519 x1, x2, z2, x3, z3;
+  fe25519 a, aa, b, bb, e, c, d, da, cb, t;
+  uint64_t swap = 0;
+  byte_t acc = 0;
+
+  memcpy(k, scalar, 32);
+  k[0] &= 248;
+  k[31] &= 127;
+  k[31] |= 64;
+
+  fe_from_bytes(x1, u);
+  fe_one(x2);
+  fe_zero(z2);
+  x3 = x1;
+  fe_one(z3);
+
+  for (int i = 254; i >= 0; i--) {
+    uint64_t k_t = (k[i >> 3] >> (i & 7)) & 1;
+    swap ^= k_t;
+    fe_cswap(x2, x3, swap);
+    fe_cswap(z2, z3, swap);
+    swap = k_t;
+
+    fe_add(a, x2, z2);
+    fe_square(aa, a);
+    fe_sub(b, x2, z2);
+    fe_square(bb, b);
+    fe_sub(e, aa, bb);
+    fe_add(c, x3, z3);
+    fe_sub(d, x3, z3);
+    fe_mult(da, d, a);
+    fe_mult(cb, c, b);
+    fe_add(t, da, cb);
+    fe_square(x3, t);
+    fe_sub(t, da, cb);
+    fe_square(t, t);
+    fe_mult(z3, x1, t);
+    fe_mult(x2, aa, bb);
+    fe_mult_small(t, e, 121665);
+    fe_add(t, aa, t);
+    fe_mult(z2, e, t);
+  }
+  fe_cswap(x2, x3, swap);
+  fe_cswap(z2, z3, swap);
+
+  fe_invert(z2, z2);
+  fe_mult(x2, x2, z2);
+  fe_to_bytes(out, x2);
+  memset(k, 0, sizeof(k));
+
+  for (int i = 0; i < 32; i++)
+    acc |= out[i];
+  return acc != 0;
+}
+
+bool x25519_public_key(byte_t* secret, byte_t* pub) {
+  byte_t base[32];
+  memset(base, 0, sizeof(base));
+  base[0] = 9;
+  return x25519(secret, base, pub);
+}
+
+// ---------------------------------------------------------------------------
+// edwards25519 points, following the ref10 representations:
+//   ed_p2:    (X:Y:Z), x = X/Z, y = Y/Z
+//   ed_p3:    (X:Y:Z:T), extended, also XY = ZT
+//   ed_p1p1:  ((X:Z),(Y:T)), x = X/Z, y = Y/T, the output of add and double
+//   ed_cached: (Y+X, Y-X, Z, 2dT), the second operand of an addition
+//   ed_niels: (y+x, y-x, 2dxy), an affine second operand
+
+class ed_p2 {
+ public:
+  fe25519 x_, y_, z_;
+};
+
+class ed_p3 {
+ public:
+  fe25519 x_, y_, z_, t_;
+};
+
+class ed_p1p1 {
+ public:
+  fe25519 x_, y_, z_, t_;
+};
+
+class ed_cached {
+ public:
+  fe25519 y_plus_x_, y_minus_x_, z_, t2d_;
+};
+
+class ed_niels {
+ public:
+  fe25519 y_plus_x_, y_minus_x_, xy2d_;
+};
+
+static void ed_p3_identity(ed_p3& h) {
+  fe_zero(h.x_);
+  fe_one(h.y_);
+  fe_one(h.z_);
+  fe_zero(h.t_);
+}
+
+static void ed_p1p1_to_p2(ed_p2& r, const ed_p1p1& p) {
+  fe_mult(r.x_, p.x_, p.t_);
+  fe_mult(r.y_, p.y_, p.z_);
+  fe_mult(r.z_, p.z_, p.t_);
+}
+
+static void ed_p1p1_to_p3(ed_p3& r, const ed_p1p1& p) {
+  fe_mult(r.x_, p.x_, p.t_);
+  fe_mult(r.y_, p.y_, p.z_);
+  fe_mult(r.z_, p.z_, p.t_);
+  fe_mult(r.t_, p.x_, p.y_);
+}
+
+static void ed_p3_to_p2(ed_p2& r, const ed_p3& p) {
+  r.x_ = p.x_;
+  r.y_ = p.y_;
+  r.z_ = p.z_;
+}
+
+static void ed_p3_to_cached(ed_cached& r, const ed_p3& p) {
+  fe_add(r.y_plus_x_, p.y_, p.x_);
+  fe_sub(r.y_minus_x_, p.y_, p.x_);
+  r.z_ = p.z_;
+  fe_mult(r.t2d_, p.t_, fe_d2);
+}
+
+static void ed_p3_neg(ed_p3& r, const ed_p3& p) {
+  fe_neg(r.x_, p.x_);
+  r.y_ = p.y_;
+  r.z_ = p.z_;
+  fe_neg(r.t_, p.t_);
+}
+
+// r = 2p
+static void ed_p2_dbl(ed_p1p1& r, const ed_p2& p) {
+  fe25519 t0;
+  fe_square(r.x_, p.x_);
+  fe_square(r.z_, p.y_);
+  fe_square(r.t_, p.z_);
+  fe_add(r.t_, r.t_, r.t_);
+  fe_add(r.y_, p.x_, p.y_);
+  fe_square(t0, r.y_);
+  fe_add(r.y_, r.z_, r.x_);
+  fe_sub(r.z_, r.z_, r.x_);
+  fe_sub(r.x_, t0, r.y_);
+  fe_sub(r.t_, r.t_, r.z_);
+}
+
+static void ed_p3_dbl(ed_p1p1& r, const ed_p3& p) {
+  ed_p2 q;
+  ed_p3_to_p2(q, p);
+  ed_p2_dbl(r, q);
+}
+
+// r = p + q
+static void ed_add(ed_p1p1& r, const ed_p3& p, const ed_cached& q) {
+  fe25519 t0;
+  fe_add(r.x_, p.y_, p.x_);
+  fe_sub(r.y_, p.y_, p.x_);
+  fe_mult(r.z_, r.x_, q.y_plus_x_);
+  fe_mult(r.y_, r.y_, q.y_minus_x_);
+  fe_mult(r.t_, q.t2d_, p.t_);
+  fe_mult(r.x_, p.z_, q.z_);
+  fe_add(t0, r.x_, r.x_);
+  fe_sub(r.x_, r.z_, r.y_);
+  fe_add(r.y_, r.z_, r.y_);
+  fe_add(r.z_, t0, r.t_);
+  fe_sub(r.t_, t0, r.t_);
+}
+
+// r = p - q
+static void ed_sub(ed_p1p1& r, const ed_p3& p, const ed_cached& q) {
+  fe25519 t0;
+  fe_add(r.x_, p.y_, p.x_);
+  fe_sub(r.y_, p.y_, p.x_);
+  fe_mult(r.z_, r.x_, q.y_minus_x_);
+  fe_mult(r.y_, r.y_, q.y_plus_x_);
+  fe_mult(r.t_, q.t2d_, p.t_);
+  fe_mult(r.x_, p.z_, q.z_);
+  fe_add(t0, r.x_, r.x_);
+  fe_sub(r.x_, r.z_, r.y_);
+  fe_add(r.y_, r.z_, r.y_);
+  fe_sub(r.z_, t0, r.t_);
+  fe_add(r.t_, t0, r.t_);
+}
+
+// r = p + q, q affine
+static void ed_madd(ed_p1p1& r, const ed_p3& p, const ed_niels& q) {
+  fe25519 t0;
+  fe_add(r.x_, p.y_, p.x_);
+  fe_sub(r.y_, p.y_, p.x_);
+  fe_mult(r.z_, r.x_, q.y_plus_x_);
+  fe_mult(r.y_, r.y_, q.y_minus_x_);
+  fe_mult(r.t_, q.xy2d_, p.t_);
+  fe_add(t0, p.z_, p.z_);
+  fe_sub(r.x_, r.z_, r.y_);
+  fe_add(r.y_, r.z_, r.y_);
+  fe_add(r.z_, t0, r.t_);
+  fe_sub(r.t_, t0, r.t_);
+}
+
+static void ed_p3_to_bytes(byte_t* out, const ed_p3& p) {
+  fe25519 recip, x, y;
+  fe_invert(recip, p.z_);
+  fe_mult(x, p.x_, recip);
+  fe_mult(y, p.y_, recip);
+  fe_to_bytes(out, y);
+  out[31] ^= fe_is_negative(x) << 7;
+}
+
+// RFC 8032, 5.1.3.  Rejects non-canonical y and x = 0 with the sign bit set.
+static bool ed_p3_from_bytes(ed_p3& h, const byte_t* in) {
+  fe25519 u, v, v3, vxx, check;
+  byte_t s[32];
+  int sign = in[31] >> 7;
+
+  fe_from_bytes(h.y_, in);
+  fe_to_bytes(s, h.y_);
+  s[31] |= sign << 7;
+  if (memcmp(s, in, 32) != 0)
+    return false;
+  fe_one(h.z_);
+
+  // x^2 = (y^2 - 1) / (dy^2 + 1) = u / v
+  fe_square(u, h.y_);
+  fe_mult(v, u, fe_d);
+  fe_sub(u, u, h.z_);
+  fe_add(v, v, h.z_);
+
+  // x = uv^3 (uv^7)^((p-5)/8)
+  fe_square(v3, v);
+  fe_mult(v3, v3, v);
+  fe_square(h.x_, v3);
+  fe_mult(h.x_, h.x_, v);
+  fe_mult(h.x_, h.x_, u);
+  fe_pow22523(h.x_, h.x_);
+  fe_mult(h.x_, h.x_, v3);
+  fe_mult(h.x_, h.x_, u);
+
+  fe_square(vxx, h.x_);
+  fe_mult(vxx, vxx, v);
+  fe_sub(check, vxx, u);
+  if (!fe_is_zero(check)) {
+    fe_add(check, vxx, u);
+    if (!fe_is_zero(check))
+      return false;
+    fe_mult(h.x_, h.x_, fe_sqrtm1);
+  }
+
+  if (fe_is_zero(h.x_) && sign == 1)
+    return false;
+  if (fe_is_negative(h.x_) != sign)
+    fe_neg(h.x_, h.x_);
+  fe_mult(h.t_, h.x_, h.y_);
+  return true;
+}
+
+// True if [8]p = O
+static bool ed_p3_times_8_is_identity(const ed_p3& p) {
+  ed_p1p1 t;
+  ed_p2 q;
+  fe25519 d;
+
+  ed_p3_dbl(t, p);
+  ed_p1p1_to_p2(q, t);
+  ed_p2_dbl(t, q);
+  ed_p1p1_to_p2(q, t);
+  ed_p2_dbl(t, q);
+  ed_p1p1_to_p2(q, t);
+  fe_sub(d, q.y_, q.z_);
+  return fe_is_zero(q.x_) && fe_is_zero(d);
+}
+
+// ---------------------------------------------------------------------------
+// Base point multiplication.  The table holds j 256^i B, 1 <= j <= 8,
+// 0 <= i < 32, in affine form.  It is built on first use.
+
+static const byte_t ed_base_point_bytes[32] = {
+  0x58, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+  0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66, 0x66,
+};
+
+static ed_niels ed_base_table[32][8];
+static bool ed_base_table_initialized = false;
+static std::mutex ed_base_table_lock;
+
+static bool ed_init_base_table() {
+  std::lock_guard<std::mutex> guard(ed_base_table_lock);
+  if (ed_base_table_initialized)
+    return true;
+
+  const int n = 32 * 8;
+  ed_p3* pts = new ed_p3[n];
+  fe25519* prod = new fe25519[n];
+  ed_p3 p, acc;
+  ed_cached p_cached;
+  ed_p1p1 t;
+  ed_p2 q;
+  fe25519 inv, z_inv, x, y;
+  bool ret = false;
+
+  if (!ed_p3_from_bytes(p, ed_base_point_bytes))
+    goto done;
+  for (int i = 0; i < 32; i++) {
+    ed_p3_to_cached(p_cached, p);
+    acc = p;
+    for (int j = 0; j < 8; j++) {
+      pts[8 * i + j] = acc;
+      ed_add(t, acc, p_cached);
+      ed_p1p1_to_p3(acc, t);
+    }
+    ed_p3_to_p2(q, p);
+    for (int j = 0; j < 7; j++) {
+      ed_p2_dbl(t, q);
+      ed_p1p1_to_p2(q, t);
+    }
+    ed_p2_dbl(t, q);
+    ed_p1p1_to_p3(p, t);
+  }
+
+  // One inversion for all the z's
+  prod[0] = pts[0].z_;
+  for (int i = 1; i < n; i++)
+    fe_mult(prod[i], prod[i - 1], pts[i].z_);
+  fe_invert(inv, prod[n - 1]);
+  for (int i = n - 1; i >= 0; i--) {
+    if (i > 0) {
+      fe_mult(z_inv, inv, prod[i - 1]);
+      fe_mult(inv, inv, pts[i].z_);
+    } else {
+      z_inv = inv;
+    }
+    fe_mult(x, pts[i].x_, z_inv);
+    fe_mult(y, pts[i].y_, z_inv);
+    ed_niels& e = ed_base_table[i / 8][i % 8];
+    fe_add(e.y_plus_x_, y, x);
+    fe_sub(e.y_minus_x_, y, x);
+    fe_mult(e.xy2d_, x, y);
+    fe_mult(e.xy2d_, e.xy2d_, fe_d2);
+  }
+  ed_base_table_initialized = true;
+  ret = true;
+
+done:
+  delete []pts;
+  delete []prod;
+  return ret;
+}
+
+static inline uint64_t ed_equal(int8_t b, int8_t c) {
+  uint64_t x = (uint8_t)(b ^ c);
+  return (x - 1) >> 63;
+}
+
+static inline uint64_t ed_negative(int8_t b) {
+  return ((uint64_t)(int64_t)b) >> 63;
+}
+
+// t = b 256^pos B, -8 <= b <= 8, in constant time
+static void ed_select(ed_niels& t, int pos, int8_t b) {
+  uint64_t b_neg = ed_negative(b);
+  int8_t b_abs = b - (int8_t)(((-(int)b_neg) & b) << 1);
+  ed_niels minus_t;
+
+  fe_one(t.y_plus_x_);
+  fe_one(t.y_minus_x_);
+  fe_zero(t.xy2d_);
+  for (int j = 0; j < 8; j++) {
+    uint64_t m = ed_equal(b_abs, j + 1);
+    fe_cmov(t.y_plus_x_, ed_base_table[pos][j].y_plus_x_, m);
+    fe_cmov(t.y_minus_x_, ed_base_table[pos][j].y_minus_x_, m);
+    fe_cmov(t.xy2d_, ed_base_table[pos][j].xy2d_, m);
+  }
+  minus_t.y_plus_x_ = t.y_minus_x_;
+  minus_t.y_minus_x_ = t.y_plus_x_;
+  fe_neg(minus_t.xy2d_, t.xy2d_);
+  fe_cmov(t.y_plus_x_, minus_t.y_plus_x_, b_neg);
+  fe_cmov(t.y_minus_x_, minus_t.y_minus_x_, b_neg);
+  fe_cmov(t.xy2d_, minus_t.xy2d_, b_neg);
+}
+
+// h = a B, a < 2^255, in constant time.  a is cut into 64 signed
+// radix 16 digits e_i, a = sum e_i 16^i, -8 <= e_i < 8.
+static bool ed_base_mult(ed_p3& h, const byte_t* a) {
+  int8_t e[64];
+  int8_t carry = 0;
+  ed_niels t;
+  ed_p1p1 r;
+  ed_p2 s;
+
+  if (!ed_init_base_table())
+    return false;
+  for (int i = 0; i < 32; i++) {
+    e[2 * i] = a[i] & 15;
+    e[2 * i + 1] = (a[i] >> 4) & 15;
+  }
+  for (int i = 0; i < 63; i++) {
+    e[i] += carry;
+    carry = (e[i] + 8) >> 4;
+    e[i] -= carry << 4;
+  }
+  e[63] += carry;
+
+  ed_p3_identity(h);
+  for (int i = 1; i < 64; i += 2) {
+    ed_select(t, i / 2, e[i]);
+    ed_madd(r, h, t);
+    ed_p1p1_to_p3(h, r);
+  }
+  ed_p3_dbl(r, h);
+  ed_p1p1_to_p2(s, r);
+  ed_p2_dbl(r, s);
+  ed_p1p1_to_p2(s, r);
+  ed_p2_dbl(r, s);
+  ed_p1p1_to_p2(s, r);
+  ed_p2_dbl(r, s);
+  ed_p1p1_to_p3(h, r);
+  for (int i = 0; i < 64; i += 2) {
+    ed_select(t, i / 2, e[i]);
+    ed_madd(r, h, t);
+    ed_p1p1_to_p3(h, r);
+  }
+  memset(e, 0, sizeof(e));
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Variable time multi-scalar multiplication for verification: Straus with
+// width 5 NAFs and the odd multiples P, 3P, ..., 15P of every point.
+
+const int ed_naf_size = 257;
+
+// naf = s in width 5 NAF, s < 2^256.  Returns the number of digits.
+static int ed_wnaf(int8_t* naf, const byte_t* s) {
+  uint64_t k[5];
+  int len = 0;
+
+  for (int i = 0; i < 4; i++)
+    k[i] = load_64(s + 8 * i);
+  k[4] = 0;
+  memset(naf, 0, ed_naf_size);
+  while ((k[0] | k[1] | k[2] | k[3] | k[4]) != 0) {
+    int d = 0;
+    if (k[0] & 1) {
+      d = (int)(k[0] & 31);
+      if (d >= 16)
+        d -= 32;
+      if (d > 0) {
+        uint64_t borrow = k[0] < (uint64_t)d;
+        k[0] -= (uint64_t)d;
+        for (int i = 1; i < 5 && borrow; i++)
+          borrow = k[i]-- == 0;
+      } else {
+        k[0] += (uint64_t)(-d);
+        uint64_t carry = k[0] < (uint64_t)(-d);
+        for (int i = 1; i < 5 && carry; i++)
+          carry = ++k[i] == 0;
+      }
+    }
+    naf[len++] = (int8_t)d;
+    for (int i = 0; i < 4; i++)
+      k[i] = (k[i] >> 1) | (k[i + 1] << 63);
+    k[4] >>= 1;
+  }
+  return len;
+}
+
+// r = sum scalars[i] pts[i], each scalar 32 bytes
+static bool ed_multi_mult_vartime(int n, byte_t* scalars, ed_p3* pts,
+                                  ed_p3& r) {
+  int8_t* naf = new int8_t[n * ed_naf_size];
+  ed_cached* pre = new ed_cached[n * 8];
+  ed_p1p1 t;
+  ed_p3 u;
+  ed_p2 s;
+  ed_cached p2;
+  int top = -1;
+
+  for (int j = 0; j < n; j++) {
+    int len = ed_wnaf(&naf[j * ed_naf_size], &scalars[32 * j]);
+    if (len - 1 > top)
+      top = len - 1;
+
+    ed_p3_to_cached(pre[8 * j], pts[j]);
+    ed_p3_dbl(t, pts[j]);
+    ed_p1p1_to_p3(u, t);
+    ed_p3_to_cached(p2, u);
+    u = pts[j];
+    for (int i = 1; i < 8; i++) {
+      ed_add(t, u, p2);
+      ed_p1p1_to_p3(u, t);
+      ed_p3_to_cached(pre[8 * j + i], u);
+    }
+  }
+
+  ed_p3_identity(r);
+  ed_p3_to_p2(s, r);
+  for (int i = top; i >= 0; i--) {
+    ed_p2_dbl(t, s);
+    for (int j = 0; j < n; j++) {
+      int d = naf[j * ed_naf_size + i];
+      if (d == 0)
+        continue;
+      ed_p1p1_to_p3(u, t);
+      if (d > 0)
+        ed_add(t, u, pre[8 * j + d / 2]);
+      else
+        ed_sub(t, u, pre[8 * j + (-d) / 2]);
+    }
+    if (i > 0)
+      ed_p1p1_to_p2(s, t);
+    else
+      ed_p1p1_to_p3(r, t);
+  }
+
+  delete []naf;
+  delete []pre;
+  return true;
+}
+
+// ---------------------------------------------------------------------------
+// Ed25519.  Scalars mod L go through big_num, little-endian on the wire.
+
+static const byte_t ed_order_bytes[32] = {
+  0xed, 0xd3, 0xf5, 0x5c, 0x1a, 0x63, 0x12, 0x58,
+  0xd6, 0x9c, 0xf7, 0xa2, 0xde, 0xf9, 0xde, 0x14,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10,
+};
+
+const int ed_scalar_digits = 10;
+
+static bool ed_scalar_from_bytes(int size, const byte_t* in, big_num& r) {
+  int n = (size + (int)sizeof(uint64_t) - 1) / (int)sizeof(uint64_t);
+  if (n > r.capacity_)
+    return false;
+  r.zero_num();
+  for (int i = 0; i < size; i++)
+    r.value_[i / sizeof(uint64_t)] |= ((uint64_t)in[i]) << (NBITSINBYTE * (i % sizeof(uint64_t)));
+  r.normalize();
+  return true;
+}
+
+static bool ed_scalar_to_bytes(big_num& a, byte_t* out) {
+  if (a.is_negative() || big_high_bit(a) > NBITSINBYTE * 32)
+    return false;
+  for (int i = 0; i < 32; i++) {
+    int d = i / sizeof(uint64_t);
+    out[i] = d < a.size_ ? (byte_t)(a.value_[d] >> (NBITSINBYTE * (i % sizeof(uint64_t)))) : 0;
+  }
+  return true;
+}
+
+// The sha512 digest is its state words, write them out as the standard octets
+static void ed_hash_final(sha512& h, byte_t* out) {
+  uint64_t d[sha512::DIGESTBYTESIZE / sizeof(uint64_t)];
+
+  h.finalize();
+  h.get_digest(sha512::DIGESTBYTESIZE, (byte_t*)d);
+  for (int i = 0; i < 8; i++) {
+    for (int j = 0; j < 8; j++)
+      out[8 * i + j] = (byte_t)(d[i] >> (56 - NBITSINBYTE * j));
+  }
+  memset(d, 0, sizeof(d));
+}
+
+// az = SHA-512(secret), with the scalar half clamped
+static void ed_expand_secret(byte_t* secret, byte_t* az) {
+  sha512 h;
+  h.init();
+  h.add_to_hash(curve25519_key_bytes, secret);
+  ed_hash_final(h, az);
+  az[0] &= 248;
+  az[31] &= 127;
+  az[31] |= 64;
+}
+
+// k = SHA-512(R || A || M) mod L
+static bool ed_challenge(byte_t* r_bytes, byte_t* pub, int size, byte_t* msg,
+                         big_num& l, big_num& k) {
+  byte_t digest[sha512::DIGESTBYTESIZE];
+  big_num t(ed_scalar_digits);
+  sha512 h;
+
+  h.init();
+  h.add_to_hash(32, r_bytes);
+  h.add_to_hash(curve25519_key_bytes, pub);
+  h.add_to_hash(size, msg);
+  ed_hash_final(h, digest);
+  if (!ed_scalar_from_bytes(sha512::DIGESTBYTESIZE, digest, t))
+    return false;
+  return big_mod(t, l, k);
+}
+
+bool ed25519_public_key(byte_t* secret, byte_t* pub) {
+  byte_t az[sha512::DIGESTBYTESIZE];
+  ed_p3 a;
+  bool ret;
+
+  ed_expand_secret(secret, az);
+  ret = ed_base_mult(a, az);
+  if (ret)
+    ed_p3_to_bytes(pub, a);
+  memset(az, 0, sizeof(az));
+  return ret;
+}
+
+// pub must be ed25519_public_key(secret)
+bool ed25519_sign(byte_t* secret, byte_t* pub, int size, byte_t* msg,
+                  byte_t* sig) {
+  byte_t az[sha512::DIGESTBYTESIZE];
+  byte_t nonce[sha512::DIGESTBYTESIZE];
+  byte_t r_bytes[32];
+  big_num l(ed_scalar_digits);
+  big_num r(ed_scalar_digits);
+  big_num k(ed_scalar_digits);
+  big_num a(ed_scalar_digits);
+  big_num t(ed_scalar_digits);
+  ed_p3 rp;
+  sha512 h;
+  bool ret = false;
+
+  ed_expand_secret(secret, az);
+  if (!ed_scalar_from_bytes(32, ed_order_bytes, l))
+    goto done;
+
+  // r = SHA-512(prefix || M) mod L, R = rB
+  h.init();
+  h.add_to_hash(32, &az[32]);
+  h.add_to_hash(size, msg);
+  ed_hash_final(h, nonce);
+  if (!ed_scalar_from_bytes(sha512::DIGESTBYTESIZE, nonce, t) ||
+      !big_mod(t, l, r) || !ed_scalar_to_bytes(r, r_bytes))
+    goto done;
+  if (!ed_base_mult(rp, r_bytes))
+    goto done;
+  ed_p3_to_bytes(sig, rp);
+
+  // S = r + ka mod L
+  if (!ed_challenge(sig, pub, size, msg, l, k))
+    goto done;
+  if (!ed_scalar_from_bytes(32, az, a))
+    goto done;
+  t.zero_num();
+  if (!big_mod_mult(k, a, l, t))
+    goto done;
+  a.zero_num();
+  if (!big_mod_add(t, r, l, a))
+    goto done;
+  if (!ed_scalar_to_bytes(a, &sig[32]))
+    goto done;
+  ret = true;
+
+done:
+  memset(az, 0, sizeof(az));
+  memset(nonce, 0, sizeof(nonce));
+  memset(r_bytes, 0, sizeof(r_bytes));
+  r.zero_num();
+  a.zero_num();
+  return ret;
+}
+
+// Decodes one signature into -A, -R, S and k, with S < L
+static bool ed_signature_terms(byte_t* pub, int size, byte_t* msg, byte_t* sig,
+                               big_num& l, ed_p3& minus_a, ed_p3& minus_r,
+                               big_num& s, big_num& k) {
+  ed_p3 p;
+
+  if (!ed_scalar_from_bytes(32, &sig[32], s) || big_compare(s, l) >= 0)
+    return false;
+  if (!ed_p3_from_bytes(p, pub))
+    return false;
+  ed_p3_neg(minus_a, p);
+  if (!ed_p3_from_bytes(p, sig))
+    return false;
+  ed_p3_neg(minus_r, p);
+  return ed_challenge(sig, pub, size, msg, l, k);
+}
+
+bool ed25519_verify(byte_t* pub, int size, byte_t* msg, byte_t* sig) {
+  big_num l(ed_scalar_digits);
+  big_num s(ed_scalar_digits);
+  big_num k(ed_scalar_digits);
+  byte_t scalars[3 * 32];
+  ed_p3 pts[3];
+  ed_p3 q;
+
+  if (!ed_scalar_from_bytes(32, ed_order_bytes, l))
+    return false;
+  if (!ed_p3_from_bytes(pts[0], ed_base_point_bytes))
+    return false;
+  if (!ed_signature_terms(pub, size, msg, sig, l, pts[1], pts[2], s, k))
+    return false;
+
+  // [8]([S]B - [k]A - R) = O
+  if (!ed_scalar_to_bytes(s, &scalars[0]) ||
+      !ed_scalar_to_bytes(k, &scalars[32]))
+    return false;
+  memset(&scalars[64], 0, 32);
+  scalars[64] = 1;
+  if (!ed_multi_mult_vartime(3, scalars, pts, q))
+    return false;
+  return ed_p3_times_8_is_identity(q);
+}
+
+bool ed25519_verify_batch(int n, byte_t** pubs, int* sizes, byte_t** msgs,
+                          byte_t** sigs) {
+  if (n <= 0)
+    return false;
+
+  int m = 2 * n + 1;
+  byte_t* scalars = new byte_t[32 * m];
+  ed_p3* pts = new ed_p3[m];
+  big_num l(ed_scalar_digits);
+  big_num s(ed_scalar_digits);
+  big_num k(ed_scalar_digits);
+  big_num z(ed_scalar_digits);
+  big_num b(ed_scalar_digits);
+  big_num t(ed_scalar_digits);
+  big_num u(ed_scalar_digits);
+  byte_t z_bytes[32];
+  ed_p3 q;
+  bool ret = false;
+
+  if (!ed_scalar_from_bytes(32, ed_order_bytes, l))
+    goto done;
+  if (!ed_p3_from_bytes(pts[0], ed_base_point_bytes))
+    goto done;
+
+  // [sum z_i S_i]B + sum [z_i](-R_i) + sum [z_i k_i](-A_i)
+  for (int i = 0; i < n; i++) {
+    if (!ed_signature_terms(pubs[i], sizes[i], msgs[i], sigs[i], l,
+                            pts[2 * i + 2], pts[2 * i + 1], s, k))
+      goto done;
+    memset(z_bytes, 0, sizeof(z_bytes));
+    if (crypto_get_random_bytes(16, z_bytes) < 16)
+      goto done;
+    memcpy(&scalars[32 * (2 * i + 1)], z_bytes, 32);
+    if (!ed_scalar_from_bytes(32, z_bytes, z))
+      goto done;
+    t.zero_num();
+    if (!big_mod_mult(z, k, l, t) ||
+        !ed_scalar_to_bytes(t, &scalars[32 * (2 * i + 2)]))
+      goto done;
+    t.zero_num();
+    if (!big_mod_mult(z, s, l, t))
+      goto done;
+    u.zero_num();
+    if (!big_mod_add(b, t, l, u) || !b.copy_from(u))
+      goto done;
+  }
+  if (!ed_scalar_to_bytes(b, scalars))
+    goto done;
+  if (!ed_multi_mult_vartime(m, scalars, pts, q))
+    goto done;
+  ret = ed_p3_times_8_is_identity(q);
+
+done:
+  delete []scalars;
+  delete []pts;
+  return ret;
+}
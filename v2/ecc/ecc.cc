@@ -16,6 +16,7 @@
 #include "big_num_functions.h"
 #include "ecc.h"
 #include "ecc_curve_data.h"
+#include "hmac_sha256.h"
 
 //#define FASTECCMULT
 
@@ -153,12 +154,14 @@ ecc_curve::ecc_curve() {
   curve_a_ = nullptr;
   curve_b_ = nullptr;
   curve_p_ = nullptr;
+  invalidate_field();
 }
 
 ecc_curve::ecc_curve(int size) {
   curve_a_ = new big_num(size);
   curve_b_ = new big_num(size);
   curve_p_ = new big_num(size);
+  invalidate_field();
 }
 
 ecc_curve::~ecc_curve() {
@@ -184,6 +187,13 @@ void ecc_curve::clear() {
   if (curve_a_ != nullptr) curve_a_->zero_num();
   if (curve_b_ != nullptr) curve_b_->zero_num();
   if (curve_p_ != nullptr) curve_p_->zero_num();
+  invalidate_field();
+}
+
+void ecc_curve::invalidate_field() {
+  field_resolved_ = false;
+  field_ = nullptr;
+  jacobian_field_ = nullptr;
 }
 
 void ecc_curve::print_curve() {
@@ -204,6 +214,7 @@ bool ecc_curve::copy_from(ecc_curve& c) {
   curve_p_->copy_from(*c.curve_p_);
   curve_a_->copy_from(*c.curve_a_);
   curve_b_->copy_from(*c.curve_b_);
+  invalidate_field();
   return true;
 }
 
@@ -362,6 +373,57 @@ bool ecc_extract(ecc_curve& c, curve_point& pt, big_num& m, int shift) {
   return true;
 }
 
+// ecc_add for a curve over one of the NIST fields, same formulas
+static bool field_ecc_add(ecc_curve& c, ecc_field& f, curve_point& p_pt,
+                          curve_point& q_pt, curve_point& r_pt) {
+  uint64_t x1[ecc_field_max_digits];
+  uint64_t y1[ecc_field_max_digits];
+  uint64_t x2[ecc_field_max_digits];
+  uint64_t y2[ecc_field_max_digits];
+  uint64_t a[ecc_field_max_digits];
+  uint64_t m[ecc_field_max_digits];
+  uint64_t t1[ecc_field_max_digits];
+  uint64_t t2[ecc_field_max_digits];
+  uint64_t t3[ecc_field_max_digits];
+
+  if (!f.load(*p_pt.x_, x1) || !f.load(*p_pt.y_, y1) ||
+      !f.load(*q_pt.x_, x2) || !f.load(*q_pt.y_, y2))
+    return false;
+
+  if (!f.is_equal(x1, x2)) {
+    f.sub(x2, x1, t1);
+    f.sub(y2, y1, t2);
+  } else {
+    f.add(y1, y2, t1);
+    if (f.is_zero(t1)) {
+      r_pt.make_zero();
+      return true;
+    }
+    if (!f.load(*c.curve_a_, a))
+      return false;
+    f.square(x1, t3);
+    f.add(t3, t3, t2);
+    f.add(t2, t3, t2);
+    f.add(t2, a, t2);
+  }
+  // m = t2 / t1
+  if (!f.inv(t1, t3))
+    return false;
+  f.mult(t2, t3, m);
+
+  // x3 = m^2 - x1 - x2, y3 = m(x1 - x3) - y1
+  f.square(m, t1);
+  f.sub(t1, x1, t1);
+  f.sub(t1, x2, t1);
+  f.sub(x1, t1, t2);
+  f.mult(m, t2, t3);
+  f.sub(t3, y1, t3);
+  if (!f.store(t1, *r_pt.x_) || !f.store(t3, *r_pt.y_))
+    return false;
+  r_pt.z_->copy_from(big_one);
+  return true;
+}
+
 // see ecc.h for description
 bool ecc_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_point& r_pt) {
   p_pt.normalize(*c.curve_p_);
@@ -373,6 +435,10 @@ bool ecc_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_point& r_
   if (q_pt.is_zero()) {
     return p_pt.copy_to(r_pt);
   }
+  ecc_field* f = ecc_field_for_curve(c);
+  if (f != nullptr)
+    return field_ecc_add(c, *f, p_pt, q_pt, r_pt);
+
   big_num m(2 * c.curve_p_->size_);
   big_num t1(2 * c.curve_p_->size_);
   big_num t2(2 * c.curve_p_->size_);
@@ -488,7 +554,7 @@ bool projective_to_affine(ecc_curve& c, curve_point& pt) {
 
   if (pt.z_->is_one())
     return true;
-  if (!big_mod_inv(*pt.z_, *c.curve_p_, zinv)) {
+  if (!big_mod_inv_ct(*pt.z_, *c.curve_p_, zinv)) {
     return false;
   }
   if (!big_mod_mult(*pt.x_, zinv, *c.curve_p_, x)) {
@@ -510,7 +576,152 @@ bool projective_to_affine(ecc_curve& c, curve_point& pt) {
   return true;
 }
 
+// Normalizes n projective points to z = 1 with a single inversion
+// (Montgomery's trick), so a list of points costs one inversion and
+// about 3 multiplications per point rather than one inversion each.
+// Points that are O or already have z = 1 are left alone.
+static bool field_projective_to_affine_batch(ecc_field& f, int n,
+                                             curve_point** pts) {
+  int nd = f.num_digits_;
+  uint64_t* z = new uint64_t[n * nd];
+  uint64_t* x = new uint64_t[n * nd];
+  uint64_t* y = new uint64_t[n * nd];
+  int* idx = new int[n];
+  bool ret = false;
+  int num = 0;
+  int i;
+
+  for (i = 0; i < n; i++) {
+    if (pts[i]->z_->is_zero()) {
+      pts[i]->make_zero();
+      continue;
+    }
+    if (pts[i]->z_->is_one())
+      continue;
+    if (!f.load(*pts[i]->x_, &x[num * nd]) ||
+        !f.load(*pts[i]->y_, &y[num * nd]) ||
+        !f.load(*pts[i]->z_, &z[num * nd]))
+      goto done;
+    idx[num++] = i;
+  }
+  if (!f.batch_inv(num, z, z))
+    goto done;
+  for (i = 0; i < num; i++) {
+    curve_point* pt = pts[idx[i]];
+    f.mult(&x[i * nd], &z[i * nd], &x[i * nd]);
+    f.mult(&y[i * nd], &z[i * nd], &y[i * nd]);
+    if (!f.store(&x[i * nd], *pt->x_) || !f.store(&y[i * nd], *pt->y_))
+      goto done;
+    if (!pt->z_->copy_from(big_one))
+      goto done;
+  }
+  ret = true;
+
+done:
+  delete []z;
+  delete []x;
+  delete []y;
+  delete []idx;
+  return ret;
+}
+
+bool projective_to_affine_batch(ecc_curve& c, int n, curve_point** pts) {
+  ecc_field* f = ecc_field_for_curve(c);
+  if (f != nullptr)
+    return field_projective_to_affine_batch(*f, n, pts);
+
+  int size = 1 + 2 * c.curve_p_->size_;
+  big_num** z = new big_num*[n];
+  big_num** z_inv = new big_num*[n];
+  big_num t(size);
+  bool ret = false;
+  int num = 0;
+  int i, j;
+
+  for (i = 0; i < n; i++) {
+    if (pts[i]->z_->is_zero()) {
+      pts[i]->make_zero();
+      continue;
+    }
+    if (pts[i]->z_->is_one())
+      continue;
+    z[num] = pts[i]->z_;
+    z_inv[num] = new big_num(size);
+    num++;
+  }
+  if (!big_batch_mod_inv(num, z, *c.curve_p_, z_inv))
+    goto done;
+
+  // the points still to normalize are in the same order as z
+  for (i = 0, j = 0; i < n; i++) {
+    curve_point* pt = pts[i];
+    if (pt->z_->is_zero() || pt->z_->is_one())
+      continue;
+    t.zero_num();
+    if (!big_mod_mult(*pt->x_, *z_inv[j], *c.curve_p_, t) ||
+        !big_mod_normalize(t, *c.curve_p_) || !pt->x_->copy_from(t))
+      goto done;
+    t.zero_num();
+    if (!big_mod_mult(*pt->y_, *z_inv[j], *c.curve_p_, t) ||
+        !big_mod_normalize(t, *c.curve_p_) || !pt->y_->copy_from(t))
+      goto done;
+    if (!pt->z_->copy_from(big_one))
+      goto done;
+    j++;
+  }
+  ret = true;
+
+done:
+  for (i = 0; i < num; i++)
+    delete z_inv[i];
+  delete []z;
+  delete []z_inv;
+  return ret;
+}
+
+// projective_double and projective_add on a = -3 NIST curves, with the
+// complete formulas
+static bool field_projective_double(ecc_curve& c, ecc_field& f,
+                                    curve_point& p_pt, curve_point& r_pt) {
+  ecc_field_scratch s;
+  homogeneous_point p;
+  uint64_t b[ecc_field_max_digits];
+
+  if (!f.load(*c.curve_b_, b) || !homogeneous_from_point(f, p_pt, p))
+    return false;
+  homogeneous_complete_double(f, b, p, p, s);
+  return homogeneous_to_point(f, p, r_pt);
+}
+
+static bool field_projective_add(ecc_curve& c, ecc_field& f, curve_point& p_pt,
+                                 curve_point& q_pt, curve_point& r_pt) {
+  ecc_field_scratch s;
+  homogeneous_point p;
+  homogeneous_point q;
+  uint64_t b[ecc_field_max_digits];
+
+  if (!f.load(*c.curve_b_, b) || !homogeneous_from_point(f, p_pt, p) ||
+      !homogeneous_from_point(f, q_pt, q))
+    return false;
+  homogeneous_complete_add(f, b, p, q, p, s);
+  return homogeneous_to_point(f, p, r_pt);
+}
+
 bool projective_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_point& r_pt) {
+  // If p_pt=O, q_pt
+  if (p_pt.z_->is_zero()) {
+    r_pt.copy_from(q_pt);
+    return true;
+  }
+  // If q_pt=O, p_pt
+  if (q_pt.z_->is_zero()) {
+    r_pt.copy_from(p_pt);
+    return true;
+  }
+  ecc_field* f = ecc_jacobian_field(c);
+  if (f != nullptr)
+    return field_projective_add(c, *f, p_pt, q_pt, r_pt);
+
   big_num u(1 + 2 * c.curve_p_->size_);
   big_num v(1 + 2 * c.curve_p_->size_);
   big_num A(1 + 2 * c.curve_p_->size_);
@@ -527,16 +738,6 @@ bool projective_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_po
   big_num b1(1 + 2 * c.curve_p_->size_);
   big_num b2(1 + 2 * c.curve_p_->size_);
 
-  // If p_pt=O, q_pt
-  if (p_pt.z_->is_zero()) {
-    r_pt.copy_from(q_pt);
-    return true;
-  }
-  // If q_pt=O, p_pt
-  if (q_pt.z_->is_zero()) {
-    r_pt.copy_from(p_pt);
-    return true;
-  }
   if (!big_mod_mult(*p_pt.x_, *q_pt.z_, *c.curve_p_, a1)) {
     return false;
   }
@@ -647,6 +848,10 @@ bool projective_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_po
 }
 
 bool projective_double(ecc_curve& c, curve_point& p_pt, curve_point& r_pt) {
+  ecc_field* f = ecc_jacobian_field(c);
+  if (f != nullptr)
+    return field_projective_double(c, *f, p_pt, r_pt);
+
   big_num w(1 + 2 * c.curve_p_->size_);
   big_num w_squared(1 + 2 * c.curve_p_->size_);
   big_num s(1 + 2 * c.curve_p_->size_);
@@ -768,6 +973,8 @@ bool projective_point_mult(ecc_curve& c, big_num& x, curve_point& p_pt, curve_po
     r_pt.make_zero();
     return true;
   }
+  if (ecc_jacobian_field(c) != nullptr)
+    return ecc_wnaf_mult(c, p_pt, x, r_pt);
 
   int k = big_high_bit(x);
   int i;
@@ -809,6 +1016,15 @@ bool ecc_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt) {
   if (x.is_one()) {
     return r_pt.copy_from(p_pt);
   }
+  // On the NIST curves projective steps are cheap and affine ones pay
+  // for an inversion each, so convert once at the end.
+  if (ecc_jacobian_field(c) != nullptr)
+    return ecc_wnaf_mult(c, p_pt, x, r_pt);
+  if (ecc_field_for_curve(c) != nullptr) {
+    if (!projective_point_mult(c, x, p_pt, r_pt))
+      return false;
+    return projective_to_affine(c, r_pt);
+  }
   int k = big_high_bit(x);
   int i;
   curve_point double_point(p_pt, 1 + 2 * c.curve_p_->capacity_);
@@ -944,6 +1160,7 @@ bool ecc::copy_key_parameters_from(ecc& copy_key) {
   c_->curve_p_->copy_from(*copy_key.c_->curve_p_);
   c_->curve_a_->copy_from(*copy_key.c_->curve_a_);
   c_->curve_b_->copy_from(*copy_key.c_->curve_b_);
+  c_->invalidate_field();
 
   if (copy_key.order_of_base_point_ != nullptr) {
     if (order_of_base_point_ != nullptr)
@@ -970,6 +1187,19 @@ bool ecc::copy_key_parameters_from(ecc& copy_key) {
   return true;
 }
 
+// Keys carry their points compressed in point_message.encoded.  Keys
+//   written before that have x and y instead, which
+//   retrieve_parameters_from_key_message still reads.
+static bool ecc_point_to_message(ecc_curve& c, curve_point& pt, point_message* pm) {
+  string s;
+  if (!ecc_point_to_octets(c, pt, true, &s))
+    return false;
+  pm->clear_x();
+  pm->clear_y();
+  pm->set_encoded(s);
+  return true;
+}
+
 bool ecc::generate_ecc_from_parameters(const char* key_name, const char* usage,
         char* notbefore, char* notafter, double seconds_to_live, ecc_curve& c,
         curve_point& base_pt, big_num& order_base_point, big_num& secret) {
@@ -991,7 +1221,7 @@ bool ecc::generate_ecc_from_parameters(const char* key_name, const char* usage,
   if (base_point_ == nullptr) {
     base_point_ = new curve_point(nw);
   }
-  if (!ecc_mult(*c_, *base_point_, *secret_, *public_point_))
+  if (!ecc_base_mult(*c_, *base_point_, *secret_, *public_point_))
     return false;
 
   string s_curve_p;
@@ -999,10 +1229,8 @@ bool ecc::generate_ecc_from_parameters(const char* key_name, const char* usage,
   string s_curve_b;
   string s_base_order;
   string s_secret;
-  string s_curve_base_x;
-  string s_curve_base_y;
-  string s_curve_public_x;
-  string s_curve_public_y;
+  // the points are filled in compressed below
+  string s_none;
 
   if (!bignum_to_string_msg(*secret_, &s_secret))
     return false;
@@ -1014,21 +1242,18 @@ bool ecc::generate_ecc_from_parameters(const char* key_name, const char* usage,
     return false;
   if (!bignum_to_string_msg(order_base_point, &s_base_order))
     return false;
-  if (!bignum_to_string_msg(*base_pt.x_, &s_curve_base_x))
-    return false;
-  if (!bignum_to_string_msg(*base_pt.y_, &s_curve_base_y))
-    return false;
-  if (!bignum_to_string_msg(*public_point_->x_, &s_curve_public_x))
-    return false;
-  if (!bignum_to_string_msg(*public_point_->y_, &s_curve_public_y))
-    return false;
   
   key_message* new_key_message =  make_ecckey(key_name, prime_bit_size_, usage,
          notbefore, notafter, c.c_name_, s_curve_p, s_curve_a, s_curve_b,
-         s_curve_base_x, s_curve_base_y, s_base_order, s_secret,
-         s_curve_public_x, s_curve_public_y);
+         s_none, s_none, s_base_order, s_secret, s_none, s_none);
   if (new_key_message == nullptr)
     return false;
+  ecc_public_parameters_message* pub = new_key_message->mutable_ecc_pub();
+  if (!ecc_point_to_message(*c_, *base_point_, pub->mutable_base_point()) ||
+      !ecc_point_to_message(*c_, *public_point_, pub->mutable_public_point())) {
+    delete new_key_message;
+    return false;
+  }
   if (ecc_key_ != nullptr)
     delete ecc_key_;
   ecc_key_ = new_key_message;
@@ -1168,39 +1393,14 @@ bool ecc::set_parameters_in_key_message() {
     cm->set_curve_b(s);
   }
 
-  point_message* pm = ecc_pub->mutable_base_point();
   if (base_point_ != nullptr) {
-    if (base_point_->x_ != nullptr) {
-      s.clear();
-      if(!bignum_to_string_msg(*base_point_->x_, &s)) {
-        return false;
-      }
-      pm->set_x(s);
-    }
-    if (base_point_->y_ != nullptr) {
-      s.clear();
-      if(!bignum_to_string_msg(*base_point_->y_, &s)) {
-        return false;
-      }
-      pm->set_y(s);
+    if (!ecc_point_to_message(*c_, *base_point_, ecc_pub->mutable_base_point())) {
+      return false;
     }
   }
-
-  pm = ecc_pub->mutable_public_point();
   if (public_point_ != nullptr) {
-    if (public_point_->x_ != nullptr) {
-      s.clear();
-      if(!bignum_to_string_msg(*public_point_->x_, &s)) {
-        return false;
-      }
-      pm->set_x(s);
-    }
-    if (public_point_->y_ != nullptr) {
-      s.clear();
-      if(!bignum_to_string_msg(*public_point_->y_, &s)) {
-        return false;
-      }
-      pm->set_y(s);
+    if (!ecc_point_to_message(*c_, *public_point_, ecc_pub->mutable_public_point())) {
+      return false;
     }
   }
 
@@ -1298,6 +1498,7 @@ bool ecc::retrieve_parameters_from_key_message() {
         if(!string_msg_to_bignum(cmsg->curve_b(), *b))
           return false;
       }
+      c_->invalidate_field();
     }
     if (pub->has_order_of_base_point()) {
       if (order_of_base_point_ == nullptr) {
@@ -1315,7 +1516,13 @@ bool ecc::retrieve_parameters_from_key_message() {
         if (base_point_ == nullptr)
           return false;
       }
-      if (pm->has_x()) {
+      if (pm->has_encoded()) {
+        if (c_ == nullptr || c_->curve_p_ == nullptr)
+          return false;
+        if (!ecc_point_from_octets(*c_, (int)pm->encoded().size(),
+                                   (const byte_t*)pm->encoded().data(), *base_point_))
+          return false;
+      } else if (pm->has_x()) {
         if (base_point_->x_ == nullptr) {
           base_point_->x_ = new big_num(u64_size);
           if (base_point_->x_ == nullptr)
@@ -1324,7 +1531,7 @@ bool ecc::retrieve_parameters_from_key_message() {
         if(!string_msg_to_bignum(pm->x(), *base_point_->x_))
             return false;
       }
-      if (pm->has_y()) {
+      if (!pm->has_encoded() && pm->has_y()) {
         if (base_point_->y_ == nullptr) {
           base_point_->y_ = new big_num(u64_size);
           if (base_point_->y_ == nullptr)
@@ -1342,7 +1549,13 @@ bool ecc::retrieve_parameters_from_key_message() {
         if (public_point_ == nullptr)
           return false;
       }
-      if (pm->has_x()) {
+      if (pm->has_encoded()) {
+        if (c_ == nullptr || c_->curve_p_ == nullptr)
+          return false;
+        if (!ecc_point_from_octets(*c_, (int)pm->encoded().size(),
+                                   (const byte_t*)pm->encoded().data(), *public_point_))
+          return false;
+      } else if (pm->has_x()) {
         if (public_point_->x_ == nullptr) {
           public_point_->x_ = new big_num(u64_size);
           if (public_point_->x_ == nullptr)
@@ -1351,7 +1564,7 @@ bool ecc::retrieve_parameters_from_key_message() {
         if(!string_msg_to_bignum(pm->x(), *public_point_->x_))
             return false;
       }
-      if (pm->has_y()) {
+      if (!pm->has_encoded() && pm->has_y()) {
         if (public_point_->y_ == nullptr) {
           public_point_->y_ = new big_num(u64_size);
           if (public_point_->y_ == nullptr)
@@ -1429,21 +1642,13 @@ bool ecc::encrypt(int size, byte_t* plain, big_num& k, curve_point& pt1,
   if (!ecc_embed(*c_, m, p_pt, 8, 20)) {
     return false;
   }
-#ifdef FASTECCMULT
-  if (!faster_ecc_mult(*c_, *base_point_, k, pt1)) {
+  if (!ecc_base_mult(*c_, *base_point_, k, pt1)) {
     return false;
   }
-  if (!faster_ecc_mult(*c_, *public_point_, k, r_pt)) {
+  // k is secret: k * public_point_ unmasks pt2
+  if (!ecc_ladder_mult(*c_, *public_point_, k, r_pt)) {
     return false;
   }
-#else
-  if (!ecc_mult(*c_, *base_point_, k, pt1)) {
-    return false;
-  }
-  if (!ecc_mult(*c_, *public_point_, k, r_pt)) {
-    return false;
-  }
-#endif
   if (!ecc_add(*c_, r_pt, p_pt, pt2)) {
     return false;
   }
@@ -1481,15 +1686,10 @@ bool ecc::decrypt(curve_point& pt1, curve_point& pt2, int* size, byte_t* plain)
   curve_point p_pt(2 * c_->curve_p_->capacity_);
   curve_point r_pt(2 * c_->curve_p_->capacity_);
 
-#ifdef FASTECCMULT
-  if (!faster_ecc_mult(*c_, pt1, *(secret_), r_pt)) {
-    return false;
-  }
-#else
-  if (!ecc_mult(*c_, pt1, *(secret_), r_pt)) {
+  // the secret multiplies a point chosen by the sender
+  if (!ecc_ladder_mult(*c_, pt1, *(secret_), r_pt)) {
     return false;
   }
-#endif
   if (!ecc_sub(*c_, pt2, r_pt, p_pt)) {
     return false;
   }
@@ -1501,3 +1701,344 @@ bool ecc::decrypt(curve_point& pt1, curve_point& pt2, int* size, byte_t* plain)
   memcpy(plain, (byte_t*)m.value_, *size);
   return true;
 }
+
+// ECDSA (FIPS 186-4) with deterministic nonces (RFC 6979, HMAC-SHA256).
+//   Digests and signature octets are big endian, as in the standards.
+
+// r = the octet string in as an integer
+static bool ecdsa_octets_to_int(int size, byte_t* in, big_num& r) {
+  int n = (size + (int)sizeof(uint64_t) - 1) / (int)sizeof(uint64_t);
+  if (n > r.capacity_)
+    return false;
+  r.zero_num();
+  for (int i = 0; i < size; i++) {
+    int j = size - 1 - i;
+    r.value_[j / sizeof(uint64_t)] |= ((uint64_t)in[i]) << (NBITSINBYTE * (j % sizeof(uint64_t)));
+  }
+  r.normalize();
+  return true;
+}
+
+// out = a as size octets, most significant first
+static bool ecdsa_int_to_octets(big_num& a, int size, byte_t* out) {
+  if (a.is_negative() || big_high_bit(a) > NBITSINBYTE * size)
+    return false;
+  for (int i = 0; i < size; i++) {
+    int j = size - 1 - i;
+    int d = j / sizeof(uint64_t);
+    out[i] = d < a.size_ ? (byte_t)(a.value_[d] >> (NBITSINBYTE * (j % sizeof(uint64_t)))) : 0;
+  }
+  return true;
+}
+
+// RFC 6979 bits2int: the leftmost qlen bits of in, qlen the bit size of n
+static bool ecdsa_bits_to_int(big_num& n, int size, byte_t* in, big_num& r) {
+  int q_len = big_high_bit(n);
+  if (!ecdsa_octets_to_int(size, in, r))
+    return false;
+  if (NBITSINBYTE * size > q_len) {
+    big_num t(r.capacity_);
+    if (!big_shift(r, -(int64_t)(NBITSINBYTE * size - q_len), t))
+      return false;
+    r.copy_from(t);
+  }
+  return true;
+}
+
+static void ecdsa_hmac(byte_t* key, int size, byte_t* in, byte_t* out) {
+  hmac_sha256 h;
+  h.init(hmac_sha256::MACBYTESIZE, key);
+  h.add_to_inner_hash(size, in);
+  h.finalize();
+  h.get_hmac(hmac_sha256::MACBYTESIZE, out);
+}
+
+// k = the attempt-th RFC 6979 nonce for the secret x and the digest,
+//   counting from 0.  Signing only asks for attempt > 0 if r or s is 0.
+static bool ecdsa_nonce(big_num& n, big_num& x, int size, byte_t* digest,
+                        int attempt, big_num& k) {
+  const int h_len = hmac_sha256::MACBYTESIZE;
+  int q_len = big_high_bit(n);
+  int r_len = (q_len + NBITSINBYTE - 1) / NBITSINBYTE;
+  int t_len = ((r_len + h_len - 1) / h_len) * h_len;
+  int in_len = h_len + 1 + 2 * r_len;
+  byte_t key[h_len];
+  byte_t v[h_len];
+  byte_t* in = new byte_t[in_len];
+  byte_t* t = new byte_t[t_len];
+  big_num h1(n.size_ + (size + 7) / 8 + 1);
+  bool ret = false;
+  int i, j;
+
+  // int2octets(x) || bits2octets(h1), bits2int(h1) < 2n
+  if (!ecdsa_bits_to_int(n, size, digest, h1))
+    goto done;
+  if (big_compare(h1, n) >= 0 && !big_unsigned_sub_from(h1, n))
+    goto done;
+  if (!ecdsa_int_to_octets(x, r_len, &in[h_len + 1]) ||
+      !ecdsa_int_to_octets(h1, r_len, &in[h_len + 1 + r_len]))
+    goto done;
+
+  memset(key, 0, h_len);
+  memset(v, 1, h_len);
+  for (i = 0; i < 2; i++) {
+    memcpy(in, v, h_len);
+    in[h_len] = (byte_t)i;
+    ecdsa_hmac(key, in_len, in, key);
+    ecdsa_hmac(key, h_len, v, v);
+  }
+
+  for (;;) {
+    for (j = 0; j < t_len; j += h_len) {
+      ecdsa_hmac(key, h_len, v, v);
+      memcpy(&t[j], v, h_len);
+    }
+    if (!ecdsa_bits_to_int(n, r_len, t, k))
+      goto done;
+    if (!k.is_zero() && big_compare(k, n) < 0 && attempt-- == 0)
+      break;
+    memcpy(in, v, h_len);
+    in[h_len] = 0;
+    ecdsa_hmac(key, h_len + 1, in, key);
+    ecdsa_hmac(key, h_len, v, v);
+  }
+  ret = true;
+
+done:
+  memset(key, 0, h_len);
+  memset(v, 0, h_len);
+  memset(in, 0, in_len);
+  memset(t, 0, t_len);
+  delete []in;
+  delete []t;
+  return ret;
+}
+
+// (r, s) is the signature of the message whose hash is digest.
+//   r = x(kG) (mod n), s = k^(-1) (e + secret r) (mod n), e the leftmost
+//   bits of the digest and k the RFC 6979 nonce.
+bool ecc::sign(int size, byte_t* digest, big_num& r, big_num& s) {
+  if (c_ == nullptr || secret_ == nullptr || order_of_base_point_ == nullptr)
+    return false;
+
+  big_num& n = *order_of_base_point_;
+  int cap = 2 * n.size_ + 2;
+  big_num e(cap);
+  big_num k(cap);
+  big_num k_inv(cap);
+  big_num t1(cap);
+  big_num t2(cap);
+  curve_point r_pt(2 * c_->curve_p_->capacity_ + 1);
+  bool ret = false;
+
+  if (!ecdsa_bits_to_int(n, size, digest, e) || !big_mod_normalize(e, n))
+    return false;
+  for (int attempt = 0; attempt < 16; attempt++) {
+    if (!ecdsa_nonce(n, *secret_, size, digest, attempt, k))
+      break;
+    if (!ecc_base_mult(*c_, *base_point_, k, r_pt))
+      break;
+    t1.zero_num();
+    if (!big_mod(*r_pt.x_, n, t1))
+      break;
+    if (t1.is_zero())
+      continue;
+    r.zero_num();
+    r.copy_from(t1);
+
+    // s = k^(-1) (e + secret r), k is secret
+    t1.zero_num();
+    t2.zero_num();
+    k_inv.zero_num();
+    if (!big_mod_mult(*secret_, r, n, t1) || !big_mod_add(e, t1, n, t2))
+      break;
+    if (!big_mod_inv_ct(k, n, k_inv))
+      break;
+    t1.zero_num();
+    if (!big_mod_mult(k_inv, t2, n, t1) || !big_mod_normalize(t1, n))
+      break;
+    if (t1.is_zero())
+      continue;
+    s.zero_num();
+    s.copy_from(t1);
+    ret = true;
+    break;
+  }
+  k.zero_num();
+  k_inv.zero_num();
+  return ret;
+}
+
+// Accepts (r, s) if 0 < r, s < n and x(u1 G + u2 Q) = r (mod n) with
+//   w = s^(-1), u1 = e w and u2 = r w, computed as one multi-scalar
+//   multiplication.
+bool ecc::verify(int size, byte_t* digest, big_num& r, big_num& s) {
+  if (c_ == nullptr || public_point_ == nullptr || order_of_base_point_ == nullptr)
+    return false;
+
+  big_num& n = *order_of_base_point_;
+  if (r.is_negative() || r.is_zero() || big_compare(r, n) >= 0)
+    return false;
+  if (s.is_negative() || s.is_zero() || big_compare(s, n) >= 0)
+    return false;
+  if (!ecc_is_on_curve(*c_, *public_point_))
+    return false;
+
+  int cap = 2 * n.size_ + 2;
+  big_num e(cap);
+  big_num w(cap);
+  big_num u1(cap);
+  big_num u2(cap);
+  big_num v(cap);
+  curve_point r_pt(2 * c_->curve_p_->capacity_ + 1);
+  big_num* scalars[2] = {&u1, &u2};
+  curve_point* points[2] = {base_point_, public_point_};
+
+  if (!ecdsa_bits_to_int(n, size, digest, e) || !big_mod_normalize(e, n))
+    return false;
+  if (!big_mod_inv(s, n, w) || !big_mod_normalize(w, n))
+    return false;
+  if (!big_mod_mult(e, w, n, u1) || !big_mod_mult(r, w, n, u2))
+    return false;
+  if (!ecc_multi_mult(*c_, 2, scalars, points, r_pt))
+    return false;
+  if (r_pt.is_zero())
+    return false;
+  if (!big_mod(*r_pt.x_, n, v) || !big_mod_normalize(v, n))
+    return false;
+  return big_compare(v, r) == 0;
+}
+
+// sig = r || s, each as many octets as the order of the base point
+bool ecdsa_signature_to_bytes(big_num& n, big_num& r, big_num& s, string* sig) {
+  int r_len = (big_high_bit(n) + NBITSINBYTE - 1) / NBITSINBYTE;
+  byte_t* b = new byte_t[2 * r_len];
+  bool ret = ecdsa_int_to_octets(r, r_len, b) && ecdsa_int_to_octets(s, r_len, &b[r_len]);
+  if (ret)
+    sig->assign((char*)b, (size_t)(2 * r_len));
+  delete []b;
+  return ret;
+}
+
+bool ecdsa_signature_from_bytes(big_num& n, string& sig, big_num& r, big_num& s) {
+  int r_len = (big_high_bit(n) + NBITSINBYTE - 1) / NBITSINBYTE;
+  if ((int)sig.size() != 2 * r_len)
+    return false;
+  byte_t* b = (byte_t*)sig.data();
+  return ecdsa_octets_to_int(r_len, b, r) && ecdsa_octets_to_int(r_len, &b[r_len], s);
+}
+
+// SEC1 (section 2.3.3) point encoding.  O is the single octet 00.  Otherwise
+//   each coordinate takes as many octets as p: 04 || x || y uncompressed,
+//   02 || x or 03 || x compressed, the low bit of the prefix being the parity
+//   of y.  Projective points (z != 1) are made affine on a copy first.
+bool ecc_point_to_octets(ecc_curve& c, curve_point& pt, bool compress, string* out) {
+  int p_len = (big_high_bit(*c.curve_p_) + NBITSINBYTE - 1) / NBITSINBYTE;
+  int size = compress ? 1 + p_len : 1 + 2 * p_len;
+  curve_point* a = &pt;
+  curve_point* t = nullptr;
+  byte_t* b = nullptr;
+  bool ret = false;
+
+  if (pt.z_->is_zero()) {
+    out->assign(1, (char)0x00);
+    return true;
+  }
+  if (!pt.z_->is_one()) {
+    t = new curve_point(pt, 2 * c.curve_p_->capacity_);
+    if (!projective_to_affine(c, *t))
+      goto done;
+    a = t;
+  }
+
+  b = new byte_t[size];
+  if (!ecdsa_int_to_octets(*a->x_, p_len, &b[1]))
+    goto done;
+  if (compress) {
+    b[0] = (a->y_->size_ > 0 && (a->y_->value_[0] & 1ULL) != 0) ? 0x03 : 0x02;
+  } else {
+    b[0] = 0x04;
+    if (!ecdsa_int_to_octets(*a->y_, p_len, &b[1 + p_len]))
+      goto done;
+  }
+  out->assign((char*)b, (size_t)size);
+  ret = true;
+
+done:
+  if (t != nullptr)
+    delete t;
+  if (b != nullptr)
+    delete []b;
+  return ret;
+}
+
+// Decodes the SEC1 octets in into pt, whose x_ and y_ must have room for p.
+//   The uncompressed (04) form is decoded in place with no intermediate
+//   numbers.  A compressed point needs scratch numbers for x^3 + ax + b and
+//   big_mod_square_root.  Either form is rejected unless it is on c.
+bool ecc_point_from_octets(ecc_curve& c, int size, const byte_t* in, curve_point& pt) {
+  int p_len = (big_high_bit(*c.curve_p_) + NBITSINBYTE - 1) / NBITSINBYTE;
+
+  if (size == 1 && in[0] == 0x00) {
+    pt.make_zero();
+    return true;
+  }
+  if (size < 1 + p_len)
+    return false;
+  if (!ecdsa_octets_to_int(p_len, (byte_t*)&in[1], *pt.x_) ||
+      big_compare(*pt.x_, *c.curve_p_) >= 0)
+    return false;
+  pt.z_->zero_num();
+  pt.z_->value_[0] = 1ULL;
+  pt.z_->normalize();
+
+  if (in[0] == 0x04) {
+    if (size != 1 + 2 * p_len)
+      return false;
+    if (!ecdsa_octets_to_int(p_len, (byte_t*)&in[1 + p_len], *pt.y_) ||
+        big_compare(*pt.y_, *c.curve_p_) >= 0)
+      return false;
+    return ecc_is_on_curve(c, pt);
+  }
+  if ((in[0] != 0x02 && in[0] != 0x03) || size != 1 + p_len)
+    return false;
+
+  // y^2 = x^3 + ax + b (mod p)
+  big_num t1(2 * c.curve_p_->capacity_);
+  big_num t2(2 * c.curve_p_->capacity_);
+  big_num rhs(2 * c.curve_p_->capacity_);
+  big_num y(2 * c.curve_p_->capacity_);
+  uint64_t parity = (uint64_t)(in[0] & 1);
+
+  if (!big_mod_mult(*pt.x_, *pt.x_, *c.curve_p_, t1) ||
+      !big_mod_mult(*pt.x_, t1, *c.curve_p_, t2))
+    return false;
+  t1.zero_num();
+  if (!big_mod_mult(*pt.x_, *c.curve_a_, *c.curve_p_, t1) ||
+      !big_mod_add(t1, t2, *c.curve_p_, rhs))
+    return false;
+  t2.zero_num();
+  if (!big_mod_add(rhs, *c.curve_b_, *c.curve_p_, t2))
+    return false;
+  rhs.copy_from(t2);
+  if (rhs.is_zero()) {
+    // the point of order 2; its y has no odd representative
+    if (parity != 0ULL)
+      return false;
+    pt.y_->zero_num();
+    return true;
+  }
+  if (!big_mod_square_root(rhs, *c.curve_p_, big_zero, y))
+    return false;
+  // big_mod_square_root does not check that rhs is a residue
+  t1.zero_num();
+  if (!big_mod_mult(y, y, *c.curve_p_, t1) || big_compare(t1, rhs) != 0)
+    return false;
+  if ((y.size_ > 0 ? (y.value_[0] & 1ULL) : 0ULL) != parity) {
+    t1.zero_num();
+    if (!big_sub(*c.curve_p_, y, t1))
+      return false;
+    y.copy_from(t1);
+  }
+  return pt.y_->copy_from(y);
+}
@@ -197,12 +197,13 @@ bool init_ecc_curves() {
     p384_key.c_->curve_p_->value_[0] = 0x00000000ffffffffULL;
     p384_key.c_->curve_p_->normalize();
 
-    p384_key.c_->curve_a_->value_[5] = 0x79d1e655f868f02fULL;
-    p384_key.c_->curve_a_->value_[4] = 0xff48dcdee14151ddULL;
-    p384_key.c_->curve_a_->value_[3] = 0xb80643c1406d0ca1ULL;
-    p384_key.c_->curve_a_->value_[2] = 0x0dfe6fc52009540aULL;
-    p384_key.c_->curve_a_->value_[1] = 0x495e8042ea5f744fULL;
-    p384_key.c_->curve_a_->value_[0] = 0x6e184667cc722483ULL;
+    // a = p - 3
+    p384_key.c_->curve_a_->value_[5] = 0xffffffffffffffffULL;
+    p384_key.c_->curve_a_->value_[4] = 0xffffffffffffffffULL;
+    p384_key.c_->curve_a_->value_[3] = 0xffffffffffffffffULL;
+    p384_key.c_->curve_a_->value_[2] = 0xfffffffffffffffeULL;
+    p384_key.c_->curve_a_->value_[1] = 0xffffffff00000000ULL;
+    p384_key.c_->curve_a_->value_[0] = 0x00000000fffffffcULL;
     p384_key.c_->curve_a_->normalize();
 
     p384_key.c_->curve_b_->value_[5] = 0xb3312fa7e23ee7e4ULL;
@@ -271,15 +272,16 @@ bool init_ecc_curves() {
     p521_key.c_->curve_p_->value_[0] = 0xffffffffffffffffULL;
     p521_key.c_->curve_p_->normalize();
 
-    p521_key.c_->curve_a_->value_[8] = 0x0b4ULL;
-    p521_key.c_->curve_a_->value_[7] = 0x8bfa5f420a349495ULL;
-    p521_key.c_->curve_a_->value_[6] = 0x39d2bdfc264eeeebULL;
-    p521_key.c_->curve_a_->value_[5] = 0x077688e44fbf0ad8ULL;
-    p521_key.c_->curve_a_->value_[4] = 0xf6d0edb37bd6b533ULL;
-    p521_key.c_->curve_a_->value_[3] = 0x281000518e19f1b9ULL;
-    p521_key.c_->curve_a_->value_[2] = 0xffbe0fe9ed8a3c22ULL;
-    p521_key.c_->curve_a_->value_[1] = 0x00b8f875e523868cULL;
-    p521_key.c_->curve_a_->value_[0] = 0x70c1e5bf55bad637ULL;
+    // a = p - 3
+    p521_key.c_->curve_a_->value_[8] = 0x1ffULL;
+    p521_key.c_->curve_a_->value_[7] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[6] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[5] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[4] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[3] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[2] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[1] = 0xffffffffffffffffULL;
+    p521_key.c_->curve_a_->value_[0] = 0xfffffffffffffffcULL;
     p521_key.c_->curve_a_->normalize();
 
     p521_key.c_->curve_b_->value_[8] = 0x051ULL;
@@ -0,0 +1,905 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: ecc_field.cc
+
+#include "crypto_support.h"
+#include "big_num.h"
+#include "big_num_functions.h"
+#include "intel_digit_arith.h"
+#include "ecc.h"
+
+// Field data
+ecc_field p256_field;
+ecc_field p384_field;
+ecc_field p521_field;
+
+//  P-256: p = 2^256 - 2^224 + 2^192 + 2^96 - 1
+//    W^8 = W^7 - W^6 - W^3 + 1 (mod p)
+//  P-384: p = 2^384 - 2^128 - 2^96 + 2^32 - 1
+//    W^12 = W^4 + W^3 - W + 1 (mod p)
+//  These are the s1, ..., s9 (d1, d2, d3) sums of FIPS 186-4, D.2,
+//  with the shuffled words of each sum regrouped by column.
+int p256_f[8] = {1, 0, 0, -1, 0, 0, -1, 1};
+int p384_f[12] = {1, -1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0};
+
+ecc_field::ecc_field() {
+  initialized_ = false;
+  mersenne_ = false;
+  num_digits_ = 0;
+  num_words_ = 0;
+  num_bits_ = 0;
+}
+
+ecc_field::~ecc_field() {
+  initialized_ = false;
+}
+
+static inline uint64_t field_word(uint64_t* a, int i) {
+  return (a[i / 2] >> (32 * (i & 1))) & 0xffffffffULL;
+}
+
+// p = W^n - f(W), fold_[j] = W^(n+j) (mod p)
+bool ecc_field::init_solinas(int num_words, int* f) {
+  int i, j;
+
+  if (num_words > ecc_field_max_words || (num_words % 2) != 0)
+    return false;
+  mersenne_ = false;
+  num_words_ = num_words;
+  num_digits_ = num_words / 2;
+  num_bits_ = 32 * num_words;
+  for (i = 0; i < num_words; i++)
+    f_[i] = f[i];
+
+  int64_t acc[ecc_field_max_words];
+  int64_t carry = 0;
+  for (i = 0; i < num_words; i++) {
+    acc[i] = -(int64_t)f[i] + carry;
+    carry = acc[i] >> 32;
+    acc[i] &= 0xffffffffLL;
+  }
+  // the W^n term cancels the final borrow
+  if (carry != -1)
+    return false;
+  for (i = 0; i < num_digits_; i++)
+    p_[i] = (uint64_t)acc[2 * i] | ((uint64_t)acc[2 * i + 1] << 32);
+
+  for (i = 0; i < num_words; i++)
+    fold_[0][i] = f[i];
+  for (j = 1; j < num_words; j++) {
+    int top = fold_[j - 1][num_words - 1];
+    fold_[j][0] = top * f[0];
+    for (i = 1; i < num_words; i++)
+      fold_[j][i] = fold_[j - 1][i - 1] + top * f[i];
+  }
+  initialized_ = true;
+  return true;
+}
+
+// p = 2^num_bits - 1
+bool ecc_field::init_mersenne(int num_bits) {
+  int i;
+
+  num_digits_ = (num_bits + NBITSINUINT64 - 1) / NBITSINUINT64;
+  if (num_digits_ > ecc_field_max_digits || (num_bits % NBITSINUINT64) == 0)
+    return false;
+  mersenne_ = true;
+  num_bits_ = num_bits;
+  num_words_ = 2 * num_digits_;
+  for (i = 0; i < num_digits_; i++)
+    p_[i] = 0xffffffffffffffffULL;
+  p_[num_digits_ - 1] = (1ULL << (num_bits % NBITSINUINT64)) - 1ULL;
+  initialized_ = true;
+  return true;
+}
+
+bool ecc_field::is_modulus(big_num& p) {
+  if (p.is_negative() || p.size_ != num_digits_)
+    return false;
+  return digit_array_compare(num_digits_, p_, p.size_, p.value_) == 0;
+}
+
+bool ecc_field::load(big_num& a, uint64_t* r) {
+  digit_array_zero_num(num_digits_, r);
+  if (!a.is_negative() && a.size_ <= num_digits_ &&
+      digit_array_compare(a.size_, a.value_, num_digits_, p_) < 0) {
+    return digit_array_copy(a.size_, a.value_, num_digits_, r);
+  }
+
+  // negative or unreduced
+  int n = a.size_ > num_digits_ ? a.size_ : num_digits_;
+  big_num t(n + 1);
+  big_num p(num_digits_);
+  t.copy_from(a);
+  if (!digit_array_copy(num_digits_, p_, p.capacity_, p.value_))
+    return false;
+  p.normalize();
+  if (!big_mod_normalize(t, p))
+    return false;
+  return digit_array_copy(t.size_, t.value_, num_digits_, r);
+}
+
+bool ecc_field::store(uint64_t* a, big_num& r) {
+  int k = digit_array_real_size(num_digits_, a);
+  if (k > r.capacity_)
+    return false;
+  r.zero_num();
+  if (!digit_array_copy(k, a, r.capacity_, r.value_))
+    return false;
+  r.normalize();
+  return true;
+}
+
+bool ecc_field::is_zero(uint64_t* a) {
+  uint64_t x = 0ULL;
+  for (int i = 0; i < num_digits_; i++)
+    x |= a[i];
+  return x == 0ULL;
+}
+
+bool ecc_field::is_equal(uint64_t* a, uint64_t* b) {
+  uint64_t x = 0ULL;
+  for (int i = 0; i < num_digits_; i++)
+    x |= a[i] ^ b[i];
+  return x == 0ULL;
+}
+
+void ecc_field::copy(uint64_t* a, uint64_t* r) {
+  for (int i = 0; i < num_digits_; i++)
+    r[i] = a[i];
+}
+
+// r = a + b, then subtract p unless that borrows
+void ecc_field::add(uint64_t* a, uint64_t* b, uint64_t* r) {
+  uint64_t s[ecc_field_max_digits];
+  uint64_t d[ecc_field_max_digits];
+  unsigned __int128 t;
+  uint64_t carry = 0ULL;
+  uint64_t borrow = 0ULL;
+  int i;
+
+  for (i = 0; i < num_digits_; i++) {
+    t = (unsigned __int128)a[i] + b[i] + carry;
+    s[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> 64);
+  }
+  for (i = 0; i < num_digits_; i++) {
+    t = (unsigned __int128)s[i] - p_[i] - borrow;
+    d[i] = (uint64_t)t;
+    borrow = (uint64_t)(t >> 64) & 1ULL;
+  }
+  // keep s only if s < p
+  uint64_t keep = 0ULL - (borrow & (carry ^ 1ULL));
+  for (i = 0; i < num_digits_; i++)
+    r[i] = (s[i] & keep) | (d[i] & ~keep);
+}
+
+// r = a - b, then add p back if that borrowed
+void ecc_field::sub(uint64_t* a, uint64_t* b, uint64_t* r) {
+  unsigned __int128 t;
+  uint64_t borrow = 0ULL;
+  uint64_t carry = 0ULL;
+  int i;
+
+  for (i = 0; i < num_digits_; i++) {
+    t = (unsigned __int128)a[i] - b[i] - borrow;
+    r[i] = (uint64_t)t;
+    borrow = (uint64_t)(t >> 64) & 1ULL;
+  }
+  uint64_t mask = 0ULL - borrow;
+  for (i = 0; i < num_digits_; i++) {
+    t = (unsigned __int128)r[i] + (p_[i] & mask) + carry;
+    r[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> 64);
+  }
+}
+
+// t has 2 num_digits_ digits and t < p^2
+void ecc_field::reduce(uint64_t* t, uint64_t* r) {
+  uint64_t s[ecc_field_max_digits];
+  unsigned __int128 u;
+  uint64_t carry = 0ULL;
+  uint64_t borrow = 0ULL;
+  int n = num_digits_;
+  int i, j;
+
+  if (mersenne_) {
+    int top = num_bits_ % NBITSINUINT64;
+    uint64_t hi[ecc_field_max_digits];
+
+    // t = hi 2^k + lo and 2^k = 1 (mod p)
+    for (i = 0; i < n; i++)
+      hi[i] = (t[n - 1 + i] >> top) | (t[n + i] << (NBITSINUINT64 - top));
+    for (i = 0; i < n; i++) {
+      uint64_t lo = t[i];
+      if (i == n - 1)
+        lo &= p_[n - 1];
+      u = (unsigned __int128)lo + hi[i] + carry;
+      r[i] = (uint64_t)u;
+      carry = (uint64_t)(u >> 64);
+    }
+    // r < 2p, fold the bit above p once more
+    carry = r[n - 1] >> top;
+    r[n - 1] &= p_[n - 1];
+    for (i = 0; i < n; i++) {
+      u = (unsigned __int128)r[i] + carry;
+      r[i] = (uint64_t)u;
+      carry = (uint64_t)(u >> 64);
+    }
+  } else {
+    int m = num_words_;
+    int64_t acc[ecc_field_max_words];
+    int64_t c;
+
+    for (i = 0; i < m; i++)
+      acc[i] = (int64_t)field_word(t, i);
+    for (j = 0; j < m; j++) {
+      int64_t w = (int64_t)field_word(t, m + j);
+      for (i = 0; i < m; i++)
+        acc[i] += fold_[j][i] * w;
+    }
+    c = 0;
+    for (i = 0; i < m; i++) {
+      acc[i] += c;
+      c = acc[i] >> 32;
+      acc[i] &= 0xffffffffLL;
+    }
+    // fold the small signed carry, c W^m = c f(W), until it is gone
+    while (c != 0) {
+      int64_t k = c;
+      c = 0;
+      for (i = 0; i < m; i++) {
+        acc[i] += k * f_[i] + c;
+        c = acc[i] >> 32;
+        acc[i] &= 0xffffffffLL;
+      }
+    }
+    for (i = 0; i < n; i++)
+      r[i] = (uint64_t)acc[2 * i] | ((uint64_t)acc[2 * i + 1] << 32);
+  }
+
+  // r < W^m < 2p
+  for (i = 0; i < n; i++) {
+    u = (unsigned __int128)r[i] - p_[i] - borrow;
+    s[i] = (uint64_t)u;
+    borrow = (uint64_t)(u >> 64) & 1ULL;
+  }
+  uint64_t keep = 0ULL - borrow;
+  for (i = 0; i < n; i++)
+    r[i] = (r[i] & keep) | (s[i] & ~keep);
+}
+
+void ecc_field::mult(uint64_t* a, uint64_t* b, uint64_t* r) {
+  uint64_t t[2 * ecc_field_max_digits];
+
+  digit_array_mult(num_digits_, a, num_digits_, b, 2 * num_digits_, t);
+  reduce(t, r);
+}
+
+void ecc_field::square(uint64_t* a, uint64_t* r) {
+  uint64_t t[2 * ecc_field_max_digits];
+
+  digit_array_square(num_digits_, a, 2 * num_digits_, t);
+  reduce(t, r);
+}
+
+bool ecc_field::inv(uint64_t* a, uint64_t* r) {
+  big_num p(num_digits_);
+  big_num x(num_digits_);
+  big_num x_inv(num_digits_ + 1);
+
+  if (!digit_array_copy(num_digits_, p_, p.capacity_, p.value_))
+    return false;
+  p.normalize();
+  if (!store(a, x))
+    return false;
+  if (!big_mod_inv_ct(x, p, x_inv))
+    return false;
+  return load(x_inv, r);
+}
+
+// r[i] = 1/a[i] for n elements num_digits_ apart with one inversion
+//   (Montgomery's trick).  Zero elements are skipped and give 0; r may be a.
+bool ecc_field::batch_inv(int n, uint64_t* a, uint64_t* r) {
+  int nd = num_digits_;
+  uint64_t* prod = new uint64_t[(n + 1) * nd];
+  uint64_t acc[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+  bool ret = true;
+  int i;
+
+  // prod[i] is the product of the nonzero a[j], j < i
+  digit_array_zero_num(nd, prod);
+  prod[0] = 1ULL;
+  for (i = 0; i < n; i++) {
+    if (is_zero(&a[i * nd]))
+      copy(&prod[i * nd], &prod[(i + 1) * nd]);
+    else
+      mult(&prod[i * nd], &a[i * nd], &prod[(i + 1) * nd]);
+  }
+  if (!inv(&prod[n * nd], acc)) {
+    ret = false;
+    goto done;
+  }
+  for (i = n - 1; i >= 0; i--) {
+    if (is_zero(&a[i * nd])) {
+      digit_array_zero_num(nd, &r[i * nd]);
+      continue;
+    }
+    mult(acc, &prod[i * nd], t);
+    mult(acc, &a[i * nd], acc);
+    copy(t, &r[i * nd]);
+  }
+
+done:
+  delete []prod;
+  return ret;
+}
+
+bool init_ecc_fields() {
+  if (!p256_field.initialized_ && !p256_field.init_solinas(8, p256_f))
+    return false;
+  if (!p384_field.initialized_ && !p384_field.init_solinas(12, p384_f))
+    return false;
+  if (!p521_field.initialized_ && !p521_field.init_mersenne(521))
+    return false;
+  return true;
+}
+
+// Sets c.field_ to the field for a named curve, nullptr if c is not one
+// of the NIST curves or its prime is not the standard one, and
+// c.jacobian_field_ to the same field if a is also -3, which the Jacobian
+// formulas below assume.  A curve whose p is not set yet is not cached.
+static void resolve_curve_field(ecc_curve& c) {
+  static bool fields_ready = init_ecc_fields();
+  uint64_t a[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+  ecc_field* f = nullptr;
+
+  c.field_ = nullptr;
+  c.jacobian_field_ = nullptr;
+  if (!fields_ready || c.curve_p_ == nullptr || c.curve_p_->is_zero())
+    return;
+  c.field_resolved_ = true;
+  if (c.c_name_ == "P-256")
+    f = &p256_field;
+  else if (c.c_name_ == "P-384")
+    f = &p384_field;
+  else if (c.c_name_ == "P-521")
+    f = &p521_field;
+  if (f == nullptr || !f->is_modulus(*c.curve_p_))
+    return;
+  c.field_ = f;
+
+  if (c.curve_a_ == nullptr || !f->load(*c.curve_a_, a))
+    return;
+  digit_array_zero_num(f->num_digits_, t);
+  t[0] = 3ULL;
+  f->add(a, t, t);
+  if (f->is_zero(t))
+    c.jacobian_field_ = f;
+}
+
+ecc_field* ecc_field_for_curve(ecc_curve& c) {
+  if (!c.field_resolved_)
+    resolve_curve_field(c);
+  return c.field_;
+}
+
+ecc_field* ecc_jacobian_field(ecc_curve& c) {
+  if (!c.field_resolved_)
+    resolve_curve_field(c);
+  return c.jacobian_field_;
+}
+
+//  Jacobian points
+//    (x, y, z) is the affine point (x/z^2, y/z^3), z = 0 is O.
+//    Doubling is dbl-2001-b, 3M + 5S, the additions are add-2007-bl
+//    and madd-2007-bl of the Explicit-Formulas Database.
+
+void jacobian_make_zero(ecc_field& f, jacobian_point& p) {
+  digit_array_zero_num(f.num_digits_, p.x_);
+  digit_array_zero_num(f.num_digits_, p.y_);
+  digit_array_zero_num(f.num_digits_, p.z_);
+  p.x_[0] = 1ULL;
+  p.y_[0] = 1ULL;
+}
+
+bool jacobian_is_zero(ecc_field& f, jacobian_point& p) {
+  return f.is_zero(p.z_);
+}
+
+void jacobian_copy(ecc_field& f, jacobian_point& p, jacobian_point& r) {
+  f.copy(p.x_, r.x_);
+  f.copy(p.y_, r.y_);
+  f.copy(p.z_, r.z_);
+}
+
+void jacobian_from_affine(ecc_field& f, uint64_t* x, uint64_t* y,
+                          jacobian_point& r) {
+  f.copy(x, r.x_);
+  f.copy(y, r.y_);
+  digit_array_zero_num(f.num_digits_, r.z_);
+  r.z_[0] = 1ULL;
+}
+
+// pt is affine or homogeneous projective, (x, y, z) ~ (x/z, y/z),
+// so the Jacobian point is (xz, yz^2, z).
+bool jacobian_from_point(ecc_field& f, curve_point& pt, jacobian_point& r) {
+  uint64_t t[ecc_field_max_digits];
+
+  if (pt.z_->is_zero()) {
+    jacobian_make_zero(f, r);
+    return true;
+  }
+  if (!f.load(*pt.x_, r.x_) || !f.load(*pt.y_, r.y_))
+    return false;
+  if (pt.z_->is_one()) {
+    digit_array_zero_num(f.num_digits_, r.z_);
+    r.z_[0] = 1ULL;
+    return true;
+  }
+  if (!f.load(*pt.z_, r.z_))
+    return false;
+  f.mult(r.x_, r.z_, r.x_);
+  f.square(r.z_, t);
+  f.mult(r.y_, t, r.y_);
+  return true;
+}
+
+// Returns false for O, which has no affine coordinates.
+bool jacobian_to_affine(ecc_field& f, jacobian_point& p, uint64_t* x,
+                        uint64_t* y) {
+  uint64_t z_inv[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+
+  if (jacobian_is_zero(f, p))
+    return false;
+  if (!f.inv(p.z_, z_inv))
+    return false;
+  f.square(z_inv, t);
+  f.mult(p.x_, t, x);
+  f.mult(t, z_inv, t);
+  f.mult(p.y_, t, y);
+  return true;
+}
+
+// x[i], y[i] are the affine coordinates of p[i], num_digits_ apart, with
+//   one field inversion for all n points.  O gives (0, 0).
+bool jacobian_to_affine_batch(ecc_field& f, int n, jacobian_point* p,
+                              uint64_t* x, uint64_t* y) {
+  int nd = f.num_digits_;
+  uint64_t* z_inv = new uint64_t[n * nd];
+  uint64_t t[ecc_field_max_digits];
+  bool ret = true;
+  int i;
+
+  for (i = 0; i < n; i++)
+    f.copy(p[i].z_, &z_inv[i * nd]);
+  if (!f.batch_inv(n, z_inv, z_inv)) {
+    ret = false;
+    goto done;
+  }
+  for (i = 0; i < n; i++) {
+    uint64_t* zi = &z_inv[i * nd];
+    f.square(zi, t);
+    f.mult(p[i].x_, t, &x[i * nd]);
+    f.mult(t, zi, t);
+    f.mult(p[i].y_, t, &y[i * nd]);
+  }
+
+done:
+  delete []z_inv;
+  return ret;
+}
+
+bool jacobian_to_point(ecc_field& f, jacobian_point& p, curve_point& r) {
+  uint64_t x[ecc_field_max_digits];
+  uint64_t y[ecc_field_max_digits];
+
+  if (jacobian_is_zero(f, p)) {
+    r.make_zero();
+    return true;
+  }
+  if (!jacobian_to_affine(f, p, x, y))
+    return false;
+  if (!f.store(x, *r.x_) || !f.store(y, *r.y_))
+    return false;
+  r.z_->copy_from(big_one);
+  return true;
+}
+
+// r = 2p, r may be p
+void jacobian_double(ecc_field& f, jacobian_point& p, jacobian_point& r,
+                     ecc_field_scratch& s) {
+  uint64_t* delta = s.t_[0];
+  uint64_t* gamma = s.t_[1];
+  uint64_t* beta = s.t_[2];
+  uint64_t* alpha = s.t_[3];
+  uint64_t* t1 = s.t_[4];
+  uint64_t* t2 = s.t_[5];
+
+  f.square(p.z_, delta);
+  f.square(p.y_, gamma);
+  f.mult(p.x_, gamma, beta);
+
+  // alpha = 3 (x - delta)(x + delta)
+  f.sub(p.x_, delta, t1);
+  f.add(p.x_, delta, t2);
+  f.mult(t1, t2, t1);
+  f.add(t1, t1, alpha);
+  f.add(alpha, t1, alpha);
+
+  // z3 = (y + z)^2 - gamma - delta
+  f.add(p.y_, p.z_, t1);
+  f.square(t1, t1);
+  f.sub(t1, gamma, t1);
+  f.sub(t1, delta, r.z_);
+
+  // x3 = alpha^2 - 8 beta
+  f.add(beta, beta, beta);
+  f.add(beta, beta, beta);
+  f.square(alpha, t1);
+  f.add(beta, beta, t2);
+  f.sub(t1, t2, r.x_);
+
+  // y3 = alpha (4 beta - x3) - 8 gamma^2
+  f.sub(beta, r.x_, t1);
+  f.mult(alpha, t1, t1);
+  f.square(gamma, t2);
+  f.add(t2, t2, t2);
+  f.add(t2, t2, t2);
+  f.add(t2, t2, t2);
+  f.sub(t1, t2, r.y_);
+}
+
+// r = p + (x2, y2), r may be p
+void jacobian_add_affine(ecc_field& f, jacobian_point& p, uint64_t* x2,
+                         uint64_t* y2, jacobian_point& r, ecc_field_scratch& sc) {
+  uint64_t* z1z1 = sc.t_[0];
+  uint64_t* h = sc.t_[1];
+  uint64_t* hh = sc.t_[2];
+  uint64_t* i = sc.t_[3];
+  uint64_t* j = sc.t_[4];
+  uint64_t* s = sc.t_[5];
+  uint64_t* v = sc.t_[6];
+  uint64_t* t = sc.t_[7];
+
+  if (jacobian_is_zero(f, p)) {
+    jacobian_from_affine(f, x2, y2, r);
+    return;
+  }
+
+  // h = x2 z1^2 - x1, s = 2 (y2 z1^3 - y1)
+  f.square(p.z_, z1z1);
+  f.mult(x2, z1z1, h);
+  f.sub(h, p.x_, h);
+  f.mult(p.z_, z1z1, t);
+  f.mult(y2, t, s);
+  f.sub(s, p.y_, s);
+  if (f.is_zero(h)) {
+    if (f.is_zero(s))
+      jacobian_double(f, p, r, sc);
+    else
+      jacobian_make_zero(f, r);
+    return;
+  }
+  f.add(s, s, s);
+
+  // i = 4 h^2, j = h i, v = x1 i
+  f.square(h, hh);
+  f.add(hh, hh, i);
+  f.add(i, i, i);
+  f.mult(h, i, j);
+  f.mult(p.x_, i, v);
+
+  // z3 = (z1 + h)^2 - z1^2 - h^2
+  f.add(p.z_, h, t);
+  f.square(t, t);
+  f.sub(t, z1z1, t);
+  f.sub(t, hh, r.z_);
+
+  // y1 j is needed after x1 and y1 are overwritten
+  f.mult(p.y_, j, i);
+  f.add(i, i, i);
+
+  // x3 = s^2 - j - 2v, y3 = s (v - x3) - 2 y1 j
+  f.square(s, t);
+  f.sub(t, j, t);
+  f.sub(t, v, t);
+  f.sub(t, v, r.x_);
+  f.sub(v, r.x_, t);
+  f.mult(s, t, t);
+  f.sub(t, i, r.y_);
+}
+
+// r = p + q, r may be p or q
+void jacobian_add(ecc_field& f, jacobian_point& p, jacobian_point& q,
+                  jacobian_point& r, ecc_field_scratch& sc) {
+  uint64_t* z1z1 = sc.t_[0];
+  uint64_t* z2z2 = sc.t_[1];
+  uint64_t* u1 = sc.t_[2];
+  uint64_t* s1 = sc.t_[3];
+  uint64_t* h = sc.t_[4];
+  uint64_t* s = sc.t_[5];
+  uint64_t* i = sc.t_[6];
+  uint64_t* j = sc.t_[7];
+  uint64_t* v = sc.t_[8];
+  uint64_t* t = sc.t_[9];
+
+  if (jacobian_is_zero(f, p)) {
+    jacobian_copy(f, q, r);
+    return;
+  }
+  if (jacobian_is_zero(f, q)) {
+    jacobian_copy(f, p, r);
+    return;
+  }
+
+  // u1 = x1 z2^2, s1 = y1 z2^3, h = x2 z1^2 - u1, s = 2 (y2 z1^3 - s1)
+  f.square(p.z_, z1z1);
+  f.square(q.z_, z2z2);
+  f.mult(p.x_, z2z2, u1);
+  f.mult(q.x_, z1z1, h);
+  f.sub(h, u1, h);
+  f.mult(q.z_, z2z2, t);
+  f.mult(p.y_, t, s1);
+  f.mult(p.z_, z1z1, t);
+  f.mult(q.y_, t, s);
+  f.sub(s, s1, s);
+  if (f.is_zero(h)) {
+    if (f.is_zero(s))
+      jacobian_double(f, p, r, sc);
+    else
+      jacobian_make_zero(f, r);
+    return;
+  }
+  f.add(s, s, s);
+
+  // i = (2h)^2, j = h i, v = u1 i
+  f.add(h, h, t);
+  f.square(t, i);
+  f.mult(h, i, j);
+  f.mult(u1, i, v);
+
+  // z3 = ((z1 + z2)^2 - z1^2 - z2^2) h
+  f.add(p.z_, q.z_, t);
+  f.square(t, t);
+  f.sub(t, z1z1, t);
+  f.sub(t, z2z2, t);
+  f.mult(t, h, r.z_);
+
+  // x3 = s^2 - j - 2v, y3 = s (v - x3) - 2 s1 j
+  f.mult(s1, j, i);
+  f.add(i, i, i);
+  f.square(s, t);
+  f.sub(t, j, t);
+  f.sub(t, v, t);
+  f.sub(t, v, r.x_);
+  f.sub(v, r.x_, t);
+  f.mult(s, t, t);
+  f.sub(t, i, r.y_);
+}
+
+void jacobian_double(ecc_field& f, jacobian_point& p, jacobian_point& r) {
+  ecc_field_scratch s;
+  jacobian_double(f, p, r, s);
+}
+
+void jacobian_add_affine(ecc_field& f, jacobian_point& p, uint64_t* x2,
+                         uint64_t* y2, jacobian_point& r) {
+  ecc_field_scratch s;
+  jacobian_add_affine(f, p, x2, y2, r, s);
+}
+
+void jacobian_add(ecc_field& f, jacobian_point& p, jacobian_point& q,
+                  jacobian_point& r) {
+  ecc_field_scratch s;
+  jacobian_add(f, p, q, r, s);
+}
+
+//  Complete formulas for a = -3, algorithms 4, 5 and 6 of Renes, Costello
+//  and Batina, "Complete addition formulas for prime order elliptic
+//  curves" (2016), on homogeneous points.  O, p = q and p = -q take the
+//  same sequence of operations as any other input.
+
+void homogeneous_make_zero(ecc_field& f, homogeneous_point& p) {
+  digit_array_zero_num(f.num_digits_, p.x_);
+  digit_array_zero_num(f.num_digits_, p.y_);
+  digit_array_zero_num(f.num_digits_, p.z_);
+  p.y_[0] = 1ULL;
+}
+
+bool homogeneous_from_point(ecc_field& f, curve_point& pt, homogeneous_point& r) {
+  if (pt.z_->is_zero()) {
+    homogeneous_make_zero(f, r);
+    return true;
+  }
+  return f.load(*pt.x_, r.x_) && f.load(*pt.y_, r.y_) && f.load(*pt.z_, r.z_);
+}
+
+// r stays projective, as the curve_point routines expect
+bool homogeneous_to_point(ecc_field& f, homogeneous_point& p, curve_point& r) {
+  if (f.is_zero(p.z_)) {
+    r.make_zero();
+    return true;
+  }
+  return f.store(p.x_, *r.x_) && f.store(p.y_, *r.y_) && f.store(p.z_, *r.z_);
+}
+
+// r = p + q, any of them may be the same point
+void homogeneous_complete_add(ecc_field& f, uint64_t* b, homogeneous_point& p,
+                              homogeneous_point& q, homogeneous_point& r,
+                              ecc_field_scratch& s) {
+  uint64_t* t0 = s.t_[0];
+  uint64_t* t1 = s.t_[1];
+  uint64_t* t2 = s.t_[2];
+  uint64_t* t3 = s.t_[3];
+  uint64_t* t4 = s.t_[4];
+  uint64_t* x3 = s.t_[5];
+  uint64_t* y3 = s.t_[6];
+  uint64_t* z3 = s.t_[7];
+
+  f.mult(p.x_, q.x_, t0);
+  f.mult(p.y_, q.y_, t1);
+  f.mult(p.z_, q.z_, t2);
+  f.add(p.x_, p.y_, t3);
+  f.add(q.x_, q.y_, t4);
+  f.mult(t3, t4, t3);
+  f.add(t0, t1, t4);
+  f.sub(t3, t4, t3);
+  f.add(p.y_, p.z_, t4);
+  f.add(q.y_, q.z_, x3);
+  f.mult(t4, x3, t4);
+  f.add(t1, t2, x3);
+  f.sub(t4, x3, t4);
+  f.add(p.x_, p.z_, x3);
+  f.add(q.x_, q.z_, y3);
+  f.mult(x3, y3, x3);
+  f.add(t0, t2, y3);
+  f.sub(x3, y3, y3);
+  f.mult(b, t2, z3);
+  f.sub(y3, z3, x3);
+  f.add(x3, x3, z3);
+  f.add(x3, z3, x3);
+  f.sub(t1, x3, z3);
+  f.add(t1, x3, x3);
+  f.mult(b, y3, y3);
+  f.add(t2, t2, t1);
+  f.add(t1, t2, t2);
+  f.sub(y3, t2, y3);
+  f.sub(y3, t0, y3);
+  f.add(y3, y3, t1);
+  f.add(t1, y3, y3);
+  f.add(t0, t0, t1);
+  f.add(t1, t0, t0);
+  f.sub(t0, t2, t0);
+  f.mult(t4, y3, t1);
+  f.mult(t0, y3, t2);
+  f.mult(x3, z3, y3);
+  f.add(y3, t2, y3);
+  f.mult(t3, x3, x3);
+  f.sub(x3, t1, x3);
+  f.mult(t4, z3, z3);
+  f.mult(t3, t0, t1);
+  f.add(z3, t1, z3);
+
+  f.copy(x3, r.x_);
+  f.copy(y3, r.y_);
+  f.copy(z3, r.z_);
+}
+
+// r = p + (x2, y2), (x2, y2) is not O
+void homogeneous_complete_add_affine(ecc_field& f, uint64_t* b, homogeneous_point& p,
+                                     uint64_t* x2, uint64_t* y2, homogeneous_point& r,
+                                     ecc_field_scratch& s) {
+  uint64_t* t0 = s.t_[0];
+  uint64_t* t1 = s.t_[1];
+  uint64_t* t2 = s.t_[2];
+  uint64_t* t3 = s.t_[3];
+  uint64_t* t4 = s.t_[4];
+  uint64_t* x3 = s.t_[5];
+  uint64_t* y3 = s.t_[6];
+  uint64_t* z3 = s.t_[7];
+
+  f.mult(p.x_, x2, t0);
+  f.mult(p.y_, y2, t1);
+  f.add(x2, y2, t3);
+  f.add(p.x_, p.y_, t4);
+  f.mult(t3, t4, t3);
+  f.add(t0, t1, t4);
+  f.sub(t3, t4, t3);
+  f.mult(y2, p.z_, t4);
+  f.add(t4, p.y_, t4);
+  f.mult(x2, p.z_, y3);
+  f.add(y3, p.x_, y3);
+  f.mult(b, p.z_, z3);
+  f.sub(y3, z3, x3);
+  f.add(x3, x3, z3);
+  f.add(x3, z3, x3);
+  f.sub(t1, x3, z3);
+  f.add(t1, x3, x3);
+  f.mult(b, y3, y3);
+  f.add(p.z_, p.z_, t1);
+  f.add(t1, p.z_, t2);
+  f.sub(y3, t2, y3);
+  f.sub(y3, t0, y3);
+  f.add(y3, y3, t1);
+  f.add(t1, y3, y3);
+  f.add(t0, t0, t1);
+  f.add(t1, t0, t0);
+  f.sub(t0, t2, t0);
+  f.mult(t4, y3, t1);
+  f.mult(t0, y3, t2);
+  f.mult(x3, z3, y3);
+  f.add(y3, t2, y3);
+  f.mult(t3, x3, x3);
+  f.sub(x3, t1, x3);
+  f.mult(t4, z3, z3);
+  f.mult(t3, t0, t1);
+  f.add(z3, t1, z3);
+
+  f.copy(x3, r.x_);
+  f.copy(y3, r.y_);
+  f.copy(z3, r.z_);
+}
+
+// r = 2p, r may be p
+void homogeneous_complete_double(ecc_field& f, uint64_t* b, homogeneous_point& p,
+                                 homogeneous_point& r, ecc_field_scratch& s) {
+  uint64_t* t0 = s.t_[0];
+  uint64_t* t1 = s.t_[1];
+  uint64_t* t2 = s.t_[2];
+  uint64_t* t3 = s.t_[3];
+  uint64_t* x3 = s.t_[4];
+  uint64_t* y3 = s.t_[5];
+  uint64_t* z3 = s.t_[6];
+
+  f.square(p.x_, t0);
+  f.square(p.y_, t1);
+  f.square(p.z_, t2);
+  f.mult(p.x_, p.y_, t3);
+  f.add(t3, t3, t3);
+  f.mult(p.x_, p.z_, z3);
+  f.add(z3, z3, z3);
+  f.mult(b, t2, y3);
+  f.sub(y3, z3, y3);
+  f.add(y3, y3, x3);
+  f.add(x3, y3, y3);
+  f.sub(t1, y3, x3);
+  f.add(t1, y3, y3);
+  f.mult(x3, y3, y3);
+  f.mult(x3, t3, x3);
+  f.add(t2, t2, t3);
+  f.add(t2, t3, t2);
+  f.mult(b, z3, z3);
+  f.sub(z3, t2, z3);
+  f.sub(z3, t0, z3);
+  f.add(z3, z3, t3);
+  f.add(z3, t3, z3);
+  f.add(t0, t0, t3);
+  f.add(t3, t0, t0);
+  f.sub(t0, t2, t0);
+  f.mult(t0, z3, t0);
+  f.add(y3, t0, y3);
+  f.mult(p.y_, p.z_, t0);
+  f.add(t0, t0, t0);
+  f.mult(t0, z3, z3);
+  f.sub(x3, z3, x3);
+  f.mult(t0, t1, z3);
+  f.add(z3, z3, z3);
+  f.add(z3, z3, z3);
+
+  f.copy(x3, r.x_);
+  f.copy(y3, r.y_);
+  f.copy(z3, r.z_);
+}
@@ -0,0 +1,877 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: ecc_mult.cc
+
+#include "crypto_support.h"
+#include "big_num.h"
+#include "big_num_functions.h"
+#include "intel_digit_arith.h"
+#include "ecc.h"
+#include "ecc_curve_data.h"
+#include <mutex>
+
+// 64 entry tables: P-256 takes 43 doublings and additions, P-521 87.
+const int ecc_comb_teeth = 6;
+
+ecc_comb_table::ecc_comb_table() {
+  initialized_ = false;
+  f_ = nullptr;
+  teeth_ = 0;
+  spacing_ = 0;
+  num_entries_ = 0;
+  x_ = nullptr;
+  y_ = nullptr;
+  order_ = nullptr;
+}
+
+ecc_comb_table::~ecc_comb_table() {
+  if (x_ != nullptr) {
+    delete []x_;
+    x_ = nullptr;
+  }
+  if (y_ != nullptr) {
+    delete []y_;
+    y_ = nullptr;
+  }
+  if (order_ != nullptr) {
+    delete order_;
+    order_ = nullptr;
+  }
+  initialized_ = false;
+}
+
+bool ecc_comb_table::init(ecc_curve& c, curve_point& base, big_num& order,
+                          int teeth) {
+  bool ret = true;
+  jacobian_point* g = nullptr;
+  jacobian_point* t = nullptr;
+  int n, i, j, b;
+
+  initialized_ = false;
+  f_ = ecc_jacobian_field(c);
+  if (f_ == nullptr || !base.z_->is_one() || order.is_negative())
+    return false;
+  n = f_->num_digits_;
+  if (order.size_ > n || teeth < 1 || teeth > 8)
+    return false;
+  if (!f_->load(*base.x_, base_x_) || !f_->load(*base.y_, base_y_) ||
+      !f_->load(*c.curve_b_, curve_b_))
+    return false;
+
+  teeth_ = teeth;
+  spacing_ = (big_high_bit(order) + teeth - 1) / teeth;
+  num_entries_ = 1 << teeth;
+  if (order_ != nullptr)
+    delete order_;
+  order_ = new big_num(n + 1);
+  order_->copy_from(order);
+  if (x_ != nullptr)
+    delete []x_;
+  if (y_ != nullptr)
+    delete []y_;
+  x_ = new uint64_t[num_entries_ * n];
+  y_ = new uint64_t[num_entries_ * n];
+  g = new jacobian_point[teeth];
+  t = new jacobian_point[num_entries_];
+
+  // g[i] = 2^(i d) G
+  jacobian_from_affine(*f_, base_x_, base_y_, g[0]);
+  for (i = 1; i < teeth; i++) {
+    jacobian_copy(*f_, g[i - 1], g[i]);
+    for (j = 0; j < spacing_; j++)
+      jacobian_double(*f_, g[i], g[i]);
+  }
+
+  // t[b] = t[b without its top bit] + g[top bit]
+  jacobian_make_zero(*f_, t[0]);
+  for (b = 1; b < num_entries_; b++) {
+    for (i = teeth - 1; (b & (1 << i)) == 0; i--);
+    jacobian_add(*f_, t[b ^ (1 << i)], g[i], t[b]);
+    // a sum of distinct 2^(i d) G below the order is never O
+    if (jacobian_is_zero(*f_, t[b])) {
+      ret = false;
+      goto done;
+    }
+  }
+  if (!jacobian_to_affine_batch(*f_, num_entries_, t, x_, y_)) {
+    ret = false;
+    goto done;
+  }
+  initialized_ = true;
+
+done:
+  delete []g;
+  delete []t;
+  return ret;
+}
+
+bool ecc_comb_table::is_table_for(ecc_curve& c, curve_point& base) {
+  uint64_t x[ecc_field_max_digits];
+  uint64_t y[ecc_field_max_digits];
+  uint64_t b[ecc_field_max_digits];
+
+  if (!initialized_ || ecc_jacobian_field(c) != f_ || !base.z_->is_one())
+    return false;
+  if (!f_->load(*base.x_, x) || !f_->load(*base.y_, y) ||
+      !f_->load(*c.curve_b_, b))
+    return false;
+  return f_->is_equal(x, base_x_) && f_->is_equal(y, base_y_) &&
+         f_->is_equal(b, curve_b_);
+}
+
+// r = kG, k is first reduced mod the order of G.  The complete formulas
+// take the same steps for O and for doubling, and every column adds a
+// point: entry 1 stands in for an empty column and that sum is masked off.
+bool ecc_comb_table::mult(big_num& k, jacobian_point& r) {
+  uint64_t e[ecc_field_max_digits + 1];
+  uint64_t x[ecc_field_max_digits];
+  uint64_t y[ecc_field_max_digits];
+  homogeneous_point h;
+  homogeneous_point s;
+  ecc_field_scratch sc;
+  int n = f_->num_digits_;
+  int i, j, b, pos;
+
+  if (!initialized_)
+    return false;
+  big_num t(k.size_ > n ? k.size_ + 1 : n + 1);
+  t.copy_from(k);
+  if (!big_mod_normalize(t, *order_))
+    return false;
+  digit_array_zero_num(n + 1, e);
+  digit_array_zero_num(n, x);
+  digit_array_zero_num(n, y);
+  if (!digit_array_copy(t.size_, t.value_, n + 1, e))
+    return false;
+
+  homogeneous_make_zero(*f_, h);
+  for (j = spacing_ - 1; j >= 0; j--) {
+    homogeneous_complete_double(*f_, curve_b_, h, h, sc);
+    uint64_t idx = 0ULL;
+    for (i = 0; i < teeth_; i++) {
+      pos = i * spacing_ + j;
+      idx |= ((e[pos / NBITSINUINT64] >> (pos % NBITSINUINT64)) & 1ULL) << i;
+    }
+    uint64_t keep = 0ULL - (uint64_t)(idx != 0ULL);
+    uint64_t sel = idx | (~keep & 1ULL);
+    for (b = 1; b < num_entries_; b++) {
+      uint64_t mask = 0ULL - (uint64_t)((uint64_t)b == sel);
+      for (i = 0; i < n; i++) {
+        x[i] = (x[i] & ~mask) | (x_[b * n + i] & mask);
+        y[i] = (y[i] & ~mask) | (y_[b * n + i] & mask);
+      }
+    }
+    homogeneous_complete_add_affine(*f_, curve_b_, h, x, y, s, sc);
+    for (i = 0; i < n; i++) {
+      h.x_[i] = (h.x_[i] & ~keep) | (s.x_[i] & keep);
+      h.y_[i] = (h.y_[i] & ~keep) | (s.y_[i] & keep);
+      h.z_[i] = (h.z_[i] & ~keep) | (s.z_[i] & keep);
+    }
+  }
+  digit_array_zero_num(n + 1, e);
+
+  // (x, y, z) homogeneous is (xz, yz^2, z) Jacobian, O goes to z = 0
+  f_->copy(h.z_, r.z_);
+  f_->mult(h.x_, h.z_, r.x_);
+  f_->square(h.z_, r.y_);
+  f_->mult(h.y_, r.y_, r.y_);
+  return true;
+}
+
+// The standard key of a NIST curve, if c has the same p, a and b.
+static ecc* standard_key(ecc_curve& c) {
+  static bool curves_ready = init_ecc_curves();
+  uint64_t b1[ecc_field_max_digits];
+  uint64_t b2[ecc_field_max_digits];
+  ecc* key = nullptr;
+
+  ecc_field* f = ecc_jacobian_field(c);
+  if (!curves_ready || f == nullptr)
+    return nullptr;
+  if (c.c_name_ == "P-256")
+    key = &p256_key;
+  else if (c.c_name_ == "P-384")
+    key = &p384_key;
+  else if (c.c_name_ == "P-521")
+    key = &p521_key;
+  if (key == nullptr || key->c_ == nullptr || key->base_point_ == nullptr ||
+      key->order_of_base_point_ == nullptr)
+    return nullptr;
+  if (ecc_jacobian_field(*key->c_) != f)
+    return nullptr;
+  if (!f->load(*c.curve_b_, b1) || !f->load(*key->c_->curve_b_, b2) ||
+      !f->is_equal(b1, b2))
+    return nullptr;
+  return key;
+}
+
+static ecc_comb_table p256_comb;
+static ecc_comb_table p384_comb;
+static ecc_comb_table p521_comb;
+static std::mutex comb_lock;
+
+// The comb for the standard base point of a NIST curve, built on first use.
+static ecc_comb_table* standard_comb_table(ecc_curve& c, curve_point& base) {
+  ecc_comb_table* t = nullptr;
+  ecc* key = standard_key(c);
+
+  if (key == &p256_key)
+    t = &p256_comb;
+  else if (key == &p384_key)
+    t = &p384_comb;
+  else if (key == &p521_key)
+    t = &p521_comb;
+  else
+    return nullptr;
+
+  std::lock_guard<std::mutex> guard(comb_lock);
+  if (!t->initialized_ && !t->init(*key->c_, *key->base_point_,
+                                   *key->order_of_base_point_, ecc_comb_teeth))
+    return nullptr;
+  if (!t->is_table_for(c, base))
+    return nullptr;
+  return t;
+}
+
+// r = x base.  The standard base points of the NIST curves use their
+// comb tables, anything else goes to ecc_mult.
+bool ecc_base_mult(ecc_curve& c, curve_point& base, big_num& x, curve_point& r_pt) {
+  ecc_comb_table* t = standard_comb_table(c, base);
+  if (t == nullptr)
+    return ecc_mult(c, base, x, r_pt);
+
+  jacobian_point r;
+  if (!t->mult(x, r))
+    return false;
+  return jacobian_to_point(*t->f_, r, r_pt);
+}
+
+// Width w NAF of |k|, least significant digit first.  Digits are 0 or
+//   odd with |d| < 2^(w-1), and of any w consecutive digits at most one
+//   is nonzero.  Returns the number of digits or -1 if naf is too short.
+int ecc_wnaf_recode(big_num& k, int w, int size_naf, int* naf) {
+  int n = k.size_ + 1;
+  uint64_t* e = new uint64_t[n];
+  int64_t d;
+  int i, len = 0;
+
+  if (w < 2 || w > 16) {
+    len = -1;
+    goto done;
+  }
+  digit_array_zero_num(n, e);
+  digit_array_copy(k.size_, k.value_, n, e);
+  while (!digit_array_is_zero(n, e)) {
+    if (len >= size_naf) {
+      len = -1;
+      goto done;
+    }
+    d = 0;
+    if ((e[0] & 1ULL) != 0) {
+      d = (int64_t)(e[0] & ((1ULL << w) - 1ULL));
+      if (d >= (1LL << (w - 1)))
+        d -= (1LL << w);
+      // e -= d, which clears the low w bits
+      uint64_t borrow = (uint64_t)d;
+      if (d > 0) {
+        for (i = 0; i < n && borrow != 0ULL; i++) {
+          uint64_t t = e[i];
+          e[i] = t - borrow;
+          borrow = t < borrow ? 1ULL : 0ULL;
+        }
+      } else {
+        uint64_t carry = (uint64_t)(-d);
+        for (i = 0; i < n && carry != 0ULL; i++) {
+          e[i] += carry;
+          carry = e[i] < carry ? 1ULL : 0ULL;
+        }
+      }
+    }
+    naf[len++] = (int)d;
+    for (i = 0; i < n - 1; i++)
+      e[i] = (e[i] >> 1) | (e[i + 1] << (NBITSINUINT64 - 1));
+    e[n - 1] >>= 1;
+  }
+
+done:
+  delete []e;
+  return len;
+}
+
+void jacobian_negate(ecc_field& f, jacobian_point& p, jacobian_point& r) {
+  uint64_t zero[ecc_field_max_digits];
+
+  digit_array_zero_num(f.num_digits_, zero);
+  f.copy(p.x_, r.x_);
+  f.sub(zero, p.y_, r.y_);
+  f.copy(p.z_, r.z_);
+}
+
+// 2^(w-2) odd multiples, 8 points for w = 5
+const int ecc_wnaf_width = 5;
+
+// For each of the n points, entry i of its table is (2i + 1) p,
+// i < 2^(ecc_wnaf_width - 2), in affine form with y and -y.  One batch
+// inversion makes the whole table affine so the main loops can use
+// mixed additions.  Points that are O get entries of 0.
+static bool wnaf_affine_tables(ecc_field& f, int n, jacobian_point* p,
+                               uint64_t* x, uint64_t* y, uint64_t* neg_y) {
+  const int num_odd = 1 << (ecc_wnaf_width - 2);
+  jacobian_point* odd = new jacobian_point[n * num_odd];
+  jacobian_point p2;
+  ecc_field_scratch sc;
+  uint64_t zero[ecc_field_max_digits];
+  int nd = f.num_digits_;
+  int i, j;
+
+  for (j = 0; j < n; j++) {
+    jacobian_point* t = &odd[j * num_odd];
+    jacobian_copy(f, p[j], t[0]);
+    jacobian_double(f, p[j], p2, sc);
+    for (i = 1; i < num_odd; i++)
+      jacobian_add(f, t[i - 1], p2, t[i], sc);
+  }
+  bool ret = jacobian_to_affine_batch(f, n * num_odd, odd, x, y);
+  digit_array_zero_num(nd, zero);
+  for (i = 0; ret && i < n * num_odd; i++)
+    f.sub(zero, &y[i * nd], &neg_y[i * nd]);
+  delete []odd;
+  return ret;
+}
+
+// r = |k| p, variable time
+bool jacobian_wnaf_mult(ecc_field& f, jacobian_point& p, big_num& k,
+                        jacobian_point& r) {
+  const int num_odd = 1 << (ecc_wnaf_width - 2);
+  uint64_t x[num_odd * ecc_field_max_digits];
+  uint64_t y[num_odd * ecc_field_max_digits];
+  uint64_t neg_y[num_odd * ecc_field_max_digits];
+  jacobian_point t;
+  ecc_field_scratch sc;
+  int nd = f.num_digits_;
+  int size_naf = NBITSINUINT64 * k.size_ + 1;
+  int* naf = nullptr;
+  bool ret = true;
+  int i, len;
+
+  if (jacobian_is_zero(f, p)) {
+    jacobian_make_zero(f, r);
+    return true;
+  }
+  naf = new int[size_naf];
+  len = ecc_wnaf_recode(k, ecc_wnaf_width, size_naf, naf);
+  if (len < 0 || !wnaf_affine_tables(f, 1, &p, x, y, neg_y)) {
+    ret = false;
+    goto done;
+  }
+
+  jacobian_make_zero(f, t);
+  for (i = len - 1; i >= 0; i--) {
+    jacobian_double(f, t, t, sc);
+    if (naf[i] > 0) {
+      int e = (naf[i] / 2) * nd;
+      jacobian_add_affine(f, t, &x[e], &y[e], t, sc);
+    } else if (naf[i] < 0) {
+      int e = (-naf[i] / 2) * nd;
+      jacobian_add_affine(f, t, &x[e], &neg_y[e], t, sc);
+    }
+  }
+  jacobian_copy(f, t, r);
+
+done:
+  delete []naf;
+  return ret;
+}
+
+// r = x p, variable time: for public scalars.  Signs as in ecc_mult.
+bool ecc_wnaf_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt) {
+  ecc_field* f = ecc_jacobian_field(c);
+  if (f == nullptr)
+    return ecc_mult(c, p_pt, x, r_pt);
+
+  jacobian_point p;
+  jacobian_point r;
+  big_num k(x.size_ + 1);
+  k.copy_from(x);
+  if (k.is_negative())
+    k.toggle_sign();
+  if (!jacobian_from_point(*f, p_pt, p))
+    return false;
+  if (!jacobian_wnaf_mult(*f, p, k, r))
+    return false;
+  if (!jacobian_to_point(*f, r, r_pt))
+    return false;
+  if (x.is_negative())
+    r_pt.y_->toggle_sign();
+  return true;
+}
+
+//  Co-Z arithmetic (Meloni; Goundar, Joye and Miyaji).  Both points share
+//  z, which is updated in place; each step costs 5M + 3S or 4M + 2S plus
+//  the multiplication that keeps z.
+
+// (p, q) -> (p', p + q), p' is p with the new z
+static void coz_add(ecc_field& f, uint64_t* x1, uint64_t* y1, uint64_t* x2,
+                    uint64_t* y2, uint64_t* z) {
+  uint64_t a[ecc_field_max_digits];
+  uint64_t b[ecc_field_max_digits];
+  uint64_t c[ecc_field_max_digits];
+  uint64_t d[ecc_field_max_digits];
+  uint64_t e[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+
+  f.sub(x2, x1, t);
+  f.mult(z, t, z);
+  f.square(t, a);
+  f.mult(x1, a, b);
+  f.mult(x2, a, c);
+  f.sub(y2, y1, t);
+  f.square(t, d);
+  f.sub(c, b, e);
+  f.mult(y1, e, e);
+
+  // x3 = d - b - c, y3 = (y2 - y1)(b - x3) - e
+  f.sub(d, b, d);
+  f.sub(d, c, x2);
+  f.sub(b, x2, c);
+  f.mult(t, c, c);
+  f.sub(c, e, y2);
+  f.copy(b, x1);
+  f.copy(e, y1);
+}
+
+// (p, q) -> (p - q, p + q)
+static void coz_add_conj(ecc_field& f, uint64_t* x1, uint64_t* y1, uint64_t* x2,
+                         uint64_t* y2, uint64_t* z) {
+  uint64_t c[ecc_field_max_digits];
+  uint64_t w1[ecc_field_max_digits];
+  uint64_t w2[ecc_field_max_digits];
+  uint64_t a1[ecc_field_max_digits];
+  uint64_t s[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+  uint64_t u[ecc_field_max_digits];
+
+  f.sub(x1, x2, t);
+  f.mult(z, t, z);
+  f.square(t, c);
+  f.mult(x1, c, w1);
+  f.mult(x2, c, w2);
+  f.sub(w1, w2, t);
+  f.mult(y1, t, a1);
+
+  // p + q: x = (y1 - y2)^2 - w1 - w2, y = (y1 - y2)(w1 - x) - a1
+  f.sub(y1, y2, s);
+  f.square(s, t);
+  f.sub(t, w1, t);
+  f.sub(t, w2, t);
+  f.sub(w1, t, u);
+  f.mult(s, u, u);
+  f.sub(u, a1, u);
+
+  // p - q, the same with -y2
+  f.add(y1, y2, s);
+  f.copy(t, x2);
+  f.copy(u, y2);
+  f.square(s, t);
+  f.sub(t, w1, t);
+  f.sub(t, w2, x1);
+  f.sub(w1, x1, u);
+  f.mult(s, u, u);
+  f.sub(u, a1, y1);
+}
+
+static void cond_swap(int n, uint64_t swap, uint64_t* a, uint64_t* b) {
+  uint64_t mask = 0ULL - swap;
+  for (int i = 0; i < n; i++) {
+    uint64_t t = (a[i] ^ b[i]) & mask;
+    a[i] ^= t;
+    b[i] ^= t;
+  }
+}
+
+// r = a + b on n digits, no early exit on the carry
+static void fixed_add(int n, uint64_t* a, uint64_t* b, uint64_t* r) {
+  unsigned __int128 t;
+  uint64_t carry = 0ULL;
+
+  for (int i = 0; i < n; i++) {
+    t = (unsigned __int128)a[i] + b[i] + carry;
+    r[i] = (uint64_t)t;
+    carry = (uint64_t)(t >> 64);
+  }
+}
+
+// r = x p with the co-Z Montgomery ladder.  The scalar is reduced mod
+// the group order n and n or 2n is added so it always has bits(n) + 1
+// bits; every bit then costs the same, and the two points are swapped
+// with masks rather than branches.  For secret scalars.
+bool ecc_ladder_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt) {
+  uint64_t x0[ecc_field_max_digits];
+  uint64_t y0[ecc_field_max_digits];
+  uint64_t x1[ecc_field_max_digits];
+  uint64_t y1[ecc_field_max_digits];
+  uint64_t z[ecc_field_max_digits];
+  uint64_t s[ecc_field_max_digits];
+  uint64_t m[ecc_field_max_digits];
+  uint64_t t[ecc_field_max_digits];
+  uint64_t e[ecc_field_max_digits + 1];
+  uint64_t e1[ecc_field_max_digits + 1];
+  uint64_t e2[ecc_field_max_digits + 1];
+
+  ecc* key = standard_key(c);
+  if (key == nullptr)
+    return ecc_mult(c, p_pt, x, r_pt);
+  ecc_field& f = *ecc_jacobian_field(c);
+  big_num& order = *key->order_of_base_point_;
+  int n = f.num_digits_;
+  int nb = big_high_bit(order);
+  int i;
+
+  if (p_pt.z_->is_zero()) {
+    r_pt.make_zero();
+    return true;
+  }
+  jacobian_point p;
+  if (!jacobian_from_point(f, p_pt, p) || !jacobian_to_affine(f, p, x1, y1))
+    return false;
+  if (f.is_zero(y1))
+    return ecc_mult(c, p_pt, x, r_pt);
+
+  // e = (x mod n) + n or + 2n, whichever has bit nb set
+  big_num k(x.size_ > n ? x.size_ + 1 : n + 1);
+  k.copy_from(x);
+  if (!big_mod_normalize(k, order))
+    return false;
+  // The ladder passes through n p = O for k = 0, 1, -2 and -1 (mod n),
+  // none of them a usable secret, so they are done directly.
+  if (k.is_zero()) {
+    r_pt.make_zero();
+    return true;
+  }
+  big_num minus_k(n + 1);
+  if (!big_sub(order, k, minus_k))
+    return false;
+  if (k.is_one() || minus_k.is_one() || big_compare(minus_k, big_two) == 0) {
+    if (big_compare(minus_k, big_two) == 0)
+      jacobian_double(f, p, p);
+    if (!k.is_one())
+      jacobian_negate(f, p, p);
+    return jacobian_to_point(f, p, r_pt);
+  }
+  digit_array_zero_num(n + 1, e);
+  digit_array_zero_num(n + 1, e1);
+  digit_array_zero_num(n + 1, e2);
+  digit_array_copy(k.size_, k.value_, n + 1, e);
+  digit_array_copy(order.size_, order.value_, n + 1, e2);
+  fixed_add(n + 1, e, e2, e1);
+  fixed_add(n + 1, e1, e2, e2);
+  uint64_t use_e1 = (e1[nb / NBITSINUINT64] >> (nb % NBITSINUINT64)) & 1ULL;
+  cond_swap(n + 1, use_e1, e1, e2);
+
+  // (r0, r1) = (p, 2p) with z = 2y
+  f.add(y1, y1, z);
+  f.square(x1, t);
+  f.add(t, t, m);
+  f.add(m, t, m);
+  digit_array_zero_num(n, t);
+  t[0] = 3ULL;
+  f.sub(m, t, m);
+  f.square(y1, t);
+  f.mult(x1, t, s);
+  f.add(s, s, s);
+  f.add(s, s, s);
+  f.square(t, t);
+  f.add(t, t, t);
+  f.add(t, t, t);
+  f.add(t, t, y0);
+  f.copy(s, x0);
+  f.square(m, x1);
+  f.sub(x1, s, x1);
+  f.sub(x1, s, x1);
+  f.sub(s, x1, t);
+  f.mult(m, t, t);
+  f.sub(t, y0, y1);
+
+  uint64_t swapped = 0ULL;
+  for (i = nb - 1; i >= 0; i--) {
+    uint64_t bit = (e2[i / NBITSINUINT64] >> (i % NBITSINUINT64)) & 1ULL;
+    cond_swap(n, swapped ^ bit, x0, x1);
+    cond_swap(n, swapped ^ bit, y0, y1);
+    swapped = bit;
+    // (r_b, r_1-b) = (2 r_b, r_b + r_1-b)
+    coz_add_conj(f, x0, y0, x1, y1, z);
+    coz_add(f, x1, y1, x0, y0, z);
+  }
+  cond_swap(n, swapped, x0, x1);
+  cond_swap(n, swapped, y0, y1);
+
+  f.copy(x0, p.x_);
+  f.copy(y0, p.y_);
+  f.copy(z, p.z_);
+  digit_array_zero_num(n + 1, e);
+  digit_array_zero_num(n + 1, e1);
+  digit_array_zero_num(n + 1, e2);
+  return jacobian_to_point(f, p, r_pt);
+}
+
+//  Multi-scalar multiplication, r = sum k_i p_i
+//    Straus: one doubling chain shared by all the points, each adding
+//    its own wNAF digits from a table of odd multiples.  Pippenger: the
+//    scalars are cut into c bit signed windows; for each window every
+//    point goes into the bucket of its digit and the buckets are summed
+//    as sum_b b B_b with two running sums.  Straus costs about
+//    n (bits / (w + 1) + 2^(w - 2)) additions, Pippenger
+//    (bits / c)(n + 2^c), so Pippenger wins once n is in the hundreds.
+
+static int straus_cost(int n, int bits) {
+  return n * (bits / (ecc_wnaf_width + 1) + (1 << (ecc_wnaf_width - 2)));
+}
+
+static int pippenger_window(int n, int bits, int* cost) {
+  int best = 1;
+  int best_cost = -1;
+  for (int c = 2; c <= 16; c++) {
+    int cst = ((bits + c) / c) * (n + (1 << c));
+    if (best_cost < 0 || cst < best_cost) {
+      best = c;
+      best_cost = cst;
+    }
+  }
+  *cost = best_cost;
+  return best;
+}
+
+static bool straus_mult(ecc_field& f, int n, big_num** k, jacobian_point* p,
+                        jacobian_point& r) {
+  const int num_odd = 1 << (ecc_wnaf_width - 2);
+  int nd = f.num_digits_;
+  uint64_t* x = new uint64_t[n * num_odd * nd];
+  uint64_t* y = new uint64_t[n * num_odd * nd];
+  uint64_t* neg_y = new uint64_t[n * num_odd * nd];
+  int** naf = new int*[n];
+  int* len = new int[n];
+  ecc_field_scratch sc;
+  bool ret = true;
+  int i, j, max_len = 0;
+
+  for (i = 0; i < n; i++)
+    naf[i] = nullptr;
+  for (i = 0; i < n; i++) {
+    int size_naf = NBITSINUINT64 * k[i]->size_ + 1;
+    naf[i] = new int[size_naf];
+    len[i] = ecc_wnaf_recode(*k[i], ecc_wnaf_width, size_naf, naf[i]);
+    if (len[i] < 0) {
+      ret = false;
+      goto done;
+    }
+    if (jacobian_is_zero(f, p[i]))
+      len[i] = 0;
+    if (len[i] > max_len)
+      max_len = len[i];
+  }
+  if (!wnaf_affine_tables(f, n, p, x, y, neg_y)) {
+    ret = false;
+    goto done;
+  }
+
+  jacobian_make_zero(f, r);
+  for (j = max_len - 1; j >= 0; j--) {
+    jacobian_double(f, r, r, sc);
+    for (i = 0; i < n; i++) {
+      if (j >= len[i] || naf[i][j] == 0)
+        continue;
+      int d = naf[i][j];
+      if (d > 0) {
+        int e = (i * num_odd + d / 2) * nd;
+        jacobian_add_affine(f, r, &x[e], &y[e], r, sc);
+      } else {
+        int e = (i * num_odd + (-d) / 2) * nd;
+        jacobian_add_affine(f, r, &x[e], &neg_y[e], r, sc);
+      }
+    }
+  }
+
+done:
+  for (i = 0; i < n; i++) {
+    if (naf[i] != nullptr)
+      delete []naf[i];
+  }
+  delete []naf;
+  delete []len;
+  delete []x;
+  delete []y;
+  delete []neg_y;
+  return ret;
+}
+
+// c bits of e starting at bit pos
+static int window_bits(int size_e, uint64_t* e, int pos, int c) {
+  int i = pos / NBITSINUINT64;
+  int s = pos % NBITSINUINT64;
+  if (i >= size_e)
+    return 0;
+  uint64_t w = e[i] >> s;
+  if (s + c > NBITSINUINT64 && i + 1 < size_e)
+    w |= e[i + 1] << (NBITSINUINT64 - s);
+  return (int)(w & ((1ULL << c) - 1ULL));
+}
+
+static bool pippenger_mult(ecc_field& f, int n, big_num** k, jacobian_point* p,
+                           int bits, int c, jacobian_point& r) {
+  // one window past the top of the scalar takes the last carry
+  int num_windows = (bits + c - 1) / c + 1;
+  int num_buckets = 1 << (c - 1);
+  int nd = f.num_digits_;
+  int* digits = new int[n * num_windows];
+  uint64_t* x = new uint64_t[n * nd];
+  uint64_t* y = new uint64_t[n * nd];
+  bool* live = new bool[n];
+  jacobian_point* bucket = new jacobian_point[num_buckets + 1];
+  jacobian_point sum;
+  jacobian_point total;
+  ecc_field_scratch sc;
+  bool ret = true;
+  int i, j, b;
+
+  // signed digits in [-2^(c-1), 2^(c-1)), the carry goes up a window
+  for (i = 0; i < n; i++) {
+    int carry = 0;
+    for (j = 0; j < num_windows; j++) {
+      int d = window_bits(k[i]->size_, k[i]->value_, j * c, c) + carry;
+      carry = 0;
+      if (d >= num_buckets) {
+        d -= 2 * num_buckets;
+        carry = 1;
+      }
+      digits[i * num_windows + j] = d;
+    }
+    if (carry != 0) {
+      ret = false;
+      goto done;
+    }
+    live[i] = !jacobian_is_zero(f, p[i]);
+  }
+  // buckets take mixed additions of the affine points
+  if (!jacobian_to_affine_batch(f, n, p, x, y)) {
+    ret = false;
+    goto done;
+  }
+
+  jacobian_make_zero(f, r);
+  for (j = num_windows - 1; j >= 0; j--) {
+    for (i = 0; i < c; i++)
+      jacobian_double(f, r, r, sc);
+    for (b = 1; b <= num_buckets; b++)
+      jacobian_make_zero(f, bucket[b]);
+    for (i = 0; i < n; i++) {
+      int d = digits[i * num_windows + j];
+      if (d == 0 || !live[i])
+        continue;
+      if (d > 0) {
+        jacobian_add_affine(f, bucket[d], &x[i * nd], &y[i * nd], bucket[d], sc);
+      } else {
+        uint64_t ny[ecc_field_max_digits];
+        uint64_t zero[ecc_field_max_digits];
+        digit_array_zero_num(nd, zero);
+        f.sub(zero, &y[i * nd], ny);
+        jacobian_add_affine(f, bucket[-d], &x[i * nd], ny, bucket[-d], sc);
+      }
+    }
+    // sum_b b bucket[b]
+    jacobian_make_zero(f, sum);
+    jacobian_make_zero(f, total);
+    for (b = num_buckets; b >= 1; b--) {
+      jacobian_add(f, sum, bucket[b], sum, sc);
+      jacobian_add(f, total, sum, total, sc);
+    }
+    jacobian_add(f, r, total, r, sc);
+  }
+
+done:
+  delete []digits;
+  delete []x;
+  delete []y;
+  delete []live;
+  delete []bucket;
+  return ret;
+}
+
+// r = sum scalars[i] points[i], variable time: for public scalars such as
+// those of signature verification.
+bool ecc_multi_mult(ecc_curve& c, int n, big_num** scalars, curve_point** points,
+                    curve_point& r_pt) {
+  ecc_field* f = ecc_jacobian_field(c);
+  int i;
+
+  if (n <= 0) {
+    r_pt.make_zero();
+    return true;
+  }
+  if (f == nullptr) {
+    int cap = 1 + 2 * c.curve_p_->capacity_;
+    curve_point t(cap);
+    curve_point s(cap);
+
+    r_pt.make_zero();
+    for (i = 0; i < n; i++) {
+      if (!ecc_mult(c, *points[i], *scalars[i], t))
+        return false;
+      if (!ecc_add(c, r_pt, t, s))
+        return false;
+      r_pt.copy_from(s);
+    }
+    return true;
+  }
+
+  // |k_i| and, for negative k_i, -p_i
+  jacobian_point* p = new jacobian_point[n];
+  big_num** k = new big_num*[n];
+  jacobian_point r;
+  bool ret = true;
+  int bits = 1;
+  int s_cost, p_cost, window;
+
+  for (i = 0; i < n; i++)
+    k[i] = nullptr;
+  for (i = 0; i < n; i++) {
+    k[i] = new big_num(scalars[i]->size_ + 1);
+    k[i]->copy_from(*scalars[i]);
+    if (!jacobian_from_point(*f, *points[i], p[i])) {
+      ret = false;
+      goto done;
+    }
+    if (k[i]->is_negative()) {
+      k[i]->toggle_sign();
+      jacobian_negate(*f, p[i], p[i]);
+    }
+    if (!k[i]->is_zero() && big_high_bit(*k[i]) > bits)
+      bits = big_high_bit(*k[i]);
+  }
+
+  s_cost = straus_cost(n, bits);
+  window = pippenger_window(n, bits, &p_cost);
+  if (p_cost < s_cost)
+    ret = pippenger_mult(*f, n, k, p, bits, window, r);
+  else
+    ret = straus_mult(*f, n, k, p, r);
+  if (ret)
+    ret = jacobian_to_point(*f, r, r_pt);
+
+done:
+  for (i = 0; i < n; i++) {
+    if (k[i] != nullptr)
+      delete k[i];
+  }
+  delete []k;
+  delete []p;
+  return ret;
+}
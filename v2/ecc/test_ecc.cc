@@ -22,6 +22,7 @@
 #include "big_num_functions.h"
 #include "ecc.h"
 #include "ecc_curve_data.h"
+#include "curve25519.h"
 
 
 bool check_big_mod_prod(big_num& a, big_num& b, big_num& m, big_num& c) {
@@ -358,6 +359,875 @@ bool test_ecc_projective() {
   return true;
 }
 
+// a and b are the same point, whatever their projective representation
+static bool same_point(ecc_curve& c, curve_point& a, curve_point& b) {
+  int cap = 1 + 2 * c.curve_p_->capacity_;
+  curve_point s(a, cap);
+  curve_point t(b, cap);
+
+  if (!projective_to_affine(c, s) || !projective_to_affine(c, t))
+    return false;
+  return s.is_equal(t);
+}
+
+// The NIST field backends against big_mod_mult and the generic point
+// formulas, which a curve gets when it is not called P-256, ...
+bool test_ecc_field() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    ecc_curve& c = *keys[i]->c_;
+    ecc_field* f = ecc_field_for_curve(c);
+    if (f == nullptr) {
+      printf("no field for %s\n", c.c_name_.c_str());
+      return false;
+    }
+    int n = f->num_digits_;
+    big_num a(2 * n + 1);
+    big_num b(2 * n + 1);
+    big_num r(2 * n + 1);
+    big_num s(2 * n + 1);
+    uint64_t fa[ecc_field_max_digits];
+    uint64_t fb[ecc_field_max_digits];
+    uint64_t fr[ecc_field_max_digits];
+
+    for (int j = 0; j < 200; j++) {
+      a.zero_num();
+      b.zero_num();
+      if (j == 0) {
+        big_sub(*c.curve_p_, big_one, a);
+        big_sub(*c.curve_p_, big_one, b);
+      } else {
+        if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)a.value_) < 0 ||
+            crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)b.value_) < 0)
+          return false;
+        a.normalize();
+        b.normalize();
+        if (j == 1)
+          b.zero_num();
+      }
+      if (!f->load(a, fa) || !f->load(b, fb))
+        return false;
+      if (!big_mod_normalize(a, *c.curve_p_) || !big_mod_normalize(b, *c.curve_p_))
+        return false;
+
+      f->mult(fa, fb, fr);
+      r.zero_num();
+      s.zero_num();
+      if (!big_mod_mult(a, b, *c.curve_p_, r) || !f->store(fr, s))
+        return false;
+      if (big_compare(r, s) != 0) {
+        printf("%s mult failed\n", c.c_name_.c_str());
+        return false;
+      }
+      f->square(fa, fr);
+      r.zero_num();
+      if (!big_mod_mult(a, a, *c.curve_p_, r) || !f->store(fr, s))
+        return false;
+      if (big_compare(r, s) != 0) {
+        printf("%s square failed\n", c.c_name_.c_str());
+        return false;
+      }
+      f->add(fa, fb, fr);
+      r.zero_num();
+      if (!big_mod_add(a, b, *c.curve_p_, r) || !f->store(fr, s))
+        return false;
+      if (big_compare(r, s) != 0) {
+        printf("%s add failed\n", c.c_name_.c_str());
+        return false;
+      }
+      f->sub(fa, fb, fr);
+      r.zero_num();
+      if (!big_mod_sub(a, b, *c.curve_p_, r) || !f->store(fr, s))
+        return false;
+      if (big_compare(r, s) != 0) {
+        printf("%s sub failed\n", c.c_name_.c_str());
+        return false;
+      }
+    }
+
+    // point formulas
+    int cap = 1 + 2 * c.curve_p_->capacity_;
+    ecc_curve generic(cap);
+    generic.copy_from(c);
+    generic.c_name_.assign("generic");
+    if (ecc_field_for_curve(generic) != nullptr)
+      return false;
+
+    curve_point g(*keys[i]->base_point_, cap);
+    curve_point p1(cap);
+    curve_point p2(cap);
+    curve_point q1(cap);
+    curve_point q2(cap);
+    // the complete formulas pick other projective representatives
+    if (!projective_double(c, g, p1) || !projective_double(generic, g, p2))
+      return false;
+    if (!same_point(c, p1, p2)) {
+      printf("%s projective_double failed\n", c.c_name_.c_str());
+      return false;
+    }
+    if (!projective_add(c, p1, g, q1) || !projective_add(generic, p2, g, q2))
+      return false;
+    if (!same_point(c, q1, q2)) {
+      printf("%s projective_add failed\n", c.c_name_.c_str());
+      return false;
+    }
+    if (!projective_to_affine(c, q1) || !projective_to_affine(generic, q2))
+      return false;
+    if (!q1.is_equal(q2) || !ecc_is_on_curve(c, q1))
+      return false;
+
+    // p + p, p + (-p) and O + p need no special cases
+    curve_point r1(cap);
+    curve_point r2(cap);
+    curve_point o(cap);
+    o.make_zero();
+    if (!projective_add(c, g, g, r1) || !projective_double(c, g, r2) ||
+        !same_point(c, r1, r2)) {
+      printf("%s projective_add (p + p) failed\n", c.c_name_.c_str());
+      return false;
+    }
+    curve_point minus_g(g, cap);
+    if (!big_sub(*c.curve_p_, *g.y_, *minus_g.y_))
+      return false;
+    if (!projective_add(c, g, minus_g, r1) || !projective_to_affine(c, r1) ||
+        !r1.is_zero()) {
+      printf("%s projective_add (p - p) failed\n", c.c_name_.c_str());
+      return false;
+    }
+    if (!projective_add(c, o, g, r1) || !same_point(c, r1, g) ||
+        !projective_double(c, o, r1) || !projective_to_affine(c, r1) ||
+        !r1.is_zero()) {
+      printf("%s projective_add (O) failed\n", c.c_name_.c_str());
+      return false;
+    }
+    if (!ecc_add(c, q1, g, p1) || !ecc_add(generic, q2, g, p2))
+      return false;
+    if (!p1.is_equal(p2)) {
+      printf("%s ecc_add failed\n", c.c_name_.c_str());
+      return false;
+    }
+    if (!ecc_add(c, g, g, p1) || !ecc_double(generic, g, p2) || !p1.is_equal(p2)) {
+      printf("%s ecc_add (double) failed\n", c.c_name_.c_str());
+      return false;
+    }
+
+    big_num k(n);
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)k.value_) < 0)
+      return false;
+    k.normalize();
+    if (!big_mod_normalize(k, *keys[i]->order_of_base_point_))
+      return false;
+    if (!ecc_mult(c, g, k, p1) || !ecc_mult(generic, g, k, p2))
+      return false;
+    if (!p1.is_equal(p2) || !ecc_is_on_curve(c, p1)) {
+      printf("%s ecc_mult failed\n", c.c_name_.c_str());
+      return false;
+    }
+    // n G = O
+    if (!faster_ecc_mult(c, g, *keys[i]->order_of_base_point_, p1) || !p1.is_zero()) {
+      printf("%s order check failed\n", c.c_name_.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+// ecc_base_mult, comb tables on the standard base points, against ecc_mult
+bool test_ecc_base_mult() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    ecc_curve& c = *keys[i]->c_;
+    big_num& order = *keys[i]->order_of_base_point_;
+    int n = c.curve_p_->capacity_;
+    int cap = 1 + 2 * n;
+    curve_point g(*keys[i]->base_point_, cap);
+    curve_point p1(cap);
+    curve_point p2(cap);
+    big_num k(n + 1);
+
+    for (int j = 0; j < 24; j++) {
+      k.zero_num();
+      if (j == 0) {
+        k.copy_from(big_zero);
+      } else if (j == 1) {
+        k.copy_from(big_one);
+      } else if (j == 2) {
+        big_sub(order, big_one, k);
+      } else if (j == 3) {
+        k.copy_from(order);
+      } else if (j == 4) {
+        // wider than the order
+        big_add(order, big_five, k);
+      } else {
+        if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)k.value_) < 0)
+          return false;
+        k.normalize();
+        if (!big_mod_normalize(k, order))
+          return false;
+      }
+      if (!ecc_base_mult(c, g, k, p1) || !ecc_mult(c, g, k, p2))
+        return false;
+      if (j == 3) {
+        if (!p1.is_zero()) {
+          printf("%s ecc_base_mult(order) is not O\n", c.c_name_.c_str());
+          return false;
+        }
+        continue;
+      }
+      if (j == 4) {
+        big_num five(1, 5ULL);
+        if (!ecc_mult(c, g, five, p2))
+          return false;
+      }
+      if (!p1.is_equal(p2) || (!p1.is_zero() && !ecc_is_on_curve(c, p1))) {
+        printf("%s ecc_base_mult failed, ", c.c_name_.c_str());
+        k.print();
+        printf("\n");
+        return false;
+      }
+    }
+
+    // any other base falls back to ecc_mult
+    curve_point h(cap);
+    big_num three(1, 3ULL);
+    if (!ecc_mult(c, g, big_two, h))
+      return false;
+    if (!ecc_base_mult(c, h, three, p1) || !ecc_mult(c, h, three, p2) ||
+        !p1.is_equal(p2))
+      return false;
+  }
+  return true;
+}
+
+// ecc_wnaf_mult and ecc_ladder_mult against the generic ecc_mult
+bool test_ecc_var_mult() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    ecc_curve& c = *keys[i]->c_;
+    big_num& order = *keys[i]->order_of_base_point_;
+    int n = c.curve_p_->capacity_;
+    int cap = 1 + 2 * n;
+    ecc_curve generic(cap);
+    generic.copy_from(c);
+    generic.c_name_.assign("generic");
+
+    curve_point g(*keys[i]->base_point_, cap);
+    curve_point p(cap);
+    curve_point p1(cap);
+    curve_point p2(cap);
+    curve_point p3(cap);
+    big_num j(n + 1);
+    big_num k(2 * n + 1);
+
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)j.value_) < 0)
+      return false;
+    j.normalize();
+    if (!big_mod_normalize(j, order) || !ecc_base_mult(c, g, j, p))
+      return false;
+
+    for (int l = 0; l < 8; l++) {
+      k.zero_num();
+      if (l == 0) {
+        k.copy_from(big_one);
+      } else if (l == 1) {
+        k.copy_from(big_two);
+      } else if (l == 2) {
+        big_sub(order, big_one, k);
+      } else if (l == 3) {
+        k.copy_from(order);
+      } else if (l == 5) {
+        big_sub(order, big_two, k);
+      } else {
+        // l == 4 is wider than the order
+        int m = l == 4 ? n + 1 : n;
+        if (crypto_get_random_bytes(m * sizeof(uint64_t), (byte_t*)k.value_) < 0)
+          return false;
+        k.normalize();
+        if (l > 4 && !big_mod_normalize(k, order))
+          return false;
+      }
+      if (!ecc_mult(generic, p, k, p1))
+        return false;
+      if (!ecc_wnaf_mult(c, p, k, p2) || !p1.is_equal(p2)) {
+        printf("%s ecc_wnaf_mult failed, ", c.c_name_.c_str());
+        k.print();
+        printf("\n");
+        return false;
+      }
+      if (!ecc_ladder_mult(c, p, k, p3) || !p1.is_equal(p3)) {
+        printf("%s ecc_ladder_mult failed, ", c.c_name_.c_str());
+        k.print();
+        printf("\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// sum k_i (j_i G) against (sum k_i j_i mod n) G
+static bool check_multi_mult(ecc* key, int num, bool negate) {
+  ecc_curve& c = *key->c_;
+  big_num& order = *key->order_of_base_point_;
+  int n = c.curve_p_->capacity_;
+  int cap = 1 + 2 * n;
+  curve_point g(*key->base_point_, cap);
+  curve_point r1(cap);
+  curve_point r2(cap);
+  big_num** k = new big_num*[num];
+  curve_point** p = new curve_point*[num];
+  big_num j(n + 1);
+  big_num sum(2 * n + 2);
+  bool ret = true;
+  int i;
+
+  for (i = 0; i < num; i++) {
+    k[i] = new big_num(n + 1);
+    p[i] = new curve_point(cap);
+  }
+  for (i = 0; i < num; i++) {
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)j.value_) < 0 ||
+        crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)k[i]->value_) < 0) {
+      ret = false;
+      goto done;
+    }
+    j.normalize();
+    k[i]->normalize();
+    if (!big_mod_normalize(j, order) || !ecc_base_mult(c, g, j, *p[i])) {
+      ret = false;
+      goto done;
+    }
+    if (negate && (i % 2) == 1)
+      k[i]->toggle_sign();
+    // big_mult only ever sets the sign of its result
+    big_num t(2 * n + 2);
+    big_num s(2 * n + 2);
+    if (!big_mult(*k[i], j, t) || !big_add(sum, t, s)) {
+      ret = false;
+      goto done;
+    }
+    sum.copy_from(s);
+    if (!big_mod_normalize(sum, order)) {
+      ret = false;
+      goto done;
+    }
+  }
+  if (!ecc_multi_mult(c, num, k, p, r1) || !ecc_base_mult(c, g, sum, r2) ||
+      !r1.is_equal(r2)) {
+    printf("%s ecc_multi_mult failed, n = %d\n", c.c_name_.c_str(), num);
+    ret = false;
+  }
+
+done:
+  for (i = 0; i < num; i++) {
+    delete k[i];
+    delete p[i];
+  }
+  delete []k;
+  delete []p;
+  return ret;
+}
+
+bool test_ecc_multi_mult() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    if (!check_multi_mult(keys[i], 1, false) || !check_multi_mult(keys[i], 2, false) ||
+        !check_multi_mult(keys[i], 5, true))
+      return false;
+  }
+  // enough points for the Pippenger buckets, with windows that do and do
+  // not divide the scalar size
+  if (!check_multi_mult(&p256_key, 800, true) ||
+      !check_multi_mult(&p384_key, 500, true) ||
+      !check_multi_mult(&p521_key, 3000, true))
+    return false;
+  return true;
+}
+
+// projective_to_affine_batch against projective_to_affine one point at a
+// time, with O and a point already affine in the list
+static bool check_batch_affine(ecc_curve& c, curve_point& g) {
+  const int num = 6;
+  int cap = 1 + 2 * c.curve_p_->capacity_;
+  curve_point* p[num];
+  curve_point* q[num];
+  big_num k(1);
+  bool ret = true;
+  int i;
+
+  for (i = 0; i < num; i++) {
+    p[i] = new curve_point(cap);
+    q[i] = new curve_point(cap);
+  }
+  for (i = 0; i < num; i++) {
+    if (i == 1) {
+      p[i]->make_zero();
+    } else if (i == 3) {
+      p[i]->copy_from(g);
+    } else {
+      k.value_[0] = 2 + 3 * i;
+      k.normalize();
+      if (!projective_point_mult(c, k, g, *p[i])) {
+        ret = false;
+        goto done;
+      }
+    }
+    q[i]->copy_from(*p[i]);
+    if (!projective_to_affine(c, *q[i])) {
+      ret = false;
+      goto done;
+    }
+  }
+  if (!projective_to_affine_batch(c, num, p)) {
+    ret = false;
+    goto done;
+  }
+  for (i = 0; i < num; i++) {
+    if (!p[i]->is_equal(*q[i])) {
+      printf("projective_to_affine_batch failed, point %d\n", i);
+      ret = false;
+    }
+  }
+
+done:
+  for (i = 0; i < num; i++) {
+    delete p[i];
+    delete q[i];
+  }
+  return ret;
+}
+
+bool test_ecc_batch_affine() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    if (!check_batch_affine(*keys[i]->c_, *keys[i]->base_point_))
+      return false;
+  }
+
+  // a prime p so every z is invertible
+  ecc_curve c1(1);
+  curve_point g(1);
+  c1.curve_p_->value_[0] = 2777;
+  c1.curve_a_->value_[0] = 4;
+  c1.curve_b_->value_[0] = 4;
+  c1.curve_p_->normalize();
+  c1.curve_a_->normalize();
+  c1.curve_b_->normalize();
+  g.x_->value_[0] = 1;
+  g.y_->value_[0] = 3;
+  g.z_->value_[0] = 1;
+  g.x_->normalize();
+  g.y_->normalize();
+  g.z_->normalize();
+  return check_batch_affine(c1, g);
+}
+
+// RFC 6979, A.2.5 and A.2.6: P-256 and P-384, SHA-256, message "sample"
+byte_t ecdsa_sample_digest[32] = {
+  0xaf, 0x2b, 0xdb, 0xe1, 0xaa, 0x9b, 0x6e, 0xc1, 0xe2, 0xad, 0xe1, 0xd6,
+  0x94, 0xf4, 0x1f, 0xc7, 0x1a, 0x83, 0x1d, 0x02, 0x68, 0xe9, 0x89, 0x15,
+  0x62, 0x11, 0x3d, 0x8a, 0x62, 0xad, 0xd1, 0xbf,
+};
+const char* ecdsa_p256_x =
+  "c9afa9d845ba75166b5c215767b1d6934e50c3db36e89b127b8a622b120f6721";
+const char* ecdsa_p256_r =
+  "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716";
+const char* ecdsa_p256_s =
+  "f7cb1c942d657c41d436c7a1b6e29f65f3e900dbb9aff4064dc4ab2f843acda8";
+const char* ecdsa_p384_x =
+  "6b9d3dad2e1b8c1c05b19875b6659f4de23c3b667bf297ba9aa47740787137d8"
+  "96d5724e4c70a825f872c9ea60d2edf5";
+const char* ecdsa_p384_r =
+  "21b13d1e013c7fa1392d03c5f99af8b30c570c6f98d4ea8e354b63a21d3daa33"
+  "bde1e888e63355d92fa2b3c36d8fb2cd";
+const char* ecdsa_p384_s =
+  "f3aa443fb107745bf4bd77cb3891674632068a10ca67e3d45db2266fa7d1feeb"
+  "efdc63eccd1ac42ec0cb8668a4fa0ab0";
+
+// sign and verify with the secret x (hex, or random if null), and check
+// (r, s) against the expected values if given
+static bool check_ecdsa(ecc* std_key, const char* x_hex, const char* r_hex,
+                        const char* s_hex) {
+  big_num& n = *std_key->order_of_base_point_;
+  int cap = 2 * n.size_ + 2;
+  big_num x(n.size_ + 1);
+  big_num r(cap);
+  big_num s(cap);
+  big_num r2(cap);
+  big_num s2(cap);
+  byte_t digest[32];
+  string sig;
+  ecc key;
+
+  if (x_hex != nullptr) {
+    big_num* t = big_convert_from_hex(x_hex);
+    if (t == nullptr)
+      return false;
+    x.copy_from(*t);
+    delete t;
+  } else {
+    if (crypto_get_random_bytes(n.size_ * sizeof(uint64_t), (byte_t*)x.value_) < 0)
+      return false;
+    x.normalize();
+    if (!big_mod_normalize(x, n))
+      return false;
+  }
+  if (!key.generate_ecc_from_parameters("ecdsa-test", "signing", (char*)"",
+          (char*)"", seconds_in_common_year, *std_key->c_, *std_key->base_point_,
+          n, x))
+    return false;
+
+  memcpy(digest, ecdsa_sample_digest, sizeof(digest));
+  if (!key.sign(sizeof(digest), digest, r, s))
+    return false;
+  if (r_hex != nullptr) {
+    big_num* r_exp = big_convert_from_hex(r_hex);
+    big_num* s_exp = big_convert_from_hex(s_hex);
+    bool same = r_exp != nullptr && s_exp != nullptr &&
+                big_compare(r, *r_exp) == 0 && big_compare(s, *s_exp) == 0;
+    delete r_exp;
+    delete s_exp;
+    if (!same) {
+      printf("%s ecdsa signature differs from the test vector\n",
+             key.c_->c_name_.c_str());
+      return false;
+    }
+  }
+  if (!key.verify(sizeof(digest), digest, r, s))
+    return false;
+
+  // deterministic, and survives serialization
+  if (!key.sign(sizeof(digest), digest, r2, s2) || big_compare(r, r2) != 0 ||
+      big_compare(s, s2) != 0)
+    return false;
+  if (!ecdsa_signature_to_bytes(n, r, s, &sig))
+    return false;
+  r2.zero_num();
+  s2.zero_num();
+  if (!ecdsa_signature_from_bytes(n, sig, r2, s2) || !key.verify(sizeof(digest), digest, r2, s2))
+    return false;
+
+  // wrong digest, wrong signature
+  digest[5] ^= 0x10;
+  if (key.verify(sizeof(digest), digest, r, s))
+    return false;
+  digest[5] ^= 0x10;
+  if (key.verify(sizeof(digest), digest, s, r))
+    return false;
+  if (key.verify(sizeof(digest), digest, r, n))
+    return false;
+  return true;
+}
+
+bool test_ecdsa() {
+  if (!init_ecc_curves())
+    return false;
+
+  if (!check_ecdsa(&p256_key, ecdsa_p256_x, ecdsa_p256_r, ecdsa_p256_s))
+    return false;
+  if (!check_ecdsa(&p384_key, ecdsa_p384_x, ecdsa_p384_r, ecdsa_p384_s))
+    return false;
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    if (!check_ecdsa(keys[i], nullptr, nullptr, nullptr))
+      return false;
+  }
+  return true;
+}
+
+// Multiples of g through the compressed and uncompressed encodings and back.
+static bool check_point_octets(ecc_curve& c, curve_point& g) {
+  int cap = 1 + 2 * c.curve_p_->capacity_;
+  int p_len = (big_high_bit(*c.curve_p_) + NBITSINBYTE - 1) / NBITSINBYTE;
+  curve_point p(cap);
+  curve_point q(cap);
+  curve_point r(cap);
+  big_num k(1);
+  string s;
+
+  for (int i = 0; i < 8; i++) {
+    if (i == 0) {
+      p.make_zero();
+    } else {
+      k.value_[0] = 5 + 7 * i;
+      k.normalize();
+      if (!projective_point_mult(c, k, g, p))
+        return false;
+    }
+    q.copy_from(p);
+    if (!projective_to_affine(c, q))
+      return false;
+    for (int compress = 0; compress < 2; compress++) {
+      s.clear();
+      if (!ecc_point_to_octets(c, p, compress != 0, &s))
+        return false;
+      int expected = p.is_zero() ? 1 : (compress != 0 ? 1 + p_len : 1 + 2 * p_len);
+      if ((int)s.size() != expected) {
+        printf("bad encoding size %d, expected %d\n", (int)s.size(), expected);
+        return false;
+      }
+      r.make_zero();
+      if (!ecc_point_from_octets(c, (int)s.size(), (const byte_t*)s.data(), r)) {
+        printf("can't decode point %d\n", i);
+        return false;
+      }
+      if (!r.is_equal(q)) {
+        printf("decoded point %d differs\n", i);
+        return false;
+      }
+    }
+  }
+
+  // q is the last, nonzero, multiple
+  s.clear();
+  if (!ecc_point_to_octets(c, q, false, &s))
+    return false;
+  string t(s);
+  t[0] = 0x05;
+  if (ecc_point_from_octets(c, (int)t.size(), (const byte_t*)t.data(), r))
+    return false;
+  t.assign(s);
+  t[t.size() - 1] ^= 0x01;
+  if (ecc_point_from_octets(c, (int)t.size(), (const byte_t*)t.data(), r))
+    return false;
+  if (ecc_point_from_octets(c, (int)s.size() - 1, (const byte_t*)s.data(), r))
+    return false;
+  t.assign(1 + p_len, (char)0xff);
+  t[0] = 0x02;
+  if (ecc_point_from_octets(c, (int)t.size(), (const byte_t*)t.data(), r))
+    return false;
+  return true;
+}
+
+bool test_ecc_point_octets() {
+  if (!init_ecc_curves())
+    return false;
+
+  ecc* keys[3] = {&p256_key, &p384_key, &p521_key};
+  for (int i = 0; i < 3; i++) {
+    if (!check_point_octets(*keys[i]->c_, *keys[i]->base_point_))
+      return false;
+  }
+
+  // p = 1 (mod 8), so decompression goes through Tonelli-Shanks
+  ecc_curve c1(1);
+  curve_point g(1);
+  c1.curve_p_->value_[0] = 2777;
+  c1.curve_a_->value_[0] = 4;
+  c1.curve_b_->value_[0] = 4;
+  c1.curve_p_->normalize();
+  c1.curve_a_->normalize();
+  c1.curve_b_->normalize();
+  g.x_->value_[0] = 1;
+  g.y_->value_[0] = 3;
+  g.z_->value_[0] = 1;
+  g.x_->normalize();
+  g.y_->normalize();
+  g.z_->normalize();
+  if (!check_point_octets(c1, g))
+    return false;
+
+  // about half of the x have no point
+  curve_point r(3);
+  byte_t b[3];
+  int n_rejected = 0;
+  for (int x = 0; x < 40; x++) {
+    b[0] = 0x02;
+    b[1] = (byte_t)(x >> NBITSINBYTE);
+    b[2] = (byte_t)x;
+    if (!ecc_point_from_octets(c1, 3, b, r))
+      n_rejected++;
+    else if (!ecc_is_on_curve(c1, r))
+      return false;
+  }
+  if (n_rejected == 0 || n_rejected == 40)
+    return false;
+
+  // keys carry compressed points
+  ecc key;
+  if (!key.generate_ecc_from_standard_template("P-256", "test_key-21",
+              "anything", seconds_in_common_year))
+    return false;
+  string serialized_str;
+  if (!key.get_serialized_key_message(&serialized_str))
+    return false;
+  if ((int)key.ecc_key_->ecc_pub().public_point().encoded().size() != 33)
+    return false;
+  ecc key1;
+  if (!key1.extract_key_message_from_serialized(serialized_str))
+    return false;
+  if (!key1.retrieve_parameters_from_key_message())
+    return false;
+  return key1.public_point_->is_equal(*key.public_point_) &&
+         key1.base_point_->is_equal(*key.base_point_);
+}
+
+// RFC 7748, 5.2 and 6.1
+static const char* x25519_vectors[][3] = {
+  {"a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+   "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+   "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552"},
+  {"4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+   "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+   "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957"},
+};
+static const char* x25519_alice_secret =
+  "77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a";
+static const char* x25519_alice_public =
+  "8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a";
+static const char* x25519_bob_secret =
+  "5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb";
+static const char* x25519_bob_public =
+  "de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f";
+static const char* x25519_shared =
+  "4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742";
+
+// RFC 8032, 7.1, tests 1-3: secret, public, message, signature
+static const char* ed25519_vectors[][4] = {
+  {"9d61b19deffd5a60ba844af492ec2cc44449c5697b326919703bac031cae7f60",
+   "d75a980182b10ab7d54bfed3c964073a0ee172f3daa62325af021a68f707511a",
+   "",
+   "e5564300c360ac729086e2cc806e828a84877f1eb8e5d974d873e06522490155"
+   "5fb8821590a33bacc61e39701cf9b46bd25bf5f0595bbe24655141438e7a100b"},
+  {"4ccd089b28ff96da9db6c346ec114e0f5b8a319f35aba624da8cf6ed4fb8a6fb",
+   "3d4017c3e843895a92b70aa74d1b7ebc9c982ccf2ec4968cc0cd55f12af4660c",
+   "72",
+   "92a009a9f0d4cab8720e820b5f642540a2b27b5416503f8fb3762223ebdb69da"
+   "085ac1e43e15996e458f3613d0f11d8c387b2eaeb4302aeeb00d291612bb0c00"},
+  {"c5aa8df43f9f837bedb7442f31dcb7b166d38535076f094b85ce3a2e0b4458f7",
+   "fc51cd8e6218a1a38da47ed00230f0580816ed13ba3303ac5deb911548908025",
+   "af82",
+   "6291d657deec24024827e69c3abe01a30ce548a284743a445e3680d7db5ac3ac"
+   "18ff9b538d16f290ae67f760984dc6594a7c15e9716ed28dc027beceea1ec40a"},
+};
+
+static bool hex_to_array(const char* h, string* b) {
+  string hex(h);
+  b->clear();
+  return hex_to_bytes(hex, b);
+}
+
+bool test_x25519() {
+  string k, u, expected, a_secret, b_secret, shared;
+  byte_t out[curve25519_key_bytes];
+  byte_t a_pub[curve25519_key_bytes];
+  byte_t b_pub[curve25519_key_bytes];
+  byte_t shared_ab[curve25519_key_bytes];
+  byte_t shared_ba[curve25519_key_bytes];
+
+  for (int i = 0; i < 2; i++) {
+    if (!hex_to_array(x25519_vectors[i][0], &k) ||
+        !hex_to_array(x25519_vectors[i][1], &u) ||
+        !hex_to_array(x25519_vectors[i][2], &expected))
+      return false;
+    if (!x25519((byte_t*)k.data(), (byte_t*)u.data(), out))
+      return false;
+    if (FLAGS_print_all) {
+      printf("x25519: ");
+      print_bytes(curve25519_key_bytes, out);
+    }
+    if (memcmp(out, expected.data(), curve25519_key_bytes) != 0)
+      return false;
+  }
+
+  if (!hex_to_array(x25519_alice_secret, &a_secret) ||
+      !hex_to_array(x25519_bob_secret, &b_secret) ||
+      !hex_to_array(x25519_shared, &shared))
+    return false;
+  if (!x25519_public_key((byte_t*)a_secret.data(), a_pub) ||
+      !x25519_public_key((byte_t*)b_secret.data(), b_pub))
+    return false;
+  if (!hex_to_array(x25519_alice_public, &expected) ||
+      memcmp(a_pub, expected.data(), curve25519_key_bytes) != 0)
+    return false;
+  if (!hex_to_array(x25519_bob_public, &expected) ||
+      memcmp(b_pub, expected.data(), curve25519_key_bytes) != 0)
+    return false;
+  if (!x25519((byte_t*)a_secret.data(), b_pub, shared_ab) ||
+      !x25519((byte_t*)b_secret.data(), a_pub, shared_ba))
+    return false;
+  if (memcmp(shared_ab, shared.data(), curve25519_key_bytes) != 0 ||
+      memcmp(shared_ba, shared.data(), curve25519_key_bytes) != 0)
+    return false;
+
+  // u = 0 has small order, the result must be rejected
+  memset(b_pub, 0, sizeof(b_pub));
+  if (x25519((byte_t*)a_secret.data(), b_pub, out))
+    return false;
+  return true;
+}
+
+bool test_ed25519() {
+  const int n = 3;
+  string secret[n], pub[n], msg[n], expected[n];
+  byte_t computed_pub[curve25519_key_bytes];
+  byte_t sig[n][ed25519_signature_bytes];
+  byte_t* pubs[n];
+  byte_t* msgs[n];
+  byte_t* sigs[n];
+  int sizes[n];
+
+  for (int i = 0; i < n; i++) {
+    if (!hex_to_array(ed25519_vectors[i][0], &secret[i]) ||
+        !hex_to_array(ed25519_vectors[i][1], &pub[i]) ||
+        !hex_to_array(ed25519_vectors[i][2], &msg[i]) ||
+        !hex_to_array(ed25519_vectors[i][3], &expected[i]))
+      return false;
+    if (!ed25519_public_key((byte_t*)secret[i].data(), computed_pub) ||
+        memcmp(computed_pub, pub[i].data(), curve25519_key_bytes) != 0)
+      return false;
+    if (!ed25519_sign((byte_t*)secret[i].data(), computed_pub,
+                      (int)msg[i].size(), (byte_t*)msg[i].data(), sig[i]))
+      return false;
+    if (FLAGS_print_all) {
+      printf("ed25519 signature: ");
+      print_bytes(ed25519_signature_bytes, sig[i]);
+    }
+    if (memcmp(sig[i], expected[i].data(), ed25519_signature_bytes) != 0)
+      return false;
+    if (!ed25519_verify(computed_pub, (int)msg[i].size(),
+                        (byte_t*)msg[i].data(), sig[i]))
+      return false;
+    pubs[i] = (byte_t*)pub[i].data();
+    msgs[i] = (byte_t*)msg[i].data();
+    sizes[i] = (int)msg[i].size();
+    sigs[i] = sig[i];
+  }
+  if (!ed25519_verify_batch(n, pubs, sizes, msgs, sigs))
+    return false;
+
+  // a signature for another key, a changed message and S >= L all fail
+  if (ed25519_verify(pubs[1], sizes[0], msgs[0], sigs[0]))
+    return false;
+  sig[2][0] ^= 1;
+  if (ed25519_verify(pubs[2], sizes[2], msgs[2], sigs[2]))
+    return false;
+  if (ed25519_verify_batch(n, pubs, sizes, msgs, sigs))
+    return false;
+  sig[2][0] ^= 1;
+  sig[1][63] |= 0x80;
+  if (ed25519_verify(pubs[1], sizes[1], msgs[1], sigs[1]))
+    return false;
+  if (ed25519_verify_batch(n, pubs, sizes, msgs, sigs))
+    return false;
+  return true;
+}
+
 bool test_ecc_curve_point() {
   curve_point p1(2);
   curve_point p2(2);
@@ -534,6 +1404,33 @@ TEST (ecc, test_affine) {
   EXPECT_TRUE(test_ecc_affine_1());
   EXPECT_TRUE(test_ecc_affine_2());
 }
+TEST (ecc, test_field) {
+  EXPECT_TRUE(test_ecc_field());
+}
+TEST (ecc, test_base_mult) {
+  EXPECT_TRUE(test_ecc_base_mult());
+}
+TEST (ecc, test_var_mult) {
+  EXPECT_TRUE(test_ecc_var_mult());
+}
+TEST (ecc, test_batch_affine) {
+  EXPECT_TRUE(test_ecc_batch_affine());
+}
+TEST (ecc, test_multi_mult) {
+  EXPECT_TRUE(test_ecc_multi_mult());
+}
+TEST (ecc, test_ecdsa) {
+  EXPECT_TRUE(test_ecdsa());
+}
+TEST (ecc, test_point_octets) {
+  EXPECT_TRUE(test_ecc_point_octets());
+}
+TEST (curve25519, test_x25519) {
+  EXPECT_TRUE(test_x25519());
+}
+TEST (curve25519, test_ed25519) {
+  EXPECT_TRUE(test_ed25519());
+}
 TEST (ecc_curve_point, ecc_curve_point) {
   EXPECT_TRUE(test_ecc_curve_point());
 }
@@ -36,6 +36,7 @@ S= $(SRC_DIR)/ecc
 O= $(OBJ_DIR)/ecc
 S_SUPPORT=$(SRC_DIR)/crypto_support
 S_BIG_NUM=$(SRC_DIR)/big_num
+S_HASH=$(SRC_DIR)/hash
 INCLUDE= -I$(SRC_DIR)/include -I$(S) -I$(S_SUPPORT) -I/usr/local/include
 
 ifndef NEWPROTOBUF
@@ -54,9 +55,9 @@ LINK=g++
 PROTO=protoc
 AR=ar
 
-dobj=	$(O)/test_ecc.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/ecc.o \
+dobj=	$(O)/test_ecc.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/ecc.o $(O)/ecc_field.o $(O)/ecc_mult.o $(O)/curve25519.o \
 	$(O)/globals.o $(O)/big_num.o $(O)/intel_digit_arith.o $(O)/basic_arith.o $(O)/number_theory.o \
-	$(O)/ecc_curve_data.o
+	$(O)/ecc_curve_data.o $(O)/hash.o $(O)/sha256.o $(O)/sha512.o $(O)/hmac_sha256.o
 
 all:	test_ecc.exe
 clean:
@@ -92,10 +93,38 @@ $(O)/ecc.o: $(S)/ecc.cc
 	@echo "compiling ecc.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc.o $(S)/ecc.cc
 
+$(O)/ecc_field.o: $(S)/ecc_field.cc
+	@echo "compiling ecc_field.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_field.o $(S)/ecc_field.cc
+
+$(O)/ecc_mult.o: $(S)/ecc_mult.cc
+	@echo "compiling ecc_mult.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_mult.o $(S)/ecc_mult.cc
+
+$(O)/curve25519.o: $(S)/curve25519.cc
+	@echo "compiling curve25519.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/curve25519.o $(S)/curve25519.cc
+
 $(O)/ecc_curve_data.o: $(S)/ecc_curve_data.cc
 	@echo "compiling ecc_curve_data.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/ecc_curve_data.o $(S)/ecc_curve_data.cc
 
+$(O)/hash.o: $(S_HASH)/hash.cc
+	@echo "compiling hash.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/hash.o $(S_HASH)/hash.cc
+
+$(O)/sha256.o: $(S_HASH)/sha256.cc
+	@echo "compiling sha256.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha256.o $(S_HASH)/sha256.cc
+
+$(O)/sha512.o: $(S_HASH)/sha512.cc
+	@echo "compiling sha512.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha512.o $(S_HASH)/sha512.cc
+
+$(O)/hmac_sha256.o: $(S_HASH)/hmac_sha256.cc
+	@echo "compiling hmac_sha256.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/hmac_sha256.o $(S_HASH)/hmac_sha256.cc
+
 $(O)/big_num.o: $(S_BIG_NUM)/big_num.cc
 	@echo "compiling big_num.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/big_num.o $(S_BIG_NUM)/big_num.cc
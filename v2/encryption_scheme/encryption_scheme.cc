@@ -17,6 +17,7 @@
 #include "hash.h"
 #include "sha256.h"
 #include "hmac_sha256.h"
+#include "aes_gcm.h"
 #include "encryption_scheme.h"
 #include "big_num.h"
 #include "big_num_functions.h"
@@ -56,7 +57,7 @@ void encryption_scheme::update_nonce(int size, byte_t* buf) {
 }
 
 void encryption_scheme::ctr_encrypt_step(byte_t* in, byte_t* out) {
-  enc_obj_.encrypt_block((byte_t*)running_nonce_.data(), out);
+  cipher_encrypt(block_size_, (byte_t*)running_nonce_.data(), out);
   xor_into(out, in, block_size_);
   int_obj_.add_to_inner_hash(block_size_, out);
 #if 0
@@ -69,7 +70,7 @@ void encryption_scheme::ctr_encrypt_step(byte_t* in, byte_t* out) {
 
 void encryption_scheme::ctr_decrypt_step(byte_t* in, byte_t* out) {
   int_obj_.add_to_inner_hash(block_size_, in);
-  enc_obj_.encrypt_block((byte_t*)running_nonce_.data(), out);
+  cipher_encrypt(block_size_, (byte_t*)running_nonce_.data(), out);
   xor_into(out, in, block_size_);
 #if 0
   printf("ctr decrypt in : "); print_bytes(block_size_, in);
@@ -83,7 +84,7 @@ void encryption_scheme::cbc_encrypt_step(byte_t* in, byte_t* out) {
   byte_t tmp[MAXBLOCKSIZE];
 
   xor_to_dst(in, (byte_t*)running_nonce_.data(), tmp, block_size_);
-  enc_obj_.encrypt_block(tmp, out);
+  cipher_encrypt(block_size_, tmp, out);
   int_obj_.add_to_inner_hash(block_size_, out);
 #if 0
   printf("cbc encrypt in : "); print_bytes(block_size_, in);
@@ -97,7 +98,7 @@ void encryption_scheme::cbc_decrypt_step(byte_t* in, byte_t* out) {
   byte_t tmp[MAXBLOCKSIZE];
 
   int_obj_.add_to_inner_hash(block_size_, in);
-  enc_obj_.decrypt_block(in, tmp);
+  cipher_decrypt(block_size_, in, tmp);
   xor_to_dst(tmp, (byte_t*)running_nonce_.data(), out, block_size_);
 #if 0
   printf("cbc decrypt in : "); print_bytes(block_size_, in);
@@ -107,6 +108,97 @@ void encryption_scheme::cbc_decrypt_step(byte_t* in, byte_t* out) {
   update_nonce(block_size_, in);
 }
 
+void encryption_scheme::cipher_encrypt(int size, byte_t* in, byte_t* out) {
+#if defined(X64)
+  if (use_aesni_) {
+    ni_obj_.encrypt(size, in, out);
+    return;
+  }
+#endif
+  enc_obj_.encrypt(size, in, out);
+}
+
+void encryption_scheme::cipher_decrypt(int size, byte_t* in, byte_t* out) {
+#if defined(X64)
+  if (use_aesni_) {
+    ni_obj_.decrypt(size, in, out);
+    return;
+  }
+#endif
+  enc_obj_.decrypt(size, in, out);
+}
+
+// Bulk paths
+//   The counter is the 128 bit little endian number update_nonce steps, so
+//   the counter blocks are laid out here and encrypted together, which lets
+//   the multi-block aesni kernels run.  CBC encryption is serial.
+
+static const int bulk_blocks = 64;
+
+void encryption_scheme::ctr_blocks(int num_blocks, byte_t* in, byte_t* out) {
+  byte_t key_stream[bulk_blocks * MAXBLOCKSIZE];
+  uint64_t counter[2];
+
+  memcpy((byte_t*)counter, (byte_t*)running_nonce_.data(), sizeof(counter));
+  while (num_blocks > 0) {
+    int n = num_blocks < bulk_blocks ? num_blocks : bulk_blocks;
+    for (int i = 0; i < n; i++) {
+      memcpy(&key_stream[i * block_size_], (byte_t*)counter, sizeof(counter));
+      if (++counter[0] == 0ULL)
+        counter[1]++;
+    }
+    cipher_encrypt(n * block_size_, key_stream, key_stream);
+    xor_to_dst(in, key_stream, out, n * block_size_);
+    in += n * block_size_;
+    out += n * block_size_;
+    num_blocks -= n;
+  }
+  memset(key_stream, 0, sizeof(key_stream));
+
+  counter_nonce_->zero_num();
+  memcpy(counter_nonce_->value_ptr(), (byte_t*)counter, sizeof(counter));
+  counter_nonce_->normalize();
+  running_nonce_.assign((char*)counter, sizeof(counter));
+}
+
+bool encryption_scheme::encrypt_blocks(int num_blocks, byte_t* in, byte_t* out) {
+  if (mode_ == CTR) {
+    ctr_blocks(num_blocks, in, out);
+    int_obj_.add_to_inner_hash(num_blocks * block_size_, out);
+    return true;
+  }
+  if (mode_ == CBC) {
+    for (int i = 0; i < num_blocks; i++)
+      cbc_encrypt_step(&in[i * block_size_], &out[i * block_size_]);
+    return true;
+  }
+  return false;
+}
+
+bool encryption_scheme::decrypt_blocks(int num_blocks, byte_t* in, byte_t* out) {
+  if (mode_ == CTR) {
+    int_obj_.add_to_inner_hash(num_blocks * block_size_, in);
+    ctr_blocks(num_blocks, in, out);
+    return true;
+  }
+  if (mode_ == CBC) {
+#if defined(X64)
+    if (use_aesni_) {
+      byte_t chain[MAXBLOCKSIZE];
+      int_obj_.add_to_inner_hash(num_blocks * block_size_, in);
+      memcpy(chain, (byte_t*)running_nonce_.data(), block_size_);
+      ni_obj_.cbc_decrypt(num_blocks * block_size_, chain, in, out);
+      running_nonce_.assign((char*)chain, block_size_);
+      return true;
+    }
+#endif
+    for (int i = 0; i < num_blocks; i++)
+      cbc_decrypt_step(&in[i * block_size_], &out[i * block_size_]);
+    return true;
+  }
+  return false;
+}
+
 bool encryption_scheme::message_info(int msg_size, int operation) {
   operation_ = operation;
   total_message_size_ = msg_size;
@@ -154,6 +246,7 @@ void encryption_scheme::clear() {
   hmac_block_size_ = 0;
   hmac_digest_size_ = 0;
   operation_ = 0;
+  use_aesni_ = false;
 }
 
 encryption_scheme::encryption_scheme() {
@@ -184,25 +277,38 @@ bool encryption_scheme::recover_encryption_scheme_from_message() {
     hmac_alg_name_.assign("hmac-sha256");
     mode_ = CBC;
     pad_ = SYMMETRIC_PAD;
+  } else if (strcmp(scheme_msg_->scheme_type().c_str(), "aes-gcm") == 0) {
+    alg_.assign("aes-gcm");
+    enc_alg_name_.assign("aes");
+    hmac_alg_name_.assign("none");
+    mode_ = GCM;
+    pad_ = NONE;
   } else  {
     return false;
   }
   if (!scheme_msg_->has_encryption_key())
     return false;
-  if (!scheme_msg_->has_parameters())
-    return false;
   if (!scheme_msg_->encryption_key().has_key_size())
     return false;
   if (!scheme_msg_->encryption_key().has_secret())
     return false;
+  enc_key_size_= scheme_msg_->encryption_key().key_size();
+  encryption_key_.assign(scheme_msg_->encryption_key().secret());
+
+  // the gcm tag needs no mac key
+  if (mode_ == GCM) {
+    hmac_key_size_ = 0;
+    hmac_key_.clear();
+    return true;
+  }
+  if (!scheme_msg_->has_parameters())
+    return false;
   if (!scheme_msg_->parameters().has_size())
     return false;
   if (!scheme_msg_->parameters().has_secret())
     return false;
 
-  enc_key_size_= scheme_msg_->encryption_key().key_size();
   hmac_key_size_ = scheme_msg_->parameters().size();
-  encryption_key_.assign(scheme_msg_->encryption_key().secret());
   hmac_key_.assign(scheme_msg_->parameters().secret());
   return true;
 }
@@ -249,14 +355,26 @@ printf("hmac_key_size_: %d, hmac_key_size_bytes_: %d\n", hmac_key_size_, hmac_ke
 print_bytes(hmac_key_size_bytes_, (byte*)hmac_key_.data());
 #endif
 
-  if (strcmp(enc_alg_name_.c_str(), "aes") == 0) {
+  if (strcmp(enc_alg_name_.c_str(), "aes") == 0 && mode_ == GCM) {
+    if (!gcm_obj_.init(enc_key_size_, (byte_t*)encryption_key_.data()))
+      return false;
+    block_size_ = aes::BLOCKBYTESIZE;
+  } else if (strcmp(enc_alg_name_.c_str(), "aes") == 0) {
     if (!enc_obj_.init(enc_key_size_, (byte_t*)encryption_key_.data(), aes::BOTH))
       return false;
     block_size_ = aes::BLOCKBYTESIZE;
+#if defined(X64)
+    use_aesni_ = have_intel_aes_ni();
+    if (use_aesni_ && !ni_obj_.init(enc_key_size_, (byte_t*)encryption_key_.data(), aes::BOTH))
+      return false;
+#endif
   } else {
     return false;
   }
-  if (strcmp(hmac_alg_name_.c_str(), "hmac-sha256") == 0) {
+  if (mode_ == GCM) {
+    hmac_digest_size_ = aes_gcm::TAGBYTESIZE;
+    hmac_block_size_ = 0;
+  } else if (strcmp(hmac_alg_name_.c_str(), "hmac-sha256") == 0) {
     if (!int_obj_.init(hmac_key_size_bytes_, (byte_t*)hmac_key_.data()))
       return false;
     hmac_digest_size_ = sha256::DIGESTBYTESIZE;
@@ -292,6 +410,8 @@ bool encryption_scheme::encryption_scheme::init(const char* alg, const char* id_
     return false;
   if (strcmp(pad, "sym-pad") == 0)
     pad_ = SYMMETRIC_PAD;
+  else if (strcmp(pad, "none") == 0)
+    pad_ = NONE;
   else
     return false;
 
@@ -301,9 +421,14 @@ bool encryption_scheme::encryption_scheme::init(const char* alg, const char* id_
     mode_ = CTR;
   } else if (strcmp(mode, "cbc") == 0) {
     mode_ = CBC;
+  } else if (strcmp(mode, "gcm") == 0) {
+    mode_ = GCM;
   } else {
     return false;
   }
+  // gcm is the only unpadded mode
+  if ((mode_ == GCM) != (pad_ == NONE))
+    return false;
 
   scheme_msg_ = make_scheme(alg, id_name, mode, pad, purpose,
       not_before, not_after, enc_alg, size_enc_key, enc_key,
@@ -322,12 +447,12 @@ bool encryption_scheme::get_nonce_data(int size, byte_t* out) {
 }
 
 bool encryption_scheme::encrypt_block(int size_in, byte_t* in, byte_t* out) {
-  enc_obj_.encrypt_block(in, out);
+  cipher_encrypt(block_size_, in, out);
   return true;
 }
 
 bool encryption_scheme::decrypt_block(int size_in, byte_t* in, byte_t* out) {
-  enc_obj_.decrypt_block(in, out);
+  cipher_decrypt(block_size_, in, out);
   return true;
 }
 
@@ -423,6 +548,8 @@ printf("Final decrypted block: ");print_bytes(block_size_, out);printf("\n");
 }
 
 bool encryption_scheme::encrypt_message(int size_in, byte_t* in, int size_out, byte_t* out) {
+  if (mode_ == GCM)
+    return gcm_encrypt_message(size_in, in, size_out, out);
   if (!message_info(size_in, encryption_scheme::ENCRYPT))
     return false;
   byte_t* cur_in = in;
@@ -444,19 +571,15 @@ printf("First nonce: "); print_bytes(block_size, cur_out);
   cur_out += block_size;
   total_bytes_output_ += block_size;
 
-  while (bytes_left >= block_size) {
-    if (mode_ == CTR) {
-      ctr_encrypt_step(cur_in, cur_out);
-    } else if (mode_ == CBC) {
-      cbc_encrypt_step(cur_in, cur_out);
-    } else {
-        return false;
-    }
-    encrypted_bytes_output_ += block_size;
-    total_bytes_output_ += block_size;
-    cur_in += block_size;
-    cur_out += block_size;
-    bytes_left -= block_size;
+  int num_blocks = bytes_left / block_size;
+  if (num_blocks > 0) {
+    if (!encrypt_blocks(num_blocks, cur_in, cur_out))
+      return false;
+    encrypted_bytes_output_ += num_blocks * block_size;
+    total_bytes_output_ += num_blocks * block_size;
+    cur_in += num_blocks * block_size;
+    cur_out += num_blocks * block_size;
+    bytes_left -= num_blocks * block_size;
   }
 
   int additional_bytes = size_out - total_bytes_output_;
@@ -471,6 +594,8 @@ printf("First nonce: "); print_bytes(block_size, cur_out);
 }
 
 bool encryption_scheme::decrypt_message(int size_in, byte_t* in, int size_out, byte_t* out) {
+  if (mode_ == GCM)
+    return gcm_decrypt_message(size_in, in, size_out, out);
   if (!message_info(size_in, encryption_scheme::DECRYPT)) {
     return false;
   }
@@ -488,19 +613,16 @@ bool encryption_scheme::decrypt_message(int size_in, byte_t* in, int size_out, b
   cur_in += block_size;
   bytes_left -= block_size;
 
-  while (bytes_left > (block_size + mac_size)) {
-    if (mode_ == CTR) {
-        ctr_decrypt_step(cur_in, cur_out);
-      } else if (mode_ == CBC) {
-        cbc_decrypt_step(cur_in, cur_out);
-      } else {
-        return false;
-      }
-    encrypted_bytes_output_ += block_size;
-    total_bytes_output_ += block_size;
-    cur_in += block_size;
-    cur_out += block_size;
-    bytes_left -= block_size;
+  // all but the final block
+  if (bytes_left > (block_size + mac_size)) {
+    int num_blocks = (bytes_left - mac_size - 1) / block_size;
+    if (!decrypt_blocks(num_blocks, cur_in, cur_out))
+      return false;
+    encrypted_bytes_output_ += num_blocks * block_size;
+    total_bytes_output_ += num_blocks * block_size;
+    cur_in += num_blocks * block_size;
+    cur_out += num_blocks * block_size;
+    bytes_left -= num_blocks * block_size;
   }
 
   if (bytes_left != (block_size + mac_size)) {
@@ -556,6 +678,8 @@ print_bytes(hmac_digest_size_, cur_in);
 const int file_buffer_size = 4096;
 
 bool encryption_scheme::encrypt_file(const char* infile, const char* outfile) {
+  if (mode_ == GCM)
+    return gcm_encrypt_file(infile, outfile);
 
   file_util in_file;
   file_util out_file;
@@ -621,7 +745,7 @@ bool encryption_scheme::encrypt_file(const char* infile, const char* outfile) {
 
     while (bytes_left_in_buffer > 0) {
 
-      if (bytes_left_in_buffer <= block_size) {
+      if (bytes_left_in_file <= block_size) {
 
         if (bytes_in_output_buffer > 0) {
           out_file.write_a_block(bytes_in_output_buffer, out_buf);
@@ -647,27 +771,32 @@ bool encryption_scheme::encrypt_file(const char* infile, const char* outfile) {
         return message_valid_;
       }
 
-      if (mode_ == CTR) {
-        ctr_encrypt_step(cur_in, cur_out);
-      } else if (mode_ == CBC) {
-        cbc_encrypt_step(cur_in, cur_out);
-      } else {
+      // the rest of the buffer, keeping back the final block of the file
+      int num_blocks = (bytes_left_in_file - 1) / block_size;
+      if (num_blocks > (bytes_left_in_buffer / block_size))
+        num_blocks = bytes_left_in_buffer / block_size;
+      if (num_blocks < 1)
+        num_blocks = 1;
+      int num_bytes = num_blocks * block_size;
+      if (!encrypt_blocks(num_blocks, cur_in, cur_out)) {
           printf("%s(), line %d, error\n", __FILE__, __LINE__);
           return false;
       }
-      encrypted_bytes_output_ += block_size;
-      total_bytes_output_ += block_size;
-      cur_in += block_size;
-      cur_out += block_size;
-      bytes_left_in_buffer -= block_size;
-      bytes_left_in_file -= block_size;
-      bytes_in_output_buffer += block_size;
+      encrypted_bytes_output_ += num_bytes;
+      total_bytes_output_ += num_bytes;
+      cur_in += num_bytes;
+      cur_out += num_bytes;
+      bytes_left_in_buffer -= num_bytes;
+      bytes_left_in_file -= num_bytes;
+      bytes_in_output_buffer += num_bytes;
     }
   }
   return true;
 }
 
 bool encryption_scheme::decrypt_file(const char* infile, const char* outfile) {
+  if (mode_ == GCM)
+    return gcm_decrypt_file(infile, outfile);
 
   file_util in_file;
   file_util out_file;
@@ -801,26 +930,205 @@ print_bytes(hmac_digest_size_, cur_in);
         return (message_valid_);
       }
 
-      if (mode_ == CTR) {
-        ctr_decrypt_step(cur_in, cur_out);
-      } else if (mode_ == CBC) {
-        cbc_decrypt_step(cur_in, cur_out);
-      } else {
+      // the rest of the buffer, keeping back the final block and mac
+      int num_blocks = (bytes_left_in_file - mac_size - 1) / block_size;
+      if (num_blocks > (bytes_left_in_buffer / block_size))
+        num_blocks = bytes_left_in_buffer / block_size;
+      if (num_blocks < 1)
+        num_blocks = 1;
+      int num_bytes = num_blocks * block_size;
+      if (!decrypt_blocks(num_blocks, cur_in, cur_out)) {
         in_file.close();
         out_file.close();
         return false;
       }
 
-      encrypted_bytes_output_ += block_size;
-      total_bytes_output_ += block_size;
-      cur_in += block_size;
-      cur_out += block_size;
-      bytes_left_in_file -= block_size;
-      bytes_left_in_buffer -= block_size;
-      bytes_in_output_buffer += block_size;
+      encrypted_bytes_output_ += num_bytes;
+      total_bytes_output_ += num_bytes;
+      cur_in += num_bytes;
+      cur_out += num_bytes;
+      bytes_left_in_file -= num_bytes;
+      bytes_left_in_buffer -= num_bytes;
+      bytes_in_output_buffer += num_bytes;
     }
   }
 
   return true;
 }
 
+
+bool encryption_scheme::gcm_encrypt_message(int size_in, byte_t* in,
+      int size_out, byte_t* out) {
+  const int iv_size = aes_gcm::IVBYTESIZE;
+
+  if (!message_info(size_in, encryption_scheme::ENCRYPT))
+    return false;
+  if (size_out < (size_in + iv_size + aes_gcm::TAGBYTESIZE))
+    return false;
+  if (crypto_get_random_bytes(iv_size, out) < iv_size)
+    return false;
+  initial_nonce_.assign((char*)out, iv_size);
+  nonce_data_valid_ = true;
+  if (!gcm_obj_.start(iv_size, out))
+    return false;
+  gcm_obj_.encrypt(size_in, in, &out[iv_size]);
+  gcm_obj_.finalize(&out[iv_size + size_in]);
+
+  encrypted_bytes_output_ += size_in;
+  total_bytes_output_ += size_in + iv_size + aes_gcm::TAGBYTESIZE;
+  message_valid_ = true;
+  return true;
+}
+
+bool encryption_scheme::gcm_decrypt_message(int size_in, byte_t* in,
+      int size_out, byte_t* out) {
+  const int iv_size = aes_gcm::IVBYTESIZE;
+  int size_text = size_in - iv_size - aes_gcm::TAGBYTESIZE;
+
+  if (!message_info(size_in, encryption_scheme::DECRYPT))
+    return false;
+  if (size_text < 0 || size_out < size_text)
+    return false;
+  initial_nonce_.assign((char*)in, iv_size);
+  nonce_data_valid_ = true;
+  if (!gcm_obj_.start(iv_size, in))
+    return false;
+  gcm_obj_.decrypt(size_text, &in[iv_size], out);
+  message_valid_ = gcm_obj_.verify(&in[iv_size + size_text]);
+  if (!message_valid_) {
+    memset(out, 0, size_text);
+    return false;
+  }
+  encrypted_bytes_output_ += size_text;
+  total_bytes_output_ += size_text;
+  return true;
+}
+
+bool encryption_scheme::gcm_encrypt_file(const char* infile, const char* outfile) {
+  const int iv_size = aes_gcm::IVBYTESIZE;
+  file_util in_file;
+  file_util out_file;
+  byte_t in_buf[file_buffer_size];
+  byte_t out_buf[file_buffer_size];
+  byte_t iv[iv_size];
+  byte_t tag[aes_gcm::TAGBYTESIZE];
+
+  if (!in_file.open(infile)) {
+    printf("Can't open %s\n", infile);
+    return false;
+  }
+  if (!out_file.create(outfile)) {
+    printf("Can't creat %s\n", outfile);
+    return false;
+  }
+  if (!message_info(in_file.bytes_in_file(), encryption_scheme::ENCRYPT))
+    return false;
+
+  if (crypto_get_random_bytes(iv_size, iv) < iv_size) {
+    printf("%s(), line %d, random bytes error\n", __FILE__, __LINE__);
+    return false;
+  }
+  initial_nonce_.assign((char*)iv, iv_size);
+  nonce_data_valid_ = true;
+  if (!gcm_obj_.start(iv_size, iv))
+    return false;
+  out_file.write_a_block(iv_size, iv);
+  total_bytes_output_ += iv_size;
+
+  // file_buffer_size is a multiple of the block size, so only the last
+  // piece can be partial
+  int bytes_left_in_file = in_file.bytes_in_file();
+  while (bytes_left_in_file > 0) {
+    int n = bytes_left_in_file < file_buffer_size ? bytes_left_in_file : file_buffer_size;
+    if (in_file.read_a_block(n, in_buf) != n) {
+      printf("%s(), line %d, read error\n", __FILE__, __LINE__);
+      in_file.close();
+      out_file.close();
+      return false;
+    }
+    gcm_obj_.encrypt(n, in_buf, out_buf);
+    out_file.write_a_block(n, out_buf);
+    encrypted_bytes_output_ += n;
+    total_bytes_output_ += n;
+    bytes_left_in_file -= n;
+  }
+  gcm_obj_.finalize(tag);
+  out_file.write_a_block(aes_gcm::TAGBYTESIZE, tag);
+  total_bytes_output_ += aes_gcm::TAGBYTESIZE;
+  memset(in_buf, 0, file_buffer_size);
+  in_file.close();
+  out_file.close();
+  message_valid_ = true;
+  return true;
+}
+
+// The plaintext goes to a temporary file that is renamed to outfile only
+// once the tag checks, so a forged file never leaves plaintext behind.
+bool encryption_scheme::gcm_decrypt_file(const char* infile, const char* outfile) {
+  const int iv_size = aes_gcm::IVBYTESIZE;
+  file_util in_file;
+  file_util out_file;
+  byte_t in_buf[file_buffer_size];
+  byte_t out_buf[file_buffer_size];
+  byte_t tag[aes_gcm::TAGBYTESIZE];
+  string tmp_file(outfile);
+  int bytes_left_in_file;
+  bool ret = false;
+
+  tmp_file.append(".partial");
+  message_valid_ = false;
+  if (!in_file.open(infile)) {
+    printf("Can't open %s\n", infile);
+    return false;
+  }
+  if (!out_file.create(tmp_file.c_str())) {
+    printf("Can't creat %s\n", tmp_file.c_str());
+    in_file.close();
+    return false;
+  }
+  if (!message_info(in_file.bytes_in_file(), encryption_scheme::DECRYPT))
+    goto done;
+
+  bytes_left_in_file = in_file.bytes_in_file() - iv_size - aes_gcm::TAGBYTESIZE;
+  if (bytes_left_in_file < 0 || in_file.read_a_block(iv_size, in_buf) != iv_size)
+    goto done;
+  initial_nonce_.assign((char*)in_buf, iv_size);
+  nonce_data_valid_ = true;
+  if (!gcm_obj_.start(iv_size, in_buf))
+    goto done;
+
+  while (bytes_left_in_file > 0) {
+    int n = bytes_left_in_file < file_buffer_size ? bytes_left_in_file : file_buffer_size;
+    if (in_file.read_a_block(n, in_buf) != n) {
+      printf("%s(), line %d, read error\n", __FILE__, __LINE__);
+      goto done;
+    }
+    gcm_obj_.decrypt(n, in_buf, out_buf);
+    if (!out_file.write_a_block(n, out_buf)) {
+      printf("%s(), line %d, write error\n", __FILE__, __LINE__);
+      goto done;
+    }
+    encrypted_bytes_output_ += n;
+    total_bytes_output_ += n;
+    bytes_left_in_file -= n;
+  }
+  if (in_file.read_a_block(aes_gcm::TAGBYTESIZE, tag) != aes_gcm::TAGBYTESIZE)
+    goto done;
+  message_valid_ = gcm_obj_.verify(tag);
+  if (!message_valid_)
+    printf("%s(), line %d, bad tag\n", __FILE__, __LINE__);
+  ret = message_valid_;
+
+done:
+  memset(out_buf, 0, file_buffer_size);
+  in_file.close();
+  out_file.close();
+  if (ret && rename(tmp_file.c_str(), outfile) != 0) {
+    printf("Can't rename %s\n", tmp_file.c_str());
+    message_valid_ = false;
+    ret = false;
+  }
+  if (!ret)
+    unlink(tmp_file.c_str());
+  return ret;
+}
@@ -20,6 +20,7 @@
 #include "crypto_names.h"
 #include "symmetric_cipher.h"
 #include "aes.h"
+#include "aes_gcm.h"
 #include "twofish.h"
 #include "hash.h"
 #include "sha256.h"
@@ -522,6 +523,247 @@ done:
   return true;
 }
 
+// Messages and files of many sizes through the bulk paths.  Each is
+// decrypted by a scheme that has AES-NI turned off, so the multi-block
+// kernels are checked against the portable aes code.
+bool bulk_init(encryption_scheme& scheme, const char* mode, string& enc_key,
+               string& hmac_key) {
+  time_point t1, t2;
+  string s1, s2;
+
+  t1.time_now();
+  if (!t1.encode_time(&s1))
+    return false;
+  t2.add_interval_to_time(t1, 5 * 365 * 86400.0);
+  if (!t2.encode_time(&s2))
+    return false;
+  return scheme.init("aes128-hmacsha256-bulk", "scheme-test",
+        mode, "sym-pad", "testing", s1.c_str(), s2.c_str(),
+        "aes", 128, enc_key, "aes_test_key", "hmac-sha256",
+        256, hmac_key);
+}
+
+bool test_aes_sha256_bulk(const char* mode) {
+  const int sizes[] = {1, 15, 16, 17, 127, 128, 1000, 4095, 4096, 4097, 70001};
+  const int max_size = 70001;
+  const int allocated = max_size + 3 * aes::BLOCKBYTESIZE + sha256::DIGESTBYTESIZE;
+  const char* plain_file = "test_bulk_plain";
+  const char* cipher_file = "test_bulk_cipher";
+  const char* recovered_file = "test_bulk_recovered";
+  bool ret_value = true;
+  string enc_key(16, 0);
+  string hmac_key(32, 0);
+  byte_t* plain = new byte_t[allocated];
+  byte_t* cipher = new byte_t[allocated];
+  byte_t* recovered = new byte_t[allocated];
+  file_util f;
+
+  if (crypto_get_random_bytes(16, (byte_t*)enc_key.data()) < 16 ||
+      crypto_get_random_bytes(32, (byte_t*)hmac_key.data()) < 32 ||
+      crypto_get_random_bytes(max_size, plain) < max_size) {
+    ret_value = false;
+    goto done;
+  }
+
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+    int size = sizes[i];
+    int cipher_size;
+    encryption_scheme enc_scheme;
+    encryption_scheme dec_scheme;
+
+    if (!bulk_init(enc_scheme, mode, enc_key, hmac_key) ||
+        !bulk_init(dec_scheme, mode, enc_key, hmac_key)) {
+      ret_value = false;
+      goto done;
+    }
+    dec_scheme.use_aesni_ = false;
+    if (!enc_scheme.encrypt_message(size, plain, allocated, cipher)) {
+      ret_value = false;
+      goto done;
+    }
+    cipher_size = enc_scheme.get_total_bytes_output();
+    memset(recovered, 0, allocated);
+    if (!dec_scheme.decrypt_message(cipher_size, cipher, allocated, recovered) ||
+        dec_scheme.get_bytes_encrypted() != size ||
+        memcmp(plain, recovered, size) != 0) {
+      printf("bulk %s message, size %d failed\n", mode, size);
+      ret_value = false;
+      goto done;
+    }
+
+    encryption_scheme file_enc_scheme;
+    encryption_scheme file_dec_scheme;
+    if (!bulk_init(file_enc_scheme, mode, enc_key, hmac_key) ||
+        !bulk_init(file_dec_scheme, mode, enc_key, hmac_key)) {
+      ret_value = false;
+      goto done;
+    }
+    file_enc_scheme.use_aesni_ = false;
+    if (!f.write_file(plain_file, size, plain) ||
+        !file_enc_scheme.encrypt_file(plain_file, cipher_file) ||
+        !file_dec_scheme.decrypt_file(cipher_file, recovered_file)) {
+      printf("bulk %s file, size %d failed\n", mode, size);
+      ret_value = false;
+      goto done;
+    }
+    memset(recovered, 0, allocated);
+    if (f.read_file(recovered_file, size, recovered) != size ||
+        f.bytes_in_file() != size || memcmp(plain, recovered, size) != 0) {
+      printf("bulk %s file, size %d, wrong plaintext\n", mode, size);
+      ret_value = false;
+      goto done;
+    }
+  }
+
+done:
+  unlink(plain_file);
+  unlink(cipher_file);
+  unlink(recovered_file);
+  delete []plain;
+  delete []cipher;
+  delete []recovered;
+  return ret_value;
+}
+
+bool gcm_init(encryption_scheme& scheme, string& enc_key) {
+  string no_key;
+
+  return scheme.init("aes-gcm", "scheme-test", "gcm", "none", "testing",
+        "now", "later", "aes", 256, enc_key, "aes_test_key", "none",
+        0, no_key);
+}
+
+// Messages and files under aes-gcm, the decrypting side on the portable
+// code, and a scheme recovered from its message.  A changed byte anywhere
+// must be rejected.
+bool test_aes_gcm_scheme() {
+  const int sizes[] = {0, 1, 16, 17, 127, 128, 129, 4095, 4096, 4097, 70001};
+  const int max_size = 70001;
+  const int allocated = max_size + aes_gcm::IVBYTESIZE + aes_gcm::TAGBYTESIZE;
+  const char* plain_file = "test_gcm_plain";
+  const char* cipher_file = "test_gcm_cipher";
+  const char* recovered_file = "test_gcm_recovered";
+  bool use_clmul = aes_gcm_use_clmul;
+  bool ret_value = true;
+  string enc_key(32, 0);
+  string serialized;
+  byte_t* plain = new byte_t[allocated];
+  byte_t* cipher = new byte_t[allocated];
+  byte_t* recovered = new byte_t[allocated];
+  file_util f;
+
+  if (crypto_get_random_bytes(32, (byte_t*)enc_key.data()) < 32 ||
+      crypto_get_random_bytes(max_size, plain) < max_size) {
+    ret_value = false;
+    goto done;
+  }
+
+  for (int i = 0; i < (int)(sizeof(sizes) / sizeof(int)); i++) {
+    int size = sizes[i];
+    int cipher_size;
+    encryption_scheme enc_scheme;
+    encryption_scheme dec_scheme;
+
+    if (!gcm_init(enc_scheme, enc_key)) {
+      ret_value = false;
+      goto done;
+    }
+    aes_gcm_use_clmul = false;
+    if (!gcm_init(dec_scheme, enc_key)) {
+      ret_value = false;
+      goto done;
+    }
+    aes_gcm_use_clmul = use_clmul;
+    if (!enc_scheme.encrypt_message(size, plain, allocated, cipher)) {
+      ret_value = false;
+      goto done;
+    }
+    cipher_size = enc_scheme.get_total_bytes_output();
+    if (cipher_size != size + aes_gcm::IVBYTESIZE + aes_gcm::TAGBYTESIZE) {
+      ret_value = false;
+      goto done;
+    }
+    memset(recovered, 0, allocated);
+    if (!dec_scheme.decrypt_message(cipher_size, cipher, allocated, recovered) ||
+        dec_scheme.get_bytes_encrypted() != size ||
+        memcmp(plain, recovered, size) != 0) {
+      printf("gcm message, size %d failed\n", size);
+      ret_value = false;
+      goto done;
+    }
+    cipher[(7 * size) % cipher_size] ^= 0x01;
+    if (dec_scheme.decrypt_message(cipher_size, cipher, allocated, recovered) ||
+        dec_scheme.get_message_valid()) {
+      printf("gcm message, size %d, change not detected\n", size);
+      ret_value = false;
+      goto done;
+    }
+
+    // write_file does not make empty files
+    if (size == 0)
+      continue;
+    encryption_scheme file_enc_scheme;
+    encryption_scheme file_dec_scheme;
+    if (!gcm_init(file_enc_scheme, enc_key) ||
+        !file_enc_scheme.get_encryption_scheme_message(&serialized)) {
+      ret_value = false;
+      goto done;
+    }
+    file_dec_scheme.scheme_msg_ = new scheme_message;
+    if (!file_dec_scheme.scheme_msg_->ParseFromString(serialized) ||
+        !file_dec_scheme.recover_encryption_scheme_from_message() ||
+        !file_dec_scheme.init()) {
+      ret_value = false;
+      goto done;
+    }
+    if (!f.write_file(plain_file, size, plain) ||
+        !file_enc_scheme.encrypt_file(plain_file, cipher_file) ||
+        !file_dec_scheme.decrypt_file(cipher_file, recovered_file)) {
+      printf("gcm file, size %d failed\n", size);
+      ret_value = false;
+      goto done;
+    }
+    memset(recovered, 0, allocated);
+    if (f.read_file(recovered_file, size, recovered) != size ||
+        f.bytes_in_file() != size || memcmp(plain, recovered, size) != 0) {
+      printf("gcm file, size %d, wrong plaintext\n", size);
+      ret_value = false;
+      goto done;
+    }
+
+    cipher_size = size + aes_gcm::IVBYTESIZE + aes_gcm::TAGBYTESIZE;
+    if (f.read_file(cipher_file, cipher_size, cipher) != cipher_size) {
+      ret_value = false;
+      goto done;
+    }
+    cipher[cipher_size - 1] ^= 0x80;
+    unlink(recovered_file);
+    if (!f.write_file(cipher_file, cipher_size, cipher) ||
+        file_dec_scheme.decrypt_file(cipher_file, recovered_file)) {
+      printf("gcm file, size %d, change not detected\n", size);
+      ret_value = false;
+      goto done;
+    }
+    // and no unauthenticated plaintext is left
+    if (access(recovered_file, F_OK) == 0 ||
+        access("test_gcm_recovered.partial", F_OK) == 0) {
+      printf("gcm file, size %d, plaintext left on failure\n", size);
+      ret_value = false;
+      goto done;
+    }
+  }
+
+done:
+  aes_gcm_use_clmul = use_clmul;
+  unlink(plain_file);
+  unlink(cipher_file);
+  unlink(recovered_file);
+  delete []plain;
+  delete []cipher;
+  delete []recovered;
+  return ret_value;
+}
+
 TEST (aes_sha256_ctr, test_aes_sha256_ctr) {
   EXPECT_TRUE(test_aes_sha256_ctr_test1());
   EXPECT_TRUE(test_aes_sha256_ctr_test2());
@@ -530,6 +772,13 @@ TEST (aes_sha256_cbc, test_aes_sha256_cbc) {
   EXPECT_TRUE(test_aes_sha256_cbc_test1());
   EXPECT_TRUE(test_aes_sha256_cbc_test2());
 }
+TEST (aes_sha256_bulk, test_aes_sha256_bulk) {
+  EXPECT_TRUE(test_aes_sha256_bulk("ctr"));
+  EXPECT_TRUE(test_aes_sha256_bulk("cbc"));
+}
+TEST (aes_gcm, test_aes_gcm_scheme) {
+  EXPECT_TRUE(test_aes_gcm_scheme());
+}
 
 int main(int an, char** av) {
   gflags::ParseCommandLineFlags(&an, &av, true);
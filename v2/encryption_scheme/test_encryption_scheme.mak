@@ -42,12 +42,12 @@ S_BIGNUM=$(SRC_DIR)/big_num
 INCLUDE= -I$(SRC_DIR)/include -I$(S) -I$(S_SUPPORT) -I/usr/local/include
 
 ifndef NEWPROTOBUF
-CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++11 -Wno-unused-variable
-CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++11 -Wno-unused-variable
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++11 -Wno-unused-variable -D X64
+CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++11 -Wno-unused-variable -D X64
 LDFLAGS= -lprotobuf -lgtest -lgflags -lpthread
 else
-CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++17 -Wno-unused-variable
-CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++17 -Wno-unused-variable
+CFLAGS=$(INCLUDE) -O3 -g -Wall -std=c++17 -Wno-unused-variable -D X64
+CFLAGS1=$(INCLUDE) -O1 -g -Wall -std=c++17 -Wno-unused-variable -D X64
 export LD_LIBRARY_PATH=/usr/local/lib
 LDFLAGS= -L/usr/local/lib `pkg-config --cflags --libs protobuf` -lgtest -lgflags -lpthread
 endif
@@ -58,7 +58,7 @@ PROTO=protoc
 AR=ar
 
 dobj=   $(O)/test_encryption_scheme.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o \
-	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/twofish.o $(O)/hash.o $(O)/sha256.o \
+	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/aes_gcm.o $(O)/twofish.o $(O)/hash.o $(O)/sha256.o \
 	$(O)/hmac_sha256.o $(O)/aesni.o $(O)/encryption_scheme.o $(O)/globals.o $(O)/intel_digit_arith.o \
 	$(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o
 
@@ -104,6 +104,10 @@ $(O)/aes.o: $(S_SYMMETRIC)/aes.cc
 	@echo "compiling aes.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes.o $(S_SYMMETRIC)/aes.cc
 
+$(O)/aes_gcm.o: $(S_SYMMETRIC)/aes_gcm.cc
+	@echo "compiling aes_gcm.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes_gcm.o $(S_SYMMETRIC)/aes_gcm.cc
+
 $(O)/twofish.o: $(S_SYMMETRIC)/twofish.cc
 	@echo "compiling twofish.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/twofish.o $(S_SYMMETRIC)/twofish.cc
@@ -49,7 +49,7 @@ AR=ar
 LDFLAGS= -lprotobuf -lgtest -lgflags -lpthread
 
 dobj=   $(O)/test_encryption_scheme.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o \
-	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/twofish.o $(O)/hash.o $(O)/sha256.o \
+	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/aes_gcm.o $(O)/twofish.o $(O)/hash.o $(O)/sha256.o \
 	$(O)/hmac_sha256.o $(O)/encryption_scheme.o $(O)/globals.o $(O)/arm64_digit_arith.o \
  	$(O)/big_num.o $(O)/basic_arith.o $(O)/number_theory.o
 
@@ -95,6 +95,10 @@ $(O)/aes.o: $(S_SYMMETRIC)/aes.cc
 	@echo "compiling aes.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes.o $(S_SYMMETRIC)/aes.cc
 
+$(O)/aes_gcm.o: $(S_SYMMETRIC)/aes_gcm.cc
+	@echo "compiling aes_gcm.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes_gcm.o $(S_SYMMETRIC)/aes_gcm.cc
+
 $(O)/twofish.o: $(S_SYMMETRIC)/twofish.cc
 	@echo "compiling twofish.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/twofish.o $(S_SYMMETRIC)/twofish.cc
@@ -16,6 +16,7 @@
 #include "crypto_support.h"
 #include "hash.h"
 #include "sha256.h"
+#include "pkcs.h"
 
 /*
  * EMSA-PKCS1-v1_5-ENCODE (M, emLen)
@@ -187,3 +188,253 @@ bool pkcs_extract(int in_size, byte_t* in, int* out_size, byte_t* out) {
   memcpy(out, &in[m], n);
   return true;
 }
+
+/*
+ * RSASSA-PSS and RSAES-OAEP, RFC 8017 sections 9.1 and 7.1
+ *   EMSA-PSS-ENCODE (mHash, emBits), sLen = hLen:
+ *     M'   = 00 00 00 00 00 00 00 00 || mHash || salt
+ *     H    = Hash(M')
+ *     DB   = PS || 01 || salt, PS zeros, emLen - hLen - 1 octets
+ *     EM   = (DB xor MGF1(H)) || H || bc, with the top 8 emLen - emBits
+ *            bits of EM cleared
+ *   EME-OAEP encoding of M with label L into k octets:
+ *     DB   = Hash(L) || PS || 01 || M, PS zeros, k - hLen - 1 octets
+ *     maskedDB   = DB xor MGF1(seed)
+ *     maskedSeed = seed xor MGF1(maskedDB)
+ *     EM   = 00 || maskedSeed || maskedDB
+ * The message hash comes from a pkcs_hash, so a caller can stream the
+ * message through it rather than hold it in memory.  Digests from it are
+ * standard octet strings.
+ */
+
+pkcs_hash::pkcs_hash() {
+  use_sha3_ = false;
+  digest_size_ = 0;
+}
+
+bool pkcs_hash::init(const char* hash_alg) {
+  if (strcmp(hash_alg, "sha-256") == 0) {
+    use_sha3_ = false;
+    digest_size_ = sha256::DIGESTBYTESIZE;
+    return sha256_.init();
+  } else if (strcmp(hash_alg, "sha3-256") == 0) {
+    use_sha3_ = true;
+    digest_size_ = 32;
+    return sha3_.init(512, 256);
+  }
+  return false;
+}
+
+void pkcs_hash::add_to_hash(int size, const byte_t* in) {
+  if (use_sha3_)
+    sha3_.add_to_hash(size, in);
+  else
+    sha256_.add_to_hash(size, in);
+}
+
+void pkcs_hash::finalize() {
+  if (use_sha3_)
+    sha3_.finalize();
+  else
+    sha256_.finalize();
+}
+
+// sha256 leaves its digest as host order words; the encodings want the
+// FIPS 180-4 octet string.
+bool pkcs_hash::get_digest(int size, byte_t* out) {
+  if (use_sha3_)
+    return sha3_.get_digest(size, out);
+  if (!sha256_.get_digest(size, out))
+    return false;
+#ifndef BIGENDIAN
+  uint32_t w;
+  for (int i = 0; i < sha256::DIGESTBYTESIZE; i += (int)sizeof(uint32_t)) {
+    memcpy(&w, &out[i], sizeof(uint32_t));
+    little_to_big_endian_32(&w, (uint32_t*)&out[i]);
+  }
+#endif
+  return true;
+}
+
+int pkcs_digest_size(const char* hash_alg) {
+  if (strcmp(hash_alg, "sha-256") == 0 || strcmp(hash_alg, "sha3-256") == 0)
+    return 32;
+  return -1;
+}
+
+bool pkcs_mgf1_xor(const char* hash_alg, int seed_size, byte_t* seed,
+                   int mask_size, byte_t* buf) {
+  int h_len = pkcs_digest_size(hash_alg);
+  if (h_len <= 0)
+    return false;
+  byte_t counter[4];
+  byte_t t[h_len];
+  pkcs_hash h;
+
+  for (uint32_t i = 0; mask_size > 0; i++) {
+    counter[0] = (byte_t)(i >> 24);
+    counter[1] = (byte_t)(i >> 16);
+    counter[2] = (byte_t)(i >> 8);
+    counter[3] = (byte_t)i;
+    if (!h.init(hash_alg))
+      return false;
+    h.add_to_hash(seed_size, seed);
+    h.add_to_hash(4, counter);
+    h.finalize();
+    if (!h.get_digest(h_len, t))
+      return false;
+    int n = mask_size < h_len ? mask_size : h_len;
+    for (int j = 0; j < n; j++)
+      buf[j] ^= t[j];
+    buf += n;
+    mask_size -= n;
+  }
+  return true;
+}
+
+// H = Hash(00^8 || mHash || salt)
+static bool pss_hash(const char* hash_alg, int h_len, byte_t* hash,
+                     byte_t* salt, byte_t* out) {
+  byte_t zeros[8];
+  pkcs_hash h;
+
+  memset(zeros, 0, 8);
+  if (!h.init(hash_alg))
+    return false;
+  h.add_to_hash(8, zeros);
+  h.add_to_hash(h_len, hash);
+  h.add_to_hash(h_len, salt);
+  h.finalize();
+  return h.get_digest(h_len, out);
+}
+
+bool pkcs_pss_encode(const char* hash_alg, byte_t* hash, int em_bits,
+                     int out_size, byte_t* out) {
+  int h_len = pkcs_digest_size(hash_alg);
+  int em_len = (em_bits + 7) / NBITSINBYTE;
+  if (h_len <= 0 || out_size != em_len || em_len < 2 * h_len + 2)
+    return false;
+  int db_len = em_len - h_len - 1;
+  byte_t* salt = &out[db_len - h_len];
+  byte_t* h = &out[db_len];
+
+  memset(out, 0, db_len - h_len - 1);
+  out[db_len - h_len - 1] = 0x01;
+  if (crypto_get_random_bytes(h_len, salt) != h_len)
+    return false;
+  if (!pss_hash(hash_alg, h_len, hash, salt, h))
+    return false;
+  if (!pkcs_mgf1_xor(hash_alg, h_len, h, db_len, out))
+    return false;
+  out[0] &= 0xff >> (NBITSINBYTE * em_len - em_bits);
+  out[em_len - 1] = 0xbc;
+  return true;
+}
+
+bool pkcs_pss_verify(const char* hash_alg, byte_t* hash, int em_bits,
+                     int in_size, byte_t* in) {
+  int h_len = pkcs_digest_size(hash_alg);
+  int em_len = (em_bits + 7) / NBITSINBYTE;
+  if (h_len <= 0 || in_size != em_len || em_len < 2 * h_len + 2)
+    return false;
+  int db_len = em_len - h_len - 1;
+  byte_t top_mask = 0xff >> (NBITSINBYTE * em_len - em_bits);
+  byte_t db[db_len];
+  byte_t h[h_len];
+
+  if (in[em_len - 1] != 0xbc || (in[0] & ~top_mask) != 0)
+    return false;
+  memcpy(db, in, db_len);
+  if (!pkcs_mgf1_xor(hash_alg, h_len, &in[db_len], db_len, db))
+    return false;
+  db[0] &= top_mask;
+  for (int i = 0; i < db_len - h_len - 1; i++) {
+    if (db[i] != 0)
+      return false;
+  }
+  if (db[db_len - h_len - 1] != 0x01)
+    return false;
+  if (!pss_hash(hash_alg, h_len, hash, &db[db_len - h_len], h))
+    return false;
+  return memcmp(h, &in[db_len], h_len) == 0;
+}
+
+bool pkcs_oaep_embed(const char* hash_alg, int label_size, byte_t* label,
+                     int in_size, byte_t* in, int out_size, byte_t* out) {
+  int h_len = pkcs_digest_size(hash_alg);
+  if (h_len <= 0 || in_size < 0 || in_size > out_size - 2 * h_len - 2)
+    return false;
+  int db_len = out_size - h_len - 1;
+  byte_t* seed = &out[1];
+  byte_t* db = &out[1 + h_len];
+  pkcs_hash h;
+
+  out[0] = 0;
+  if (!h.init(hash_alg))
+    return false;
+  if (label_size > 0)
+    h.add_to_hash(label_size, label);
+  h.finalize();
+  if (!h.get_digest(h_len, db))
+    return false;
+  memset(&db[h_len], 0, db_len - h_len - in_size - 1);
+  db[db_len - in_size - 1] = 0x01;
+  memcpy(&db[db_len - in_size], in, in_size);
+  if (crypto_get_random_bytes(h_len, seed) != h_len)
+    return false;
+  if (!pkcs_mgf1_xor(hash_alg, h_len, seed, db_len, db))
+    return false;
+  return pkcs_mgf1_xor(hash_alg, db_len, db, h_len, seed);
+}
+
+// The checks are accumulated and reported once, so a failure doesn't say
+// which part of the block was wrong.
+bool pkcs_oaep_extract(const char* hash_alg, int label_size, byte_t* label,
+                       int in_size, byte_t* in, int* out_size, byte_t* out) {
+  int h_len = pkcs_digest_size(hash_alg);
+  if (h_len <= 0 || in_size < 2 * h_len + 2)
+    return false;
+  int db_len = in_size - h_len - 1;
+  byte_t seed[h_len];
+  byte_t db[db_len];
+  byte_t l_hash[h_len];
+  pkcs_hash h;
+
+  if (!h.init(hash_alg))
+    return false;
+  if (label_size > 0)
+    h.add_to_hash(label_size, label);
+  h.finalize();
+  if (!h.get_digest(h_len, l_hash))
+    return false;
+  memcpy(seed, &in[1], h_len);
+  memcpy(db, &in[1 + h_len], db_len);
+  if (!pkcs_mgf1_xor(hash_alg, db_len, db, h_len, seed) ||
+      !pkcs_mgf1_xor(hash_alg, h_len, seed, db_len, db))
+    return false;
+
+  uint32_t bad = in[0];
+  for (int i = 0; i < h_len; i++)
+    bad |= db[i] ^ l_hash[i];
+  // index of the 01 after PS, found without branching on the data
+  uint32_t looking = 1;
+  int start = 0;
+  for (int i = h_len; i < db_len; i++) {
+    uint32_t is_one = (uint32_t)(((uint32_t)(db[i] ^ 0x01) - 1) >> 31);
+    uint32_t is_zero = (uint32_t)(((uint32_t)db[i] - 1) >> 31);
+    start |= (int)(0 - (looking & is_one)) & (i + 1);
+    bad |= looking & ~is_one & ~is_zero & 1;
+    looking &= ~is_one;
+  }
+  bad |= looking;
+  int n = db_len - start;
+  memset(seed, 0, h_len);
+  if (bad != 0 || n > *out_size) {
+    memset(db, 0, db_len);
+    return false;
+  }
+  *out_size = n;
+  memcpy(out, &db[start], n);
+  memset(db, 0, db_len);
+  return true;
+}
@@ -0,0 +1,191 @@
+//
+// Copyright 2014 John Manferdelli, All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: sha512.cc
+
+#include "crypto_support.h"
+#include "hash.h"
+#include "sha512.h"
+
+static const uint64_t K[80] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL,
+    0xe9b5dba58189dbbcULL, 0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL,
+    0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL, 0xd807aa98a3030242ULL,
+    0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL,
+    0xc19bf174cf692694ULL, 0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL,
+    0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL, 0x2de92c6f592b0275ULL,
+    0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL,
+    0xbf597fc7beef0ee4ULL, 0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL,
+    0x06ca6351e003826fULL, 0x142929670a0e6e70ULL, 0x27b70a8546d22ffcULL,
+    0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL,
+    0x92722c851482353bULL, 0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL,
+    0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL, 0xd192e819d6ef5218ULL,
+    0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL,
+    0x34b0bcb5e19b48a8ULL, 0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL,
+    0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL, 0x748f82ee5defb2fcULL,
+    0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL,
+    0xc67178f2e372532bULL, 0xca273eceea26619cULL, 0xd186b8c721c0c207ULL,
+    0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL, 0x06f067aa72176fbaULL,
+    0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL,
+    0x431d67c49c100d4cULL, 0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL,
+    0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL};
+
+// Circular right shift in 64 bits
+inline uint64_t rotr64(uint64_t x, int y) {
+  return (x >> y) | (x << (64 - y));
+}
+
+#define Ch(x, y, z) (z ^ (x & (y ^ z)))
+#define Maj(x, y, z) ((x & y) | (z & (x | y)))
+#define S0(x) (rotr64(x, 28) ^ rotr64(x, 34) ^ rotr64(x, 39))
+#define S1(x) (rotr64(x, 14) ^ rotr64(x, 18) ^ rotr64(x, 41))
+#define s0(x) (rotr64(x, 1) ^ rotr64(x, 8) ^ (x >> 7))
+#define s1(x) (rotr64(x, 19) ^ rotr64(x, 61) ^ (x >> 6))
+
+sha512::sha512() {
+  num_bytes_waiting_ = 0;
+  num_bits_processed_ = 0;
+}
+
+sha512::~sha512() {}
+
+bool sha512::init() {
+  num_bytes_waiting_ = 0;
+  num_bits_processed_ = 0;
+  hash_name_.assign("sha-512");
+  finalized_ = false;
+  memset(bytes_waiting_, 0, BLOCKBYTESIZE);
+  memset(digest_, 0, DIGESTBYTESIZE);
+  state_[0] = 0x6a09e667f3bcc908ULL;
+  state_[1] = 0xbb67ae8584caa73bULL;
+  state_[2] = 0x3c6ef372fe94f82bULL;
+  state_[3] = 0xa54ff53a5f1d36f1ULL;
+  state_[4] = 0x510e527fade682d1ULL;
+  state_[5] = 0x9b05688c2b3e6c1fULL;
+  state_[6] = 0x1f83d9abfb41bd6bULL;
+  state_[7] = 0x5be0cd19137e2179ULL;
+  return true;
+}
+
+void sha512::transform_block(const uint64_t* block) {
+  uint64_t W[80];
+  uint64_t a, b, c, d, e, f, g, h, t1, t2;
+  int i;
+
+#ifndef BIGENDIAN
+  for (i = 0; i < 16; i++)
+    little_to_big_endian_64((uint64_t*)&block[i], &W[i]);
+#else
+  for (i = 0; i < 16; i++) W[i] = block[i];
+#endif
+  for (i = 16; i < 80; i++)
+    W[i] = s1(W[i - 2]) + W[i - 7] + s0(W[i - 15]) + W[i - 16];
+
+  a = state_[0];
+  b = state_[1];
+  c = state_[2];
+  d = state_[3];
+  e = state_[4];
+  f = state_[5];
+  g = state_[6];
+  h = state_[7];
+  for (i = 0; i < 80; i++) {
+    t1 = h + S1(e) + Ch(e, f, g) + K[i] + W[i];
+    t2 = S0(a) + Maj(a, b, c);
+    h = g;
+    g = f;
+    f = e;
+    e = d + t1;
+    d = c;
+    c = b;
+    b = a;
+    a = t1 + t2;
+  }
+  state_[0] += a;
+  state_[1] += b;
+  state_[2] += c;
+  state_[3] += d;
+  state_[4] += e;
+  state_[5] += f;
+  state_[6] += g;
+  state_[7] += h;
+  memset(W, 0, sizeof(W));
+}
+
+void sha512::add_to_hash(int size, const byte_t* in) {
+  if (num_bytes_waiting_ > 0) {
+    int needed = BLOCKBYTESIZE - num_bytes_waiting_;
+    if (size < needed) {
+      memcpy(&bytes_waiting_[num_bytes_waiting_], in, size);
+      num_bytes_waiting_ += size;
+      return;
+    }
+    memcpy(&bytes_waiting_[num_bytes_waiting_], in, needed);
+    transform_block((const uint64_t*)bytes_waiting_);
+    num_bits_processed_ += BLOCKBYTESIZE * NBITSINBYTE;
+    size -= needed;
+    in += needed;
+    num_bytes_waiting_ = 0;
+  }
+  while (size >= BLOCKBYTESIZE) {
+    memcpy(bytes_waiting_, in, BLOCKBYTESIZE);
+    transform_block((const uint64_t*)bytes_waiting_);
+    num_bits_processed_ += BLOCKBYTESIZE * NBITSINBYTE;
+    size -= BLOCKBYTESIZE;
+    in += BLOCKBYTESIZE;
+  }
+  if (size > 0) {
+    num_bytes_waiting_ = size;
+    memcpy(bytes_waiting_, in, size);
+  }
+}
+
+bool sha512::get_digest(int size, byte_t* out) {
+  if (!finalized_) return false;
+  if (size < DIGESTBYTESIZE) return false;
+  memcpy(out, digest_, DIGESTBYTESIZE);
+  return true;
+}
+
+// The length field is 128 bits, messages here are under 2^64 bits.
+void sha512::finalize() {
+  uint64_t num_bits = num_bits_processed_ + num_bytes_waiting_ * NBITSINBYTE;
+
+  // append 1
+  bytes_waiting_[num_bytes_waiting_++] = 0x80;
+  if ((num_bytes_waiting_ + 2 * sizeof(uint64_t)) > BLOCKBYTESIZE) {
+    memset(&bytes_waiting_[num_bytes_waiting_], 0,
+           BLOCKBYTESIZE - num_bytes_waiting_);
+    transform_block((const uint64_t*)bytes_waiting_);
+    num_bytes_waiting_ = 0;
+  }
+
+  // zero and set bits processed
+  memset(&bytes_waiting_[num_bytes_waiting_], 0,
+         (BLOCKBYTESIZE - num_bytes_waiting_ - sizeof(uint64_t)));
+  uint64_t* psize = (uint64_t*)&bytes_waiting_[BLOCKBYTESIZE - sizeof(uint64_t)];
+#ifndef BIGENDIAN
+  little_to_big_endian_64(&num_bits, psize);
+#else
+  *psize = num_bits;
+#endif
+  transform_block((const uint64_t*)bytes_waiting_);
+  memcpy(digest_, (byte_t*)state_, DIGESTBYTESIZE);
+  finalized_ = true;
+}
@@ -21,6 +21,7 @@
 #include "hash.h"
 #include "sha1.h"
 #include "sha256.h"
+#include "sha512.h"
 #include "sha3.h"
 #include "hmac_sha256.h"
 #include "pkcs.h"
@@ -67,6 +68,23 @@ uint32_t sha256_test3_answer[8] = {
   0x0b249b11, 0xe8f07a51, 0xafac4503, 0x7afee9d1
 };
 
+// sha512 tests
+const byte_t* sha512_test1_input = (const byte_t*)"abc";
+int sha512_test1_size= 3;
+uint64_t sha512_test1_answer[8] = {
+  0xddaf35a193617abaULL, 0xcc417349ae204131ULL, 0x12e6fa4e89a97ea2ULL,
+  0x0a9eeee64b55d39aULL, 0x2192992a274fc1a8ULL, 0x36ba3c23a3feebbdULL,
+  0x454d4423643ce80eULL, 0x2a9ac94fa54ca49fULL
+};
+const byte_t* sha512_test2_input=
+      (const byte_t*)"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu";
+int sha512_test2_size= 112;
+uint64_t sha512_test2_answer[8] = {
+  0x8e959b75dae313daULL, 0x8cf4f72814fc143fULL, 0x8f7779c6eb9f7fa1ULL,
+  0x7299aeadb6889018ULL, 0x501d289e4900f7e4ULL, 0x331b99dec4b5433aULL,
+  0xc7d329eeb6dd2654ULL, 0x5e96e55b874be909ULL
+};
+
 // sha-3
 
 const int sha3_testa_size = 0;
@@ -273,6 +291,49 @@ bool test_sha256() {
   return true;
 }
 
+bool test_sha512() {
+  sha512 hash_object;
+
+  byte_t digest1[hash_object.DIGESTBYTESIZE];
+  byte_t digest2[hash_object.DIGESTBYTESIZE];
+
+  if (!hash_object.init())
+    return false;
+  hash_object.add_to_hash(sha512_test1_size, sha512_test1_input);
+  hash_object.finalize();
+  if (!hash_object.get_digest(hash_object.DIGESTBYTESIZE, digest1))
+    return false;
+  if (FLAGS_print_all) {
+    printf("Bytes to hash  : "); print_bytes(sha512_test1_size, (byte_t*)sha512_test1_input);
+    printf("Correct digest : "); print_bytes(hash_object.DIGESTBYTESIZE, (byte_t*)sha512_test1_answer);
+    printf("Computed digest: "); print_bytes(hash_object.DIGESTBYTESIZE, digest1);
+  }
+  if (memcmp((const void *)sha512_test1_answer,
+             (const void *) digest1, hash_object.DIGESTBYTESIZE) != 0)
+    return false;
+
+  // feed the second message in uneven pieces to cross the block boundary
+  if (!hash_object.init())
+    return false;
+  hash_object.add_to_hash(5, sha512_test2_input);
+  hash_object.add_to_hash(sha512_test2_size - 5, &sha512_test2_input[5]);
+  hash_object.finalize();
+  if (!hash_object.get_digest(hash_object.DIGESTBYTESIZE, digest2))
+    return false;
+  if (FLAGS_print_all) {
+    printf("Bytes to hash  : "); print_bytes(sha512_test2_size,
+                                             (byte_t*)sha512_test2_input);
+    printf("Correct digest : "); print_bytes(hash_object.DIGESTBYTESIZE,
+                                             (byte_t*)sha512_test2_answer);
+    printf("Computed digest: "); print_bytes(hash_object.DIGESTBYTESIZE, digest2);
+  }
+  if (memcmp((const void *)sha512_test2_answer,
+             (const void *) digest2, hash_object.DIGESTBYTESIZE) != 0)
+    return false;
+
+  return true;
+}
+
 bool test_sha3() {
   sha3 hash_object;
   byte_t digest[1024 / NBITSINBYTE];
@@ -534,6 +595,92 @@ bool test_pkcs() {
   return true;
 }
 
+bool test_pkcs_pss_oaep() {
+  const char* algs[] = {"sha-256", "sha3-256"};
+  byte_t abc_digests[2][32] = {
+    {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40,
+     0xde, 0x5d, 0xae, 0x22, 0x23, 0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17,
+     0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+    {0x3a, 0x98, 0x5d, 0xa7, 0x4f, 0xe2, 0x25, 0xb2, 0x04, 0x5c, 0x17,
+     0x2d, 0x6b, 0xd3, 0x90, 0xbd, 0x85, 0x5f, 0x08, 0x6e, 0x3e, 0x9d,
+     0x52, 0x5b, 0x46, 0xbf, 0xe2, 0x45, 0x11, 0x43, 0x15, 0x32},
+  };
+  byte_t digest[32];
+  byte_t in[64];
+  byte_t out[256];
+  byte_t new_out[256];
+  int new_out_size;
+  pkcs_hash h;
+
+  for (int a = 0; a < 2; a++) {
+    // streamed in pieces
+    if (!h.init(algs[a]))
+      return false;
+    h.add_to_hash(1, (byte_t*)"a");
+    h.add_to_hash(2, (byte_t*)"bc");
+    h.finalize();
+    if (!h.get_digest(32, digest) || memcmp(digest, abc_digests[a], 32) != 0) {
+      printf("pkcs_hash %s wrong\n", algs[a]);
+      return false;
+    }
+
+    // PSS, full and short top byte
+    int em_bits[] = {2047, 2044};
+    for (int j = 0; j < 2; j++) {
+      memset(out, 0, 256);
+      if (!pkcs_pss_encode(algs[a], digest, em_bits[j], 256, out)) {
+        printf("pkcs_pss_encode %s failed\n", algs[a]);
+        return false;
+      }
+      if (FLAGS_print_all) {
+        printf("pss encoded: ");
+        print_bytes(256, out);
+        printf("\n");
+      }
+      if (!pkcs_pss_verify(algs[a], digest, em_bits[j], 256, out)) {
+        printf("pkcs_pss_verify %s failed\n", algs[a]);
+        return false;
+      }
+      out[100] ^= 0x01;
+      if (pkcs_pss_verify(algs[a], digest, em_bits[j], 256, out)) {
+        printf("pkcs_pss_verify %s accepts a changed block\n", algs[a]);
+        return false;
+      }
+    }
+
+    // OAEP, with and without a label
+    memset(in, 0xbb, 64);
+    for (int j = 0; j < 2; j++) {
+      int label_size = j == 0 ? 0 : 5;
+      byte_t* label = (byte_t*)"label";
+      memset(out, 0, 256);
+      if (!pkcs_oaep_embed(algs[a], label_size, label, 64, in, 256, out)) {
+        printf("pkcs_oaep_embed %s failed\n", algs[a]);
+        return false;
+      }
+      new_out_size = 256;
+      memset(new_out, 0, 256);
+      if (!pkcs_oaep_extract(algs[a], label_size, label, 256, out,
+                             &new_out_size, new_out) ||
+          new_out_size != 64 || memcmp(new_out, in, 64) != 0) {
+        printf("pkcs_oaep_extract %s failed\n", algs[a]);
+        return false;
+      }
+      new_out_size = 256;
+      if (pkcs_oaep_extract(algs[a], 5, (byte_t*)"lobel", 256, out,
+                            &new_out_size, new_out)) {
+        printf("pkcs_oaep_extract %s accepts the wrong label\n", algs[a]);
+        return false;
+      }
+    }
+    if (pkcs_oaep_embed(algs[a], 0, nullptr, 256 - 2 * 32 - 1, out, 256, out)) {
+      printf("pkcs_oaep_embed %s accepts a message too long\n", algs[a]);
+      return false;
+    }
+  }
+  return true;
+}
+
 bool test_pkdf2() {
   byte_t out[256];
   int salt_size = 24;
@@ -571,12 +718,18 @@ TEST (sha1, test_sha1) {
 TEST (sha2, sha2) {
   EXPECT_TRUE(test_sha256());
 }
+TEST (sha2, sha512) {
+  EXPECT_TRUE(test_sha512());
+}
 TEST(hmac, test_hmac_sha256) {
   EXPECT_TRUE(test_hmac_sha256());
 }
 TEST (pkcs1, test_pkcs) {
   EXPECT_TRUE(test_pkcs());
 }
+TEST (pkcs1, test_pkcs_pss_oaep) {
+  EXPECT_TRUE(test_pkcs_pss_oaep());
+}
 TEST (pkdf, test_pkdf2) {
   EXPECT_TRUE(test_pkdf2());
 }
@@ -53,7 +53,7 @@ PROTO=protoc
 AR=ar
 
 dobj=	$(O)/test_hash.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/hash.o \
-        $(O)/sha1.o $(O)/sha256.o $(O)/hmac_sha256.o $(O)/pkcs.o $(O)/pbkdf2.o $(O)/sha3.o
+        $(O)/sha1.o $(O)/sha256.o $(O)/sha512.o $(O)/hmac_sha256.o $(O)/pkcs.o $(O)/pbkdf2.o $(O)/sha3.o
 
 all:	test_hash.exe
 clean:
@@ -97,6 +97,10 @@ $(O)/sha256.o: $(S)/sha256.cc
 	@echo "compiling sha256.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha256.o $(S)/sha256.cc
 
+$(O)/sha512.o: $(S)/sha512.cc
+	@echo "compiling sha512.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha512.o $(S)/sha512.cc
+
 $(O)/hmac_sha256.o: $(S)/hmac_sha256.cc
 	@echo "compiling hmac_sha256.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/hmac_sha256.o $(S)/hmac_sha256.cc
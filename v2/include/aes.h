@@ -67,6 +67,11 @@ class aesni : public symmetric_cipher {
   void decrypt_block(const byte_t* in, byte_t* out);
   void encrypt(int byte_size, byte_t* in, byte_t* out);
   void decrypt(int byte_size, byte_t* in, byte_t* out);
+  void ctr_encrypt(int byte_size, byte_t* counter, byte_t* in, byte_t* out);
+  void cbc_decrypt(int byte_size, byte_t* iv, byte_t* in, byte_t* out);
 };
 
+// Use the VAES kernels in aesni, set at startup from cpuid.
+extern bool aesni_use_vaes;
+
 #endif
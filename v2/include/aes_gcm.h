@@ -0,0 +1,66 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: aes_gcm.h
+
+#ifndef _CRYPTO_AES_GCM_H__
+#define _CRYPTO_AES_GCM_H__
+
+#include "crypto_support.h"
+#include "symmetric_cipher.h"
+#include "aes.h"
+
+// AES-GCM, NIST SP 800-38D, with 96 bit IVs and 128 bit tags.
+//   For each message: start, add_aad, then encrypt or decrypt, then
+//   finalize or verify.  Every add_aad, encrypt or decrypt call except the
+//   last one of its kind must be a multiple of BLOCKBYTESIZE.
+class aes_gcm {
+ public:
+  enum {
+    BLOCKBYTESIZE = 16,
+    IVBYTESIZE = 12,
+    TAGBYTESIZE = 16,
+    NUMHPOWERS = 8
+  };
+
+  bool initialized_;
+  bool use_clmul_;
+  aes aes_obj_;
+#if defined(X64)
+  aesni ni_obj_;
+#endif
+
+  // H^1, ..., H^NUMHPOWERS, two words each; byte reflected for the clmul
+  //   kernels, big endian words otherwise.  x_ is the running GHASH value
+  //   in the same form.
+  uint64_t h_[2 * NUMHPOWERS];
+  uint64_t x_[2];
+  byte_t j0_[BLOCKBYTESIZE];
+  uint32_t counter_;
+  uint64_t aad_size_;
+  uint64_t text_size_;
+
+  aes_gcm();
+  ~aes_gcm();
+
+  bool init(int key_bit_size, byte_t* key);
+  bool start(int iv_size, byte_t* iv);
+  void add_aad(int size, byte_t* aad);
+  void encrypt(int size, byte_t* in, byte_t* out);
+  void decrypt(int size, byte_t* in, byte_t* out);
+  void finalize(byte_t* tag);
+  bool verify(byte_t* tag);
+};
+
+// Use the AES-NI and PCLMULQDQ kernels, set at startup from cpuid.
+extern bool aes_gcm_use_clmul;
+
+#endif
@@ -19,6 +19,67 @@
 #ifndef _CRYPTO_BIG_NUM_H__
 #define _CRYPTO_BIG_NUM_H__
 
+// big_num's with at most BIG_NUM_INLINE_DIGITS digits keep their value
+//   inside the object; the default covers double width P-521 products.
+#ifndef BIG_NUM_INLINE_DIGITS
+#define BIG_NUM_INLINE_DIGITS 20
+#endif
+
+// Bump allocator for big_num digits.
+//   Digits come from large blocks and are only given back in bulk, by
+//   rewind or release, which zero them; blocks are kept for reuse until
+//   the arena is destroyed.  An arena is not thread safe.  A big_num
+//   draws from an arena when one is passed to its constructor or when
+//   one is installed as the calling thread's arena, usually through a
+//   big_num_arena_scope.  Every big_num using an arena must be destroyed
+//   before the storage under it is rewound.
+class big_num_arena {
+ public:
+  struct mark {
+    int block_;
+    int used_;
+  };
+
+  big_num_arena(int block_digits = 4096);
+  ~big_num_arena();
+
+  uint64_t* alloc(int n);
+  mark get_mark();
+  void rewind(mark& m);
+  void release();
+
+  // per thread arena, created on first use
+  static big_num_arena* thread_pool();
+  // arena new big_num's on this thread draw from, nullptr if none
+  static big_num_arena* thread_arena();
+  // returns the previously installed arena
+  static big_num_arena* set_thread_arena(big_num_arena* arena);
+
+ private:
+  int block_digits_;
+  int num_blocks_;
+  int max_blocks_;
+  int current_;
+  int used_;
+  int* block_size_;
+  uint64_t** blocks_;
+};
+
+// Installs an arena (the thread pool by default) for the current
+//   thread and, on exit, rewinds it and restores the previous one.
+//   Declare it before the big_num's it should cover.
+class big_num_arena_scope {
+ public:
+  big_num_arena_scope();
+  big_num_arena_scope(big_num_arena* arena);
+  ~big_num_arena_scope();
+
+ private:
+  big_num_arena* arena_;
+  big_num_arena* previous_;
+  big_num_arena::mark mark_;
+};
+
 //  num= value_[0]+ 2^64 value_[1] + ... + 2^(64n) value_[n]
 class big_num {
  public:
@@ -28,10 +89,12 @@ class big_num {
   __attribute__((aligned(8))) uint64_t* value_;
 
   big_num(int size);
+  big_num(big_num_arena* arena, int size);
   big_num(big_num& n);
   big_num(big_num& n, int capacity);
   big_num(int size, uint64_t);  // big_num with one initialized digit
   ~big_num();
+  big_num& operator=(const big_num&) = delete;
 
   int capacity();  // total number of digits (64 bits) allocated
   int size();      // number of digit required to hold current value
@@ -47,6 +110,12 @@ class big_num {
   bool copy_from(big_num&);
   bool copy_to(big_num&);
   void print();
+
+ private:
+  big_num_arena* arena_;  // non-null if value_ came from an arena
+  __attribute__((aligned(8))) uint64_t inline_[BIG_NUM_INLINE_DIGITS];
+
+  void allocate(int size, big_num_arena* arena);
 };
 
 extern int num_smallest_primes;
@@ -26,6 +26,13 @@ int big_max_power_of_two_dividing(big_num& a);
 bool big_shift(big_num& a, int64_t shift, big_num& r);
 bool big_unsigned_add(big_num& a, big_num& b, big_num& r);
 bool big_unsigned_sub(big_num& a, big_num& b, big_num& r);
+extern int big_karatsuba_threshold;
+extern int big_karatsuba_square_threshold;
+extern int big_toom3_threshold;
+int digit_array_fast_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
+                   int size_result, uint64_t* result);
+int digit_array_fast_square(int size_a, uint64_t* a, int size_result,
+                   uint64_t* result);
 bool big_unsigned_mult(big_num& a, big_num& b, big_num& r);
 bool big_unsigned_euclid(big_num& a, big_num& b, big_num& q, big_num& r);
 bool big_unsigned_div(big_num& a, big_num& b, big_num& q);
@@ -54,9 +61,13 @@ bool big_mod_neg(big_num& a, big_num& m, big_num& r);
 bool big_mod_mult(big_num& a, big_num& b, big_num& m, big_num& r);
 bool big_mod_square(big_num& a, big_num& m, big_num& r);
 bool big_mod_inv(big_num& a, big_num& m, big_num& r);
+bool big_mod_inv_ct(big_num& a, big_num& m, big_num& r);
+bool big_batch_mod_inv(int n, big_num** in, big_num& m, big_num** out);
 bool big_mod_div(big_num& a, big_num& b, big_num& m, big_num& r);
 bool big_mod_exp(big_num& a, big_num& e, big_num& m, big_num& r);
-bool big_gen_prime(big_num& p, uint64_t num_bits, int prime_trys=2500);
+extern int big_prime_threads;
+bool big_gen_prime(big_num& p, uint64_t num_bits, int prime_trys=2500,
+                   int num_threads=0);
 int big_high_bit(big_num& a);
 bool big_miller_rabin(big_num& n, big_num** random_a, int trys);
 bool big_is_prime(big_num& n);
@@ -71,4 +82,95 @@ bool big_mont_mult(big_num& aR, big_num& bR, big_num& m, uint64_t r, big_num& m_
                  big_num& abR);
 bool big_mont_exp(big_num& b, big_num& e, int r, big_num& m, big_num& m_prime, big_num& out);
 
+// Montgomery context for a fixed odd modulus, m.
+//   R = 2^(64 num_digits_), n0_prime_ = -1/m (mod 2^64).  Montgomery
+//   values are num_digits_ digit arrays in [0, m).  Build it once per
+//   modulus and reuse it.  Nothing in a context changes after init and
+//   the operations use only stack temporaries, so one context can be
+//   shared between threads.
+typedef void (*mont_mult_kernel)(uint64_t* a, uint64_t* b, uint64_t* m,
+                                 uint64_t n0_prime, uint64_t* r);
+class mont_context {
+ public:
+  bool initialized_;
+  int num_digits_;
+  uint64_t n0_prime_;
+  big_num* m_;
+  big_num* r_mod_m_;    // R (mod m), Montgomery form of 1
+  big_num* r_squared_;  // R^2 (mod m)
+  mont_mult_kernel kernel_;
+
+  mont_context();
+  ~mont_context();
+
+  bool init(big_num& m);
+  void clear();
+  void mult_digits(uint64_t* a, uint64_t* b, uint64_t* r);
+  bool to_mont(big_num& a, big_num& mont_a);
+  bool from_mont(big_num& mont_a, big_num& a);
+  bool mult(big_num& aR, big_num& bR, big_num& abR);
+  bool square(big_num& aR, big_num& a2R);
+};
+
+int big_exp_window_size(int exp_bits);
+bool big_mont_window_exp(mont_context& ctx, big_num& b, big_num& e, big_num& out);
+bool big_mont_fixed_window_exp(mont_context& ctx, big_num& b, big_num& e, big_num& out);
+
+// Batches of equal width numbers in structure of arrays form: digit i of
+//   number j is value_[i * num_ + j], so digit i of consecutive numbers is
+//   contiguous and maps onto vector lanes.
+class big_num_batch {
+ public:
+  int num_;   // numbers in the batch
+  int size_;  // digits in each number
+  uint64_t* value_;
+
+  big_num_batch(int num, int size);
+  ~big_num_batch();
+
+  void zero_num();
+  bool set(int j, big_num& a);
+  bool get(int j, big_num& a);
+};
+
+// Montgomery context for batches with a fixed odd modulus, m.
+//   With AVX-512 IFMA, eight numbers are processed at once in 52 bit limbs
+//   and R = 2^(52 num_limbs_); otherwise each number goes through the
+//   scalar mont_context and R = 2^(64 num_digits_).  Montgomery values are
+//   only meaningful to the context that made them.
+extern bool big_batch_use_ifma;
+class batch_mont_context {
+ public:
+  bool initialized_;
+  bool use_ifma_;
+  int num_digits_;
+  int num_limbs_;
+  uint64_t k0_;                // -1/m (mod 2^52)
+  uint64_t* m_limbs_;          // m, num_limbs_ limbs
+  uint64_t* one_limbs_;        // R (mod m)
+  uint64_t* r_squared_limbs_;  // R^2 (mod m)
+  mont_context ctx_;
+
+  batch_mont_context();
+  ~batch_mont_context();
+
+  bool init(big_num& m);
+  void clear();
+  bool to_mont(big_num_batch& a, big_num_batch& mont_a);
+  bool from_mont(big_num_batch& mont_a, big_num_batch& a);
+  bool mult(big_num_batch& aR, big_num_batch& bR, big_num_batch& abR);
+  bool mod_mult(big_num_batch& a, big_num_batch& b, big_num_batch& r);
+  bool exp(big_num_batch& b, big_num& e, big_num_batch& out);
+  bool exp(big_num_batch& b, big_num_batch& e, big_num_batch& out);
+};
+
+bool big_batch_mont_mult(batch_mont_context& ctx, big_num_batch& aR,
+                         big_num_batch& bR, big_num_batch& abR);
+bool big_batch_mod_mult(big_num_batch& a, big_num_batch& b, big_num& m,
+                        big_num_batch& r);
+bool big_batch_mod_exp(big_num_batch& b, big_num& e, big_num& m,
+                       big_num_batch& out);
+bool big_batch_mod_exp(big_num_batch& b, big_num_batch& e, big_num& m,
+                       big_num_batch& out);
+
 #endif
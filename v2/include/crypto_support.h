@@ -146,6 +146,10 @@ int bytes_to_u64_array(string& b, int size_n, uint64_t* n);
 
 bool have_intel_rd_rand();
 bool have_intel_aes_ni();
+bool have_intel_pclmul();
+bool have_intel_bmi2_adx();
+bool have_intel_avx512_ifma();
+bool have_intel_vaes_avx512();
 
 bool init_log(const char* log_file);
 void close_log();
@@ -192,6 +196,11 @@ key_message* make_ecckey(const char* name, int bit_size, const char* purpose,
                          string& order_base_point, string& secret,
                          string& curve_public_point_x, string& curve_public_point_y);
 
+key_message* make_curve25519_key(const char* alg, const char* name,
+                                 const char* purpose, const char* not_before,
+                                 const char* not_after, string& secret,
+                                 string& public_key);
+
 scheme_message* make_scheme(const char* alg, const char* id_name,
       const char* mode, const char* pad, const char* purpose,
       const char* not_before, const char* not_after,
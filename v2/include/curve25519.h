@@ -0,0 +1,55 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: curve25519.h
+
+#include "crypto_support.h"
+
+// Background
+//  Curve25519 is the Montgomery curve v^2 = u^3 + 486662u^2 + u over
+//  GF(2^255-19).  It is birationally equivalent to the twisted Edwards curve
+//  edwards25519, -x^2 + y^2 = 1 + dx^2y^2, d = -121665/121666.  The group
+//  of points has order 8L, L = 2^252 + 27742317777372353535851937790883648493.
+//
+//  X25519 (RFC 7748) is Diffie-Hellman on the u-coordinate alone, computed
+//  with the Montgomery ladder.  Ed25519 (RFC 8032) is a Schnorr signature on
+//  edwards25519 using SHA-512.  Keys, coordinates and scalars are 32 byte
+//  little-endian strings, Ed25519 signatures are R || S, 64 bytes.
+//
+//  Field elements are held as five 51 bit limbs and never go through big_num;
+//  only the scalar arithmetic mod L in Ed25519 does.  The X25519 ladder and
+//  the Ed25519 base point multiplication run in constant time, verification
+//  works on public data and does not.  Verification is cofactored,
+//  [8][S]B = [8]R + [8][k]A, so the batch and single verifiers agree.
+
+#ifndef _CRYPTO_CURVE25519_H__
+#define _CRYPTO_CURVE25519_H__
+
+const int curve25519_key_bytes = 32;
+const int ed25519_signature_bytes = 64;
+
+// out = X25519(scalar, u).  Fails if the result is all zero, which happens
+// exactly when u has small order.
+bool x25519(byte_t* scalar, byte_t* u, byte_t* out);
+bool x25519_public_key(byte_t* secret, byte_t* pub);
+
+bool ed25519_public_key(byte_t* secret, byte_t* pub);
+// pub must be ed25519_public_key(secret)
+bool ed25519_sign(byte_t* secret, byte_t* pub, int size, byte_t* msg,
+                  byte_t* sig);
+bool ed25519_verify(byte_t* pub, int size, byte_t* msg, byte_t* sig);
+
+// True only if every signature verifies.  Checks
+//   sum z_i ([8][S_i]B - [8]R_i - [8][k_i]A_i) = O
+// for random 128 bit z_i in one multi-scalar multiplication.
+bool ed25519_verify_batch(int n, byte_t** pubs, int* sizes, byte_t** msgs,
+                          byte_t** sigs);
+#endif
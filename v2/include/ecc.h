@@ -45,14 +45,14 @@
 //  ECC decrypt
 //    Receiver gets message D = [Q, R].  He calculates M= R - (sA)Q and extracts
 //    m form M.
-//  ECC sign(m).  Public, private keys are the same as in ECC.
-//    Pick an unreuseable nonce, sS, 0 <= sS < N.  Make sure sS has an inverse
-//    mod N.
-//    Compute Q= (sS)B = (x,y).
-//    Compute s= (sS^(-1))(m-sAx) (mod N).
-//    Send [m, Q, s]
-//  ECC verify
-//    Compute v1 = xB + sQ and v2 = mA.  Accept signature if v1 == v2.
+//  ECDSA sign(m).  Public, private keys are the same as in ECC, N is the
+//    order of B and e is the leftmost bits of the hash of m.
+//    Derive the nonce k, 0 < k < N, from sA and the hash (RFC 6979).
+//    Compute r = x(kB) (mod N), s = (k^(-1))(e + sA r) (mod N).
+//    Send [m, r, s]
+//  ECDSA verify
+//    Compute w = s^(-1), u1 = ew, u2 = rw (mod N) and (x, y) = u1 B + u2 P.
+//    Accept signature if x = r (mod N).
 
 #ifndef _CRYPTO_ECC_H__
 #define _CRYPTO_ECC_H__
@@ -79,6 +79,7 @@ class curve_point {
   void print();
 };
 
+class ecc_field;
 class ecc_curve {
  public:
   int prime_bit_size_;
@@ -87,15 +88,163 @@ class ecc_curve {
   big_num* curve_a_;
   big_num* curve_b_;
 
+  // What ecc_field_for_curve and ecc_jacobian_field found, on first use.
+  //   Code that changes c_name_, p or a of a curve already in use calls
+  //   invalidate_field.
+  bool field_resolved_;
+  ecc_field* field_;
+  ecc_field* jacobian_field_;
+
   ecc_curve();
   ecc_curve(int size);
   ~ecc_curve();
 
   void clear();
+  void invalidate_field();
   void print_curve();
   bool copy_from(ecc_curve& c);
 };
 
+// Field arithmetic mod the NIST primes.
+//   Elements are num_digits_ digit arrays in [0, p).  Products go through
+//   digit_array_mult and are then reduced without a division: P-256 and
+//   P-384 use the Solinas reduction on 32 bit words, P-521 = 2^521 - 1 the
+//   Mersenne fold.  For a Solinas prime p = W^n - f(W), W = 2^32, row j of
+//   fold_ holds the coefficients of W^(n+j) (mod p) as a polynomial in W,
+//   so the high words of a product are folded into the low ones column by
+//   column.  The curve routines pick the field through ecc_curve::c_name_.
+const int ecc_field_max_digits = 9;
+const int ecc_field_max_words = 2 * ecc_field_max_digits;
+class ecc_field {
+ public:
+  bool initialized_;
+  bool mersenne_;
+  int num_digits_;
+  int num_words_;
+  int num_bits_;
+  uint64_t p_[ecc_field_max_digits];
+  int f_[ecc_field_max_words];
+  int fold_[ecc_field_max_words][ecc_field_max_words];
+
+  ecc_field();
+  ~ecc_field();
+
+  bool init_solinas(int num_words, int* f);
+  bool init_mersenne(int num_bits);
+  bool is_modulus(big_num& p);
+  bool load(big_num& a, uint64_t* r);
+  bool store(uint64_t* a, big_num& r);
+  bool is_zero(uint64_t* a);
+  bool is_equal(uint64_t* a, uint64_t* b);
+  void copy(uint64_t* a, uint64_t* r);
+  void add(uint64_t* a, uint64_t* b, uint64_t* r);
+  void sub(uint64_t* a, uint64_t* b, uint64_t* r);
+  void reduce(uint64_t* t, uint64_t* r);
+  void mult(uint64_t* a, uint64_t* b, uint64_t* r);
+  void square(uint64_t* a, uint64_t* r);
+  bool inv(uint64_t* a, uint64_t* r);
+  bool batch_inv(int n, uint64_t* a, uint64_t* r);
+};
+
+extern ecc_field p256_field;
+extern ecc_field p384_field;
+extern ecc_field p521_field;
+bool init_ecc_fields();
+ecc_field* ecc_field_for_curve(ecc_curve& c);
+ecc_field* ecc_jacobian_field(ecc_curve& c);
+
+// A point over an ecc_field in Jacobian coordinates, (x, y, z) is the
+//   affine point (x/z^2, y/z^3) and z = 0 is O.  The formulas take
+//   a = -3, true of all the NIST curves.
+class jacobian_point {
+ public:
+  uint64_t x_[ecc_field_max_digits];
+  uint64_t y_[ecc_field_max_digits];
+  uint64_t z_[ecc_field_max_digits];
+};
+
+// Temporaries for the point formulas, so inner loops can keep one set
+//   for the whole multiplication.  The formulas that take no scratch use
+//   one on their own stack.
+const int ecc_scratch_size = 12;
+class ecc_field_scratch {
+ public:
+  uint64_t t_[ecc_scratch_size][ecc_field_max_digits];
+};
+
+void jacobian_make_zero(ecc_field& f, jacobian_point& p);
+bool jacobian_is_zero(ecc_field& f, jacobian_point& p);
+void jacobian_copy(ecc_field& f, jacobian_point& p, jacobian_point& r);
+void jacobian_from_affine(ecc_field& f, uint64_t* x, uint64_t* y, jacobian_point& r);
+bool jacobian_from_point(ecc_field& f, curve_point& pt, jacobian_point& r);
+bool jacobian_to_affine(ecc_field& f, jacobian_point& p, uint64_t* x, uint64_t* y);
+bool jacobian_to_affine_batch(ecc_field& f, int n, jacobian_point* p,
+                              uint64_t* x, uint64_t* y);
+bool jacobian_to_point(ecc_field& f, jacobian_point& p, curve_point& r);
+void jacobian_double(ecc_field& f, jacobian_point& p, jacobian_point& r);
+void jacobian_double(ecc_field& f, jacobian_point& p, jacobian_point& r,
+        ecc_field_scratch& s);
+void jacobian_add_affine(ecc_field& f, jacobian_point& p, uint64_t* x2, uint64_t* y2,
+        jacobian_point& r);
+void jacobian_add_affine(ecc_field& f, jacobian_point& p, uint64_t* x2, uint64_t* y2,
+        jacobian_point& r, ecc_field_scratch& s);
+void jacobian_add(ecc_field& f, jacobian_point& p, jacobian_point& q, jacobian_point& r);
+void jacobian_add(ecc_field& f, jacobian_point& p, jacobian_point& q, jacobian_point& r,
+        ecc_field_scratch& s);
+void jacobian_negate(ecc_field& f, jacobian_point& p, jacobian_point& r);
+int ecc_wnaf_recode(big_num& k, int w, int size_naf, int* naf);
+bool jacobian_wnaf_mult(ecc_field& f, jacobian_point& p, big_num& k, jacobian_point& r);
+
+// A point over an ecc_field in homogeneous projective coordinates,
+//   (x, y, z) is (x/z, y/z) and O is (0, 1, 0).  The complete formulas
+//   work on these and take b, the curve constant, as a field element.
+class homogeneous_point {
+ public:
+  uint64_t x_[ecc_field_max_digits];
+  uint64_t y_[ecc_field_max_digits];
+  uint64_t z_[ecc_field_max_digits];
+};
+
+void homogeneous_make_zero(ecc_field& f, homogeneous_point& p);
+bool homogeneous_from_point(ecc_field& f, curve_point& pt, homogeneous_point& r);
+bool homogeneous_to_point(ecc_field& f, homogeneous_point& p, curve_point& r);
+void homogeneous_complete_add(ecc_field& f, uint64_t* b, homogeneous_point& p,
+        homogeneous_point& q, homogeneous_point& r, ecc_field_scratch& s);
+void homogeneous_complete_add_affine(ecc_field& f, uint64_t* b, homogeneous_point& p,
+        uint64_t* x2, uint64_t* y2, homogeneous_point& r, ecc_field_scratch& s);
+void homogeneous_complete_double(ecc_field& f, uint64_t* b, homogeneous_point& p,
+        homogeneous_point& r, ecc_field_scratch& s);
+
+// Fixed base comb (Lim-Lee).
+//   For a base point G with an order of n bits, teeth_ = w and
+//   spacing_ = d = ceil(n / w), entry b of the table is
+//   sum over the bits i of b of 2^(i d) G, stored affine.  kG then takes
+//   d doublings and d mixed additions: column j of k, the bits
+//   j, d + j, ..., (w - 1)d + j, indexes the table.  Lookups read every
+//   entry and the additions are complete, so neither the memory trace nor
+//   the sequence of field operations depends on k.
+class ecc_comb_table {
+ public:
+  bool initialized_;
+  ecc_field* f_;
+  int teeth_;
+  int spacing_;
+  int num_entries_;
+  uint64_t* x_;
+  uint64_t* y_;
+  uint64_t base_x_[ecc_field_max_digits];
+  uint64_t base_y_[ecc_field_max_digits];
+  uint64_t curve_b_[ecc_field_max_digits];
+  big_num* order_;
+
+  ecc_comb_table();
+  ~ecc_comb_table();
+
+  bool init(ecc_curve& c, curve_point& base, big_num& order, int teeth);
+  bool is_table_for(ecc_curve& c, curve_point& base);
+  bool mult(big_num& k, jacobian_point& r);
+};
+
 class ecc {
  public:
   bool initialized_;
@@ -129,6 +278,8 @@ class ecc {
 
   bool encrypt(int size, byte_t* plain, big_num& k, curve_point& pt1, curve_point& pt2);
   bool decrypt(curve_point& pt1, curve_point& pt2, int* size, byte_t* plain);
+  bool sign(int size, byte_t* digest, big_num& r, big_num& s);
+  bool verify(int size, byte_t* digest, big_num& r, big_num& s);
 };
 
 bool ecc_is_on_curve(ecc_curve& c, curve_point& pt);
@@ -140,7 +291,17 @@ bool ecc_sub(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_point& r_
 bool ecc_double(ecc_curve& c, curve_point& p_pt, curve_point& r_pt);
 bool ecc_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt);
 bool faster_ecc_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt);
+bool ecc_base_mult(ecc_curve& c, curve_point& base, big_num& x, curve_point& r_pt);
+bool ecc_wnaf_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt);
+bool ecc_ladder_mult(ecc_curve& c, curve_point& p_pt, big_num& x, curve_point& r_pt);
+bool ecc_multi_mult(ecc_curve& c, int n, big_num** scalars, curve_point** points,
+        curve_point& r_pt);
+bool ecdsa_signature_to_bytes(big_num& n, big_num& r, big_num& s, string* sig);
+bool ecdsa_signature_from_bytes(big_num& n, string& sig, big_num& r, big_num& s);
+bool ecc_point_to_octets(ecc_curve& c, curve_point& pt, bool compress, string* out);
+bool ecc_point_from_octets(ecc_curve& c, int size, const byte_t* in, curve_point& pt);
 bool projective_to_affine(ecc_curve& c, curve_point& pt);
+bool projective_to_affine_batch(ecc_curve& c, int n, curve_point** pts);
 bool projective_add(ecc_curve& c, curve_point& p_pt, curve_point& q_pt, curve_point& r_pt);
 bool projective_double(ecc_curve& c, curve_point& p_pt, curve_point& r_pt);
 bool projective_point_mult(ecc_curve& c, big_num& x, curve_point& p_pt, curve_point& r_pt);
@@ -16,12 +16,13 @@
 
 #include "crypto_support.h"
 #include "aes.h"
+#include "aes_gcm.h"
 #include "hmac_sha256.h"
 #include "big_num.h"
 
 class encryption_scheme {
 public:
-  enum { NONE = 0, AES= 0x01, SHA2 = 0x01, SYMMETRIC_PAD = 0x01, MODE = 0x01, CTR = 1, CBC = 2 };
+  enum { NONE = 0, AES= 0x01, SHA2 = 0x01, SYMMETRIC_PAD = 0x01, MODE = 0x01, CTR = 1, CBC = 2, GCM = 3 };
   enum { ENCRYPT=1, DECRYPT=2};
   enum { MAXBLOCKSIZE=64};
   bool initialized_;
@@ -60,7 +61,12 @@ public:
   bool message_valid_;
 
   aes enc_obj_;
+#if defined(X64)
+  aesni ni_obj_;
+#endif
+  bool use_aesni_;
   hmac_sha256 int_obj_;
+  aes_gcm gcm_obj_;
 
   bool get_message_valid();
   bool message_info(int msg_size, int operation);
@@ -93,6 +99,11 @@ public:
   void cbc_encrypt_step(byte_t* in, byte_t* out);
   void cbc_decrypt_step(byte_t* in, byte_t* out);
   void update_nonce(int size, byte_t* buf);
+  void cipher_encrypt(int size, byte_t* in, byte_t* out);
+  void cipher_decrypt(int size, byte_t* in, byte_t* out);
+  void ctr_blocks(int num_blocks, byte_t* in, byte_t* out);
+  bool encrypt_blocks(int num_blocks, byte_t* in, byte_t* out);
+  bool decrypt_blocks(int num_blocks, byte_t* in, byte_t* out);
   bool get_nonce_data(int size_in, byte_t* in);
 
   bool encrypt_block(int size_in, byte_t* in, byte_t* out);
@@ -108,6 +119,12 @@ public:
 
   bool encrypt_file(const char* file_in, const char* file_out);
   bool decrypt_file(const char* file_in, const char* file_out);
+
+  // GCM: iv || ciphertext || tag, no pad and no hmac
+  bool gcm_encrypt_message(int size_in, byte_t* in, int size_out, byte_t* out);
+  bool gcm_decrypt_message(int size_in, byte_t* in, int size_out, byte_t* out);
+  bool gcm_encrypt_file(const char* file_in, const char* file_out);
+  bool gcm_decrypt_file(const char* file_in, const char* file_out);
 };
 
 #endif
@@ -45,6 +45,7 @@ int digit_array_sub(int size_a, uint64_t* a, int size_b, uint64_t* b,
 int digit_array_add_to(int capacity_a, int size_a, uint64_t* a, int size_b,
                     uint64_t* b);
 int digit_array_sub_from(int capacity_a, int size_a, uint64_t* a, int size_b, uint64_t* b);
+extern bool digit_array_use_mulx;
 int digit_array_mult(int size_a, uint64_t* a, int size_b, uint64_t* b,
                    int size_result, uint64_t* result);
 int digit_array_square(int size_a, uint64_t* a, int size_result, uint64_t* result);
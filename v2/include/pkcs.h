@@ -16,6 +16,7 @@
 #include "crypto_support.h"
 #include "hash.h"
 #include "sha256.h"
+#include "sha3.h"
 
 #ifndef _CRYPTO_PKCS_H__
 #define _CRYPTO_PKCS_H__
@@ -25,4 +26,39 @@ bool pkcs_encode(const char* hash_alg, byte_t* hash, int out_size, byte_t* out);
 bool pkcs_verify(const char* hash_alg, byte_t* hash, int in_size, byte_t* in);
 bool pkcs_embed(int in_size, byte_t* in, int out_size, byte_t* out);
 bool pkcs_extract(int in_size, byte_t* in, int* out_size, byte_t* out);
+
+// Incremental hash for the PSS and OAEP encodings, "sha-256" or
+//   "sha3-256".  Feed the message with add_to_hash as it arrives.
+const int pkcs_max_digest_size = 64;
+class pkcs_hash {
+ public:
+  bool use_sha3_;
+  int digest_size_;
+  sha256 sha256_;
+  sha3 sha3_;
+
+  pkcs_hash();
+  bool init(const char* hash_alg);
+  void add_to_hash(int size, const byte_t* in);
+  void finalize();
+  bool get_digest(int size, byte_t* out);
+};
+int pkcs_digest_size(const char* hash_alg);
+
+// buf ^= MGF1(seed), mask_size bytes
+bool pkcs_mgf1_xor(const char* hash_alg, int seed_size, byte_t* seed,
+                   int mask_size, byte_t* buf);
+
+// EMSA-PSS with a salt as long as the hash.  em_bits is one less than the
+//   modulus size in bits; out_size is (em_bits + 7) / 8.
+bool pkcs_pss_encode(const char* hash_alg, byte_t* hash, int em_bits,
+                     int out_size, byte_t* out);
+bool pkcs_pss_verify(const char* hash_alg, byte_t* hash, int em_bits,
+                     int in_size, byte_t* in);
+
+// EME-OAEP; the block is out_size bytes, the size of the modulus.
+bool pkcs_oaep_embed(const char* hash_alg, int label_size, byte_t* label,
+                     int in_size, byte_t* in, int out_size, byte_t* out);
+bool pkcs_oaep_extract(const char* hash_alg, int label_size, byte_t* label,
+                       int in_size, byte_t* in, int* out_size, byte_t* out);
 #endif
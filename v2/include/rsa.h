@@ -15,7 +15,9 @@
 
 #include "crypto_support.h"
 #include "big_num.h"
+#include "big_num_functions.h"
 #include <iostream>
+#include <mutex>
 
 #ifndef _CRYPTO_RSA_H__
 #define _CRYPTO_RSA_H__
@@ -52,4 +54,79 @@ class rsa {
   bool decrypt(int size_in, byte_t* in, int* size_out, byte_t* out, int speed);
   key_message* get_key() {return rsa_key_;}
 };
+
+// Private key operations for a long lived key.
+//   init copies what the CRT needs from a loaded rsa key and builds the
+//   Montgomery contexts for m, p and q once.  decrypt and sign take the
+//   same blocks as rsa::decrypt and may be called from any number of
+//   threads: their temporaries are on the stack or in the calling
+//   thread's big_num arena, so after the first call on a thread nothing
+//   is allocated.  The input is blinded by r^e and the result unblinded
+//   by r^(-1) (mod m).  Each call squares the pair and a fresh r is drawn
+//   every rsa_blinding_uses calls or on refresh_blinding.  sign also
+//   checks the result with the public exponent so a faulty CRT half
+//   can't leak a factor.  With concurrent_halves_ set the q half runs on
+//   a second thread, which cuts the latency of one call at the cost of a
+//   thread start; leave it off when calls are already spread over cores.
+const int rsa_blinding_uses = 32;
+class rsa_private_context {
+ public:
+  bool initialized_;
+  int bit_size_modulus_;
+  int num_digits_;       // digits in m
+  big_num* m_;
+  big_num* e_;
+  big_num* p_;
+  big_num* q_;
+  big_num* dp_;
+  big_num* dq_;
+  big_num* q_inv_r_;     // q^(-1) R (mod p), Montgomery form for p_ctx_
+  mont_context m_ctx_;
+  mont_context p_ctx_;
+  mont_context q_ctx_;
+
+  std::mutex blinding_lock_;
+  big_num* blind_r_;     // r^e R (mod m)
+  big_num* unblind_r_;   // r^(-1) R (mod m)
+  int blinding_uses_;
+  bool concurrent_halves_;
+
+  rsa_private_context();
+  ~rsa_private_context();
+
+  bool init(rsa& key);
+  void clear();
+  bool refresh_blinding();
+  bool decrypt(int size_in, byte_t* in, int* size_out, byte_t* out);
+  bool sign(int size_in, byte_t* in, int* size_out, byte_t* out);
+
+ private:
+  bool new_blinding_pair();
+  bool next_blinding_pair(uint64_t* blind, uint64_t* unblind);
+  bool private_op(int size_in, byte_t* in, int* size_out, byte_t* out,
+                  bool check);
+};
+
+// Decrypts n blocks of bit_size_modulus_ / 8 bytes, inputs[i] into
+//   outputs[i], spread over num_threads threads (rsa_batch_threads if 0).
+//   The rsa version builds a context for the call; keep a context and use
+//   the first to amortize that over batches.  False if any block fails.
+extern int rsa_batch_threads;
+bool rsa_decrypt_batch(rsa_private_context& ctx, int n, byte_t** inputs,
+                       byte_t** outputs, int num_threads=0);
+bool rsa_decrypt_batch(rsa& key, int n, byte_t** inputs, byte_t** outputs,
+                       int num_threads=0);
+
+// RSASSA-PSS and RSAES-OAEP (empty label), hash_alg "sha-256" or
+//   "sha3-256".  hash is the digest of the message, usually from a
+//   pkcs_hash fed as the message is read.  Signatures and ciphertexts
+//   are bit_size_modulus_ / 8 bytes.
+bool rsa_pss_sign(rsa_private_context& ctx, const char* hash_alg, byte_t* hash,
+                  int* size_out, byte_t* out);
+bool rsa_pss_verify(rsa& key, const char* hash_alg, byte_t* hash, int size_in,
+                    byte_t* in);
+bool rsa_oaep_encrypt(rsa& key, const char* hash_alg, int size_in, byte_t* in,
+                      int* size_out, byte_t* out);
+bool rsa_oaep_decrypt(rsa_private_context& ctx, const char* hash_alg,
+                      int size_in, byte_t* in, int* size_out, byte_t* out);
 #endif
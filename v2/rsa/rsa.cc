@@ -16,7 +16,11 @@
 #include "crypto_support.h"
 #include "big_num.h"
 #include "rsa.h"
+#include "pkcs.h"
 #include "big_num_functions.h"
+#include "intel_digit_arith.h"
+#include <thread>
+#include <atomic>
 
 rsa::rsa() {
   initialized_ = true;
@@ -138,9 +142,10 @@ bool rsa::compute_fast_decrypt_parameters() {
   if (!big_mod_normalize(*d_, t))
     return false;
 
-return true;
-// Fix
-
+  if (dp_ == nullptr)
+    dp_ = new big_num(p_->capacity_ + 1);
+  if (dq_ == nullptr)
+    dq_ = new big_num(q_->capacity_ + 1);
   t.zero_num();
   y.zero_num();
   if (!big_extended_gcd(p_minus_1, *e_, y, *dp_, g)) {
@@ -388,9 +393,17 @@ bool rsa::set_parameters_in_key_message() {
   return true;
 }
 
+static void generate_rsa_prime(big_num* r, int num_bits, int num_trys,
+                               int num_threads, bool* succeeded) {
+  *succeeded = false;
+  for (int i = 0; i < num_trys && !*succeeded; i++)
+    *succeeded = big_gen_prime(*r, num_bits, 2500, num_threads);
+}
+
 bool rsa::generate_rsa(int num_bits) {
   int n_trys = 5;
-  bool succeeded = true;
+  bool p_succeeded = false;
+  bool q_succeeded = false;
   bit_size_modulus_ = num_bits;
 
   m_ = new big_num(1 + 2 * num_bits / NBITSINUINT64);
@@ -399,20 +412,17 @@ bool rsa::generate_rsa(int num_bits) {
   e_ = new big_num(1, 0x010001ULL);
   d_ = new big_num(1 + num_bits / NBITSINUINT64);
 
-  for (int i = 0; i < n_trys; i++) {
-    succeeded = big_gen_prime(*p_, num_bits / 2);
-    if (succeeded)
-      break;
-  }
-  if (!succeeded)
+  // p and q are found concurrently, splitting the prime search threads
+  int prime_threads = big_prime_threads / 2;
+  if (prime_threads < 1)
+    prime_threads = 1;
+  std::thread q_thread(generate_rsa_prime, q_, num_bits / 2, n_trys,
+                       prime_threads, &q_succeeded);
+  generate_rsa_prime(p_, num_bits / 2, n_trys, prime_threads, &p_succeeded);
+  q_thread.join();
+  if (!p_succeeded || !q_succeeded)
     return false;
-
-  for (int i = 0; i < n_trys; i++) {
-    succeeded = big_gen_prime(*q_, num_bits / 2);
-    if (succeeded)
-      break;
-  }
-  if (!succeeded)
+  if (big_compare(*p_, *q_) == 0)
     return false;
 
   if (!big_mult(*p_, *q_, *m_)) {
@@ -492,6 +502,9 @@ done:
 
 bool rsa::encrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
                      int speed) {
+  // temporaries here and in the big_num calls below come from the
+  // thread's arena and are given back in bulk on return
+  big_num_arena_scope arena_scope;
   int bytes_in_block = bit_size_modulus_ / NBITSINBYTE;
 
   if (size_in > bytes_in_block) {
@@ -561,8 +574,19 @@ bool rsa::encrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
   return true;
 }
 
+// out = in^d (mod ctx's modulus) for one CRT half, run on its own thread.
+//   The thread has no arena installed, so it takes its own.
+static void rsa_crt_half(mont_context* ctx, big_num* in, big_num* d,
+                         big_num* out, bool* succeeded) {
+  big_num_arena_scope arena_scope;
+  *succeeded = big_mont_fixed_window_exp(*ctx, *in, *d, *out);
+}
+
 bool rsa::decrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
                      int speed) {
+  // temporaries here and in the big_num calls below come from the
+  // thread's arena and are given back in bulk on return
+  big_num_arena_scope arena_scope;
   int bytes_in_block = bit_size_modulus_ / NBITSINBYTE;
 
   if (size_in > bytes_in_block) {
@@ -592,6 +616,9 @@ bool rsa::decrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
     if (!big_mod(int_in, *p_, int_inp)) {
       return false;
     }
+    if (!big_mod(int_in, *q_, int_inq)) {
+      return false;
+    }
     if (!big_mod_exp(int_inp, *dp_, *p_, int_outp)) {
       return false;
     }
@@ -602,20 +629,40 @@ bool rsa::decrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
       return false;
     }
   } else if (speed == 3) {
-    if (p_prime_ == nullptr || p_prime_ == nullptr) {
+    // CRT halves with constant time fixed window Montgomery exponentiation
+    if (p_ == nullptr || q_ == nullptr || dp_ == nullptr || dq_ == nullptr) {
       return false;
     }
-    int t = big_high_bit(*p_);
-    if (!big_mod(int_in, *p_, int_inp)) {
+    mont_context p_ctx;
+    mont_context q_ctx;
+    if (!p_ctx.init(*p_) || !q_ctx.init(*q_)) {
       return false;
     }
-    if (!big_mod(int_in, *q_, int_inq)) {
+    if (!big_mont_fixed_window_exp(p_ctx, int_in, *dp_, int_outp)) {
+      return false;
+    }
+    if (!big_mont_fixed_window_exp(q_ctx, int_in, *dq_, int_outq)) {
       return false;
     }
-    if (!big_mont_exp(int_inp, *dp_, t, *p_, *p_prime_, int_outp)) {
+    if (!big_crt(int_outp, int_outq, *p_, *q_, int_out)) {
       return false;
     }
-    if (!big_mont_exp(int_inq, *dq_, t, *q_, *q_prime_, int_outq)) {
+  } else if (speed == 4) {
+    // speed 3 with the q half on a second thread
+    if (p_ == nullptr || q_ == nullptr || dp_ == nullptr || dq_ == nullptr) {
+      return false;
+    }
+    mont_context p_ctx;
+    mont_context q_ctx;
+    bool q_succeeded = false;
+    if (!p_ctx.init(*p_) || !q_ctx.init(*q_)) {
+      return false;
+    }
+    std::thread q_thread(rsa_crt_half, &q_ctx, &int_in, dq_, &int_outq,
+                         &q_succeeded);
+    bool p_succeeded = big_mont_fixed_window_exp(p_ctx, int_in, *dp_, int_outp);
+    q_thread.join();
+    if (!p_succeeded || !q_succeeded) {
       return false;
     }
     if (!big_crt(int_outp, int_outq, *p_, *q_, int_out)) {
@@ -629,3 +676,447 @@ bool rsa::decrypt(int size_in, byte_t* in, int* size_out, byte_t* out,
 
   return true;
 }
+
+rsa_private_context::rsa_private_context() {
+  initialized_ = false;
+  bit_size_modulus_ = 0;
+  num_digits_ = 0;
+  m_ = nullptr;
+  e_ = nullptr;
+  p_ = nullptr;
+  q_ = nullptr;
+  dp_ = nullptr;
+  dq_ = nullptr;
+  q_inv_r_ = nullptr;
+  blind_r_ = nullptr;
+  unblind_r_ = nullptr;
+  blinding_uses_ = 0;
+  concurrent_halves_ = false;
+}
+
+rsa_private_context::~rsa_private_context() {
+  clear();
+}
+
+void rsa_private_context::clear() {
+  big_num** nums[] = {&m_, &e_, &p_, &q_, &dp_, &dq_, &q_inv_r_,
+                      &blind_r_, &unblind_r_};
+  for (int i = 0; i < (int)(sizeof(nums) / sizeof(big_num**)); i++) {
+    if (*nums[i] != nullptr) {
+      delete *nums[i];
+      *nums[i] = nullptr;
+    }
+  }
+  m_ctx_.clear();
+  p_ctx_.clear();
+  q_ctx_.clear();
+  initialized_ = false;
+  bit_size_modulus_ = 0;
+  num_digits_ = 0;
+  blinding_uses_ = 0;
+}
+
+// d mod (p - 1), for keys stored without dp or dq
+static bool rsa_crt_exponent_missing(big_num* d_p) {
+  return d_p == nullptr || d_p->is_zero();
+}
+
+static big_num* rsa_crt_exponent(big_num& d, big_num& p) {
+  int n = d.capacity_ > p.capacity_ ? d.capacity_ : p.capacity_;
+  big_num p_minus_1(n + 1);
+  big_num* r = new big_num(n + 1);
+
+  if (!big_sub(p, big_one, p_minus_1) || !big_mod(d, p_minus_1, *r)) {
+    delete r;
+    return nullptr;
+  }
+  return r;
+}
+
+bool rsa_private_context::init(rsa& key) {
+  if (key.m_ == nullptr || key.e_ == nullptr || key.p_ == nullptr ||
+      key.q_ == nullptr)
+    return false;
+  if ((rsa_crt_exponent_missing(key.dp_) || rsa_crt_exponent_missing(key.dq_)) &&
+      key.d_ == nullptr)
+    return false;
+
+  // everything kept comes from the heap, whatever arena the caller has
+  big_num_arena* previous = big_num_arena::set_thread_arena(nullptr);
+  bool ret = false;
+
+  clear();
+  bit_size_modulus_ = key.bit_size_modulus_;
+  m_ = new big_num(*key.m_, key.m_->capacity_);
+  e_ = new big_num(*key.e_, key.e_->capacity_);
+  p_ = new big_num(*key.p_, key.p_->capacity_);
+  q_ = new big_num(*key.q_, key.q_->capacity_);
+  dp_ = !rsa_crt_exponent_missing(key.dp_)
+            ? new big_num(*key.dp_, key.dp_->capacity_)
+            : rsa_crt_exponent(*key.d_, *key.p_);
+  dq_ = !rsa_crt_exponent_missing(key.dq_)
+            ? new big_num(*key.dq_, key.dq_->capacity_)
+            : rsa_crt_exponent(*key.d_, *key.q_);
+  if (dp_ == nullptr || dq_ == nullptr)
+    goto done;
+  m_->normalize();
+  e_->normalize();
+  p_->normalize();
+  q_->normalize();
+  dp_->normalize();
+  dq_->normalize();
+  num_digits_ = m_->size_;
+  if (bit_size_modulus_ <= 0)
+    bit_size_modulus_ = big_high_bit(*m_);
+
+  if (!m_ctx_.init(*m_) || !p_ctx_.init(*p_) || !q_ctx_.init(*q_))
+    goto done;
+  {
+    big_num q_inv(p_->size_ + 1);
+    q_inv_r_ = new big_num(p_ctx_.num_digits_);
+    if (!big_mod_inv_ct(*q_, *p_, q_inv) || !p_ctx_.to_mont(q_inv, *q_inv_r_))
+      goto done;
+  }
+  blind_r_ = new big_num(num_digits_);
+  unblind_r_ = new big_num(num_digits_);
+  if (!new_blinding_pair())
+    goto done;
+  initialized_ = true;
+  ret = true;
+
+done:
+  if (!ret)
+    clear();
+  big_num_arena::set_thread_arena(previous);
+  return ret;
+}
+
+// A fresh random r and its pair; the caller holds blinding_lock_ or owns
+// the context.
+bool rsa_private_context::new_blinding_pair() {
+  int n = num_digits_;
+  big_num r(n + 1);
+  big_num r_inv(n + 1);
+  big_num r_e(n + 1);
+  // other threads are reading m_ and e_, and is_zero and
+  // big_mont_window_exp write to their arguments
+  big_num m(*m_, m_->capacity_);
+  big_num e(*e_, e_->capacity_);
+
+  for (int i = 0; i < 8; i++) {
+    r.zero_num();
+    if (crypto_get_random_bytes(n * sizeof(uint64_t), (byte_t*)r.value_) < 0)
+      return false;
+    r.normalize();
+    if (!big_mod_normalize(r, m))
+      return false;
+    if (r.is_zero() || r.is_one())
+      continue;
+    // fails only if r shares a factor with m
+    if (!big_mod_inv_ct(r, m, r_inv))
+      continue;
+    if (!big_mont_window_exp(m_ctx_, r, e, r_e))
+      return false;
+    blinding_uses_ = 0;
+    return m_ctx_.to_mont(r_e, *blind_r_) && m_ctx_.to_mont(r_inv, *unblind_r_);
+  }
+  return false;
+}
+
+bool rsa_private_context::refresh_blinding() {
+  if (!initialized_)
+    return false;
+  big_num_arena_scope arena_scope;
+  std::lock_guard<std::mutex> guard(blinding_lock_);
+  return new_blinding_pair();
+}
+
+// Hands out the current pair in Montgomery form and moves the shared
+// one on: (r^e, r^(-1)) -> (r^2e, r^(-2)).
+bool rsa_private_context::next_blinding_pair(uint64_t* blind, uint64_t* unblind) {
+  int n = num_digits_;
+  std::lock_guard<std::mutex> guard(blinding_lock_);
+
+  if (blinding_uses_ >= rsa_blinding_uses && !new_blinding_pair())
+    return false;
+  if (!digit_array_copy(blind_r_->size_, blind_r_->value_, n, blind) ||
+      !digit_array_copy(unblind_r_->size_, unblind_r_->value_, n, unblind))
+    return false;
+  m_ctx_.mult_digits(blind_r_->value_, blind_r_->value_, blind_r_->value_);
+  m_ctx_.mult_digits(unblind_r_->value_, unblind_r_->value_, unblind_r_->value_);
+  blind_r_->normalize();
+  unblind_r_->normalize();
+  blinding_uses_++;
+  return true;
+}
+
+// out = in^d (mod m) by the CRT on the blinded input, with Garner's
+// recombination s = s_q + q ((s_p - s_q) q^(-1) (mod p)).
+bool rsa_private_context::private_op(int size_in, byte_t* in, int* size_out,
+                                     byte_t* out, bool check) {
+  if (!initialized_)
+    return false;
+  int bytes_in_block = bit_size_modulus_ / NBITSINBYTE;
+  if (size_in > bytes_in_block || *size_out < bytes_in_block)
+    return false;
+
+  // temporaries come from the thread's arena and are given back on return
+  big_num_arena_scope arena_scope;
+  int n = num_digits_;
+  int np = p_ctx_.num_digits_;
+  byte_t block[bytes_in_block];
+  uint64_t x[n];
+  uint64_t blind[n];
+  uint64_t unblind[n];
+  uint64_t h[np];
+  big_num c(2 * n + 1);
+  big_num s(2 * n + 1);
+  big_num c_p(2 * n + 1);
+  big_num c_q(2 * n + 1);
+  big_num s_p(2 * n + 1);
+  big_num s_q(2 * n + 1);
+  big_num t(2 * n + 1);
+  bool ret = false;
+
+  memset(block, 0, bytes_in_block);
+  memcpy(block, in, size_in);
+  reverse_bytes(bytes_in_block, block, (byte_t*)c.value_);
+  c.normalize();
+  if (big_compare(c, *m_) >= 0)
+    goto done;
+  if (!next_blinding_pair(blind, unblind))
+    goto done;
+
+  // c r^e
+  digit_array_copy(c.size_, c.value_, n, x);
+  m_ctx_.mult_digits(x, blind, x);
+  digit_array_copy(n, x, s.capacity_, s.value_);
+  s.normalize();
+
+  if (!big_mod(s, *p_, c_p) || !big_mod(s, *q_, c_q))
+    goto done;
+  if (concurrent_halves_) {
+    bool p_succeeded = false;
+    bool q_succeeded = false;
+    std::thread q_thread(rsa_crt_half, &q_ctx_, &c_q, dq_, &s_q, &q_succeeded);
+    p_succeeded = big_mont_fixed_window_exp(p_ctx_, c_p, *dp_, s_p);
+    q_thread.join();
+    if (!p_succeeded || !q_succeeded)
+      goto done;
+  } else {
+    if (!big_mont_fixed_window_exp(p_ctx_, c_p, *dp_, s_p) ||
+        !big_mont_fixed_window_exp(q_ctx_, c_q, *dq_, s_q))
+      goto done;
+  }
+  if (!big_sub(s_p, s_q, t) || !big_mod_normalize(t, *p_))
+    goto done;
+  digit_array_copy(t.size_, t.value_, np, h);
+  p_ctx_.mult_digits(h, q_inv_r_->value_, h);
+  t.zero_num();
+  digit_array_copy(np, h, t.capacity_, t.value_);
+  t.normalize();
+  s.zero_num();
+  if (!big_mult(t, *q_, s))
+    goto done;
+  t.zero_num();
+  if (!big_add(s, s_q, t))
+    goto done;
+
+  // times r^(-1)
+  digit_array_copy(t.size_, t.value_, n, x);
+  m_ctx_.mult_digits(x, unblind, x);
+  s.zero_num();
+  digit_array_copy(n, x, s.capacity_, s.value_);
+  s.normalize();
+
+  // big_mont_window_exp normalizes its exponent, so use a copy of e
+  if (check) {
+    big_num e(*e_, e_->capacity_);
+    t.zero_num();
+    if (!big_mont_window_exp(m_ctx_, s, e, t) || big_compare(t, c) != 0)
+      goto done;
+  }
+  reverse_bytes(bytes_in_block, (byte_t*)s.value_, out);
+  *size_out = bytes_in_block;
+  ret = true;
+
+done:
+  memset(block, 0, bytes_in_block);
+  digit_array_zero_num(n, x);
+  digit_array_zero_num(n, blind);
+  digit_array_zero_num(n, unblind);
+  digit_array_zero_num(np, h);
+  return ret;
+}
+
+bool rsa_private_context::decrypt(int size_in, byte_t* in, int* size_out,
+                                  byte_t* out) {
+  return private_op(size_in, in, size_out, out, false);
+}
+
+bool rsa_private_context::sign(int size_in, byte_t* in, int* size_out,
+                               byte_t* out) {
+  return private_op(size_in, in, size_out, out, true);
+}
+
+// Batch private key operations
+//   Requests are handed out in order from next_ to num_threads workers
+//   (rsa_batch_threads by default), each with its own arena, all sharing
+//   ctx.  A failed request is marked in failed_ and the others go on.
+
+int rsa_batch_threads = (int)std::thread::hardware_concurrency();
+
+class rsa_batch {
+public:
+  rsa_private_context* ctx_;
+  int n_;
+  int block_size_;
+  byte_t** inputs_;
+  byte_t** outputs_;
+  std::atomic<int> next_;
+  std::atomic<bool> failed_;
+};
+
+static void rsa_batch_worker(rsa_batch* b) {
+  big_num_arena_scope arena_scope;
+  int i;
+
+  while ((i = b->next_.fetch_add(1)) < b->n_) {
+    int size_out = b->block_size_;
+    if (!b->ctx_->decrypt(b->block_size_, b->inputs_[i], &size_out,
+                          b->outputs_[i]))
+      b->failed_ = true;
+  }
+}
+
+bool rsa_decrypt_batch(rsa_private_context& ctx, int n, byte_t** inputs,
+                       byte_t** outputs, int num_threads) {
+  if (!ctx.initialized_ || n < 0)
+    return false;
+  if (num_threads <= 0)
+    num_threads = rsa_batch_threads;
+  if (num_threads > n)
+    num_threads = n;
+  if (num_threads <= 0)
+    num_threads = 1;
+
+  rsa_batch b;
+  b.ctx_ = &ctx;
+  b.n_ = n;
+  b.block_size_ = ctx.bit_size_modulus_ / NBITSINBYTE;
+  b.inputs_ = inputs;
+  b.outputs_ = outputs;
+  b.next_ = 0;
+  b.failed_ = false;
+  if (num_threads == 1) {
+    rsa_batch_worker(&b);
+  } else {
+    std::thread* workers = new std::thread[num_threads];
+    for (int i = 0; i < num_threads; i++)
+      workers[i] = std::thread(rsa_batch_worker, &b);
+    for (int i = 0; i < num_threads; i++)
+      workers[i].join();
+    delete []workers;
+  }
+  return !b.failed_;
+}
+
+bool rsa_decrypt_batch(rsa& key, int n, byte_t** inputs, byte_t** outputs,
+                       int num_threads) {
+  rsa_private_context ctx;
+
+  if (!ctx.init(key))
+    return false;
+  return rsa_decrypt_batch(ctx, n, inputs, outputs, num_threads);
+}
+
+// PSS and OAEP
+//   The encoded message for PSS is em_bits = bit_size_modulus_ - 1 bits,
+//   so it can be a byte shorter than the block; it is then put in the
+//   block behind a zero byte.
+
+static bool rsa_block_in_range(rsa& key, int size, byte_t* in) {
+  big_num_arena_scope arena_scope;
+  big_num x(1 + size / (int)sizeof(uint64_t));
+
+  reverse_bytes(size, in, (byte_t*)x.value_);
+  x.normalize();
+  return big_compare(x, *key.m_) < 0;
+}
+
+bool rsa_pss_sign(rsa_private_context& ctx, const char* hash_alg, byte_t* hash,
+                  int* size_out, byte_t* out) {
+  if (!ctx.initialized_)
+    return false;
+  int block_size = ctx.bit_size_modulus_ / NBITSINBYTE;
+  int em_bits = ctx.bit_size_modulus_ - 1;
+  int em_len = (em_bits + 7) / NBITSINBYTE;
+  byte_t block[block_size];
+  bool ret;
+
+  memset(block, 0, block_size);
+  if (!pkcs_pss_encode(hash_alg, hash, em_bits, em_len,
+                       &block[block_size - em_len]))
+    return false;
+  ret = ctx.sign(block_size, block, size_out, out);
+  memset(block, 0, block_size);
+  return ret;
+}
+
+bool rsa_pss_verify(rsa& key, const char* hash_alg, byte_t* hash, int size_in,
+                    byte_t* in) {
+  if (key.m_ == nullptr || key.e_ == nullptr)
+    return false;
+  int block_size = key.bit_size_modulus_ / NBITSINBYTE;
+  int em_bits = key.bit_size_modulus_ - 1;
+  int em_len = (em_bits + 7) / NBITSINBYTE;
+  byte_t block[block_size];
+  int size_out = block_size;
+
+  if (size_in != block_size || !rsa_block_in_range(key, size_in, in))
+    return false;
+  if (!key.encrypt(size_in, in, &size_out, block, 0))
+    return false;
+  for (int i = 0; i < block_size - em_len; i++) {
+    if (block[i] != 0)
+      return false;
+  }
+  return pkcs_pss_verify(hash_alg, hash, em_bits, em_len,
+                         &block[block_size - em_len]);
+}
+
+bool rsa_oaep_encrypt(rsa& key, const char* hash_alg, int size_in, byte_t* in,
+                      int* size_out, byte_t* out) {
+  if (key.m_ == nullptr || key.e_ == nullptr)
+    return false;
+  int block_size = key.bit_size_modulus_ / NBITSINBYTE;
+  byte_t block[block_size];
+  bool ret;
+
+  if (*size_out < block_size)
+    return false;
+  if (!pkcs_oaep_embed(hash_alg, 0, nullptr, size_in, in, block_size, block))
+    return false;
+  ret = key.encrypt(block_size, block, size_out, out, 0);
+  memset(block, 0, block_size);
+  return ret;
+}
+
+bool rsa_oaep_decrypt(rsa_private_context& ctx, const char* hash_alg,
+                      int size_in, byte_t* in, int* size_out, byte_t* out) {
+  if (!ctx.initialized_)
+    return false;
+  int block_size = ctx.bit_size_modulus_ / NBITSINBYTE;
+  byte_t block[block_size];
+  int size_block = block_size;
+  bool ret;
+
+  if (size_in != block_size)
+    return false;
+  if (!ctx.decrypt(size_in, in, &size_block, block))
+    return false;
+  ret = pkcs_oaep_extract(hash_alg, 0, nullptr, block_size, block, size_out,
+                          out);
+  memset(block, 0, block_size);
+  return ret;
+}
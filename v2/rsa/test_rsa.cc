@@ -21,6 +21,8 @@
 #include "big_num.h"
 #include "big_num_functions.h"
 #include "rsa.h"
+#include "pkcs.h"
+#include <thread>
 
 
 DEFINE_bool(print_all, false, "Print intermediate test computations");
@@ -93,6 +95,317 @@ bool test_rsa1(int num_bits) {
   return true;
 }
 
+// decrypt with each speed and compare
+bool test_rsa_decrypt_speeds(int num_bits) {
+  int byte_size = num_bits / NBITSINBYTE;
+  rsa r;
+
+  if (!r.generate_rsa(num_bits)) {
+    printf("generate fails\n");
+    return false;
+  }
+
+  byte_t msg_in[byte_size];
+  byte_t msg_out[byte_size];
+  byte_t msg_recovered[byte_size];
+  memset(msg_in, 0, byte_size);
+  memset(msg_out, 0, byte_size);
+  memcpy(msg_in, (byte_t*)"hello", 6);
+  int size_out1 = byte_size;
+
+  if (!r.encrypt(64, msg_in, &size_out1, msg_out, 0)) {
+    printf("encrypt fails\n");
+    return false;
+  }
+
+  int speeds[] = {0, 2, 3, 4};
+  for (int i = 0; i < (int)(sizeof(speeds) / sizeof(int)); i++) {
+    int size_out2 = byte_size;
+    memset(msg_recovered, 0, byte_size);
+    if (!r.decrypt(size_out1, msg_out, &size_out2, msg_recovered, speeds[i])) {
+      printf("decrypt fails, speed %d\n", speeds[i]);
+      return false;
+    }
+    if (memcmp(msg_in, msg_recovered, 64) != 0) {
+      printf("decrypt mismatch, speed %d\n", speeds[i]);
+      if (FLAGS_print_all) {
+        printf("Message       : "); print_bytes(64, msg_in);
+        printf("Recovered     : "); print_bytes(size_out2, msg_recovered);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+// one rsa_private_context shared by several threads, checked against
+// decrypt speed 0 and against the public operation
+static void private_context_worker(rsa_private_context* ctx, int byte_size,
+                                   byte_t* cipher, byte_t* expected,
+                                   int iterations, bool* ok) {
+  byte_t recovered[byte_size];
+
+  *ok = true;
+  for (int i = 0; i < iterations; i++) {
+    int size_out = byte_size;
+    memset(recovered, 0, byte_size);
+    if (!ctx->decrypt(byte_size, cipher, &size_out, recovered) ||
+        memcmp(recovered, expected, byte_size) != 0) {
+      *ok = false;
+      return;
+    }
+  }
+}
+
+bool test_rsa_private_context(int num_bits) {
+  const int num_threads = 4;
+  int byte_size = num_bits / NBITSINBYTE;
+  rsa r;
+  rsa_private_context ctx;
+
+  if (!r.generate_rsa(num_bits) || !ctx.init(r)) {
+    printf("generate or init fails\n");
+    return false;
+  }
+
+  byte_t msg_in[byte_size];
+  byte_t msg_out[byte_size];
+  byte_t msg_recovered[byte_size];
+  byte_t msg_expected[byte_size];
+  memset(msg_in, 0, byte_size);
+  memset(msg_out, 0, byte_size);
+  memcpy(msg_in, (byte_t*)"hello", 6);
+  int size_out1 = byte_size;
+  int size_out2 = byte_size;
+
+  if (!r.encrypt(64, msg_in, &size_out1, msg_out, 0) ||
+      !r.decrypt(size_out1, msg_out, &size_out2, msg_expected, 0)) {
+    printf("encrypt or decrypt fails\n");
+    return false;
+  }
+
+  // more uses than one blinding pair allows, and a forced refresh
+  for (int i = 0; i < 2 * rsa_blinding_uses; i++) {
+    if (i == rsa_blinding_uses / 2 && !ctx.refresh_blinding()) {
+      printf("refresh_blinding fails\n");
+      return false;
+    }
+    size_out2 = byte_size;
+    memset(msg_recovered, 0, byte_size);
+    if (!ctx.decrypt(size_out1, msg_out, &size_out2, msg_recovered) ||
+        size_out2 != byte_size ||
+        memcmp(msg_recovered, msg_expected, byte_size) != 0) {
+      printf("context decrypt mismatch, iteration %d\n", i);
+      if (FLAGS_print_all) {
+        printf("Expected      : "); print_bytes(byte_size, msg_expected);
+        printf("Recovered     : "); print_bytes(size_out2, msg_recovered);
+      }
+      return false;
+    }
+  }
+
+  // sign, then recover the message with the public key
+  size_out2 = byte_size;
+  if (!ctx.sign(byte_size, msg_out, &size_out2, msg_recovered)) {
+    printf("context sign fails\n");
+    return false;
+  }
+  size_out1 = byte_size;
+  if (!r.encrypt(size_out2, msg_recovered, &size_out1, msg_in, 0) ||
+      memcmp(msg_in, msg_out, byte_size) != 0) {
+    printf("signature does not verify\n");
+    return false;
+  }
+
+  // keys stored without dp and dq get them from d
+  {
+    rsa_private_context ctx_from_d;
+    big_num* dp = r.dp_;
+    big_num* dq = r.dq_;
+    r.dp_ = nullptr;
+    r.dq_ = nullptr;
+    bool ok = ctx_from_d.init(r);
+    r.dp_ = dp;
+    r.dq_ = dq;
+    size_out2 = byte_size;
+    if (!ok || !ctx_from_d.decrypt(size_out1, msg_out, &size_out2, msg_recovered) ||
+        memcmp(msg_recovered, msg_expected, byte_size) != 0) {
+      printf("context without dp, dq fails\n");
+      return false;
+    }
+  }
+
+  // inputs not less than the modulus are refused
+  memset(msg_in, 0xff, byte_size);
+  size_out2 = byte_size;
+  if (ctx.decrypt(byte_size, msg_in, &size_out2, msg_recovered)) {
+    printf("context decrypt accepts input >= modulus\n");
+    return false;
+  }
+
+  // both halves at once
+  ctx.concurrent_halves_ = true;
+  size_out2 = byte_size;
+  memset(msg_recovered, 0, byte_size);
+  if (!ctx.decrypt(size_out1, msg_out, &size_out2, msg_recovered) ||
+      memcmp(msg_recovered, msg_expected, byte_size) != 0) {
+    printf("concurrent halves decrypt mismatch\n");
+    return false;
+  }
+  ctx.concurrent_halves_ = false;
+
+  std::thread workers[num_threads];
+  bool results[num_threads];
+  for (int i = 0; i < num_threads; i++)
+    workers[i] = std::thread(private_context_worker, &ctx, byte_size,
+                             (byte_t*)msg_out, (byte_t*)msg_expected,
+                             (int)rsa_blinding_uses, &results[i]);
+  for (int i = 0; i < num_threads; i++)
+    workers[i].join();
+  for (int i = 0; i < num_threads; i++) {
+    if (!results[i]) {
+      printf("threaded context decrypt fails, thread %d\n", i);
+      return false;
+    }
+  }
+  return true;
+}
+
+// batch decrypt on one and several threads against speed 0
+bool test_rsa_decrypt_batch(int num_bits) {
+  const int num_msgs = 20;
+  int byte_size = num_bits / NBITSINBYTE;
+  rsa r;
+  rsa_private_context ctx;
+
+  if (!r.generate_rsa(num_bits) || !ctx.init(r)) {
+    printf("generate or init fails\n");
+    return false;
+  }
+
+  byte_t cipher[num_msgs][byte_size];
+  byte_t expected[num_msgs][byte_size];
+  byte_t recovered[num_msgs][byte_size];
+  byte_t* inputs[num_msgs];
+  byte_t* outputs[num_msgs];
+  byte_t msg_in[byte_size];
+
+  for (int i = 0; i < num_msgs; i++) {
+    int size_out1 = byte_size;
+    int size_out2 = byte_size;
+    memset(msg_in, 0, byte_size);
+    sprintf((char*)msg_in, "message %d", i);
+    if (!r.encrypt(64, msg_in, &size_out1, cipher[i], 0) ||
+        !r.decrypt(size_out1, cipher[i], &size_out2, expected[i], 0)) {
+      printf("encrypt or decrypt fails\n");
+      return false;
+    }
+    inputs[i] = cipher[i];
+    outputs[i] = recovered[i];
+  }
+
+  int threads[] = {1, 4, 0};
+  for (int j = 0; j < (int)(sizeof(threads) / sizeof(int)); j++) {
+    memset(recovered, 0, sizeof(recovered));
+    bool ok = j == 0 ? rsa_decrypt_batch(r, num_msgs, inputs, outputs, threads[j])
+                     : rsa_decrypt_batch(ctx, num_msgs, inputs, outputs, threads[j]);
+    if (!ok) {
+      printf("batch decrypt fails, %d threads\n", threads[j]);
+      return false;
+    }
+    for (int i = 0; i < num_msgs; i++) {
+      if (memcmp(recovered[i], expected[i], byte_size) != 0) {
+        printf("batch decrypt mismatch, message %d, %d threads\n", i, threads[j]);
+        return false;
+      }
+    }
+  }
+
+  // one bad block fails the batch but not the others
+  memset(cipher[3], 0xff, byte_size);
+  memset(recovered, 0, sizeof(recovered));
+  if (rsa_decrypt_batch(ctx, num_msgs, inputs, outputs, 4)) {
+    printf("batch decrypt accepts input >= modulus\n");
+    return false;
+  }
+  if (memcmp(recovered[4], expected[4], byte_size) != 0) {
+    printf("batch decrypt stops at a bad block\n");
+    return false;
+  }
+  return true;
+}
+
+// PSS and OAEP over one loaded key, message hashed in pieces
+bool test_rsa_pss_oaep(int num_bits) {
+  const char* algs[] = {"sha-256", "sha3-256"};
+  int byte_size = num_bits / NBITSINBYTE;
+  rsa r;
+  rsa_private_context ctx;
+
+  if (!r.generate_rsa(num_bits) || !ctx.init(r)) {
+    printf("generate or init fails\n");
+    return false;
+  }
+
+  byte_t msg[1000];
+  byte_t digest[pkcs_max_digest_size];
+  byte_t sig[byte_size];
+  byte_t cipher[byte_size];
+  byte_t recovered[byte_size];
+  for (int i = 0; i < (int)sizeof(msg); i++)
+    msg[i] = (byte_t)i;
+
+  for (int a = 0; a < 2; a++) {
+    pkcs_hash h;
+    if (!h.init(algs[a]))
+      return false;
+    for (int i = 0; i < (int)sizeof(msg); i += 100)
+      h.add_to_hash(100, &msg[i]);
+    h.finalize();
+    if (!h.get_digest(pkcs_max_digest_size, digest))
+      return false;
+
+    int size_sig = byte_size;
+    if (!rsa_pss_sign(ctx, algs[a], digest, &size_sig, sig) ||
+        size_sig != byte_size) {
+      printf("rsa_pss_sign %s fails\n", algs[a]);
+      return false;
+    }
+    if (!rsa_pss_verify(r, algs[a], digest, size_sig, sig)) {
+      printf("rsa_pss_verify %s fails\n", algs[a]);
+      return false;
+    }
+    digest[0] ^= 0x01;
+    if (rsa_pss_verify(r, algs[a], digest, size_sig, sig)) {
+      printf("rsa_pss_verify %s accepts the wrong digest\n", algs[a]);
+      return false;
+    }
+
+    int size_cipher = byte_size;
+    int size_recovered = byte_size;
+    int msg_size = byte_size - 2 * pkcs_digest_size(algs[a]) - 2;
+    if (!rsa_oaep_encrypt(r, algs[a], msg_size, msg, &size_cipher, cipher) ||
+        !rsa_oaep_decrypt(ctx, algs[a], size_cipher, cipher, &size_recovered,
+                          recovered)) {
+      printf("rsa oaep %s fails\n", algs[a]);
+      return false;
+    }
+    if (size_recovered != msg_size || memcmp(recovered, msg, msg_size) != 0) {
+      printf("rsa oaep %s mismatch\n", algs[a]);
+      return false;
+    }
+    cipher[byte_size / 2] ^= 0x01;
+    size_recovered = byte_size;
+    if (rsa_oaep_decrypt(ctx, algs[a], size_cipher, cipher, &size_recovered,
+                         recovered) &&
+        size_recovered == msg_size && memcmp(recovered, msg, msg_size) == 0) {
+      printf("rsa oaep %s accepts a changed ciphertext\n", algs[a]);
+      return false;
+    }
+  }
+  return true;
+}
+
 TEST (rsa, test_rsa1) {
   EXPECT_TRUE(test_rsa1(512));
   EXPECT_TRUE(test_rsa1(512));
@@ -101,6 +414,23 @@ TEST (rsa, test_rsa1) {
   EXPECT_TRUE(test_rsa1(2048));
   EXPECT_TRUE(test_rsa1(2048));
 }
+TEST (rsa, test_rsa_decrypt_speeds) {
+  EXPECT_TRUE(test_rsa_decrypt_speeds(512));
+  EXPECT_TRUE(test_rsa_decrypt_speeds(1024));
+}
+TEST (rsa, test_rsa_private_context) {
+  EXPECT_TRUE(test_rsa_private_context(512));
+  EXPECT_TRUE(test_rsa_private_context(1024));
+  EXPECT_TRUE(test_rsa_private_context(2048));
+}
+TEST (rsa, test_rsa_decrypt_batch) {
+  EXPECT_TRUE(test_rsa_decrypt_batch(512));
+  EXPECT_TRUE(test_rsa_decrypt_batch(1024));
+}
+TEST (rsa, test_rsa_pss_oaep) {
+  EXPECT_TRUE(test_rsa_pss_oaep(1024));
+  EXPECT_TRUE(test_rsa_pss_oaep(2048));
+}
 
 int main(int an, char** av) {
   gflags::ParseCommandLineFlags(&an, &av, true);
@@ -29,6 +29,7 @@ S= $(SRC_DIR)/rsa
 O= $(OBJ_DIR)/rsa
 S_SUPPORT=$(SRC_DIR)/crypto_support
 S_BIG_NUM=$(SRC_DIR)/big_num
+S_HASH=$(SRC_DIR)/hash
 
 
 INCLUDE= -I $(SRC_DIR)/include -I $(S_SUPPORT) -I $(S) -I/opt/homebrew/include
@@ -41,7 +42,8 @@ PROTO=protoc
 AR=ar
 
 dobj=	$(O)/test_rsa.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o $(O)/rsa.o \
-	$(O)/globals.o $(O)/big_num.o $(O)/arm64_digit_arith.o $(O)/basic_arith.o $(O)/number_theory.o
+	$(O)/globals.o $(O)/big_num.o $(O)/arm64_digit_arith.o $(O)/basic_arith.o $(O)/number_theory.o \
+	$(O)/hash.o $(O)/sha256.o $(O)/sha3.o $(O)/pkcs.o
 
 all:	test_rsa.exe
 clean:
@@ -85,6 +87,22 @@ $(O)/globals.o: $(S_BIG_NUM)/globals.cc
 	@echo "compiling globals.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/globals.o $(S_BIG_NUM)/globals.cc
 
+$(O)/hash.o: $(S_HASH)/hash.cc
+	@echo "compiling hash.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/hash.o $(S_HASH)/hash.cc
+
+$(O)/sha256.o: $(S_HASH)/sha256.cc
+	@echo "compiling sha256.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha256.o $(S_HASH)/sha256.cc
+
+$(O)/sha3.o: $(S_HASH)/sha3.cc
+	@echo "compiling sha3.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/sha3.o $(S_HASH)/sha3.cc
+
+$(O)/pkcs.o: $(S_HASH)/pkcs.cc
+	@echo "compiling pkcs.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/pkcs.o $(S_HASH)/pkcs.cc
+
 $(O)/arm64_digit_arith.o: $(S_BIG_NUM)/arm64_digit_arith.cc
 	@echo "compiling arm64_digit_arith.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/arm64_digit_arith.o $(S_BIG_NUM)/arm64_digit_arith.cc
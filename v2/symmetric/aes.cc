@@ -1039,8 +1039,20 @@ bool aes::init(int key_bit_size, byte_t* key_buf, int directionflag) {
   if (key_buf == nullptr) {
     return false;
   }
-  secret_.append((const char*) key_buf, key_size_in_bits_ / NBITSINBYTE);
+  secret_.assign((const char*) key_buf, key_size_in_bits_ / NBITSINBYTE);
   key_ = (byte_t*)secret_.data();
+
+  // a second init must not keep the old schedules
+  if (encrypt_round_key_ != nullptr) {
+    memset(encrypt_round_key_, 0, (4 * (aes::MAXNR + 1) + 1) * sizeof(uint32_t));
+    delete []encrypt_round_key_;
+    encrypt_round_key_ = nullptr;
+  }
+  if (decrypt_round_key_ != nullptr) {
+    memset(decrypt_round_key_, 0, (4 * (aes::MAXNR + 1) + 1) * sizeof(uint32_t));
+    delete []decrypt_round_key_;
+    decrypt_round_key_ = nullptr;
+  }
   if (directionflag == DECRYPT || directionflag == BOTH) {
     if (!init_decrypt()) {
       return false;
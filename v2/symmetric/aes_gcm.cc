@@ -0,0 +1,465 @@
+// Copyright 2014-2020, John Manferdelli, All Rights Reserved.
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//     http://www.apache.org/licenses/LICENSE-2.0
+// or in the the file LICENSE-2.0.txt in the top level sourcedirectory
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License
+// File: aes_gcm.cc
+
+#include "crypto_support.h"
+#include "symmetric_cipher.h"
+#include "aes.h"
+#include "aes_gcm.h"
+#if defined(X64)
+#include <immintrin.h>
+#endif
+
+// AES-GCM
+//   GHASH multiplies in GF(2^128) mod x^128 + x^7 + x^2 + x + 1 with the
+//   bits of each byte reflected.  The portable code is the shift and add
+//   of SP 800-38D, algorithm 1.  The clmul kernels work on byte reversed
+//   blocks, form the 256 bit product of each block with a power of H using
+//   pclmulqdq, sum 8 of them unreduced,
+//     X' = (X + B[0]) H^8 + B[1] H^7 + ... + B[7] H,
+//   and reduce once per 8 blocks (Gueron and Kounavis, "Intel Carry-Less
+//   Multiplication Instruction and its Usage for Computing the GCM Mode").
+//   The counter blocks for the same 8 blocks go through the aesenc rounds
+//   in the same loop so the AES and multiplier units overlap.  The counter
+//   is the low 32 bits of the block; messages here are far shorter than
+//   2^32 blocks.
+
+#if defined(X64)
+bool aes_gcm_use_clmul = have_intel_aes_ni() && have_intel_pclmul();
+#else
+bool aes_gcm_use_clmul = false;
+#endif
+
+static void gcm_load_be(const byte_t* b, uint64_t* w) {
+  memcpy(w, b, 2 * sizeof(uint64_t));
+  w[0] = __builtin_bswap64(w[0]);
+  w[1] = __builtin_bswap64(w[1]);
+}
+
+static void gcm_store_be(const uint64_t* w, byte_t* b) {
+  uint64_t t[2];
+
+  t[0] = __builtin_bswap64(w[0]);
+  t[1] = __builtin_bswap64(w[1]);
+  memcpy(b, t, 2 * sizeof(uint64_t));
+}
+
+// z = x h, words big endian.  No data dependent branches.
+static void gcm_mult(const uint64_t* x, const uint64_t* h, uint64_t* z) {
+  uint64_t z_hi = 0ULL;
+  uint64_t z_lo = 0ULL;
+  uint64_t v_hi = h[0];
+  uint64_t v_lo = h[1];
+  uint64_t mask, r;
+
+  for (int i = 0; i < 128; i++) {
+    if (i < 64)
+      mask = 0ULL - ((x[0] >> (63 - i)) & 1ULL);
+    else
+      mask = 0ULL - ((x[1] >> (127 - i)) & 1ULL);
+    z_hi ^= v_hi & mask;
+    z_lo ^= v_lo & mask;
+    r = 0ULL - (v_lo & 1ULL);
+    v_lo = (v_lo >> 1) | (v_hi << 63);
+    v_hi = (v_hi >> 1) ^ (r & 0xe100000000000000ULL);
+  }
+  z[0] = z_hi;
+  z[1] = z_lo;
+}
+
+static void gcm_ghash_portable(const uint64_t* h, uint64_t* x, int num_blocks,
+                               const byte_t* in) {
+  uint64_t b[2];
+
+  for (int i = 0; i < num_blocks; i++) {
+    gcm_load_be(&in[aes_gcm::BLOCKBYTESIZE * i], b);
+    x[0] ^= b[0];
+    x[1] ^= b[1];
+    gcm_mult(x, h, x);
+  }
+}
+
+#if defined(X64)
+static inline __m128i gcm_reverse_mask() {
+  return _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+}
+
+__attribute__((target("pclmul")))
+static inline __attribute__((always_inline)) void gcm_clmul_acc(__m128i a,
+      __m128i b, __m128i* lo, __m128i* mid, __m128i* hi) {
+  *lo = _mm_xor_si128(*lo, _mm_clmulepi64_si128(a, b, 0x00));
+  *hi = _mm_xor_si128(*hi, _mm_clmulepi64_si128(a, b, 0x11));
+  *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x10));
+  *mid = _mm_xor_si128(*mid, _mm_clmulepi64_si128(a, b, 0x01));
+}
+
+// Shift the 255 bit product left one bit, then reduce.
+static inline __m128i gcm_reduce(__m128i lo, __m128i mid, __m128i hi) {
+  __m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+  t3 = _mm_xor_si128(lo, _mm_slli_si128(mid, 8));
+  t6 = _mm_xor_si128(hi, _mm_srli_si128(mid, 8));
+
+  t7 = _mm_srli_epi32(t3, 31);
+  t8 = _mm_srli_epi32(t6, 31);
+  t3 = _mm_slli_epi32(t3, 1);
+  t6 = _mm_slli_epi32(t6, 1);
+  t9 = _mm_srli_si128(t7, 12);
+  t8 = _mm_slli_si128(t8, 4);
+  t7 = _mm_slli_si128(t7, 4);
+  t3 = _mm_or_si128(t3, t7);
+  t6 = _mm_or_si128(t6, t8);
+  t6 = _mm_or_si128(t6, t9);
+
+  t7 = _mm_slli_epi32(t3, 31);
+  t8 = _mm_slli_epi32(t3, 30);
+  t9 = _mm_slli_epi32(t3, 25);
+  t7 = _mm_xor_si128(t7, t8);
+  t7 = _mm_xor_si128(t7, t9);
+  t8 = _mm_srli_si128(t7, 4);
+  t7 = _mm_slli_si128(t7, 12);
+  t3 = _mm_xor_si128(t3, t7);
+
+  t2 = _mm_srli_epi32(t3, 1);
+  t4 = _mm_srli_epi32(t3, 2);
+  t5 = _mm_srli_epi32(t3, 7);
+  t2 = _mm_xor_si128(t2, t4);
+  t2 = _mm_xor_si128(t2, t5);
+  t2 = _mm_xor_si128(t2, t8);
+  t3 = _mm_xor_si128(t3, t2);
+  return _mm_xor_si128(t6, t3);
+}
+
+__attribute__((target("pclmul,ssse3")))
+static void gcm_ghash_clmul(const uint64_t* h, uint64_t* x, int num_blocks,
+                            const byte_t* in) {
+  __m128i reverse = gcm_reverse_mask();
+  __m128i hp[aes_gcm::NUMHPOWERS];
+  __m128i acc = _mm_loadu_si128((const __m128i*)x);
+  __m128i lo, mid, hi, b;
+  int j;
+
+  for (j = 0; j < aes_gcm::NUMHPOWERS; j++)
+    hp[j] = _mm_loadu_si128((const __m128i*)&h[2 * j]);
+  while (num_blocks >= aes_gcm::NUMHPOWERS) {
+    lo = mid = hi = _mm_setzero_si128();
+    for (j = 0; j < aes_gcm::NUMHPOWERS; j++) {
+      b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&in[16 * j]), reverse);
+      if (j == 0)
+        b = _mm_xor_si128(b, acc);
+      gcm_clmul_acc(b, hp[aes_gcm::NUMHPOWERS - 1 - j], &lo, &mid, &hi);
+    }
+    acc = gcm_reduce(lo, mid, hi);
+    in += 16 * aes_gcm::NUMHPOWERS;
+    num_blocks -= aes_gcm::NUMHPOWERS;
+  }
+  while (num_blocks > 0) {
+    lo = mid = hi = _mm_setzero_si128();
+    b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), reverse);
+    gcm_clmul_acc(_mm_xor_si128(b, acc), hp[0], &lo, &mid, &hi);
+    acc = gcm_reduce(lo, mid, hi);
+    in += 16;
+    num_blocks--;
+  }
+  _mm_storeu_si128((__m128i*)x, acc);
+}
+
+__attribute__((target("aes")))
+static inline __attribute__((always_inline)) void gcm_aes_n(int nr,
+      const __m128i* k, int n, __m128i* b) {
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_xor_si128(b[j], k[0]);
+  for (int i = 1; i < nr; i++) {
+    for (int j = 0; j < n; j++)
+      b[j] = _mm_aesenc_si128(b[j], k[i]);
+  }
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_aesenclast_si128(b[j], k[nr]);
+}
+
+// CTR and GHASH of the ciphertext in one pass, 8 blocks at a time.
+__attribute__((target("aes,pclmul,sse4.1")))
+static void gcm_crypt_clmul(int nr, const uint32_t* ks, const uint64_t* h,
+      bool decrypt, int num_blocks, const byte_t* j0, uint32_t* counter,
+      uint64_t* x, const byte_t* in, byte_t* out) {
+  const int n = aes_gcm::NUMHPOWERS;
+  __m128i reverse = gcm_reverse_mask();
+  __m128i k[aesni::MAXNR + 1];
+  __m128i hp[aes_gcm::NUMHPOWERS];
+  __m128i base = _mm_loadu_si128((const __m128i*)j0);
+  __m128i acc = _mm_loadu_si128((const __m128i*)x);
+  __m128i b[aes_gcm::NUMHPOWERS];
+  __m128i lo, mid, hi, c, t;
+  int j;
+
+  for (j = 0; j <= nr; j++)
+    k[j] = _mm_loadu_si128((const __m128i*)&ks[4 * j]);
+  for (j = 0; j < n; j++)
+    hp[j] = _mm_loadu_si128((const __m128i*)&h[2 * j]);
+
+  while (num_blocks >= n) {
+    for (j = 0; j < n; j++)
+      b[j] = _mm_insert_epi32(base, (int)__builtin_bswap32(*counter + j), 3);
+    *counter += n;
+    gcm_aes_n(nr, k, n, b);
+    lo = mid = hi = _mm_setzero_si128();
+    for (j = 0; j < n; j++) {
+      c = _mm_loadu_si128((const __m128i*)&in[16 * j]);
+      b[j] = _mm_xor_si128(b[j], c);
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+      t = _mm_shuffle_epi8(decrypt ? c : b[j], reverse);
+      if (j == 0)
+        t = _mm_xor_si128(t, acc);
+      gcm_clmul_acc(t, hp[n - 1 - j], &lo, &mid, &hi);
+    }
+    acc = gcm_reduce(lo, mid, hi);
+    in += 16 * n;
+    out += 16 * n;
+    num_blocks -= n;
+  }
+  while (num_blocks > 0) {
+    b[0] = _mm_insert_epi32(base, (int)__builtin_bswap32(*counter), 3);
+    (*counter)++;
+    gcm_aes_n(nr, k, 1, b);
+    c = _mm_loadu_si128((const __m128i*)in);
+    b[0] = _mm_xor_si128(b[0], c);
+    _mm_storeu_si128((__m128i*)out, b[0]);
+    t = _mm_shuffle_epi8(decrypt ? c : b[0], reverse);
+    lo = mid = hi = _mm_setzero_si128();
+    gcm_clmul_acc(_mm_xor_si128(t, acc), hp[0], &lo, &mid, &hi);
+    acc = gcm_reduce(lo, mid, hi);
+    in += 16;
+    out += 16;
+    num_blocks--;
+  }
+  _mm_storeu_si128((__m128i*)x, acc);
+}
+
+// H^1, ..., H^8 byte reversed
+__attribute__((target("pclmul,ssse3")))
+static void gcm_clmul_powers(const byte_t* h_block, uint64_t* h) {
+  __m128i hp = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)h_block),
+                                gcm_reverse_mask());
+  __m128i p = hp;
+  __m128i lo, mid, hi;
+
+  _mm_storeu_si128((__m128i*)h, p);
+  for (int j = 1; j < aes_gcm::NUMHPOWERS; j++) {
+    lo = mid = hi = _mm_setzero_si128();
+    gcm_clmul_acc(p, hp, &lo, &mid, &hi);
+    p = gcm_reduce(lo, mid, hi);
+    _mm_storeu_si128((__m128i*)&h[2 * j], p);
+  }
+}
+
+__attribute__((target("ssse3")))
+static void gcm_clmul_to_bytes(const uint64_t* x, byte_t* out) {
+  __m128i t = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)x),
+                               gcm_reverse_mask());
+  _mm_storeu_si128((__m128i*)out, t);
+}
+#endif
+
+aes_gcm::aes_gcm() {
+  initialized_ = false;
+  use_clmul_ = false;
+  memset(h_, 0, sizeof(h_));
+  memset(x_, 0, sizeof(x_));
+  memset(j0_, 0, sizeof(j0_));
+  counter_ = 0;
+  aad_size_ = 0ULL;
+  text_size_ = 0ULL;
+}
+
+aes_gcm::~aes_gcm() {
+  memset(h_, 0, sizeof(h_));
+  memset(x_, 0, sizeof(x_));
+  initialized_ = false;
+}
+
+static void gcm_encrypt_block(aes_gcm* g, byte_t* in, byte_t* out) {
+#if defined(X64)
+  if (g->use_clmul_) {
+    g->ni_obj_.encrypt_block(in, out);
+    return;
+  }
+#endif
+  g->aes_obj_.encrypt_block(in, out);
+}
+
+static void gcm_ghash(aes_gcm* g, int num_blocks, const byte_t* in) {
+#if defined(X64)
+  if (g->use_clmul_) {
+    gcm_ghash_clmul(g->h_, g->x_, num_blocks, in);
+    return;
+  }
+#endif
+  gcm_ghash_portable(g->h_, g->x_, num_blocks, in);
+}
+
+static void gcm_counter_block(aes_gcm* g, byte_t* out) {
+  uint32_t c = __builtin_bswap32(g->counter_);
+  byte_t block[aes_gcm::BLOCKBYTESIZE];
+
+  memcpy(block, g->j0_, aes_gcm::IVBYTESIZE);
+  memcpy(&block[aes_gcm::IVBYTESIZE], &c, sizeof(uint32_t));
+  gcm_encrypt_block(g, block, out);
+  g->counter_++;
+}
+
+static void gcm_crypt(aes_gcm* g, bool decrypt, int size, byte_t* in,
+                      byte_t* out) {
+  const int bs = aes_gcm::BLOCKBYTESIZE;
+  int num_blocks = size / bs;
+  int left = size - bs * num_blocks;
+  byte_t key_stream[bs];
+  byte_t last[bs];
+
+#if defined(X64)
+  if (g->use_clmul_) {
+    gcm_crypt_clmul(g->ni_obj_.num_rounds_, g->ni_obj_.encrypt_round_key_,
+                    g->h_, decrypt, num_blocks, g->j0_, &g->counter_, g->x_,
+                    in, out);
+  } else
+#endif
+  {
+    for (int i = 0; i < num_blocks; i++) {
+      if (decrypt)
+        gcm_ghash_portable(g->h_, g->x_, 1, &in[bs * i]);
+      gcm_counter_block(g, key_stream);
+      for (int j = 0; j < bs; j++)
+        out[bs * i + j] = in[bs * i + j] ^ key_stream[j];
+      if (!decrypt)
+        gcm_ghash_portable(g->h_, g->x_, 1, &out[bs * i]);
+    }
+  }
+
+  // the hashed ciphertext block is zero padded
+  if (left > 0) {
+    in += bs * num_blocks;
+    out += bs * num_blocks;
+    memset(last, 0, bs);
+    memcpy(last, in, left);
+    if (decrypt)
+      gcm_ghash(g, 1, last);
+    gcm_counter_block(g, key_stream);
+    for (int j = 0; j < left; j++)
+      last[j] ^= key_stream[j];
+    memcpy(out, last, left);
+    if (!decrypt)
+      gcm_ghash(g, 1, last);
+    memset(last, 0, bs);
+  }
+  memset(key_stream, 0, bs);
+  g->text_size_ += (uint64_t)size;
+}
+
+bool aes_gcm::init(int key_bit_size, byte_t* key) {
+  byte_t zero[BLOCKBYTESIZE];
+  byte_t h_block[BLOCKBYTESIZE];
+
+  initialized_ = false;
+  use_clmul_ = aes_gcm_use_clmul;
+#if defined(X64)
+  if (use_clmul_) {
+    if (!ni_obj_.init(key_bit_size, key, aesni::ENCRYPT))
+      return false;
+  } else
+#endif
+  if (!aes_obj_.init(key_bit_size, key, aes::ENCRYPT)) {
+    return false;
+  }
+
+  memset(zero, 0, BLOCKBYTESIZE);
+  gcm_encrypt_block(this, zero, h_block);
+#if defined(X64)
+  if (use_clmul_)
+    gcm_clmul_powers(h_block, h_);
+  else
+#endif
+    gcm_load_be(h_block, h_);
+  memset(h_block, 0, BLOCKBYTESIZE);
+  initialized_ = true;
+  return true;
+}
+
+// J0 = IV || 0^31 || 1; the text starts at counter 2.
+bool aes_gcm::start(int iv_size, byte_t* iv) {
+  if (!initialized_ || iv_size != IVBYTESIZE)
+    return false;
+  memset(j0_, 0, BLOCKBYTESIZE);
+  memcpy(j0_, iv, IVBYTESIZE);
+  j0_[BLOCKBYTESIZE - 1] = 1;
+  counter_ = 2;
+  x_[0] = 0ULL;
+  x_[1] = 0ULL;
+  aad_size_ = 0ULL;
+  text_size_ = 0ULL;
+  return true;
+}
+
+void aes_gcm::add_aad(int size, byte_t* aad) {
+  int num_blocks = size / BLOCKBYTESIZE;
+  int left = size - BLOCKBYTESIZE * num_blocks;
+
+  gcm_ghash(this, num_blocks, aad);
+  if (left > 0) {
+    byte_t last[BLOCKBYTESIZE];
+    memset(last, 0, BLOCKBYTESIZE);
+    memcpy(last, &aad[BLOCKBYTESIZE * num_blocks], left);
+    gcm_ghash(this, 1, last);
+  }
+  aad_size_ += (uint64_t)size;
+}
+
+void aes_gcm::encrypt(int size, byte_t* in, byte_t* out) {
+  gcm_crypt(this, false, size, in, out);
+}
+
+void aes_gcm::decrypt(int size, byte_t* in, byte_t* out) {
+  gcm_crypt(this, true, size, in, out);
+}
+
+// T = E(J0) + GHASH(A, C, len(A) || len(C))
+void aes_gcm::finalize(byte_t* tag) {
+  uint64_t lengths[2];
+  byte_t block[BLOCKBYTESIZE];
+  byte_t s[BLOCKBYTESIZE];
+
+  lengths[0] = aad_size_ * NBITSINBYTE;
+  lengths[1] = text_size_ * NBITSINBYTE;
+  gcm_store_be(lengths, block);
+  gcm_ghash(this, 1, block);
+#if defined(X64)
+  if (use_clmul_)
+    gcm_clmul_to_bytes(x_, s);
+  else
+#endif
+    gcm_store_be(x_, s);
+
+  gcm_encrypt_block(this, j0_, block);
+  for (int i = 0; i < TAGBYTESIZE; i++)
+    tag[i] = block[i] ^ s[i];
+  memset(block, 0, BLOCKBYTESIZE);
+  memset(s, 0, BLOCKBYTESIZE);
+}
+
+bool aes_gcm::verify(byte_t* tag) {
+  byte_t computed[TAGBYTESIZE];
+  byte_t diff = 0;
+
+  finalize(computed);
+  for (int i = 0; i < TAGBYTESIZE; i++)
+    diff |= computed[i] ^ tag[i];
+  memset(computed, 0, TAGBYTESIZE);
+  return diff == 0;
+}
@@ -17,6 +17,7 @@
 #include "crypto_support.h"
 #include "symmetric_cipher.h"
 #include "aes.h"
+#include <immintrin.h>
 
 aesni::aesni() {
   direction_ = NONE;
@@ -401,6 +402,18 @@ bool aesni::init(int key_bit_size, byte_t* key_buf, int directionflag) {
     return false;
   }
   key_ = (byte_t*)secret_.data();
+
+  // a second init must not keep the old schedules
+  if (encrypt_round_key_ != nullptr) {
+    memset(encrypt_round_key_, 0, (4 * (aesni::MAXNR + 1) + 1) * sizeof(uint32_t));
+    delete []encrypt_round_key_;
+    encrypt_round_key_ = nullptr;
+  }
+  if (decrypt_round_key_ != nullptr) {
+    memset(decrypt_round_key_, 0, (4 * (aesni::MAXNR + 1) + 1) * sizeof(uint32_t));
+    delete []decrypt_round_key_;
+    decrypt_round_key_ = nullptr;
+  }
   if (directionflag == DECRYPT || directionflag == BOTH) {
     if (!init_decrypt()) {
       return false;
@@ -416,22 +429,450 @@ bool aesni::init(int key_bit_size, byte_t* key_buf, int directionflag) {
   return initialized_;
 }
 
+// Multi-block kernels
+//   aesenc has a latency of several cycles but a new one can issue every
+//   cycle, so one block at a time leaves the AES unit mostly idle.  These
+//   keep 8 independent blocks in flight, then 4, then 1 for the tail.  With
+//   VAES a zmm register carries 4 blocks and the main loop runs 16 blocks.
+//   ECB, CTR and CBC decryption have no dependence between blocks; CBC
+//   encryption does and stays on encrypt_block.  in may equal out.
+
+bool aesni_use_vaes = have_intel_vaes_avx512();
+
+static const int vaes_lanes = 4;
+static const int vaes_blocks = 16;
+
+// Decryption keys are loaded last to first so both directions run k[0]
+// through k[nr].
+static void aesni_load_keys(int nr, const uint32_t* ks, bool reverse,
+                            __m128i* k) {
+  for (int i = 0; i <= nr; i++)
+    k[reverse ? nr - i : i] = _mm_loadu_si128((const __m128i*)&ks[4 * i]);
+}
+
+__attribute__((target("aes")))
+static inline __attribute__((always_inline)) void aesni_enc_n(int nr,
+      const __m128i* k, int n, __m128i* b) {
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_xor_si128(b[j], k[0]);
+  for (int i = 1; i < nr; i++) {
+    for (int j = 0; j < n; j++)
+      b[j] = _mm_aesenc_si128(b[j], k[i]);
+  }
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_aesenclast_si128(b[j], k[nr]);
+}
+
+__attribute__((target("aes")))
+static inline __attribute__((always_inline)) void aesni_dec_n(int nr,
+      const __m128i* k, int n, __m128i* b) {
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_xor_si128(b[j], k[0]);
+  for (int i = 1; i < nr; i++) {
+    for (int j = 0; j < n; j++)
+      b[j] = _mm_aesdec_si128(b[j], k[i]);
+  }
+  for (int j = 0; j < n; j++)
+    b[j] = _mm_aesdeclast_si128(b[j], k[nr]);
+}
+
+__attribute__((target("aes")))
+static void aesni_ecb(int nr, const uint32_t* ks, bool decrypt, int num_blocks,
+                      const byte_t* in, byte_t* out) {
+  __m128i k[aesni::MAXNR + 1];
+  __m128i b[8];
+  int j;
+
+  aesni_load_keys(nr, ks, decrypt, k);
+  while (num_blocks >= 8) {
+    for (j = 0; j < 8; j++)
+      b[j] = _mm_loadu_si128((const __m128i*)&in[16 * j]);
+    if (decrypt)
+      aesni_dec_n(nr, k, 8, b);
+    else
+      aesni_enc_n(nr, k, 8, b);
+    for (j = 0; j < 8; j++)
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    in += 128;
+    out += 128;
+    num_blocks -= 8;
+  }
+  if (num_blocks >= 4) {
+    for (j = 0; j < 4; j++)
+      b[j] = _mm_loadu_si128((const __m128i*)&in[16 * j]);
+    if (decrypt)
+      aesni_dec_n(nr, k, 4, b);
+    else
+      aesni_enc_n(nr, k, 4, b);
+    for (j = 0; j < 4; j++)
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    in += 64;
+    out += 64;
+    num_blocks -= 4;
+  }
+  while (num_blocks > 0) {
+    b[0] = _mm_loadu_si128((const __m128i*)in);
+    if (decrypt)
+      aesni_dec_n(nr, k, 1, b);
+    else
+      aesni_enc_n(nr, k, 1, b);
+    _mm_storeu_si128((__m128i*)out, b[0]);
+    in += 16;
+    out += 16;
+    num_blocks--;
+  }
+}
+
+// The counter is a 128 bit big endian number, hi:lo.  When lo does not wrap
+// within a group the counter blocks are made with a 64 bit vector add and a
+// byte reversal, otherwise one at a time.
+static inline __m128i aesni_counter_block(uint64_t hi, uint64_t lo) {
+  return _mm_set_epi64x((long long)__builtin_bswap64(lo),
+                        (long long)__builtin_bswap64(hi));
+}
+
+static inline void aesni_counter_next(uint64_t* hi, uint64_t* lo) {
+  if (++(*lo) == 0ULL)
+    (*hi)++;
+}
+
+static inline bool aesni_counter_no_wrap(uint64_t lo, int n) {
+  return lo <= (~0ULL - (uint64_t)n);
+}
+
+__attribute__((target("ssse3")))
+static inline __attribute__((always_inline)) void aesni_counter_blocks(int n,
+      uint64_t* hi, uint64_t* lo, __m128i* b) {
+  if (aesni_counter_no_wrap(*lo, n)) {
+    __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                   13, 14, 15);
+    __m128i base = _mm_set_epi64x((long long)*hi, (long long)*lo);
+    for (int j = 0; j < n; j++)
+      b[j] = _mm_shuffle_epi8(_mm_add_epi64(base, _mm_set_epi64x(0, j)), reverse);
+    *lo += n;
+    return;
+  }
+  for (int j = 0; j < n; j++) {
+    b[j] = aesni_counter_block(*hi, *lo);
+    aesni_counter_next(hi, lo);
+  }
+}
+
+__attribute__((target("aes,ssse3")))
+static void aesni_ctr(int nr, const uint32_t* ks, int num_blocks,
+      uint64_t* hi, uint64_t* lo, const byte_t* in, byte_t* out) {
+  __m128i k[aesni::MAXNR + 1];
+  __m128i b[8];
+  int j;
+
+  aesni_load_keys(nr, ks, false, k);
+  while (num_blocks >= 8) {
+    aesni_counter_blocks(8, hi, lo, b);
+    aesni_enc_n(nr, k, 8, b);
+    for (j = 0; j < 8; j++) {
+      b[j] = _mm_xor_si128(b[j], _mm_loadu_si128((const __m128i*)&in[16 * j]));
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    }
+    in += 128;
+    out += 128;
+    num_blocks -= 8;
+  }
+  if (num_blocks >= 4) {
+    aesni_counter_blocks(4, hi, lo, b);
+    aesni_enc_n(nr, k, 4, b);
+    for (j = 0; j < 4; j++) {
+      b[j] = _mm_xor_si128(b[j], _mm_loadu_si128((const __m128i*)&in[16 * j]));
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    }
+    in += 64;
+    out += 64;
+    num_blocks -= 4;
+  }
+  while (num_blocks > 0) {
+    aesni_counter_blocks(1, hi, lo, b);
+    aesni_enc_n(nr, k, 1, b);
+    b[0] = _mm_xor_si128(b[0], _mm_loadu_si128((const __m128i*)in));
+    _mm_storeu_si128((__m128i*)out, b[0]);
+    in += 16;
+    out += 16;
+    num_blocks--;
+  }
+}
+
+// P[i] = D(C[i]) xor C[i - 1], C[-1] = iv.  All the ciphertext blocks of a
+// group are loaded before any plaintext is stored.
+__attribute__((target("aes")))
+static void aesni_cbc_decrypt(int nr, const uint32_t* ks, int num_blocks,
+      __m128i* iv, const byte_t* in, byte_t* out) {
+  __m128i k[aesni::MAXNR + 1];
+  __m128i b[8];
+  __m128i c[8];
+  __m128i prev = *iv;
+  int j;
+
+  aesni_load_keys(nr, ks, true, k);
+  while (num_blocks >= 8) {
+    for (j = 0; j < 8; j++) {
+      c[j] = _mm_loadu_si128((const __m128i*)&in[16 * j]);
+      b[j] = c[j];
+    }
+    aesni_dec_n(nr, k, 8, b);
+    b[0] = _mm_xor_si128(b[0], prev);
+    for (j = 1; j < 8; j++)
+      b[j] = _mm_xor_si128(b[j], c[j - 1]);
+    prev = c[7];
+    for (j = 0; j < 8; j++)
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    in += 128;
+    out += 128;
+    num_blocks -= 8;
+  }
+  if (num_blocks >= 4) {
+    for (j = 0; j < 4; j++) {
+      c[j] = _mm_loadu_si128((const __m128i*)&in[16 * j]);
+      b[j] = c[j];
+    }
+    aesni_dec_n(nr, k, 4, b);
+    b[0] = _mm_xor_si128(b[0], prev);
+    for (j = 1; j < 4; j++)
+      b[j] = _mm_xor_si128(b[j], c[j - 1]);
+    prev = c[3];
+    for (j = 0; j < 4; j++)
+      _mm_storeu_si128((__m128i*)&out[16 * j], b[j]);
+    in += 64;
+    out += 64;
+    num_blocks -= 4;
+  }
+  while (num_blocks > 0) {
+    c[0] = _mm_loadu_si128((const __m128i*)in);
+    b[0] = c[0];
+    aesni_dec_n(nr, k, 1, b);
+    b[0] = _mm_xor_si128(b[0], prev);
+    prev = c[0];
+    _mm_storeu_si128((__m128i*)out, b[0]);
+    in += 16;
+    out += 16;
+    num_blocks--;
+  }
+  *iv = prev;
+}
+
+// VAES kernels, 16 blocks per iteration.  They return the number of blocks
+// done and leave the rest to the kernels above.  The unmasked broadcast,
+// extract and valignq intrinsics merge into an undefined register that gcc
+// 12 reports as uninitialized, so the kernels use the zero masked forms
+// with every lane on; they compile to the same instructions.
+
+__attribute__((target("avx512f")))
+static inline __m512i vaes_broadcast(__m128i x) {
+  return _mm512_maskz_broadcast_i32x4((__mmask16)0xffff, x);
+}
+
+__attribute__((target("avx512f,vaes")))
+static inline __attribute__((always_inline)) void vaes_enc_n(int nr,
+      const __m512i* k, __m512i* b) {
+  for (int j = 0; j < vaes_lanes; j++)
+    b[j] = _mm512_xor_si512(b[j], k[0]);
+  for (int i = 1; i < nr; i++) {
+    for (int j = 0; j < vaes_lanes; j++)
+      b[j] = _mm512_aesenc_epi128(b[j], k[i]);
+  }
+  for (int j = 0; j < vaes_lanes; j++)
+    b[j] = _mm512_aesenclast_epi128(b[j], k[nr]);
+}
+
+__attribute__((target("avx512f,vaes")))
+static inline __attribute__((always_inline)) void vaes_dec_n(int nr,
+      const __m512i* k, __m512i* b) {
+  for (int j = 0; j < vaes_lanes; j++)
+    b[j] = _mm512_xor_si512(b[j], k[0]);
+  for (int i = 1; i < nr; i++) {
+    for (int j = 0; j < vaes_lanes; j++)
+      b[j] = _mm512_aesdec_epi128(b[j], k[i]);
+  }
+  for (int j = 0; j < vaes_lanes; j++)
+    b[j] = _mm512_aesdeclast_epi128(b[j], k[nr]);
+}
+
+__attribute__((target("avx512f")))
+static void vaes_load_keys(int nr, const uint32_t* ks, bool reverse,
+                           __m512i* k) {
+  __m128i k1[aesni::MAXNR + 1];
+
+  aesni_load_keys(nr, ks, reverse, k1);
+  for (int i = 0; i <= nr; i++)
+    k[i] = vaes_broadcast(k1[i]);
+}
+
+__attribute__((target("avx512f,vaes")))
+static int vaes_ecb(int nr, const uint32_t* ks, bool decrypt, int num_blocks,
+                    const byte_t* in, byte_t* out) {
+  __m512i k[aesni::MAXNR + 1];
+  __m512i b[vaes_lanes];
+  int done = 0;
+  int j;
+
+  vaes_load_keys(nr, ks, decrypt, k);
+  while ((num_blocks - done) >= vaes_blocks) {
+    for (j = 0; j < vaes_lanes; j++)
+      b[j] = _mm512_loadu_si512((const void*)&in[64 * j]);
+    if (decrypt)
+      vaes_dec_n(nr, k, b);
+    else
+      vaes_enc_n(nr, k, b);
+    for (j = 0; j < vaes_lanes; j++)
+      _mm512_storeu_si512((void*)&out[64 * j], b[j]);
+    in += 16 * vaes_blocks;
+    out += 16 * vaes_blocks;
+    done += vaes_blocks;
+  }
+  return done;
+}
+
+__attribute__((target("avx512f,avx512bw,vaes")))
+static int vaes_ctr(int nr, const uint32_t* ks, int num_blocks,
+      uint64_t* hi, uint64_t* lo, const byte_t* in, byte_t* out) {
+  __m512i k[aesni::MAXNR + 1];
+  __m512i b[vaes_lanes];
+  __m128i ctr[vaes_blocks];
+  __m512i reverse = vaes_broadcast(_mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8,
+                                   9, 10, 11, 12, 13, 14, 15));
+  __m512i base;
+  int done = 0;
+  int j;
+
+  vaes_load_keys(nr, ks, false, k);
+  while ((num_blocks - done) >= vaes_blocks) {
+    if (aesni_counter_no_wrap(*lo, vaes_blocks)) {
+      base = vaes_broadcast(_mm_set_epi64x((long long)*hi, (long long)*lo));
+      for (j = 0; j < vaes_lanes; j++) {
+        b[j] = _mm512_add_epi64(base, _mm512_set_epi64(0, 4 * j + 3, 0, 4 * j + 2,
+                                                       0, 4 * j + 1, 0, 4 * j));
+        b[j] = _mm512_shuffle_epi8(b[j], reverse);
+      }
+      *lo += vaes_blocks;
+    } else {
+      for (j = 0; j < vaes_blocks; j++) {
+        ctr[j] = aesni_counter_block(*hi, *lo);
+        aesni_counter_next(hi, lo);
+      }
+      for (j = 0; j < vaes_lanes; j++)
+        b[j] = _mm512_loadu_si512((const void*)&ctr[vaes_lanes * j]);
+    }
+    vaes_enc_n(nr, k, b);
+    for (j = 0; j < vaes_lanes; j++) {
+      b[j] = _mm512_xor_si512(b[j], _mm512_loadu_si512((const void*)&in[64 * j]));
+      _mm512_storeu_si512((void*)&out[64 * j], b[j]);
+    }
+    in += 16 * vaes_blocks;
+    out += 16 * vaes_blocks;
+    done += vaes_blocks;
+  }
+  return done;
+}
+
+// The previous ciphertext for the four blocks of c[j] is the top block of
+// c[j - 1] followed by the low three blocks of c[j]; valignq by 6 quadwords
+// builds it without going back to memory, which in place may already hold
+// plaintext.
+__attribute__((target("avx512f,vaes")))
+static int vaes_cbc_decrypt(int nr, const uint32_t* ks, int num_blocks,
+      __m128i* iv, const byte_t* in, byte_t* out) {
+  __m512i k[aesni::MAXNR + 1];
+  __m512i b[vaes_lanes];
+  __m512i c[vaes_lanes];
+  __m512i prev = vaes_broadcast(*iv);
+  int done = 0;
+  int j;
+
+  if (num_blocks < vaes_blocks)
+    return 0;
+  vaes_load_keys(nr, ks, true, k);
+  while ((num_blocks - done) >= vaes_blocks) {
+    for (j = 0; j < vaes_lanes; j++) {
+      c[j] = _mm512_loadu_si512((const void*)&in[64 * j]);
+      b[j] = c[j];
+    }
+    vaes_dec_n(nr, k, b);
+    b[0] = _mm512_xor_si512(b[0],
+               _mm512_maskz_alignr_epi64((__mmask8)0xff, c[0], prev, 6));
+    for (j = 1; j < vaes_lanes; j++)
+      b[j] = _mm512_xor_si512(b[j],
+                 _mm512_maskz_alignr_epi64((__mmask8)0xff, c[j], c[j - 1], 6));
+    prev = c[vaes_lanes - 1];
+    for (j = 0; j < vaes_lanes; j++)
+      _mm512_storeu_si512((void*)&out[64 * j], b[j]);
+    in += 16 * vaes_blocks;
+    out += 16 * vaes_blocks;
+    done += vaes_blocks;
+  }
+  *iv = _mm512_maskz_extracti32x4_epi32((__mmask8)0xf, prev, 3);
+  return done;
+}
+
 void aesni::encrypt(int in_size, byte_t* in, byte_t* out) {
   // in_size should be a multiple of block size
-  while (in_size > 0) {
-    encrypt_block(in, out);
-    in_size -= BLOCKBYTESIZE;
-    in += BLOCKBYTESIZE;
-    out += BLOCKBYTESIZE;
-  }
+  int num_blocks = in_size / BLOCKBYTESIZE;
+  int done = 0;
+
+  if (aesni_use_vaes)
+    done = vaes_ecb(num_rounds_, encrypt_round_key_, false, num_blocks, in, out);
+  aesni_ecb(num_rounds_, encrypt_round_key_, false, num_blocks - done,
+            &in[BLOCKBYTESIZE * done], &out[BLOCKBYTESIZE * done]);
 }
 
 void aesni::decrypt(int in_size, byte_t* in, byte_t* out) {
   // in_size should be a multiple of block size
-  while (in_size > 0) {
-    decrypt_block(in, out);
-    in_size -= BLOCKBYTESIZE;
-    in += BLOCKBYTESIZE;
-    out += BLOCKBYTESIZE;
+  int num_blocks = in_size / BLOCKBYTESIZE;
+  int done = 0;
+
+  if (aesni_use_vaes)
+    done = vaes_ecb(num_rounds_, decrypt_round_key_, true, num_blocks, in, out);
+  aesni_ecb(num_rounds_, decrypt_round_key_, true, num_blocks - done,
+            &in[BLOCKBYTESIZE * done], &out[BLOCKBYTESIZE * done]);
+}
+
+// counter is a big endian 128 bit number; on return it is the next unused
+// counter.  A final partial block uses the front of one keystream block.
+void aesni::ctr_encrypt(int in_size, byte_t* counter, byte_t* in, byte_t* out) {
+  int num_blocks = in_size / BLOCKBYTESIZE;
+  int done = 0;
+  uint64_t hi, lo;
+
+  memcpy(&hi, counter, sizeof(uint64_t));
+  memcpy(&lo, &counter[sizeof(uint64_t)], sizeof(uint64_t));
+  hi = __builtin_bswap64(hi);
+  lo = __builtin_bswap64(lo);
+  if (aesni_use_vaes)
+    done = vaes_ctr(num_rounds_, encrypt_round_key_, num_blocks, &hi, &lo, in, out);
+  aesni_ctr(num_rounds_, encrypt_round_key_, num_blocks - done, &hi, &lo,
+            &in[BLOCKBYTESIZE * done], &out[BLOCKBYTESIZE * done]);
+
+  int left = in_size - BLOCKBYTESIZE * num_blocks;
+  if (left > 0) {
+    byte_t tmp[BLOCKBYTESIZE];
+    memset(tmp, 0, BLOCKBYTESIZE);
+    memcpy(tmp, &in[BLOCKBYTESIZE * num_blocks], left);
+    aesni_ctr(num_rounds_, encrypt_round_key_, 1, &hi, &lo, tmp, tmp);
+    memcpy(&out[BLOCKBYTESIZE * num_blocks], tmp, left);
+    memset(tmp, 0, BLOCKBYTESIZE);
   }
+  hi = __builtin_bswap64(hi);
+  lo = __builtin_bswap64(lo);
+  memcpy(counter, &hi, sizeof(uint64_t));
+  memcpy(&counter[sizeof(uint64_t)], &lo, sizeof(uint64_t));
+}
+
+// iv is replaced by the last ciphertext block so calls can be chained.
+void aesni::cbc_decrypt(int in_size, byte_t* iv, byte_t* in, byte_t* out) {
+  // in_size should be a multiple of block size
+  int num_blocks = in_size / BLOCKBYTESIZE;
+  int done = 0;
+  __m128i chain = _mm_loadu_si128((const __m128i*)iv);
+
+  if (aesni_use_vaes)
+    done = vaes_cbc_decrypt(num_rounds_, decrypt_round_key_, num_blocks, &chain, in, out);
+  aesni_cbc_decrypt(num_rounds_, decrypt_round_key_, num_blocks - done, &chain,
+                    &in[BLOCKBYTESIZE * done], &out[BLOCKBYTESIZE * done]);
+  _mm_storeu_si128((__m128i*)iv, chain);
 }
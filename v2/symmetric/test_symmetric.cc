@@ -23,6 +23,7 @@
 #include "rc4.h"
 #include "twofish.h"
 #include "simonspeck.h"
+#include "aes_gcm.h"
 
 
 DEFINE_bool(print_all, false, "Print intermediate test computations");
@@ -316,8 +317,372 @@ bool test_aesni_test2() {
   if (memcmp(aes256_test1_plain, test_plain_out, 16) != 0) return false;
   return true;
 }
+
+// NIST SP 800-38A, F.2.2 and F.5.1
+byte_t sp800_38a_key[] = {
+  0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+byte_t sp800_38a_plain[] = {
+  0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+  0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+  0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c,
+  0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+  0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11,
+  0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+  0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17,
+  0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10
+};
+byte_t sp800_38a_cbc_iv[] = {
+  0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+  0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+byte_t sp800_38a_cbc_cipher[] = {
+  0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46,
+  0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+  0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee,
+  0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+  0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b,
+  0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+  0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09,
+  0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7
+};
+byte_t sp800_38a_ctr_counter[] = {
+  0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+  0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff
+};
+byte_t sp800_38a_ctr_cipher[] = {
+  0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+  0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce,
+  0x98, 0x06, 0xf6, 0x6b, 0x79, 0x70, 0xfd, 0xff,
+  0x86, 0x17, 0x18, 0x7b, 0xb9, 0xff, 0xfd, 0xff,
+  0x5a, 0xe4, 0xdf, 0x3e, 0xdb, 0xd5, 0xd3, 0x5e,
+  0x5b, 0x4f, 0x09, 0x02, 0x0d, 0xb0, 0x3e, 0xab,
+  0x1e, 0x03, 0x1d, 0xda, 0x2f, 0xbe, 0x03, 0xd1,
+  0x79, 0x21, 0x70, 0xa0, 0xf3, 0x00, 0x9c, 0xee
+};
+
+bool test_aesni_modes() {
+  aesni aes_obj;
+  byte_t out[64];
+  byte_t chain[16];
+
+  if (!aes_obj.init(128, sp800_38a_key, aes::BOTH))
+    return false;
+
+  memcpy(chain, sp800_38a_ctr_counter, 16);
+  aes_obj.ctr_encrypt(64, chain, sp800_38a_plain, out);
+  if (FLAGS_print_all) {
+    printf("  ctr cipher     : ");
+    print_bytes(64, out);
+  }
+  if (memcmp(out, sp800_38a_ctr_cipher, 64) != 0)
+    return false;
+  // ...feff + 4 carries into the next byte
+  if (chain[13] != 0xfd || chain[14] != 0xff || chain[15] != 0x03)
+    return false;
+
+  memcpy(chain, sp800_38a_cbc_iv, 16);
+  aes_obj.cbc_decrypt(64, chain, sp800_38a_cbc_cipher, out);
+  if (FLAGS_print_all) {
+    printf("  cbc plain      : ");
+    print_bytes(64, out);
+  }
+  if (memcmp(out, sp800_38a_plain, 64) != 0)
+    return false;
+  if (memcmp(chain, &sp800_38a_cbc_cipher[48], 16) != 0)
+    return false;
+  return true;
+}
+
+// The multi-block kernels against encrypt_block and decrypt_block, for
+// every tail length, in place and not, and with the counter carrying out of
+// its low 64 bits.
+bool test_aesni_multi_block(int key_bit_size) {
+  const int max_blocks = 41;
+  const int max_bytes = 16 * max_blocks;
+  aesni aes_obj;
+  byte_t key[32];
+  byte_t iv[16];
+  byte_t in[max_bytes];
+  byte_t out[max_bytes];
+  byte_t check[max_bytes];
+  byte_t chain[16];
+  byte_t counter[16];
+  byte_t tmp[16];
+
+  if (crypto_get_random_bytes(32, key) < 32)
+    return false;
+  if (crypto_get_random_bytes(16, iv) < 16)
+    return false;
+  if (crypto_get_random_bytes(max_bytes, in) < max_bytes)
+    return false;
+  if (!aes_obj.init(key_bit_size, key, aes::BOTH))
+    return false;
+
+  for (int n = 1; n <= max_blocks; n++) {
+    int size = 16 * n;
+
+    // ecb
+    for (int i = 0; i < n; i++)
+      aes_obj.encrypt_block(&in[16 * i], &check[16 * i]);
+    aes_obj.encrypt(size, in, out);
+    if (memcmp(out, check, size) != 0)
+      return false;
+    aes_obj.decrypt(size, out, out);
+    if (memcmp(out, in, size) != 0)
+      return false;
+
+    // cbc decrypt, reference is a cbc encryption of in
+    memcpy(chain, iv, 16);
+    for (int i = 0; i < n; i++) {
+      for (int j = 0; j < 16; j++)
+        tmp[j] = in[16 * i + j] ^ chain[j];
+      aes_obj.encrypt_block(tmp, &check[16 * i]);
+      memcpy(chain, &check[16 * i], 16);
+    }
+    memcpy(chain, iv, 16);
+    aes_obj.cbc_decrypt(size, chain, check, out);
+    if (memcmp(out, in, size) != 0)
+      return false;
+    if (memcmp(chain, &check[size - 16], 16) != 0)
+      return false;
+    memcpy(chain, iv, 16);
+    memcpy(out, check, size);
+    aes_obj.cbc_decrypt(size, chain, out, out);
+    if (memcmp(out, in, size) != 0)
+      return false;
+
+    // ctr, with a partial final block
+    for (int partial = 0; partial < 16; partial += 5) {
+      int ctr_size = size - partial;
+      memcpy(counter, iv, 16);
+      memset(&counter[8], 0xff, 7);
+      counter[15] = 0xf0;
+      memcpy(chain, counter, 16);
+      for (int i = 0; i < n; i++) {
+        aes_obj.encrypt_block(chain, tmp);
+        for (int j = 0; j < 16; j++)
+          check[16 * i + j] = in[16 * i + j] ^ tmp[j];
+        for (int j = 15; j >= 0; j--) {
+          if (++chain[j] != 0)
+            break;
+        }
+      }
+      aes_obj.ctr_encrypt(ctr_size, counter, in, out);
+      if (memcmp(out, check, ctr_size) != 0)
+        return false;
+      if (memcmp(counter, chain, 16) != 0)
+        return false;
+    }
+  }
+  return true;
+}
+
+bool test_aesni_kernels() {
+  bool use_vaes = aesni_use_vaes;
+  bool ret_value = true;
+
+  // both kernel sets, where the machine has VAES
+  for (int v = 0; v <= (use_vaes ? 1 : 0); v++) {
+    aesni_use_vaes = (v == 1);
+    if (!test_aesni_modes() || !test_aesni_multi_block(128) ||
+        !test_aesni_multi_block(256)) {
+      printf("aesni kernels failed, vaes: %d\n", v);
+      ret_value = false;
+      break;
+    }
+  }
+  aesni_use_vaes = use_vaes;
+  return ret_value;
+}
 #endif
 
+// SP 800-38D test cases 2, 3, 4 and 16 from the GCM submission
+struct gcm_test_vector {
+  int key_bit_size;
+  const char* key;
+  const char* iv;
+  const char* aad;
+  const char* plain;
+  const char* cipher;
+  const char* tag;
+};
+
+gcm_test_vector gcm_test_vectors[] = {
+  { 128, "00000000000000000000000000000000", "000000000000000000000000", "",
+    "00000000000000000000000000000000",
+    "0388dace60b6a392f328c2b971b2fe78",
+    "ab6e47d42cec13bdf53a67b21257bddf" },
+  { 128, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888", "",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+    "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b391aafd255",
+    "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+    "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091473f5985",
+    "4d5c2af327cd64a62cf35abd2ba6fab4" },
+  { 128, "feffe9928665731c6d6a8f9467308308", "cafebabefacedbaddecaf888",
+    "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+    "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e"
+    "21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091",
+    "5bc94fbc3221a5db94fae95ae7121a47" },
+  { 256, "feffe9928665731c6d6a8f9467308308feffe9928665731c6d6a8f9467308308",
+    "cafebabefacedbaddecaf888",
+    "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+    "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a72"
+    "1c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39",
+    "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd2555d1aa"
+    "8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0abcc9f662",
+    "76fc6ece0f4e1768cddf8853bb2d551b" },
+};
+
+bool test_aes_gcm_vectors() {
+  int n = sizeof(gcm_test_vectors) / sizeof(gcm_test_vector);
+
+  for (int i = 0; i < n; i++) {
+    gcm_test_vector* v = &gcm_test_vectors[i];
+    string h, key, iv, aad, plain, cipher, tag;
+    aes_gcm gcm;
+    byte_t out[64];
+    byte_t computed_tag[aes_gcm::TAGBYTESIZE];
+
+    h.assign(v->key);
+    hex_to_bytes(h, &key);
+    h.assign(v->iv);
+    hex_to_bytes(h, &iv);
+    h.assign(v->aad);
+    hex_to_bytes(h, &aad);
+    h.assign(v->plain);
+    hex_to_bytes(h, &plain);
+    h.assign(v->cipher);
+    hex_to_bytes(h, &cipher);
+    h.assign(v->tag);
+    hex_to_bytes(h, &tag);
+
+    if (!gcm.init(v->key_bit_size, (byte_t*)key.data()))
+      return false;
+    if (!gcm.start(iv.size(), (byte_t*)iv.data()))
+      return false;
+    gcm.add_aad(aad.size(), (byte_t*)aad.data());
+    gcm.encrypt(plain.size(), (byte_t*)plain.data(), out);
+    gcm.finalize(computed_tag);
+    if (FLAGS_print_all) {
+      printf("  gcm test %d tag : ", i);
+      print_bytes(aes_gcm::TAGBYTESIZE, computed_tag);
+    }
+    if (memcmp(out, cipher.data(), cipher.size()) != 0 ||
+        memcmp(computed_tag, tag.data(), aes_gcm::TAGBYTESIZE) != 0) {
+      printf("gcm test %d encrypt failed\n", i);
+      return false;
+    }
+
+    if (!gcm.start(iv.size(), (byte_t*)iv.data()))
+      return false;
+    gcm.add_aad(aad.size(), (byte_t*)aad.data());
+    gcm.decrypt(cipher.size(), (byte_t*)cipher.data(), out);
+    if (memcmp(out, plain.data(), plain.size()) != 0 ||
+        !gcm.verify((byte_t*)tag.data())) {
+      printf("gcm test %d decrypt failed\n", i);
+      return false;
+    }
+
+    // a flipped tag bit must fail
+    tag[5] ^= 0x10;
+    if (!gcm.start(iv.size(), (byte_t*)iv.data()))
+      return false;
+    gcm.add_aad(aad.size(), (byte_t*)aad.data());
+    gcm.decrypt(cipher.size(), (byte_t*)cipher.data(), out);
+    if (gcm.verify((byte_t*)tag.data()))
+      return false;
+  }
+  return true;
+}
+
+// The clmul kernels against the portable code at every length around the
+// 8 block groups, fed in 16 byte multiple pieces.
+bool test_aes_gcm_streaming(int key_bit_size) {
+  const int max_bytes = 16 * 19 + 15;
+  aes_gcm fast;
+  aes_gcm slow;
+  byte_t key[32];
+  byte_t iv[aes_gcm::IVBYTESIZE];
+  byte_t aad[40];
+  byte_t in[max_bytes];
+  byte_t out_fast[max_bytes];
+  byte_t out_slow[max_bytes];
+  byte_t back[max_bytes];
+  byte_t tag_fast[aes_gcm::TAGBYTESIZE];
+  byte_t tag_slow[aes_gcm::TAGBYTESIZE];
+  bool use_clmul = aes_gcm_use_clmul;
+
+  if (crypto_get_random_bytes(32, key) < 32)
+    return false;
+  if (crypto_get_random_bytes(aes_gcm::IVBYTESIZE, iv) < aes_gcm::IVBYTESIZE)
+    return false;
+  if (crypto_get_random_bytes(40, aad) < 40)
+    return false;
+  if (crypto_get_random_bytes(max_bytes, in) < max_bytes)
+    return false;
+
+  if (!fast.init(key_bit_size, key))
+    return false;
+  aes_gcm_use_clmul = false;
+  bool ok = slow.init(key_bit_size, key);
+  aes_gcm_use_clmul = use_clmul;
+  if (!ok)
+    return false;
+
+  for (int size = 0; size <= max_bytes; size++) {
+    int first = 16 * ((size / 3) / 16);
+
+    fast.start(aes_gcm::IVBYTESIZE, iv);
+    fast.add_aad(32, aad);
+    fast.add_aad(size % 9, &aad[32]);
+    fast.encrypt(first, in, out_fast);
+    fast.encrypt(size - first, &in[first], &out_fast[first]);
+    fast.finalize(tag_fast);
+
+    slow.start(aes_gcm::IVBYTESIZE, iv);
+    slow.add_aad(32 + size % 9, aad);
+    slow.encrypt(size, in, out_slow);
+    slow.finalize(tag_slow);
+
+    if (memcmp(out_fast, out_slow, size) != 0 ||
+        memcmp(tag_fast, tag_slow, aes_gcm::TAGBYTESIZE) != 0) {
+      printf("gcm streaming failed at %d\n", size);
+      return false;
+    }
+
+    slow.start(aes_gcm::IVBYTESIZE, iv);
+    slow.add_aad(32 + size % 9, aad);
+    slow.decrypt(first, out_fast, back);
+    slow.decrypt(size - first, &out_fast[first], &back[first]);
+    if (memcmp(back, in, size) != 0 || !slow.verify(tag_fast))
+      return false;
+  }
+  return true;
+}
+
+bool test_aes_gcm() {
+  bool use_clmul = aes_gcm_use_clmul;
+  bool ret_value = true;
+
+  // both paths, where the machine has PCLMULQDQ
+  for (int c = 0; c <= (use_clmul ? 1 : 0); c++) {
+    aes_gcm_use_clmul = (c == 1);
+    if (!test_aes_gcm_vectors()) {
+      printf("aes gcm failed, clmul: %d\n", c);
+      ret_value = false;
+      break;
+    }
+  }
+  aes_gcm_use_clmul = use_clmul;
+  if (!ret_value)
+    return false;
+  return test_aes_gcm_streaming(128) && test_aes_gcm_streaming(256);
+}
+
 
 TEST (aes, test_aes_test1) {
   EXPECT_TRUE(test_aes_test1());
@@ -344,7 +709,13 @@ TEST (aesni, test_aesni_test1) {
 TEST (aesni, test_aesni_test2) {
   EXPECT_TRUE(test_aesni_test2());
 }
+TEST (aesni, test_aesni_kernels) {
+  EXPECT_TRUE(test_aesni_kernels());
+}
 #endif
+TEST (aes_gcm, test_aes_gcm) {
+  EXPECT_TRUE(test_aes_gcm());
+}
 
 
 int main(int an, char** av) {
@@ -352,8 +723,14 @@ int main(int an, char** av) {
   an = 1;
   ::testing::InitGoogleTest(&an, av);
 
+  if (!init_crypto()) {
+    printf("Can't init_crypto\n");
+    return 1;
+  }
+
   int result = RUN_ALL_TESTS();
 
+  close_crypto();
   printf("\n");
   return result;
 }
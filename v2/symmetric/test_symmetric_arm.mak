@@ -45,7 +45,7 @@ AR=ar
 LDFLAGS= -lprotobuf -lgtest -lgflags -lpthread
 
 dobj=   $(O)/test_symmetric.o $(O)/support.pb.o $(O)/crypto_support.o $(O)/crypto_names.o \
-	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/tea.o $(O)/rc4.o $(O)/twofish.o \
+	$(O)/symmetric_cipher.o $(O)/aes.o $(O)/aes_gcm.o $(O)/tea.o $(O)/rc4.o $(O)/twofish.o \
 	$(O)/simonspeck.o
 
 all:    test_symmetric.exe
@@ -86,6 +86,10 @@ $(O)/aes.o: $(S)/aes.cc
 	@echo "compiling aes.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes.o $(S)/aes.cc
 
+$(O)/aes_gcm.o: $(S)/aes_gcm.cc
+	@echo "compiling aes_gcm.cc"
+	$(CC) $(CFLAGS) -c $(I) -o $(O)/aes_gcm.o $(S)/aes_gcm.cc
+
 $(O)/tea.o: $(S)/tea.cc
 	@echo "compiling tea.cc"
 	$(CC) $(CFLAGS) -c $(I) -o $(O)/tea.o $(S)/tea.cc